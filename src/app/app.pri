@@ -18,12 +18,14 @@ HEADERS += \
     $$PWD/application.h \
     $$PWD/cmdoptions.h \
     $$PWD/filelogger.h \
+    $$PWD/filelogwriter.h \
     $$PWD/upgrade.h
 
 SOURCES += \
     $$PWD/application.cpp \
     $$PWD/cmdoptions.cpp \
     $$PWD/filelogger.cpp \
+    $$PWD/filelogwriter.cpp \
     $$PWD/main.cpp \
     $$PWD/upgrade.cpp
 
@@ -28,145 +28,60 @@
 
 #include "filelogger.h"
 
-#include <QDateTime>
-#include <QDir>
-#include <QTextStream>
+#include <QThread>
 
-#include "base/global.h"
 #include "base/logger.h"
-#include "base/utils/fs.h"
+#include "filelogwriter.h"
 
 FileLogger::FileLogger(const QString &path, const bool backup, const int maxSize, const bool deleteOld, const int age, const FileLogAgeType ageType)
-    : m_backup(backup)
-    , m_maxSize(maxSize)
+    : m_writerThread(new QThread(this))
+    , m_writer(new FileLogWriter(backup, maxSize))
 {
-    m_flusher.setInterval(0);
-    m_flusher.setSingleShot(true);
-    connect(&m_flusher, &QTimer::timeout, this, &FileLogger::flushLog);
-
-    changePath(path);
+    m_writer->changePath(path);
     if (deleteOld)
-        this->deleteOld(age, ageType);
+        m_writer->deleteOld(age, ageType);
 
     const Logger *const logger = Logger::instance();
-    for (const Log::Msg &msg : asConst(logger->getMessages()))
-        addLogMessage(msg);
+    m_writer->writeMessages(logger->getMessages());
+
+    m_writer->moveToThread(m_writerThread);
+    connect(m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_writerThread->start();
 
-    connect(logger, &Logger::newLogMessage, this, &FileLogger::addLogMessage);
+    // Messages are queued for the writer straight from the thread that logs them
+    connect(logger, &Logger::newLogMessage, this, &FileLogger::addLogMessage, Qt::DirectConnection);
 }
 
 FileLogger::~FileLogger()
 {
-    closeLogFile();
+    disconnect(Logger::instance(), nullptr, this, nullptr);
+
+    QMetaObject::invokeMethod(m_writer, "close", Qt::BlockingQueuedConnection);
+    m_writerThread->quit();
+    m_writerThread->wait();
 }
 
 void FileLogger::changePath(const QString &newPath)
 {
-    const QDir dir(newPath);
-    dir.mkpath(newPath);
-    const QString tmpPath = dir.absoluteFilePath("qbittorrent.log");
-
-    if (tmpPath != m_path) {
-        m_path = tmpPath;
-
-        closeLogFile();
-        m_logFile.setFileName(m_path);
-        openLogFile();
-    }
+    QMetaObject::invokeMethod(m_writer, "changePath", Qt::QueuedConnection, Q_ARG(QString, newPath));
 }
 
 void FileLogger::deleteOld(const int age, const FileLogAgeType ageType)
 {
-    const QDateTime date = QDateTime::currentDateTime();
-    const QDir dir(Utils::Fs::branchPath(m_path));
-    const QFileInfoList fileList = dir.entryInfoList(QStringList("qbittorrent.log.bak*")
-        , (QDir::Files | QDir::Writable), (QDir::Time | QDir::Reversed));
-
-    for (const QFileInfo &file : fileList) {
-        QDateTime modificationDate = file.lastModified();
-        switch (ageType) {
-        case DAYS:
-            modificationDate = modificationDate.addDays(age);
-            break;
-        case MONTHS:
-            modificationDate = modificationDate.addMonths(age);
-            break;
-        default:
-            modificationDate = modificationDate.addYears(age);
-        }
-        if (modificationDate > date)
-            break;
-        Utils::Fs::forceRemove(file.absoluteFilePath());
-    }
+    QMetaObject::invokeMethod(m_writer, "deleteOld", Qt::QueuedConnection, Q_ARG(int, age), Q_ARG(int, ageType));
 }
 
 void FileLogger::setBackup(const bool value)
 {
-    m_backup = value;
+    QMetaObject::invokeMethod(m_writer, "setBackup", Qt::QueuedConnection, Q_ARG(bool, value));
 }
 
 void FileLogger::setMaxSize(const int value)
 {
-    m_maxSize = value;
+    QMetaObject::invokeMethod(m_writer, "setMaxSize", Qt::QueuedConnection, Q_ARG(int, value));
 }
 
 void FileLogger::addLogMessage(const Log::Msg &msg)
 {
-    if (!m_logFile.isOpen()) return;
-
-    QTextStream str(&m_logFile);
-
-    switch (msg.type) {
-    case Log::INFO:
-        str << "(I) ";
-        break;
-    case Log::WARNING:
-        str << "(W) ";
-        break;
-    case Log::CRITICAL:
-        str << "(C) ";
-        break;
-    default:
-        str << "(N) ";
-    }
-
-    str << QDateTime::fromMSecsSinceEpoch(msg.timestamp).toString(Qt::ISODate) << " - " << msg.message << endl;
-
-    if (m_backup && (m_logFile.size() >= m_maxSize)) {
-        closeLogFile();
-        int counter = 0;
-        QString backupLogFilename = m_path + ".bak";
-
-        while (QFile::exists(backupLogFilename)) {
-            ++counter;
-            backupLogFilename = m_path + ".bak" + QString::number(counter);
-        }
-
-        QFile::rename(m_path, backupLogFilename);
-        openLogFile();
-    }
-    else {
-        m_flusher.start();
-    }
-}
-
-void FileLogger::flushLog()
-{
-    if (m_logFile.isOpen())
-        m_logFile.flush();
-}
-
-void FileLogger::openLogFile()
-{
-    if (!m_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)
-        || !m_logFile.setPermissions(QFile::ReadOwner | QFile::WriteOwner)) {
-        m_logFile.close();
-        LogMsg(tr("An error occurred while trying to open the log file. Logging to file is disabled."), Log::CRITICAL);
-    }
-}
-
-void FileLogger::closeLogFile()
-{
-    m_flusher.stop();
-    m_logFile.close();
+    m_writer->enqueue(msg);
 }
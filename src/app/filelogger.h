@@ -29,15 +29,17 @@
 #ifndef FILELOGGER_H
 #define FILELOGGER_H
 
-#include <QFile>
 #include <QObject>
-#include <QTimer>
+
+class QThread;
+class FileLogWriter;
 
 namespace Log
 {
     struct Msg;
 }
 
+// Writes the log messages to file, the writing itself happens in a dedicated thread
 class FileLogger : public QObject
 {
     Q_OBJECT
@@ -61,17 +63,10 @@ public:
 
 private slots:
     void addLogMessage(const Log::Msg &msg);
-    void flushLog();
 
 private:
-    void openLogFile();
-    void closeLogFile();
-
-    QString m_path;
-    bool m_backup;
-    int m_maxSize;
-    QFile m_logFile;
-    QTimer m_flusher;
+    QThread *m_writerThread;
+    FileLogWriter *m_writer;
 };
 
 #endif // FILELOGGER_H
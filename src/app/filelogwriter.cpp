@@ -0,0 +1,328 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "filelogwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QTimer>
+
+#include "base/utils/fs.h"
+#include "base/utils/gzip.h"
+#include "filelogger.h"
+
+namespace
+{
+    // must be a power of 2
+    const size_t QUEUE_CAPACITY = 8192;
+    // the queued messages are written at once when there are this many of them...
+    const size_t FLUSH_BATCH_SIZE = 512;
+    // ...or after this delay since the first of them was queued
+    const int FLUSH_DELAY = 500; // ms
+
+    void compressBackup(const QString &path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        bool ok = false;
+        const QByteArray compressed = Utils::Gzip::compress(file.readAll(), 6, &ok);
+        file.close();
+        if (!ok)
+            return;
+
+        const QString compressedPath = path + ".gz";
+        QSaveFile compressedFile(compressedPath);
+        if (!compressedFile.open(QIODevice::WriteOnly)
+            || (compressedFile.write(compressed) != compressed.size())
+            || !compressedFile.commit())
+            return;
+
+        QFile::setPermissions(compressedPath, (QFile::ReadOwner | QFile::WriteOwner));
+        Utils::Fs::forceRemove(path);
+    }
+}
+
+FileLogWriter::FileLogWriter(const bool backup, const int maxSize, QObject *parent)
+    : QObject(parent)
+    , m_cells(new Cell[QUEUE_CAPACITY])
+    , m_backup(backup)
+    , m_maxSize(maxSize)
+    , m_stream(&m_logFile)
+    , m_flushTimer(new QTimer(this))
+{
+    for (size_t i = 0; i < QUEUE_CAPACITY; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    m_flushTimer->setInterval(FLUSH_DELAY);
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, &QTimer::timeout, this, &FileLogWriter::drain);
+}
+
+FileLogWriter::~FileLogWriter()
+{
+    close();
+}
+
+void FileLogWriter::enqueue(const Log::Msg &msg)
+{
+    if (!tryPush(msg)) {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (pendingCount() >= FLUSH_BATCH_SIZE) {
+        if (!m_drainRequested.exchange(true))
+            QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    }
+    else if (!m_flushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, "scheduleFlush", Qt::QueuedConnection);
+    }
+}
+
+void FileLogWriter::writeMessages(const QVector<Log::Msg> &messages)
+{
+    if (!m_logFile.isOpen()) return;
+
+    for (const Log::Msg &msg : messages)
+        writeMessage(msg);
+    flushLog();
+}
+
+void FileLogWriter::changePath(const QString &newPath)
+{
+    const QDir dir(newPath);
+    dir.mkpath(newPath);
+    const QString tmpPath = dir.absoluteFilePath("qbittorrent.log");
+
+    if (tmpPath != m_path) {
+        // the pending messages still belong to the previous file
+        drain();
+
+        m_path = tmpPath;
+
+        closeLogFile();
+        m_logFile.setFileName(m_path);
+        openLogFile();
+    }
+}
+
+void FileLogWriter::deleteOld(const int age, const int ageType)
+{
+    const QDateTime date = QDateTime::currentDateTime();
+    const QDir dir(Utils::Fs::branchPath(m_path));
+    const QFileInfoList fileList = dir.entryInfoList(QStringList("qbittorrent.log.bak*")
+        , (QDir::Files | QDir::Writable), (QDir::Time | QDir::Reversed));
+
+    for (const QFileInfo &file : fileList) {
+        QDateTime modificationDate = file.lastModified();
+        switch (ageType) {
+        case FileLogger::DAYS:
+            modificationDate = modificationDate.addDays(age);
+            break;
+        case FileLogger::MONTHS:
+            modificationDate = modificationDate.addMonths(age);
+            break;
+        default:
+            modificationDate = modificationDate.addYears(age);
+        }
+        if (modificationDate > date)
+            break;
+        Utils::Fs::forceRemove(file.absoluteFilePath());
+    }
+}
+
+void FileLogWriter::setBackup(const bool value)
+{
+    m_backup = value;
+}
+
+void FileLogWriter::setMaxSize(const int value)
+{
+    m_maxSize = value;
+}
+
+void FileLogWriter::close()
+{
+    drain();
+    closeLogFile();
+}
+
+void FileLogWriter::scheduleFlush()
+{
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void FileLogWriter::drain()
+{
+    // Reset first so the messages queued from now on schedule another flush
+    m_drainRequested = false;
+    m_flushScheduled = false;
+    m_flushTimer->stop();
+
+    Log::Msg msg;
+    bool hasMessages = false;
+    while (tryPop(msg)) {
+        hasMessages = true;
+        if (m_logFile.isOpen())
+            writeMessage(msg);
+    }
+
+    if (!m_logFile.isOpen()) return;
+
+    writeDroppedCount();
+    if (!hasMessages) return;
+
+    flushLog();
+}
+
+bool FileLogWriter::tryPush(const Log::Msg &msg)
+{
+    // Bounded multi-producer queue, see http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell &cell = m_cells[pos & (QUEUE_CAPACITY - 1)];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, (pos + 1), std::memory_order_relaxed)) {
+                cell.msg = msg;
+                cell.sequence.store((pos + 1), std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            // queue is full
+            return false;
+        }
+        else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool FileLogWriter::tryPop(Log::Msg &msg)
+{
+    // Only the writer thread dequeues
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    Cell &cell = m_cells[pos & (QUEUE_CAPACITY - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != (pos + 1))
+        return false;
+
+    msg = std::move(cell.msg);
+    cell.msg.message.clear();
+    cell.sequence.store((pos + QUEUE_CAPACITY), std::memory_order_release);
+    m_dequeuePos.store((pos + 1), std::memory_order_relaxed);
+    return true;
+}
+
+size_t FileLogWriter::pendingCount() const
+{
+    return (m_enqueuePos.load(std::memory_order_relaxed) - m_dequeuePos.load(std::memory_order_relaxed));
+}
+
+void FileLogWriter::writeMessage(const Log::Msg &msg)
+{
+    switch (msg.type) {
+    case Log::INFO:
+        m_stream << "(I) ";
+        break;
+    case Log::WARNING:
+        m_stream << "(W) ";
+        break;
+    case Log::CRITICAL:
+        m_stream << "(C) ";
+        break;
+    default:
+        m_stream << "(N) ";
+    }
+
+    // The timestamps have a resolution of one second in the log file
+    const qint64 second = msg.timestamp / 1000;
+    if (second != m_cachedSecond) {
+        m_cachedSecond = second;
+        m_cachedTimeString = QDateTime::fromMSecsSinceEpoch(msg.timestamp).toString(Qt::ISODate);
+    }
+
+    m_stream << m_cachedTimeString << " - " << msg.message << '\n';
+}
+
+void FileLogWriter::writeDroppedCount()
+{
+    const int droppedCount = m_droppedCount.exchange(0, std::memory_order_relaxed);
+    if (droppedCount == 0) return;
+
+    writeMessage({-1, QDateTime::currentMSecsSinceEpoch(), Log::WARNING
+                  , FileLogger::tr("%1 log messages were not written to the log file because it couldn't keep up.")
+                      .arg(droppedCount)});
+    flushLog();
+}
+
+void FileLogWriter::flushLog()
+{
+    m_stream.flush();
+
+    if (m_backup && (m_logFile.size() >= m_maxSize))
+        rotateLogFile();
+}
+
+void FileLogWriter::rotateLogFile()
+{
+    closeLogFile();
+    int counter = 0;
+    QString backupLogFilename = m_path + ".bak";
+
+    while (QFile::exists(backupLogFilename) || QFile::exists(backupLogFilename + ".gz")) {
+        ++counter;
+        backupLogFilename = m_path + ".bak" + QString::number(counter);
+    }
+
+    QFile::rename(m_path, backupLogFilename);
+    openLogFile();
+    compressBackup(backupLogFilename);
+}
+
+void FileLogWriter::openLogFile()
+{
+    if (!m_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)
+        || !m_logFile.setPermissions(QFile::ReadOwner | QFile::WriteOwner)) {
+        m_logFile.close();
+        LogMsg(FileLogger::tr("An error occurred while trying to open the log file. Logging to file is disabled."), Log::CRITICAL);
+    }
+}
+
+void FileLogWriter::closeLogFile()
+{
+    m_flushTimer->stop();
+    m_stream.flush();
+    m_logFile.close();
+}
@@ -0,0 +1,110 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#ifndef FILELOGWRITER_H
+#define FILELOGWRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <QFile>
+#include <QObject>
+#include <QTextStream>
+#include <QVector>
+
+#include "base/logger.h"
+
+class QTimer;
+
+// Writes the log messages to file from its own thread.
+// Messages are passed through a bounded lock-free queue and written in batches,
+// when the queue is full new messages are dropped and counted.
+class FileLogWriter final : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FileLogWriter)
+
+public:
+    FileLogWriter(bool backup, int maxSize, QObject *parent = nullptr);
+    ~FileLogWriter() override;
+
+    // Thread safe
+    void enqueue(const Log::Msg &msg);
+
+    // Not thread safe, to be used before the writer is moved to its thread
+    void writeMessages(const QVector<Log::Msg> &messages);
+
+public slots:
+    void changePath(const QString &newPath);
+    void deleteOld(int age, int ageType);
+    void setBackup(bool value);
+    void setMaxSize(int value);
+    void close();
+
+private slots:
+    void scheduleFlush();
+    void drain();
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Log::Msg msg;
+    };
+
+    bool tryPush(const Log::Msg &msg);
+    bool tryPop(Log::Msg &msg);
+    size_t pendingCount() const;
+
+    void writeMessage(const Log::Msg &msg);
+    void writeDroppedCount();
+    void flushLog();
+    void rotateLogFile();
+    void openLogFile();
+    void closeLogFile();
+
+    std::unique_ptr<Cell[]> m_cells;
+    std::atomic<size_t> m_enqueuePos {0};
+    std::atomic<size_t> m_dequeuePos {0};
+    std::atomic<int> m_droppedCount {0};
+    std::atomic<bool> m_flushScheduled {false};
+    std::atomic<bool> m_drainRequested {false};
+
+    QString m_path;
+    bool m_backup;
+    int m_maxSize;
+    QFile m_logFile;
+    QTextStream m_stream;
+    QTimer *m_flushTimer;
+    qint64 m_cachedSecond = -1;
+    QString m_cachedTimeString;
+};
+
+#endif // FILELOGWRITER_H
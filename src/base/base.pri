@@ -7,10 +7,14 @@ HEADERS += \
     $$PWD/bittorrent/infohash.h \
     $$PWD/bittorrent/magneturi.h \
     $$PWD/bittorrent/peerinfo.h \
+    $$PWD/bittorrent/peerlist.h \
+    $$PWD/bittorrent/private/asyncsnapshot.h \
     $$PWD/bittorrent/private/bandwidthscheduler.h \
+    $$PWD/bittorrent/private/directoryresumedatastorage.h \
     $$PWD/bittorrent/private/filterparserthread.h \
+    $$PWD/bittorrent/private/journalresumedatastorage.h \
     $$PWD/bittorrent/private/portforwarderimpl.h \
-    $$PWD/bittorrent/private/resumedatasavingmanager.h \
+    $$PWD/bittorrent/private/resumedatastorage.h \
     $$PWD/bittorrent/private/speedmonitor.h \
     $$PWD/bittorrent/private/statistics.h \
     $$PWD/bittorrent/session.h \
@@ -24,11 +28,13 @@ HEADERS += \
     $$PWD/filesystemwatcher.h \
     $$PWD/global.h \
     $$PWD/http/connection.h \
+    $$PWD/http/connectionworker.h \
     $$PWD/http/httperror.h \
     $$PWD/http/irequesthandler.h \
     $$PWD/http/requestparser.h \
     $$PWD/http/responsebuilder.h \
     $$PWD/http/responsegenerator.h \
+    $$PWD/http/responsestream.h \
     $$PWD/http/server.h \
     $$PWD/http/types.h \
     $$PWD/iconprovider.h \
@@ -57,6 +63,8 @@ HEADERS += \
     $$PWD/search/searchhandler.h \
     $$PWD/search/searchdownloadhandler.h \
     $$PWD/search/searchpluginmanager.h \
+    $$PWD/search/searchresultfilter.h \
+    $$PWD/search/searchresultindex.h \
     $$PWD/settingsstorage.h \
     $$PWD/settingvalue.h \
     $$PWD/torrentfileguard.h \
@@ -81,10 +89,12 @@ SOURCES += \
     $$PWD/bittorrent/infohash.cpp \
     $$PWD/bittorrent/magneturi.cpp \
     $$PWD/bittorrent/peerinfo.cpp \
+    $$PWD/bittorrent/peerlist.cpp \
     $$PWD/bittorrent/private/bandwidthscheduler.cpp \
+    $$PWD/bittorrent/private/directoryresumedatastorage.cpp \
     $$PWD/bittorrent/private/filterparserthread.cpp \
+    $$PWD/bittorrent/private/journalresumedatastorage.cpp \
     $$PWD/bittorrent/private/portforwarderimpl.cpp \
-    $$PWD/bittorrent/private/resumedatasavingmanager.cpp \
     $$PWD/bittorrent/private/speedmonitor.cpp \
     $$PWD/bittorrent/private/statistics.cpp \
     $$PWD/bittorrent/session.cpp \
@@ -96,10 +106,12 @@ SOURCES += \
     $$PWD/exceptions.cpp \
     $$PWD/filesystemwatcher.cpp \
     $$PWD/http/connection.cpp \
+    $$PWD/http/connectionworker.cpp \
     $$PWD/http/httperror.cpp \
     $$PWD/http/requestparser.cpp \
     $$PWD/http/responsebuilder.cpp \
     $$PWD/http/responsegenerator.cpp \
+    $$PWD/http/responsestream.cpp \
     $$PWD/http/server.cpp \
     $$PWD/iconprovider.cpp \
     $$PWD/logger.cpp \
@@ -126,6 +138,8 @@ SOURCES += \
     $$PWD/search/searchdownloadhandler.cpp \
     $$PWD/search/searchhandler.cpp \
     $$PWD/search/searchpluginmanager.cpp \
+    $$PWD/search/searchresultfilter.cpp \
+    $$PWD/search/searchresultindex.cpp \
     $$PWD/settingsstorage.cpp \
     $$PWD/torrentfileguard.cpp \
     $$PWD/torrentfilter.cpp \
@@ -50,191 +50,221 @@ PeerAddress::PeerAddress(const QHostAddress &ip, ushort port)
 {
 }
 
+bool BitTorrent::operator==(const PeerAddress &left, const PeerAddress &right)
+{
+    return ((left.port == right.port) && (left.ip == right.ip));
+}
+
+bool BitTorrent::operator!=(const PeerAddress &left, const PeerAddress &right)
+{
+    return !(left == right);
+}
+
+uint BitTorrent::qHash(const PeerAddress &addr, const uint seed)
+{
+    return (::qHash(addr.ip, seed) ^ ::qHash(addr.port, seed));
+}
+
 // PeerInfo
 
 PeerInfo::PeerInfo(const TorrentHandle *torrent, const lt::peer_info &nativeInfo)
-    : m_nativeInfo(nativeInfo)
+    : PeerInfo(nativeInfo, torrent->pieces())
 {
-    calcRelevance(torrent);
-    determineFlags();
+}
+
+PeerInfo::PeerInfo(const lt::peer_info &nativeInfo, const QBitArray &torrentPieces)
+    : m_endpoint(nativeInfo.ip)
+    , m_nativeClient(nativeInfo.client)
+    , m_totalUpload(nativeInfo.total_upload)
+    , m_totalDownload(nativeInfo.total_download)
+    , m_nativeFlags(nativeInfo.flags)
+    , m_source(nativeInfo.source)
+    , m_connectionType(nativeInfo.connection_type)
+    , m_payloadUpSpeed(nativeInfo.payload_up_speed)
+    , m_payloadDownSpeed(nativeInfo.payload_down_speed)
+    , m_downloadingPieceIndex(static_cast<int>(nativeInfo.downloading_piece_index))
+    , m_progress(nativeInfo.progress)
+{
+    calcRelevance(nativeInfo, torrentPieces);
 }
 
 bool PeerInfo::fromDHT() const
 {
-    return static_cast<bool>(m_nativeInfo.source & lt::peer_info::dht);
+    return static_cast<bool>(m_source & lt::peer_info::dht);
 }
 
 bool PeerInfo::fromPeX() const
 {
-    return static_cast<bool>(m_nativeInfo.source & lt::peer_info::pex);
+    return static_cast<bool>(m_source & lt::peer_info::pex);
 }
 
 bool PeerInfo::fromLSD() const
 {
-    return static_cast<bool>(m_nativeInfo.source & lt::peer_info::lsd);
+    return static_cast<bool>(m_source & lt::peer_info::lsd);
 }
 
 #ifndef DISABLE_COUNTRIES_RESOLUTION
 QString PeerInfo::country() const
 {
-    return Net::GeoIPManager::instance()->lookup(address().ip);
+    if (!(m_derivedValues & CountryValue)) {
+        m_country = Net::GeoIPManager::instance()->lookup(address().ip);
+        m_derivedValues |= CountryValue;
+    }
+    return m_country;
 }
 #endif
 
 bool PeerInfo::isInteresting() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::interesting);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::interesting);
 }
 
 bool PeerInfo::isChocked() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::choked);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::choked);
 }
 
 bool PeerInfo::isRemoteInterested() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::remote_interested);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::remote_interested);
 }
 
 bool PeerInfo::isRemoteChocked() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::remote_choked);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::remote_choked);
 }
 
 bool PeerInfo::isSupportsExtensions() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::supports_extensions);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::supports_extensions);
 }
 
 bool PeerInfo::isLocalConnection() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::local_connection);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::local_connection);
 }
 
 bool PeerInfo::isHandshake() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::handshake);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::handshake);
 }
 
 bool PeerInfo::isConnecting() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::connecting);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::connecting);
 }
 
 bool PeerInfo::isOnParole() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::on_parole);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::on_parole);
 }
 
 bool PeerInfo::isSeed() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::seed);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::seed);
 }
 
 bool PeerInfo::optimisticUnchoke() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::optimistic_unchoke);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::optimistic_unchoke);
 }
 
 bool PeerInfo::isSnubbed() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::snubbed);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::snubbed);
 }
 
 bool PeerInfo::isUploadOnly() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::upload_only);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::upload_only);
 }
 
 bool PeerInfo::isEndgameMode() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::endgame_mode);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::endgame_mode);
 }
 
 bool PeerInfo::isHolepunched() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::holepunched);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::holepunched);
 }
 
 bool PeerInfo::useI2PSocket() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::i2p_socket);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::i2p_socket);
 }
 
 bool PeerInfo::useUTPSocket() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::utp_socket);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::utp_socket);
 }
 
 bool PeerInfo::useSSLSocket() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::ssl_socket);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::ssl_socket);
 }
 
 bool PeerInfo::isRC4Encrypted() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::rc4_encrypted);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::rc4_encrypted);
 }
 
 bool PeerInfo::isPlaintextEncrypted() const
 {
-    return static_cast<bool>(m_nativeInfo.flags & lt::peer_info::plaintext_encrypted);
+    return static_cast<bool>(m_nativeFlags & lt::peer_info::plaintext_encrypted);
 }
 
 PeerAddress PeerInfo::address() const
 {
-    return PeerAddress(QHostAddress(QString::fromStdString(m_nativeInfo.ip.address().to_string())),
-                       m_nativeInfo.ip.port());
+    if (!(m_derivedValues & AddressValue)) {
+        m_address = PeerAddress(QHostAddress(QString::fromStdString(m_endpoint.address().to_string())),
+                                m_endpoint.port());
+        m_derivedValues |= AddressValue;
+    }
+    return m_address;
 }
 
 QString PeerInfo::client() const
 {
-    return QString::fromStdString(m_nativeInfo.client);
+    if (!(m_derivedValues & ClientValue)) {
+        m_client = QString::fromStdString(m_nativeClient);
+        m_derivedValues |= ClientValue;
+    }
+    return m_client;
 }
 
 qreal PeerInfo::progress() const
 {
-    return m_nativeInfo.progress;
+    return m_progress;
 }
 
 int PeerInfo::payloadUpSpeed() const
 {
-    return m_nativeInfo.payload_up_speed;
+    return m_payloadUpSpeed;
 }
 
 int PeerInfo::payloadDownSpeed() const
 {
-    return m_nativeInfo.payload_down_speed;
+    return m_payloadDownSpeed;
 }
 
 qlonglong PeerInfo::totalUpload() const
 {
-    return m_nativeInfo.total_upload;
+    return m_totalUpload;
 }
 
 qlonglong PeerInfo::totalDownload() const
 {
-    return m_nativeInfo.total_download;
-}
-
-QBitArray PeerInfo::pieces() const
-{
-    QBitArray result(m_nativeInfo.pieces.size());
-
-    int i = 0;
-    for (const bool bit : m_nativeInfo.pieces)
-        result.setBit(i++, bit);
-
-    return result;
+    return m_totalDownload;
 }
 
 QString PeerInfo::connectionType() const
 {
-    if (m_nativeInfo.flags & lt::peer_info::utp_socket)
+    if (m_nativeFlags & lt::peer_info::utp_socket)
         return QString::fromUtf8(C_UTP);
 
     QString connection;
-    switch (m_nativeInfo.connection_type) {
+    switch (m_connectionType) {
     case lt::peer_info::http_seed:
     case lt::peer_info::web_seed:
         connection = "Web";
@@ -246,26 +276,25 @@ QString PeerInfo::connectionType() const
     return connection;
 }
 
-void PeerInfo::calcRelevance(const TorrentHandle *torrent)
+void PeerInfo::calcRelevance(const lt::peer_info &nativeInfo, const QBitArray &torrentPieces)
 {
-    const QBitArray allPieces = torrent->pieces();
-    const QBitArray peerPieces = pieces();
+    const int localMissing = torrentPieces.size() - torrentPieces.count(true);
+    if (localMissing == 0) {
+        m_relevance = 0.0;
+        return;
+    }
 
-    int localMissing = 0;
     int remoteHaves = 0;
-
-    for (int i = 0; i < allPieces.size(); ++i) {
-        if (!allPieces[i]) {
-            ++localMissing;
-            if (peerPieces[i])
-                ++remoteHaves;
-        }
+    int i = 0;
+    for (const bool peerHasPiece : nativeInfo.pieces) {
+        if (i >= torrentPieces.size())
+            break;
+        if (peerHasPiece && !torrentPieces.testBit(i))
+            ++remoteHaves;
+        ++i;
     }
 
-    if (localMissing == 0)
-        m_relevance = 0.0;
-    else
-        m_relevance = static_cast<qreal>(remoteHaves) / localMissing;
+    m_relevance = static_cast<qreal>(remoteHaves) / localMissing;
 }
 
 qreal PeerInfo::relevance() const
@@ -273,9 +302,10 @@ qreal PeerInfo::relevance() const
     return m_relevance;
 }
 
-void PeerInfo::determineFlags()
+void PeerInfo::determineFlags() const
 {
     QStringList flagsDescriptionList;
+    m_flags.clear();
 
     if (isInteresting()) {
         // d = Your client wants to download, but peer doesn't want to send (interested and choked)
@@ -385,19 +415,64 @@ void PeerInfo::determineFlags()
     }
     m_flags = m_flags.trimmed();
     m_flagsDescription = flagsDescriptionList.join('\n');
+    m_derivedValues |= FlagsValue;
 }
 
 QString PeerInfo::flags() const
 {
+    if (!(m_derivedValues & FlagsValue))
+        determineFlags();
     return m_flags;
 }
 
 QString PeerInfo::flagsDescription() const
 {
+    if (!(m_derivedValues & FlagsValue))
+        determineFlags();
     return m_flagsDescription;
 }
 
 int PeerInfo::downloadingPieceIndex() const
 {
-    return static_cast<int>(m_nativeInfo.downloading_piece_index);
+    return m_downloadingPieceIndex;
+}
+
+bool PeerInfo::hasSameState(const PeerInfo &other) const
+{
+    return ((m_endpoint == other.m_endpoint)
+            && (m_nativeFlags == other.m_nativeFlags)
+            && (m_source == other.m_source)
+            && (m_connectionType == other.m_connectionType)
+            && (m_payloadUpSpeed == other.m_payloadUpSpeed)
+            && (m_payloadDownSpeed == other.m_payloadDownSpeed)
+            && (m_totalUpload == other.m_totalUpload)
+            && (m_totalDownload == other.m_totalDownload)
+            && (m_downloadingPieceIndex == other.m_downloadingPieceIndex)
+            && (m_progress == other.m_progress)
+            && (m_relevance == other.m_relevance)
+            && (m_nativeClient == other.m_nativeClient));
+}
+
+void PeerInfo::reuseDerivedValues(const PeerInfo &other)
+{
+    if (m_endpoint != other.m_endpoint)
+        return;
+
+    if (other.m_derivedValues & AddressValue) {
+        m_address = other.m_address;
+        m_derivedValues |= AddressValue;
+    }
+    if (other.m_derivedValues & CountryValue) {
+        m_country = other.m_country;
+        m_derivedValues |= CountryValue;
+    }
+    if ((other.m_derivedValues & ClientValue) && (m_nativeClient == other.m_nativeClient)) {
+        m_client = other.m_client;
+        m_derivedValues |= ClientValue;
+    }
+    if ((other.m_derivedValues & FlagsValue) && (m_nativeFlags == other.m_nativeFlags) && (m_source == other.m_source)) {
+        m_flags = other.m_flags;
+        m_flagsDescription = other.m_flagsDescription;
+        m_derivedValues |= FlagsValue;
+    }
 }
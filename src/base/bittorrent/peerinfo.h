@@ -49,12 +49,22 @@ namespace BitTorrent
         PeerAddress(const QHostAddress &ip, ushort port);
     };
 
+    bool operator==(const PeerAddress &left, const PeerAddress &right);
+    bool operator!=(const PeerAddress &left, const PeerAddress &right);
+    uint qHash(const PeerAddress &addr, uint seed);
+
+    // Compact copy of the peer state. Only the raw values are copied
+    // from libtorrent, the derived ones (strings, country etc.)
+    // are calculated on the first access and memoized.
     class PeerInfo
     {
         Q_DECLARE_TR_FUNCTIONS(PeerInfo)
 
     public:
         PeerInfo(const TorrentHandle *torrent, const lt::peer_info &nativeInfo);
+        // 'torrentPieces' are used to calculate the peer relevance so they
+        // can be shared by all the peers of the torrent
+        PeerInfo(const lt::peer_info &nativeInfo, const QBitArray &torrentPieces);
 
         bool fromDHT() const;
         bool fromPeX() const;
@@ -92,7 +102,6 @@ namespace BitTorrent
         int payloadDownSpeed() const;
         qlonglong totalUpload() const;
         qlonglong totalDownload() const;
-        QBitArray pieces() const;
         QString connectionType() const;
         qreal relevance() const;
         QString flags() const;
@@ -102,14 +111,46 @@ namespace BitTorrent
 #endif
         int downloadingPieceIndex() const;
 
-    private:
-        void calcRelevance(const TorrentHandle *torrent);
-        void determineFlags();
+        // Returns true if the peer has the same state (raw values) as the other one
+        bool hasSameState(const PeerInfo &other) const;
+        // Reuses the derived values already calculated for the same peer
+        void reuseDerivedValues(const PeerInfo &other);
 
-        lt::peer_info m_nativeInfo;
+    private:
+        using NativeFlags = decltype(lt::peer_info::flags);
+        using NativeSource = decltype(lt::peer_info::source);
+        using NativeConnectionType = decltype(lt::peer_info::connection_type);
+
+        enum DerivedValue
+        {
+            AddressValue = 1,
+            ClientValue = 2,
+            FlagsValue = 4,
+            CountryValue = 8
+        };
+
+        void calcRelevance(const lt::peer_info &nativeInfo, const QBitArray &torrentPieces);
+        void determineFlags() const;
+
+        lt::tcp::endpoint m_endpoint;
+        std::string m_nativeClient;
+        qlonglong m_totalUpload;
+        qlonglong m_totalDownload;
+        NativeFlags m_nativeFlags;
+        NativeSource m_source;
+        NativeConnectionType m_connectionType;
+        int m_payloadUpSpeed;
+        int m_payloadDownSpeed;
+        int m_downloadingPieceIndex;
+        float m_progress;
         qreal m_relevance;
-        QString m_flags;
-        QString m_flagsDescription;
+
+        mutable int m_derivedValues = 0;
+        mutable PeerAddress m_address;
+        mutable QString m_client;
+        mutable QString m_flags;
+        mutable QString m_flagsDescription;
+        mutable QString m_country;
     };
 }
 
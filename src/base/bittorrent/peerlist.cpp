@@ -0,0 +1,80 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "peerlist.h"
+
+using namespace BitTorrent;
+
+PeerListState::PeerListState(const QList<PeerInfo> &peers)
+{
+    m_peers.reserve(peers.size());
+    for (const PeerInfo &peer : peers) {
+        const PeerAddress addr = peer.address();
+        if (!addr.ip.isNull())
+            m_peers.insert(addr, peer);
+    }
+}
+
+bool PeerListState::isEmpty() const
+{
+    return m_peers.isEmpty();
+}
+
+int PeerListState::size() const
+{
+    return m_peers.size();
+}
+
+QList<PeerInfo> PeerListState::peers() const
+{
+    return m_peers.values();
+}
+
+PeerListChanges PeerListState::diff(const PeerListState &previous)
+{
+    PeerListChanges changes;
+
+    for (auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        const auto prevIter = previous.m_peers.constFind(it.key());
+        if (prevIter == previous.m_peers.cend()) {
+            changes.added << it.value();
+            continue;
+        }
+
+        it.value().reuseDerivedValues(prevIter.value());
+        if (!it.value().hasSameState(prevIter.value()))
+            changes.changed << it.value();
+    }
+
+    for (auto it = previous.m_peers.cbegin(); it != previous.m_peers.cend(); ++it) {
+        if (!m_peers.contains(it.key()))
+            changes.removed << it.key();
+    }
+
+    return changes;
+}
@@ -0,0 +1,122 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+// Value produced by an asynchronous request and cached for a limited time.
+// Requests made while the cached value is fresh are served immediately and
+// requests made while a fetch is in progress share its result.
+template <typename T>
+class AsyncSnapshot
+{
+public:
+    using ResultHandler = std::function<void (const T &)>;
+
+    explicit AsyncSnapshot(const int ttl)
+        : m_ttl {ttl}
+    {
+    }
+
+    bool isFresh() const
+    {
+        return (m_timer.isValid() && !m_timer.hasExpired(m_ttl));
+    }
+
+    const T &value() const
+    {
+        return m_value;
+    }
+
+    void setValue(const T &value)
+    {
+        m_value = value;
+        m_timer.start();
+    }
+
+    // Drops the cached value, result of the fetch in progress (if any)
+    // will be delivered to the waiting handlers but not cached
+    void invalidate()
+    {
+        m_timer.invalidate();
+        ++m_generation;
+    }
+
+    int generation() const
+    {
+        return m_generation;
+    }
+
+    // Returns true if the caller should start a new fetch
+    bool enqueue(QObject *context, const ResultHandler &resultHandler)
+    {
+        Q_ASSERT(context);
+
+        m_handlers.append({context, resultHandler});
+        if (m_isFetching)
+            return false;
+
+        m_isFetching = true;
+        return true;
+    }
+
+    void finish(const T &value, const int generation)
+    {
+        if (generation == m_generation)
+            setValue(value);
+
+        m_isFetching = false;
+        const QVector<Handler> handlers = m_handlers;
+        m_handlers.clear();
+        for (const Handler &handler : handlers) {
+            // the requester could be destroyed while it was waiting
+            if (handler.context)
+                handler.resultHandler(value);
+        }
+    }
+
+private:
+    struct Handler
+    {
+        QPointer<QObject> context;
+        ResultHandler resultHandler;
+    };
+
+    const int m_ttl;
+    T m_value;
+    QElapsedTimer m_timer;
+    int m_generation = 0;
+    bool m_isFetching = false;
+    QVector<Handler> m_handlers;
+};
@@ -0,0 +1,157 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2015, 2018  Vladimir Golovnev <glassez@yandex.ru>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "directoryresumedatastorage.h"
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QSaveFile>
+
+#include "base/logger.h"
+#include "base/utils/fs.h"
+
+namespace
+{
+    const char QUEUE_FILENAME[] = "queue";
+
+    bool readFile(const QString &path, QByteArray &buf)
+    {
+        QFile file {path};
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug("Cannot read file %s: %s", qUtf8Printable(path), qUtf8Printable(file.errorString()));
+            return false;
+        }
+
+        buf = file.readAll();
+        return true;
+    }
+}
+
+DirectoryResumeDataStorage::DirectoryResumeDataStorage(const QString &resumeFolderPath, QObject *parent)
+    : ResumeDataStorage {parent}
+    , m_resumeFolderPath {resumeFolderPath}
+    , m_resumeDataDir {resumeFolderPath}
+{
+}
+
+QStringList DirectoryResumeDataStorage::registeredTorrents() const
+{
+    const QStringList fastresumes = m_resumeDataDir.entryList(
+                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+
+    const QRegularExpression rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
+    QStringList hashes;
+    hashes.reserve(fastresumes.size());
+    for (const QString &fastresumeName : fastresumes) {
+        const QRegularExpressionMatch rxMatch = rx.match(fastresumeName);
+        if (rxMatch.hasMatch())
+            hashes.append(rxMatch.captured(1));
+    }
+
+    return hashes;
+}
+
+bool DirectoryResumeDataStorage::load(const QString &hash, QByteArray &resumeData, QByteArray &metadata) const
+{
+    // can be called from multiple threads so don't share QDir instance
+    const QDir resumeDataDir {m_resumeFolderPath};
+    if (!readFile(resumeDataDir.absoluteFilePath(QString("%1.fastresume").arg(hash)), resumeData))
+        return false;
+
+    // torrents added using magnet links may have no metadata yet
+    const QString torrentFilePath = resumeDataDir.absoluteFilePath(QString("%1.torrent").arg(hash));
+    if (!QFile::exists(torrentFilePath) || !readFile(torrentFilePath, metadata))
+        metadata.clear();
+
+    return true;
+}
+
+bool DirectoryResumeDataStorage::loadQueue(QStringList &queue) const
+{
+    queue.clear();
+
+    QFile queueFile {m_resumeDataDir.absoluteFilePath(QLatin1String {QUEUE_FILENAME})};
+    if (!queueFile.exists())
+        return false;
+
+    if (queueFile.open(QFile::ReadOnly)) {
+        QByteArray line;
+        while (!(line = queueFile.readLine()).isEmpty())
+            queue.append(QString::fromLatin1(line.trimmed()));
+    }
+    else {
+        LogMsg(tr("Couldn't load torrents queue from '%1'. Error: %2")
+               .arg(queueFile.fileName(), queueFile.errorString()), Log::WARNING);
+    }
+
+    return true;
+}
+
+void DirectoryResumeDataStorage::store(const QString &hash, const QByteArray &resumeData)
+{
+    saveFile(QString("%1.fastresume").arg(hash), resumeData);
+}
+
+void DirectoryResumeDataStorage::storeMetadata(const QString &hash, const QByteArray &metadata)
+{
+    saveFile(QString("%1.torrent").arg(hash), metadata);
+}
+
+void DirectoryResumeDataStorage::storeQueue(const QStringList &queue)
+{
+    QByteArray data;
+    for (const QString &hash : queue)
+        data += (hash.toLatin1() + '\n');
+
+    saveFile(QLatin1String {QUEUE_FILENAME}, data);
+}
+
+void DirectoryResumeDataStorage::remove(const QString &hash)
+{
+    Utils::Fs::forceRemove(m_resumeDataDir.absoluteFilePath(QString("%1.fastresume").arg(hash)));
+    Utils::Fs::forceRemove(m_resumeDataDir.absoluteFilePath(QString("%1.torrent").arg(hash)));
+}
+
+void DirectoryResumeDataStorage::removeQueue()
+{
+    Utils::Fs::forceRemove(m_resumeDataDir.absoluteFilePath(QLatin1String {QUEUE_FILENAME}));
+}
+
+void DirectoryResumeDataStorage::saveFile(const QString &filename, const QByteArray &data) const
+{
+    const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
+
+    QSaveFile file {filepath};
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(data);
+        if (!file.commit()) {
+            Logger::instance()->addMessage(QString("Couldn't save data in '%1'. Error: %2")
+                                           .arg(filepath, file.errorString()), Log::WARNING);
+        }
+    }
+}
@@ -29,22 +29,32 @@
 #pragma once
 
 #include <QDir>
-#include <QObject>
 
-class QByteArray;
+#include "resumedatastorage.h"
 
-class ResumeDataSavingManager : public QObject
+// Stores resume data of each torrent in separate files
+// (<hash>.fastresume and <hash>.torrent) inside of the resume folder
+class DirectoryResumeDataStorage final : public ResumeDataStorage
 {
     Q_OBJECT
-    Q_DISABLE_COPY(ResumeDataSavingManager)
+    Q_DISABLE_COPY(DirectoryResumeDataStorage)
 
 public:
-    explicit ResumeDataSavingManager(const QString &resumeFolderPath);
+    explicit DirectoryResumeDataStorage(const QString &resumeFolderPath, QObject *parent = nullptr);
 
-public slots:
-    void save(const QString &filename, const QByteArray &data) const;
-    void remove(const QString &filename) const;
+    QStringList registeredTorrents() const override;
+    bool load(const QString &hash, QByteArray &resumeData, QByteArray &metadata) const override;
+    bool loadQueue(QStringList &queue) const override;
+
+    void store(const QString &hash, const QByteArray &resumeData) override;
+    void storeMetadata(const QString &hash, const QByteArray &metadata) override;
+    void storeQueue(const QStringList &queue) override;
+    void remove(const QString &hash) override;
+    void removeQueue() override;
 
 private:
-    QDir m_resumeDataDir;
+    void saveFile(const QString &filename, const QByteArray &data) const;
+
+    const QString m_resumeFolderPath;
+    const QDir m_resumeDataDir;
 };
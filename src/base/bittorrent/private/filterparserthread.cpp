@@ -28,12 +28,25 @@
 
 #include "filterparserthread.h"
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
 
-#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
 
 #include "base/logger.h"
+#include "base/profile.h"
 
 namespace
 {
@@ -99,435 +112,577 @@ namespace
         return !ec;
     }
 
-    const int BUFFER_SIZE = 2 * 1024 * 1024; // 2 MiB
     const int MAX_LOGGED_ERRORS = 5;
-}
-
-FilterParserThread::FilterParserThread(QObject *parent)
-    : QThread(parent)
-    , m_abort(false)
-{
-}
-
-FilterParserThread::~FilterParserThread()
-{
-    m_abort = true;
-    wait();
-}
+    // Text filters are split into chunks of at least this size which are parsed concurrently
+    const qint64 MIN_CHUNK_SIZE = 1024 * 1024; // 1 MiB
+
+    // Cache file layout (all integers are little endian):
+    // magic (8 bytes), SHA-1 of the filter file (20 bytes), rule count, IPv4 range count,
+    // IPv6 range count (quint32 each), IPv4 ranges (pairs of quint32),
+    // IPv6 ranges (pairs of 16 bytes addresses in network byte order)
+    const char CACHE_FILE_NAME[] = "ipfilter.cache";
+    const char CACHE_MAGIC[] = {'Q', 'B', 'I', 'P', 'F', 'L', 'T', '1'};
+    const int CACHE_HASH_SIZE = 20;
+    const int CACHE_HEADER_SIZE = sizeof(CACHE_MAGIC) + CACHE_HASH_SIZE + (3 * sizeof(quint32));
+    const int CACHE_IPV4_RANGE_SIZE = 2 * sizeof(quint32);
+    const int CACHE_IPV6_RANGE_SIZE = 2 * 16;
+
+    struct IPv4Range
+    {
+        quint32 first;
+        quint32 last;
+    };
 
-// Parser for eMule ip filter in DAT format
-int FilterParserThread::parseDATFilterFile()
-{
-    int ruleCount = 0;
-    QFile file(m_filePath);
-    if (!file.exists()) return ruleCount;
+    struct IPv6Range
+    {
+        lt::address_v6::bytes_type first;
+        lt::address_v6::bytes_type last;
+    };
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
-    }
+    struct FilterRanges
+    {
+        std::vector<IPv4Range> v4;
+        std::vector<IPv6Range> v6;
+        int ruleCount = 0;
+    };
 
-    std::vector<char> buffer(BUFFER_SIZE, 0); // seems a bit faster than QVector
-    qint64 bytesRead = 0;
-    int offset = 0;
-    int start = 0;
-    int endOfLine = -1;
-    int nbLine = 0;
-    int parseErrorCount = 0;
-    const auto addLog = [&parseErrorCount](const QString &msg)
+    enum class LineError
     {
-        if (parseErrorCount <= MAX_LOGGED_ERRORS)
-            LogMsg(msg, Log::CRITICAL);
+        NoError,
+        Ignored,
+        Malformed,
+        MalformedStartIP,
+        MalformedEndIP,
+        MixedIPVersions
     };
 
-    while (true) {
-        bytesRead = file.read(buffer.data() + offset, BUFFER_SIZE - offset - 1);
-        if (bytesRead < 0)
-            break;
-        const int dataSize = bytesRead + offset;
-        if ((bytesRead == 0) && (dataSize == 0))
-            break;
-
-        for (start = 0; start < dataSize; ++start) {
-            endOfLine = -1;
-            // The file might have ended without the last line having a newline
-            if (!((bytesRead == 0) && (dataSize > 0))) {
-                for (int i = start; i < dataSize; ++i) {
-                    if (buffer[i] == '\n') {
-                        endOfLine = i;
-                        // We need to NULL the newline in case the line has only an IP range.
-                        // In that case the parser won't work for the end IP, because it ends
-                        // with the newline and not with a number.
-                        buffer[i] = '\0';
-                        break;
-                    }
-                }
-            }
-            else {
-                endOfLine = dataSize;
-                buffer[dataSize] = '\0';
-            }
+    using LineParser = LineError (*)(char *line, int length, lt::address &startAddr, lt::address &endAddr);
 
-            if (endOfLine == -1) {
-                // read the next chunk from file
-                // but first move(copy) the leftover data to the front of the buffer
-                offset = dataSize - start;
-                memmove(buffer.data(), buffer.data() + start, offset);
-                break;
-            }
+    struct ChunkResult
+    {
+        FilterRanges ranges;
+        int lineCount = 0;
+        int errorCount = 0;
+        // line numbers are relative to the chunk start
+        QVector<QPair<int, LineError>> errors;
+    };
 
-            ++nbLine;
+    class ParseTask final : public QRunnable
+    {
+    public:
+        explicit ParseTask(std::function<void ()> job)
+            : m_job {std::move(job)}
+        {
+        }
 
-            if ((buffer[start] == '#')
-                || ((buffer[start] == '/') && ((start + 1 < dataSize) && (buffer[start + 1] == '/')))) {
-                start = endOfLine;
-                continue;
-            }
+        void run() override
+        {
+            m_job();
+        }
 
-            // Each line should follow this format:
-            // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
-            // The 3rd entry is access level and if above 127 the IP range isn't blocked.
-            const int firstComma = findAndNullDelimiter(buffer.data(), ',', start, endOfLine);
-            if (firstComma != -1)
-                findAndNullDelimiter(buffer.data(), ',', firstComma + 1, endOfLine);
-
-            // Check if there is an access value (apparently not mandatory)
-            if (firstComma != -1) {
-                // There is possibly one
-                const long int nbAccess = strtol(buffer.data() + firstComma + 1, nullptr, 10);
-                // Ignoring this rule because access value is too high
-                if (nbAccess > 127L) {
-                    start = endOfLine;
-                    continue;
-                }
-            }
+    private:
+        std::function<void ()> m_job;
+    };
 
-            // IP Range should be split by a dash
-            const int endOfIPRange = ((firstComma == -1) ? (endOfLine - 1) : (firstComma - 1));
-            const int delimIP = findAndNullDelimiter(buffer.data(), '-', start, endOfIPRange);
-            if (delimIP == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    quint32 toIPv4Number(const lt::address_v4 &address)
+    {
+        return qFromBigEndian<quint32>(address.to_bytes().data());
+    }
 
-            lt::address startAddr;
-            int newStart = trim(buffer.data(), start, delimIP - 1);
-            if (!parseIPAddress(buffer.data() + newStart, startAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    lt::address_v4 fromIPv4Number(const quint32 number)
+    {
+        lt::address_v4::bytes_type bytes;
+        qToBigEndian(number, bytes.data());
+        return lt::address_v4(bytes);
+    }
 
-            lt::address endAddr;
-            newStart = trim(buffer.data(), delimIP + 1, endOfIPRange);
-            if (!parseIPAddress(buffer.data() + newStart, endAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    bool addRange(FilterRanges &ranges, const lt::address &startAddr, const lt::address &endAddr)
+    {
+        if (startAddr.is_v4()) {
+            const IPv4Range range {toIPv4Number(startAddr.to_v4()), toIPv4Number(endAddr.to_v4())};
+            if (range.last < range.first)
+                return false;
+            ranges.v4.push_back(range);
+        }
+        else {
+            const IPv6Range range {startAddr.to_v6().to_bytes(), endAddr.to_v6().to_bytes()};
+            if (range.last < range.first)
+                return false;
+            ranges.v6.push_back(range);
+        }
 
-            if ((startAddr.is_v4() != endAddr.is_v4())
-                || (startAddr.is_v6() != endAddr.is_v6())) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        ++ranges.ruleCount;
+        return true;
+    }
 
-            start = endOfLine;
+    // Sorts the ranges by their first address and joins the ones for which `isJoinable(previous, next)` holds
+    template <typename Range, typename IsJoinable>
+    void joinRanges(std::vector<Range> &ranges, IsJoinable isJoinable)
+    {
+        std::sort(ranges.begin(), ranges.end(), [](const Range &left, const Range &right)
+        {
+            return (left.first < right.first);
+        });
 
-            // Now Add to the filter
-            try {
-                m_filter.add_rule(startAddr, endAddr, lt::ip_filter::blocked);
-                ++ruleCount;
+        size_t count = 0;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            if ((count > 0) && isJoinable(ranges[count - 1], ranges[i])) {
+                if (ranges[count - 1].last < ranges[i].last)
+                    ranges[count - 1].last = ranges[i].last;
             }
-            catch (const std::exception &e) {
-                ++parseErrorCount;
-                addLog(tr("IP filter exception thrown for line %1. Exception is: %2")
-                       .arg(nbLine).arg(QString::fromLocal8Bit(e.what())));
+            else {
+                ranges[count++] = ranges[i];
             }
         }
-
-        if (start >= dataSize)
-            offset = 0;
+        ranges.resize(count);
     }
 
-    if (parseErrorCount > MAX_LOGGED_ERRORS)
-        LogMsg(tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
-               .arg(parseErrorCount - MAX_LOGGED_ERRORS), Log::CRITICAL);
-    return ruleCount;
-}
+    void joinRanges(FilterRanges &ranges)
+    {
+        joinRanges(ranges.v4, [](const IPv4Range &previous, const IPv4Range &next)
+        {
+            return ((next.first <= previous.last) || (next.first == (previous.last + 1)));
+        });
+        joinRanges(ranges.v6, [](const IPv6Range &previous, const IPv6Range &next)
+        {
+            return !(previous.last < next.first);
+        });
+    }
 
-// Parser for PeerGuardian ip filter in p2p format
-int FilterParserThread::parseP2PFilterFile()
-{
-    int ruleCount = 0;
-    QFile file(m_filePath);
-    if (!file.exists()) return ruleCount;
+    lt::ip_filter toIPFilter(const FilterRanges &ranges)
+    {
+        lt::ip_filter filter;
+        for (const IPv4Range &range : ranges.v4)
+            filter.add_rule(fromIPv4Number(range.first), fromIPv4Number(range.last), lt::ip_filter::blocked);
+        for (const IPv6Range &range : ranges.v6)
+            filter.add_rule(lt::address_v6(range.first), lt::address_v6(range.last), lt::ip_filter::blocked);
+        return filter;
+    }
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
+    QString cacheFilePath()
+    {
+        return QDir::cleanPath(specialFolderLocation(SpecialFolder::Cache) + QLatin1Char('/') + QLatin1String(CACHE_FILE_NAME));
     }
 
-    std::vector<char> buffer(BUFFER_SIZE, 0); // seems a bit faster than QVector
-    qint64 bytesRead = 0;
-    int offset = 0;
-    int start = 0;
-    int endOfLine = -1;
-    int nbLine = 0;
-    int parseErrorCount = 0;
-    const auto addLog = [&parseErrorCount](const QString &msg)
+    QByteArray filterHash(const QString &filePath, const char *data, qint64 size)
     {
-        if (parseErrorCount <= MAX_LOGGED_ERRORS)
-            LogMsg(msg, Log::CRITICAL);
-    };
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        // the same data is parsed differently depending on the format
+        hash.addData(QFileInfo(filePath).suffix().toLower().toLatin1());
+        while (size > 0) {
+            const int chunkSize = static_cast<int>(std::min<qint64>(size, std::numeric_limits<int>::max()));
+            hash.addData(data, chunkSize);
+            data += chunkSize;
+            size -= chunkSize;
+        }
+        return hash.result();
+    }
 
-    while (true) {
-        bytesRead = file.read(buffer.data() + offset, BUFFER_SIZE - offset - 1);
-        if (bytesRead < 0)
-            break;
-        const int dataSize = bytesRead + offset;
-        if ((bytesRead == 0) && (dataSize == 0))
-            break;
-
-        for (start = 0; start < dataSize; ++start) {
-            endOfLine = -1;
-            // The file might have ended without the last line having a newline
-            if (!((bytesRead == 0) && (dataSize > 0))) {
-                for (int i = start; i < dataSize; ++i) {
-                    if (buffer[i] == '\n') {
-                        endOfLine = i;
-                        // We need to NULL the newline in case the line has only an IP range.
-                        // In that case the parser won't work for the end IP, because it ends
-                        // with the newline and not with a number.
-                        buffer[i] = '\0';
-                        break;
-                    }
-                }
-            }
-            else {
-                endOfLine = dataSize;
-                buffer[dataSize] = '\0';
-            }
+    bool loadCache(const QByteArray &sourceHash, lt::ip_filter &filter, int &ruleCount)
+    {
+        QFile file(cacheFilePath());
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
 
-            if (endOfLine == -1) {
-                // read the next chunk from file
-                // but first move(copy) the leftover data to the front of the buffer
-                offset = dataSize - start;
-                memmove(buffer.data(), buffer.data() + start, offset);
-                break;
-            }
+        const qint64 size = file.size();
+        if (size < CACHE_HEADER_SIZE)
+            return false;
 
-            ++nbLine;
+        QByteArray buffer;
+        const uchar *data = file.map(0, size);
+        if (!data) {
+            buffer = file.readAll();
+            if (buffer.size() != size)
+                return false;
+            data = reinterpret_cast<const uchar *>(buffer.constData());
+        }
 
-            if ((buffer[start] == '#')
-                || ((buffer[start] == '/') && ((start + 1 < dataSize) && (buffer[start + 1] == '/')))) {
-                start = endOfLine;
-                continue;
-            }
+        if ((memcmp(data, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+            || (memcmp((data + sizeof(CACHE_MAGIC)), sourceHash.constData(), CACHE_HASH_SIZE) != 0))
+            return false;
 
-            // Each line should follow this format:
-            // Some organization:1.0.0.0-1.255.255.255
-            // The "Some organization" part might contain a ':' char itself so we find the last occurrence
-            const int partsDelimiter = findAndNullDelimiter(buffer.data(), ':', start, endOfLine, true);
-            if (partsDelimiter == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        const uchar *ptr = data + sizeof(CACHE_MAGIC) + CACHE_HASH_SIZE;
+        const quint32 cachedRuleCount = qFromLittleEndian<quint32>(ptr);
+        const quint32 v4Count = qFromLittleEndian<quint32>(ptr + 4);
+        const quint32 v6Count = qFromLittleEndian<quint32>(ptr + 8);
+        ptr += 3 * sizeof(quint32);
+        if (size != (CACHE_HEADER_SIZE + (static_cast<qint64>(v4Count) * CACHE_IPV4_RANGE_SIZE)
+                      + (static_cast<qint64>(v6Count) * CACHE_IPV6_RANGE_SIZE)))
+            return false;
 
-            // IP Range should be split by a dash
-            const int delimIP = findAndNullDelimiter(buffer.data(), '-', partsDelimiter + 1, endOfLine);
-            if (delimIP == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        lt::ip_filter cachedFilter;
+        for (quint32 i = 0; i < v4Count; ++i, ptr += CACHE_IPV4_RANGE_SIZE) {
+            cachedFilter.add_rule(fromIPv4Number(qFromLittleEndian<quint32>(ptr))
+                                  , fromIPv4Number(qFromLittleEndian<quint32>(ptr + 4)), lt::ip_filter::blocked);
+        }
+        for (quint32 i = 0; i < v6Count; ++i, ptr += CACHE_IPV6_RANGE_SIZE) {
+            lt::address_v6::bytes_type first;
+            lt::address_v6::bytes_type last;
+            memcpy(first.data(), ptr, first.size());
+            memcpy(last.data(), (ptr + first.size()), last.size());
+            cachedFilter.add_rule(lt::address_v6(first), lt::address_v6(last), lt::ip_filter::blocked);
+        }
 
-            lt::address startAddr;
-            int newStart = trim(buffer.data(), partsDelimiter + 1, delimIP - 1);
-            if (!parseIPAddress(buffer.data() + newStart, startAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        filter = std::move(cachedFilter);
+        ruleCount = static_cast<int>(cachedRuleCount);
+        return true;
+    }
 
-            lt::address endAddr;
-            newStart = trim(buffer.data(), delimIP + 1, endOfLine);
-            if (!parseIPAddress(buffer.data() + newStart, endAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    void saveCache(const QByteArray &sourceHash, const FilterRanges &ranges)
+    {
+        QByteArray data;
+        data.reserve(CACHE_HEADER_SIZE + (static_cast<int>(ranges.v4.size()) * CACHE_IPV4_RANGE_SIZE)
+                     + (static_cast<int>(ranges.v6.size()) * CACHE_IPV6_RANGE_SIZE));
 
-            if ((startAddr.is_v4() != endAddr.is_v4())
-                || (startAddr.is_v6() != endAddr.is_v6())) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        const auto appendNumber = [&data](const quint32 number)
+        {
+            uchar buf[sizeof(number)];
+            qToLittleEndian(number, buf);
+            data.append(reinterpret_cast<const char *>(buf), sizeof(buf));
+        };
+
+        data.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        data.append(sourceHash);
+        appendNumber(static_cast<quint32>(ranges.ruleCount));
+        appendNumber(static_cast<quint32>(ranges.v4.size()));
+        appendNumber(static_cast<quint32>(ranges.v6.size()));
+        for (const IPv4Range &range : ranges.v4) {
+            appendNumber(range.first);
+            appendNumber(range.last);
+        }
+        for (const IPv6Range &range : ranges.v6) {
+            data.append(reinterpret_cast<const char *>(range.first.data()), static_cast<int>(range.first.size()));
+            data.append(reinterpret_cast<const char *>(range.last.data()), static_cast<int>(range.last.size()));
+        }
 
-            start = endOfLine;
+        QSaveFile file(cacheFilePath());
+        if (!file.open(QIODevice::WriteOnly) || (file.write(data) != data.size()) || !file.commit())
+            LogMsg(FilterParserThread::tr("Couldn't save IP filter cache. Reason: %1").arg(file.errorString()), Log::WARNING);
+    }
 
-            try {
-                m_filter.add_rule(startAddr, endAddr, lt::ip_filter::blocked);
-                ++ruleCount;
+    int findAndNullDelimiter(char *const data, const char delimiter, const int start, const int end, const bool reverse = false)
+    {
+        if (!reverse) {
+            for (int i = start; i <= end; ++i) {
+                if (data[i] == delimiter) {
+                    data[i] = '\0';
+                    return i;
+                }
             }
-            catch (const std::exception &e) {
-                ++parseErrorCount;
-                addLog(tr("IP filter exception thrown for line %1. Exception is: %2")
-                       .arg(nbLine).arg(QString::fromLocal8Bit(e.what())));
+        }
+        else {
+            for (int i = end; i >= start; --i) {
+                if (data[i] == delimiter) {
+                    data[i] = '\0';
+                    return i;
+                }
             }
         }
 
-        if (start >= dataSize)
-            offset = 0;
+        return -1;
     }
 
-    if (parseErrorCount > MAX_LOGGED_ERRORS)
-        LogMsg(tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
-               .arg(parseErrorCount - MAX_LOGGED_ERRORS), Log::CRITICAL);
-    return ruleCount;
-}
+    int trim(char *const data, const int start, const int end)
+    {
+        if (start >= end) return start;
+        int newStart = start;
 
-int FilterParserThread::getlineInStream(QDataStream &stream, std::string &name, const char delim)
-{
-    char c;
-    int totalRead = 0;
-    int read;
-    do {
-        read = stream.readRawData(&c, 1);
-        totalRead += read;
-        if (read > 0) {
-            if (c != delim) {
-                name += c;
+        for (int i = start; i <= end; ++i) {
+            if (isspace(data[i]) != 0) {
+                data[i] = '\0';
             }
             else {
-                // Delim found
-                return totalRead;
+                newStart = i;
+                break;
             }
         }
-    }
-    while (read > 0);
 
-    return totalRead;
-}
+        for (int i = end; i >= start; --i) {
+            if (isspace(data[i]) != 0)
+                data[i] = '\0';
+            else
+                break;
+        }
 
-// Parser for PeerGuardian ip filter in p2p format
-int FilterParserThread::parseP2BFilterFile()
-{
-    int ruleCount = 0;
-    QFile file(m_filePath);
-    if (!file.exists()) return ruleCount;
+        return newStart;
+    }
 
-    if (!file.open(QIODevice::ReadOnly)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
+    // Each line should follow this format:
+    // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
+    // The 3rd entry is access level and if above 127 the IP range isn't blocked.
+    LineError parseDATLine(char *const line, const int length, lt::address &startAddr, lt::address &endAddr)
+    {
+        const int endOfLine = length - 1;
+        const int firstComma = findAndNullDelimiter(line, ',', 0, endOfLine);
+        if (firstComma != -1)
+            findAndNullDelimiter(line, ',', (firstComma + 1), endOfLine);
+
+        // Check if there is an access value (apparently not mandatory)
+        if (firstComma != -1) {
+            // There is possibly one
+            const long int nbAccess = strtol(line + firstComma + 1, nullptr, 10);
+            // Ignoring this rule because access value is too high
+            if (nbAccess > 127L)
+                return LineError::Ignored;
+        }
+
+        // IP Range should be split by a dash
+        const int endOfIPRange = ((firstComma == -1) ? endOfLine : (firstComma - 1));
+        const int delimIP = findAndNullDelimiter(line, '-', 0, endOfIPRange);
+        if (delimIP == -1)
+            return LineError::Malformed;
+
+        if (!parseIPAddress((line + trim(line, 0, (delimIP - 1))), startAddr))
+            return LineError::MalformedStartIP;
+        if (!parseIPAddress((line + trim(line, (delimIP + 1), endOfIPRange)), endAddr))
+            return LineError::MalformedEndIP;
+        return LineError::NoError;
     }
 
-    QDataStream stream(&file);
-    // Read header
-    char buf[7];
-    unsigned char version;
-    if (!stream.readRawData(buf, sizeof(buf))
-        || memcmp(buf, "\xFF\xFF\xFF\xFFP2B", 7)
-        || !stream.readRawData(reinterpret_cast<char*>(&version), sizeof(version))) {
-        LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-        return ruleCount;
+    // Each line should follow this format:
+    // Some organization:1.0.0.0-1.255.255.255
+    // The "Some organization" part might contain a ':' char itself so we find the last occurrence
+    LineError parseP2PLine(char *const line, const int length, lt::address &startAddr, lt::address &endAddr)
+    {
+        const int endOfLine = length - 1;
+        const int partsDelimiter = findAndNullDelimiter(line, ':', 0, endOfLine, true);
+        if (partsDelimiter == -1)
+            return LineError::Malformed;
+
+        // IP Range should be split by a dash
+        const int delimIP = findAndNullDelimiter(line, '-', (partsDelimiter + 1), endOfLine);
+        if (delimIP == -1)
+            return LineError::Malformed;
+
+        if (!parseIPAddress((line + trim(line, (partsDelimiter + 1), (delimIP - 1))), startAddr))
+            return LineError::MalformedStartIP;
+        if (!parseIPAddress((line + trim(line, (delimIP + 1), endOfLine)), endAddr))
+            return LineError::MalformedEndIP;
+        return LineError::NoError;
     }
 
-    if ((version == 1) || (version == 2)) {
-        qDebug ("p2b version 1 or 2");
-        unsigned int start, end;
+    void parseChunk(const char *begin, const char *const end, const LineParser parseLine
+                    , const std::atomic<bool> &abort, ChunkResult &result)
+    {
+        std::vector<char> line;
+        while ((begin < end) && !abort) {
+            const char *const lineBegin = begin;
+            const char *lineEnd = static_cast<const char *>(memchr(lineBegin, '\n', (end - lineBegin)));
+            if (lineEnd)
+                begin = lineEnd + 1;
+            else
+                lineEnd = begin = end;
+            const int lineNumber = ++result.lineCount;
+
+            // also drops the '\r' of CRLF line endings
+            int length = static_cast<int>(lineEnd - lineBegin);
+            while ((length > 0) && (isspace(static_cast<unsigned char>(lineBegin[length - 1])) != 0))
+                --length;
+
+            if ((length == 0) || (lineBegin[0] == '#')
+                || ((lineBegin[0] == '/') && (length > 1) && (lineBegin[1] == '/')))
+                continue;
 
-        std::string name;
-        while (getlineInStream(stream, name, '\0') && !m_abort) {
-            if (!stream.readRawData(reinterpret_cast<char*>(&start), sizeof(start))
-                || !stream.readRawData(reinterpret_cast<char*>(&end), sizeof(end))) {
-                LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-                return ruleCount;
-            }
+            // the line parsers split the line in place, so they need a null terminated copy
+            line.assign(lineBegin, (lineBegin + length));
+            line.push_back('\0');
 
-            // Network byte order to Host byte order
-            // asio address_v4 constructor expects it
-            // that way
-            const lt::address_v4 first(ntohl(start));
-            const lt::address_v4 last(ntohl(end));
-            // Apply to bittorrent session
-            try {
-                m_filter.add_rule(first, last, lt::ip_filter::blocked);
-                ++ruleCount;
+            lt::address startAddr;
+            lt::address endAddr;
+            LineError error = parseLine(line.data(), length, startAddr, endAddr);
+            if (error == LineError::NoError) {
+                if ((startAddr.is_v4() != endAddr.is_v4()) || (startAddr.is_v6() != endAddr.is_v6()))
+                    error = LineError::MixedIPVersions;
+                else if (!addRange(result.ranges, startAddr, endAddr))
+                    error = LineError::Malformed;
             }
-            catch (const std::exception &) {}
+
+            if ((error == LineError::NoError) || (error == LineError::Ignored))
+                continue;
+
+            ++result.errorCount;
+            if (result.errors.size() < MAX_LOGGED_ERRORS)
+                result.errors.append({lineNumber, error});
         }
     }
-    else if (version == 3) {
-        qDebug ("p2b version 3");
-        unsigned int namecount;
-        if (!stream.readRawData(reinterpret_cast<char*>(&namecount), sizeof(namecount))) {
-            LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-            return ruleCount;
+
+    QString lineErrorMessage(const LineError error, const int lineNumber)
+    {
+        switch (error) {
+        case LineError::MalformedStartIP:
+            return FilterParserThread::tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(lineNumber);
+        case LineError::MalformedEndIP:
+            return FilterParserThread::tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(lineNumber);
+        case LineError::MixedIPVersions:
+            return FilterParserThread::tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(lineNumber);
+        default:
+            return FilterParserThread::tr("IP filter line %1 is malformed.").arg(lineNumber);
         }
+    }
 
-        namecount = ntohl(namecount);
-        // Reading names although, we don't really care about them
-        for (unsigned int i = 0; i < namecount; ++i) {
-            std::string name;
-            if (!getlineInStream(stream, name, '\0')) {
-                LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-                return ruleCount;
-            }
+    // Parser for eMule ip filter in DAT format and PeerGuardian ip filter in p2p format
+    FilterRanges parseTextFilter(const char *const data, const qint64 size, const LineParser parseLine
+                                 , const std::atomic<bool> &abort)
+    {
+        // Split the data at line ends into chunks which are parsed concurrently
+        const int chunkCount = static_cast<int>(qBound<qint64>(1, (size / MIN_CHUNK_SIZE), QThread::idealThreadCount()));
+        const char *const dataEnd = data + size;
+        std::vector<const char *> bounds {data};
+        for (int i = 1; i < chunkCount; ++i) {
+            const char *bound = std::max((data + (size * i / chunkCount)), bounds.back());
+            const char *lineEnd = static_cast<const char *>(memchr(bound, '\n', (dataEnd - bound)));
+            bounds.push_back(lineEnd ? (lineEnd + 1) : dataEnd);
+        }
+        bounds.push_back(dataEnd);
 
-            if (m_abort) return ruleCount;
+        std::vector<ChunkResult> results(chunkCount);
+        if (chunkCount == 1) {
+            parseChunk(data, dataEnd, parseLine, abort, results[0]);
+        }
+        else {
+            QThreadPool threadPool;
+            threadPool.setMaxThreadCount(chunkCount);
+            for (int i = 0; i < chunkCount; ++i) {
+                const char *chunkBegin = bounds[i];
+                const char *chunkEnd = bounds[i + 1];
+                ChunkResult &result = results[i];
+                threadPool.start(new ParseTask([chunkBegin, chunkEnd, parseLine, &abort, &result]()
+                {
+                    parseChunk(chunkBegin, chunkEnd, parseLine, abort, result);
+                }));
+            }
+            threadPool.waitForDone();
         }
 
-        // Reading the ranges
-        unsigned int rangecount;
-        if (!stream.readRawData(reinterpret_cast<char*>(&rangecount), sizeof(rangecount))) {
-            LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-            return ruleCount;
+        FilterRanges ranges;
+        int lineOffset = 0;
+        int parseErrorCount = 0;
+        int loggedErrorCount = 0;
+        for (const ChunkResult &result : results) {
+            for (const QPair<int, LineError> &error : result.errors) {
+                if (loggedErrorCount >= MAX_LOGGED_ERRORS)
+                    break;
+                LogMsg(lineErrorMessage(error.second, (lineOffset + error.first)), Log::CRITICAL);
+                ++loggedErrorCount;
+            }
+
+            parseErrorCount += result.errorCount;
+            lineOffset += result.lineCount;
+            ranges.ruleCount += result.ranges.ruleCount;
+            ranges.v4.insert(ranges.v4.end(), result.ranges.v4.cbegin(), result.ranges.v4.cend());
+            ranges.v6.insert(ranges.v6.end(), result.ranges.v6.cbegin(), result.ranges.v6.cend());
         }
 
-        rangecount = ntohl(rangecount);
-        unsigned int name, start, end;
-        for (unsigned int i = 0; i < rangecount; ++i) {
-            if (!stream.readRawData(reinterpret_cast<char*>(&name), sizeof(name))
-                || !stream.readRawData(reinterpret_cast<char*>(&start), sizeof(start))
-                || !stream.readRawData(reinterpret_cast<char*>(&end), sizeof(end))) {
-                LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-                return ruleCount;
+        if (parseErrorCount > loggedErrorCount)
+            LogMsg(FilterParserThread::tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
+                   .arg(parseErrorCount - loggedErrorCount), Log::CRITICAL);
+        return ranges;
+    }
+
+    // Parser for PeerGuardian ip filter in p2b format
+    FilterRanges parseP2BFilter(const char *const data, const qint64 size, const std::atomic<bool> &abort)
+    {
+        FilterRanges ranges;
+        const char *ptr = data;
+        const char *const end = data + size;
+
+        const auto readNumber = [&ptr, end](quint32 &number) -> bool
+        {
+            if ((end - ptr) < static_cast<qint64>(sizeof(number)))
+                return false;
+            number = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(ptr));
+            ptr += sizeof(number);
+            return true;
+        };
+        const auto skipName = [&ptr, end]() -> bool
+        {
+            const char *nameEnd = static_cast<const char *>(memchr(ptr, '\0', (end - ptr)));
+            if (!nameEnd)
+                return false;
+            ptr = nameEnd + 1;
+            return true;
+        };
+        const auto addP2BRange = [&ranges](const quint32 first, const quint32 last)
+        {
+            if (first > last)
+                return;
+            ranges.v4.push_back({first, last});
+            ++ranges.ruleCount;
+        };
+        const auto logError = []()
+        {
+            LogMsg(FilterParserThread::tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
+        };
+
+        // Read header
+        if ((size < 8) || (memcmp(ptr, "\xFF\xFF\xFF\xFFP2B", 7) != 0)) {
+            logError();
+            return ranges;
+        }
+        const unsigned char version = static_cast<unsigned char>(ptr[7]);
+        ptr += 8;
+
+        if ((version == 1) || (version == 2)) {
+            qDebug ("p2b version 1 or 2");
+            while ((ptr < end) && !abort) {
+                quint32 start, last;
+                if (!skipName() || !readNumber(start) || !readNumber(last)) {
+                    logError();
+                    return ranges;
+                }
+                addP2BRange(start, last);
+            }
+        }
+        else if (version == 3) {
+            qDebug ("p2b version 3");
+            quint32 namecount;
+            if (!readNumber(namecount)) {
+                logError();
+                return ranges;
+            }
+
+            // Reading names although, we don't really care about them
+            for (quint32 i = 0; i < namecount; ++i) {
+                if (!skipName()) {
+                    logError();
+                    return ranges;
+                }
             }
 
-            // Network byte order to Host byte order
-            // asio address_v4 constructor expects it
-            // that way
-            const lt::address_v4 first(ntohl(start));
-            const lt::address_v4 last(ntohl(end));
-            // Apply to bittorrent session
-            try {
-                m_filter.add_rule(first, last, lt::ip_filter::blocked);
-                ++ruleCount;
+            // Reading the ranges
+            quint32 rangecount;
+            if (!readNumber(rangecount)) {
+                logError();
+                return ranges;
             }
-            catch (const std::exception &) {}
 
-            if (m_abort) return ruleCount;
+            for (quint32 i = 0; (i < rangecount) && !abort; ++i) {
+                quint32 name, start, last;
+                if (!readNumber(name) || !readNumber(start) || !readNumber(last)) {
+                    logError();
+                    return ranges;
+                }
+                addP2BRange(start, last);
+            }
         }
+        else {
+            logError();
+        }
+
+        return ranges;
     }
-    else {
-        LogMsg(tr("Parsing Error: The filter file is not a valid PeerGuardian P2B file."), Log::CRITICAL);
-    }
+}
 
-    return ruleCount;
+FilterParserThread::FilterParserThread(QObject *parent)
+    : QThread(parent)
+    , m_abort(false)
+{
+}
+
+FilterParserThread::~FilterParserThread()
+{
+    m_abort = true;
+    wait();
 }
 
 // Process ip filter file
@@ -559,17 +714,29 @@ void FilterParserThread::run()
 {
     qDebug("Processing filter file");
     int ruleCount = 0;
-    if (m_filePath.endsWith(".p2p", Qt::CaseInsensitive)) {
-        // PeerGuardian p2p file
-        ruleCount = parseP2PFilterFile();
-    }
-    else if (m_filePath.endsWith(".p2b", Qt::CaseInsensitive)) {
-        // PeerGuardian p2b file
-        ruleCount = parseP2BFilterFile();
+    try {
+        QFile file(m_filePath);
+        if (file.exists()) {
+            if (file.open(QIODevice::ReadOnly)) {
+                qint64 size = file.size();
+                QByteArray buffer;
+                const char *data = reinterpret_cast<const char *>(file.map(0, size));
+                if (!data) {
+                    buffer = file.readAll();
+                    data = buffer.constData();
+                    size = buffer.size();
+                }
+                ruleCount = parseFilterData(data, size);
+            }
+            else {
+                LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
+            }
+        }
     }
-    else if (m_filePath.endsWith(".dat", Qt::CaseInsensitive)) {
-        // eMule DAT format
-        ruleCount = parseDATFilterFile();
+    catch (const std::exception &) {
+        if (!m_abort)
+            emit IPFilterError();
+        return;
     }
 
     if (m_abort) return;
@@ -584,49 +751,35 @@ void FilterParserThread::run()
     qDebug("IP Filter thread: finished parsing, filter applied");
 }
 
-int FilterParserThread::findAndNullDelimiter(char *const data, const char delimiter, const int start, const int end, const bool reverse)
+int FilterParserThread::parseFilterData(const char *data, const qint64 size)
 {
-    if (!reverse) {
-        for (int i = start; i <= end; ++i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
-            }
-        }
-    }
-    else {
-        for (int i = end; i >= start; --i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
-            }
-        }
+    // An unchanged filter file is loaded from the cache of its parsed ranges
+    const QByteArray sourceHash = filterHash(m_filePath, data, size);
+    int ruleCount = 0;
+    if (loadCache(sourceHash, m_filter, ruleCount)) {
+        qDebug("IP filter loaded from cache");
+        return ruleCount;
     }
 
-    return -1;
-}
-
-int FilterParserThread::trim(char *const data, const int start, const int end)
-{
-    if (start >= end) return start;
-    int newStart = start;
-
-    for (int i = start; i <= end; ++i) {
-        if (isspace(data[i]) != 0) {
-            data[i] = '\0';
-        }
-        else {
-            newStart = i;
-            break;
-        }
+    FilterRanges ranges;
+    if (m_filePath.endsWith(".p2p", Qt::CaseInsensitive)) {
+        // PeerGuardian p2p file
+        ranges = parseTextFilter(data, size, parseP2PLine, m_abort);
     }
-
-    for (int i = end; i >= start; --i) {
-        if (isspace(data[i]) != 0)
-            data[i] = '\0';
-        else
-            break;
+    else if (m_filePath.endsWith(".p2b", Qt::CaseInsensitive)) {
+        // PeerGuardian p2b file
+        ranges = parseP2BFilter(data, size, m_abort);
     }
+    else if (m_filePath.endsWith(".dat", Qt::CaseInsensitive)) {
+        // eMule DAT format
+        ranges = parseTextFilter(data, size, parseDATLine, m_abort);
+    }
+
+    if (m_abort) return 0;
 
-    return newStart;
+    // Overlapping ranges are joined up front so the filter is built from sorted disjoint ranges
+    joinRanges(ranges);
+    m_filter = toIPFilter(ranges);
+    saveCache(sourceHash, ranges);
+    return ranges.ruleCount;
 }
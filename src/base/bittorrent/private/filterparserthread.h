@@ -29,12 +29,12 @@
 #ifndef FILTERPARSERTHREAD_H
 #define FILTERPARSERTHREAD_H
 
+#include <atomic>
+
 #include <libtorrent/ip_filter.hpp>
 
 #include <QThread>
 
-class QDataStream;
-
 class FilterParserThread : public QThread
 {
     Q_OBJECT
@@ -53,14 +53,9 @@ protected:
     void run();
 
 private:
-    int findAndNullDelimiter(char *const data, char delimiter, int start, int end, bool reverse = false);
-    int trim(char *const data, int start, int end);
-    int parseDATFilterFile();
-    int parseP2PFilterFile();
-    int getlineInStream(QDataStream &stream, std::string &name, char delim);
-    int parseP2BFilterFile();
+    int parseFilterData(const char *data, qint64 size);
 
-    bool m_abort;
+    std::atomic<bool> m_abort;
     QString m_filePath;
     lt::ip_filter m_filter;
 };
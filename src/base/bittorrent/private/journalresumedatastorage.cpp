@@ -0,0 +1,433 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "journalresumedatastorage.h"
+
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <zlib.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtEndian>
+
+#include "base/logger.h"
+
+namespace
+{
+    const char JOURNAL_FILENAME[] = "resumedata.journal";
+    const char JOURNAL_SIGNATURE[] = "qBtRDJ01";
+    const int SIGNATURE_SIZE = sizeof(JOURNAL_SIGNATURE) - 1;
+
+    // record layout:
+    // type (1 byte), key size (1 byte), reserved (2 bytes), payload size (4 bytes),
+    // CRC32 of the other header fields, key and payload (4 bytes), key, payload
+    const int RECORD_HEADER_SIZE = 12;
+    const int CHECKSUM_OFFSET = 8;
+
+    const int COMMIT_INTERVAL = 1000; // ms
+    const int MAX_WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+    const qint64 MIN_COMPACTION_SIZE = 16 * 1024 * 1024;
+
+    quint32 recordChecksum(const char *header, const char *body, const int bodySize)
+    {
+        uLong crc = ::crc32(0L, Z_NULL, 0);
+        crc = ::crc32(crc, reinterpret_cast<const Bytef *>(header), CHECKSUM_OFFSET);
+        crc = ::crc32(crc, reinterpret_cast<const Bytef *>(body), static_cast<uInt>(bodySize));
+        return static_cast<quint32>(crc);
+    }
+
+    QByteArray makeRecord(const quint8 type, const QByteArray &key, const QByteArray &payload)
+    {
+        QByteArray record(RECORD_HEADER_SIZE + key.size() + payload.size(), Qt::Uninitialized);
+        char *data = record.data();
+        data[0] = static_cast<char>(type);
+        data[1] = static_cast<char>(key.size());
+        data[2] = 0;
+        data[3] = 0;
+        qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), (data + 4));
+        std::memcpy((data + RECORD_HEADER_SIZE), key.constData(), key.size());
+        std::memcpy((data + RECORD_HEADER_SIZE + key.size()), payload.constData(), payload.size());
+        qToLittleEndian<quint32>(recordChecksum(data, (data + RECORD_HEADER_SIZE), (key.size() + payload.size()))
+                                 , (data + CHECKSUM_OFFSET));
+        return record;
+    }
+
+    qint64 recordSize(const QString &key, const int payloadSize)
+    {
+        return (RECORD_HEADER_SIZE + key.size() + payloadSize);
+    }
+
+    bool syncToDisk(QFile &file)
+    {
+#ifdef Q_OS_WIN
+        return (::_commit(file.handle()) == 0);
+#else
+        return (::fsync(file.handle()) == 0);
+#endif
+    }
+}
+
+JournalResumeDataStorage::JournalResumeDataStorage(const QString &resumeFolderPath, QObject *parent)
+    : ResumeDataStorage {parent}
+    , m_journalPath {QDir(resumeFolderPath).absoluteFilePath(QLatin1String {JOURNAL_FILENAME})}
+    , m_journalSize {SIGNATURE_SIZE}
+    , m_liveDataSize {0}
+    , m_commitTimer {new QTimer {this}}
+{
+    m_commitTimer->setSingleShot(true);
+    m_commitTimer->setInterval(COMMIT_INTERVAL);
+    connect(m_commitTimer, &QTimer::timeout, this, &JournalResumeDataStorage::commit);
+
+    readJournal();
+}
+
+JournalResumeDataStorage::~JournalResumeDataStorage()
+{
+    commit();
+}
+
+QStringList JournalResumeDataStorage::registeredTorrents() const
+{
+    return m_loadedResumeData.keys();
+}
+
+bool JournalResumeDataStorage::load(const QString &hash, QByteArray &resumeData, QByteArray &metadata) const
+{
+    const auto resumeDataIter = m_loadedResumeData.constFind(hash);
+    if (resumeDataIter == m_loadedResumeData.cend())
+        return false;
+
+    resumeData = m_loadedData.mid(resumeDataIter->offset, resumeDataIter->size);
+
+    const auto metadataIter = m_loadedMetadata.constFind(hash);
+    if (metadataIter != m_loadedMetadata.cend())
+        metadata = m_loadedData.mid(metadataIter->offset, metadataIter->size);
+    else
+        metadata.clear();
+
+    return true;
+}
+
+bool JournalResumeDataStorage::loadQueue(QStringList &queue) const
+{
+    queue.clear();
+    if (!m_loadedQueue.isValid())
+        return false;
+
+    const QByteArray data = m_loadedData.mid(m_loadedQueue.offset, m_loadedQueue.size);
+    queue = QString::fromLatin1(data).split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    return true;
+}
+
+void JournalResumeDataStorage::releaseLoadedData()
+{
+    m_loadedData.clear();
+    m_loadedResumeData.clear();
+    m_loadedMetadata.clear();
+    m_loadedQueue = {};
+}
+
+void JournalResumeDataStorage::store(const QString &hash, const QByteArray &resumeData)
+{
+    const qint64 offset = append(RecordType::ResumeData, hash, resumeData);
+    updateIndex(m_resumeData, hash, {offset, resumeData.size()});
+}
+
+void JournalResumeDataStorage::storeMetadata(const QString &hash, const QByteArray &metadata)
+{
+    const qint64 offset = append(RecordType::Metadata, hash, metadata);
+    updateIndex(m_metadata, hash, {offset, metadata.size()});
+}
+
+void JournalResumeDataStorage::storeQueue(const QStringList &queue)
+{
+    const QByteArray data = queue.join(QLatin1Char('\n')).toLatin1();
+    const qint64 offset = append(RecordType::Queue, {}, data);
+    updateQueue({offset, data.size()});
+}
+
+void JournalResumeDataStorage::remove(const QString &hash)
+{
+    if (!m_resumeData.contains(hash) && !m_metadata.contains(hash))
+        return;
+
+    append(RecordType::Remove, hash, {});
+    updateIndex(m_resumeData, hash, {});
+    updateIndex(m_metadata, hash, {});
+}
+
+void JournalResumeDataStorage::removeQueue()
+{
+    if (!m_queue.isValid())
+        return;
+
+    append(RecordType::RemoveQueue, {}, {});
+    updateQueue({});
+}
+
+void JournalResumeDataStorage::flush()
+{
+    commit();
+}
+
+void JournalResumeDataStorage::readJournal()
+{
+    QFile journal {m_journalPath};
+    if (!journal.exists())
+        return;
+
+    if (!journal.open(QIODevice::ReadOnly)) {
+        LogMsg(tr("Couldn't read resume data journal '%1'. Error: %2")
+               .arg(m_journalPath, journal.errorString()), Log::CRITICAL);
+        return;
+    }
+
+    // the whole journal is read at once, then the torrents are loaded from memory
+    m_loadedData = journal.readAll();
+    journal.close();
+
+    if (m_loadedData.isEmpty())
+        return;
+
+    if (!m_loadedData.startsWith(JOURNAL_SIGNATURE)) {
+        const QString backupPath = m_journalPath + QLatin1String {".bad"};
+        QFile::remove(backupPath);
+        QFile::rename(m_journalPath, backupPath);
+        LogMsg(tr("Resume data journal '%1' is corrupted. It was moved to '%2'.")
+               .arg(m_journalPath, backupPath), Log::CRITICAL);
+        m_loadedData.clear();
+        return;
+    }
+
+    const char *data = m_loadedData.constData();
+    const qint64 dataSize = m_loadedData.size();
+    qint64 pos = SIGNATURE_SIZE;
+    while ((dataSize - pos) >= RECORD_HEADER_SIZE) {
+        const char *header = data + pos;
+        const auto type = static_cast<RecordType>(static_cast<quint8>(header[0]));
+        const int keySize = static_cast<quint8>(header[1]);
+        const quint32 payloadSize = qFromLittleEndian<quint32>(header + 4);
+        const qint64 bodySize = keySize + static_cast<qint64>(payloadSize);
+        if ((dataSize - pos - RECORD_HEADER_SIZE) < bodySize) break;
+
+        const char *body = header + RECORD_HEADER_SIZE;
+        if (qFromLittleEndian<quint32>(header + CHECKSUM_OFFSET) != recordChecksum(header, body, static_cast<int>(bodySize)))
+            break;
+
+        const QString key = QString::fromLatin1(body, keySize);
+        const RecordRef ref {(pos + RECORD_HEADER_SIZE + keySize), static_cast<int>(payloadSize)};
+        switch (type) {
+        case RecordType::ResumeData:
+            updateIndex(m_resumeData, key, ref);
+            break;
+        case RecordType::Metadata:
+            updateIndex(m_metadata, key, ref);
+            break;
+        case RecordType::Remove:
+            updateIndex(m_resumeData, key, {});
+            updateIndex(m_metadata, key, {});
+            break;
+        case RecordType::Queue:
+            updateQueue(ref);
+            break;
+        case RecordType::RemoveQueue:
+            updateQueue({});
+            break;
+        default:
+            qDebug("Skipping resume data journal record of unknown type %d", static_cast<int>(type));
+            break;
+        }
+
+        pos += (RECORD_HEADER_SIZE + bodySize);
+    }
+
+    if (pos < dataSize) {
+        // most likely the application was terminated while writing the journal
+        LogMsg(tr("Resume data journal '%1' is damaged at offset %2. %3 bytes of trailing data were discarded.")
+               .arg(m_journalPath).arg(pos).arg(dataSize - pos), Log::WARNING);
+        m_loadedData.truncate(pos);
+        QFile::resize(m_journalPath, pos);
+    }
+
+    m_journalSize = pos;
+    m_loadedResumeData = m_resumeData;
+    m_loadedMetadata = m_metadata;
+    m_loadedQueue = m_queue;
+}
+
+qint64 JournalResumeDataStorage::append(const RecordType type, const QString &key, const QByteArray &payload)
+{
+    const QByteArray keyData = key.toLatin1();
+    const qint64 payloadOffset = m_journalSize + m_writeBuffer.size() + RECORD_HEADER_SIZE + keyData.size();
+    m_writeBuffer.append(makeRecord(static_cast<quint8>(type), keyData, payload));
+
+    // records are written in batches to reduce the number of disk syncs
+    if (m_writeBuffer.size() >= MAX_WRITE_BUFFER_SIZE)
+        commit();
+    else if (!m_commitTimer->isActive())
+        m_commitTimer->start();
+
+    return payloadOffset;
+}
+
+void JournalResumeDataStorage::updateIndex(RecordIndex &index, const QString &key, const RecordRef &ref)
+{
+    const RecordRef oldRef = index.value(key);
+    if (oldRef.isValid())
+        m_liveDataSize -= recordSize(key, oldRef.size);
+
+    if (ref.isValid()) {
+        index[key] = ref;
+        m_liveDataSize += recordSize(key, ref.size);
+    }
+    else {
+        index.remove(key);
+    }
+}
+
+void JournalResumeDataStorage::updateQueue(const RecordRef &ref)
+{
+    if (m_queue.isValid())
+        m_liveDataSize -= recordSize({}, m_queue.size);
+    if (ref.isValid())
+        m_liveDataSize += recordSize({}, ref.size);
+    m_queue = ref;
+}
+
+bool JournalResumeDataStorage::openJournal()
+{
+    if (m_journal.isOpen())
+        return true;
+
+    m_journal.setFileName(m_journalPath);
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        LogMsg(tr("Couldn't open resume data journal '%1' for writing. Error: %2")
+               .arg(m_journalPath, m_journal.errorString()), Log::CRITICAL);
+        return false;
+    }
+
+    if ((m_journal.size() == 0) && (m_journal.write(JOURNAL_SIGNATURE, SIGNATURE_SIZE) != SIGNATURE_SIZE)) {
+        m_journal.close();
+        return false;
+    }
+
+    return true;
+}
+
+void JournalResumeDataStorage::commit()
+{
+    m_commitTimer->stop();
+    if (m_writeBuffer.isEmpty()) return;
+    if (!openJournal()) return;
+
+    if ((m_journal.write(m_writeBuffer) != m_writeBuffer.size()) || !m_journal.flush() || !syncToDisk(m_journal)) {
+        LogMsg(tr("Couldn't write resume data journal '%1'. Error: %2")
+               .arg(m_journalPath, m_journal.errorString()), Log::CRITICAL);
+        // drop partially written data, pending records will be written by the next commit
+        m_journal.close();
+        QFile::resize(m_journalPath, m_journalSize);
+        return;
+    }
+
+    m_journalSize += m_writeBuffer.size();
+    m_writeBuffer.clear();
+
+    const qint64 outdatedDataSize = m_journalSize - SIGNATURE_SIZE - m_liveDataSize;
+    if ((outdatedDataSize > 0)
+        && ((m_liveDataSize == 0) || ((m_journalSize > MIN_COMPACTION_SIZE) && (outdatedDataSize > m_liveDataSize)))) {
+        compact();
+    }
+}
+
+void JournalResumeDataStorage::compact()
+{
+    Q_ASSERT(m_writeBuffer.isEmpty());
+
+    qDebug("Compacting resume data journal (%lld bytes, %lld bytes of actual data)", m_journalSize, m_liveDataSize);
+
+    m_journal.close();
+
+    QFile source {m_journalPath};
+    QSaveFile target {m_journalPath};
+    if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly)) {
+        LogMsg(tr("Couldn't compact resume data journal '%1'.").arg(m_journalPath), Log::WARNING);
+        return;
+    }
+
+    bool ok = (target.write(JOURNAL_SIGNATURE, SIGNATURE_SIZE) == SIGNATURE_SIZE);
+    qint64 targetSize = SIGNATURE_SIZE;
+    const auto copyRecord = [&source, &target, &ok, &targetSize](const RecordType type, const QString &key, const RecordRef &ref) -> RecordRef
+    {
+        if (!ok || !source.seek(ref.offset)) {
+            ok = false;
+            return {};
+        }
+
+        const QByteArray payload = source.read(ref.size);
+        const QByteArray keyData = key.toLatin1();
+        const QByteArray record = makeRecord(static_cast<quint8>(type), keyData, payload);
+        if ((payload.size() != ref.size) || (target.write(record) != record.size())) {
+            ok = false;
+            return {};
+        }
+
+        const RecordRef newRef {(targetSize + RECORD_HEADER_SIZE + keyData.size()), ref.size};
+        targetSize += record.size();
+        return newRef;
+    };
+
+    RecordIndex resumeData;
+    for (auto it = m_resumeData.cbegin(); ok && (it != m_resumeData.cend()); ++it)
+        resumeData.insert(it.key(), copyRecord(RecordType::ResumeData, it.key(), it.value()));
+    RecordIndex metadata;
+    for (auto it = m_metadata.cbegin(); ok && (it != m_metadata.cend()); ++it)
+        metadata.insert(it.key(), copyRecord(RecordType::Metadata, it.key(), it.value()));
+    const RecordRef queue = m_queue.isValid() ? copyRecord(RecordType::Queue, {}, m_queue) : RecordRef {};
+
+    source.close();
+    if (!ok || !target.commit()) {
+        target.cancelWriting();
+        LogMsg(tr("Couldn't compact resume data journal '%1'. Error: %2")
+               .arg(m_journalPath, target.errorString()), Log::WARNING);
+        return;
+    }
+
+    m_resumeData = resumeData;
+    m_metadata = metadata;
+    m_queue = queue;
+    m_journalSize = targetSize;
+}
@@ -0,0 +1,117 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QHash>
+
+#include "resumedatastorage.h"
+
+class QTimer;
+
+// Stores resume data of all the torrents in a single append-only journal file.
+// Every record is protected by checksum so a torn write at the end of the journal
+// is detected and discarded on startup. Records are written in batches (group commits)
+// and the journal is compacted once it accumulates too much outdated data.
+class JournalResumeDataStorage final : public ResumeDataStorage
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(JournalResumeDataStorage)
+
+public:
+    explicit JournalResumeDataStorage(const QString &resumeFolderPath, QObject *parent = nullptr);
+    ~JournalResumeDataStorage() override;
+
+    QStringList registeredTorrents() const override;
+    bool load(const QString &hash, QByteArray &resumeData, QByteArray &metadata) const override;
+    bool loadQueue(QStringList &queue) const override;
+    void releaseLoadedData() override;
+
+    void store(const QString &hash, const QByteArray &resumeData) override;
+    void storeMetadata(const QString &hash, const QByteArray &metadata) override;
+    void storeQueue(const QStringList &queue) override;
+    void remove(const QString &hash) override;
+    void removeQueue() override;
+    void flush() override;
+
+private:
+    enum class RecordType : quint8
+    {
+        ResumeData = 1,
+        Metadata = 2,
+        Remove = 3,
+        Queue = 4,
+        RemoveQueue = 5
+    };
+
+    // location of the record payload in the journal
+    struct RecordRef
+    {
+        RecordRef(const qint64 payloadOffset = -1, const int payloadSize = 0)
+            : offset {payloadOffset}
+            , size {payloadSize}
+        {
+        }
+
+        bool isValid() const { return offset >= 0; }
+
+        qint64 offset;
+        int size;
+    };
+
+    using RecordIndex = QHash<QString, RecordRef>;
+
+    void readJournal();
+    // returns offset of the record payload
+    qint64 append(RecordType type, const QString &key, const QByteArray &payload);
+    void updateIndex(RecordIndex &index, const QString &key, const RecordRef &ref);
+    void updateQueue(const RecordRef &ref);
+    void commit();
+    void compact();
+    bool openJournal();
+
+    const QString m_journalPath;
+
+    // journal content loaded on startup
+    QByteArray m_loadedData;
+    RecordIndex m_loadedResumeData;
+    RecordIndex m_loadedMetadata;
+    RecordRef m_loadedQueue;
+
+    // actual journal state
+    RecordIndex m_resumeData;
+    RecordIndex m_metadata;
+    RecordRef m_queue;
+    qint64 m_journalSize;
+    qint64 m_liveDataSize;
+
+    QFile m_journal;
+    QByteArray m_writeBuffer;
+    QTimer *m_commitTimer;
+};
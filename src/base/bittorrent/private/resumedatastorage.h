@@ -0,0 +1,64 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+class QByteArray;
+
+// Abstract storage of the torrents resume data.
+// Loading methods are used on startup and can be called concurrently from multiple threads.
+// Storing methods are invoked (as slots) in the fastresume data writing thread.
+class ResumeDataStorage : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ResumeDataStorage)
+
+public:
+    explicit ResumeDataStorage(QObject *parent = nullptr)
+        : QObject {parent}
+    {
+    }
+
+    virtual QStringList registeredTorrents() const = 0;
+    virtual bool load(const QString &hash, QByteArray &resumeData, QByteArray &metadata) const = 0;
+    // returns false if torrents queue wasn't stored at all
+    virtual bool loadQueue(QStringList &queue) const = 0;
+    // called when startup loading is finished
+    virtual void releaseLoadedData() {}
+
+public slots:
+    virtual void store(const QString &hash, const QByteArray &resumeData) = 0;
+    virtual void storeMetadata(const QString &hash, const QByteArray &metadata) = 0;
+    virtual void storeQueue(const QStringList &queue) = 0;
+    virtual void remove(const QString &hash) = 0;
+    virtual void removeQueue() = 0;
+    virtual void flush() {}
+};
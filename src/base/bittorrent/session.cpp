@@ -31,6 +31,8 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <limits>
+#include <memory>
 #include <queue>
 #include <string>
 
@@ -41,14 +43,22 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileSystemWatcher>
 #include <QHostAddress>
+#include <QMutex>
 #include <QNetworkAddressEntry>
 #include <QNetworkInterface>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QString>
 #include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 #include <QUuid>
+#include <QWaitCondition>
 
 #include <libtorrent/alert_types.hpp>
 #include <libtorrent/bdecode.hpp>
@@ -81,9 +91,10 @@
 #include "base/utils/random.h"
 #include "magneturi.h"
 #include "private/bandwidthscheduler.h"
+#include "private/directoryresumedatastorage.h"
 #include "private/filterparserthread.h"
+#include "private/journalresumedatastorage.h"
 #include "private/portforwarderimpl.h"
-#include "private/resumedatasavingmanager.h"
 #include "private/statistics.h"
 #include "torrenthandle.h"
 #include "tracker.h"
@@ -96,6 +107,9 @@ using NETIO_STATUS = LONG;
 static const char PEER_ID[] = "qB";
 static const char RESUME_FOLDER[] = "BT_backup";
 static const char USER_AGENT[] = "qBittorrent/" QBT_VERSION_2;
+static const int RESUME_DATA_SCHEDULER_INTERVAL = 1000; // ms
+// delay before reloading a modified IP filter file, lets the writer finish
+static const int IP_FILTER_RELOAD_DELAY = 2000; // ms
 
 using namespace BitTorrent;
 
@@ -111,7 +125,6 @@ namespace
     using LTString = lt::string_view;
 #endif
 
-    bool readFile(const QString &path, QByteArray &buf);
     bool loadTorrentResumeData(const QByteArray &data, CreateTorrentParams &torrentParams, int &prio, MagnetUri &magnetUri);
 
     void torrentQueuePositionUp(const lt::torrent_handle &handle);
@@ -123,6 +136,70 @@ namespace
     QString convertIfaceNameToGuid(const QString &name);
 #endif
 
+    struct TorrentResumeData
+    {
+        QString hash;
+        MagnetUri magnetUri;
+        CreateTorrentParams addTorrentData;
+        QByteArray data;
+        TorrentInfo torrentInfo;
+        int queuePosition = 0;
+        bool isValid = false;
+    };
+
+    // Loaded items that haven't been taken by the consumer yet
+    const int MAX_RESUME_DATA_READ_AHEAD = 64;
+
+    // Reads and decodes resume data of the given torrents on a pool of worker threads.
+    // Items are picked up in the requested order so the consumer can start adding
+    // torrents to the session while the rest of them are still being loaded.
+    class ResumeDataLoader
+    {
+        Q_DISABLE_COPY(ResumeDataLoader)
+
+    public:
+        ResumeDataLoader(const ResumeDataStorage *storage, const QStringList &hashes);
+        ~ResumeDataLoader();
+
+        int count() const;
+        // blocks until the item at the given index is loaded
+        TorrentResumeData take(int index);
+
+    private:
+        class Worker;
+
+        void loadItems();
+        void loadItem(int index);
+
+        const ResumeDataStorage *m_storage;
+        const QStringList m_hashes;
+        QVector<TorrentResumeData> m_items;
+        QVector<bool> m_loaded;
+        QAtomicInt m_nextIndex;
+        QMutex m_mutex;
+        QWaitCondition m_itemLoaded;
+        // a worker holds a slot from picking up an item until the consumer takes it
+        QSemaphore m_readAheadSlots;
+        QThreadPool m_threadPool;
+    };
+
+    class AsyncTask final : public QRunnable
+    {
+    public:
+        explicit AsyncTask(const std::function<void ()> &func)
+            : m_func {func}
+        {
+        }
+
+        void run() override
+        {
+            m_func();
+        }
+
+    private:
+        const std::function<void ()> m_func;
+    };
+
     QStringMap map_cast(const QVariantMap &map)
     {
         QStringMap result;
@@ -359,6 +436,9 @@ Session::Session(QObject *parent)
                             return tmp;
                         }
                  )
+    , m_resumeDataStorageType(BITTORRENT_SESSION_KEY("ResumeDataStorageType"), ResumeDataStorageType::Directory)
+    , m_resumeDataMigratedStorageType(BITTORRENT_SESSION_KEY("ResumeDataMigratedStorageType"), ResumeDataStorageType::Directory)
+    , m_resumeDataSavingRateLimit(BITTORRENT_SESSION_KEY("ResumeDataSavingRateLimit"), 0, lowerLimited(0))
     , m_wasPexEnabled(m_isPeXEnabled)
     , m_numResumeData(0)
     , m_extraLimit(0)
@@ -374,7 +454,7 @@ Session::Session(QObject *parent)
     connect(m_recentErroredTorrentsTimer, &QTimer::timeout, this, [this]() { m_recentErroredTorrents.clear(); });
 
     m_seedingLimitTimer = new QTimer(this);
-    m_seedingLimitTimer->setInterval(10000);
+    m_seedingLimitTimer->setSingleShot(true);
     connect(m_seedingLimitTimer, &QTimer::timeout, this, &Session::processShareLimits);
 
     // Set severity level of libtorrent session
@@ -475,7 +555,7 @@ Session::Session(QObject *parent)
 
     m_statistics = new Statistics(this);
 
-    updateSeedingLimitTimer();
+    m_shareLimitClock.start();
     populateAdditionalTrackers();
 
     enableTracker(isTrackerEnabled());
@@ -489,10 +569,15 @@ Session::Session(QObject *parent)
     connect(&m_networkManager, &QNetworkConfigurationManager::configurationRemoved, this, &Session::networkConfigurationChange);
     connect(&m_networkManager, &QNetworkConfigurationManager::configurationChanged, this, &Session::networkConfigurationChange);
 
+    // Blocking libtorrent requests are performed by a single worker
+    // thread so the event loop isn't stalled by them
+    m_asyncWorker = new QThreadPool(this);
+    m_asyncWorker->setMaxThreadCount(1);
+
+    initResumeDataStorage();
     m_ioThread = new QThread(this);
-    m_resumeDataSavingManager = new ResumeDataSavingManager {m_resumeFolderPath};
-    m_resumeDataSavingManager->moveToThread(m_ioThread);
-    connect(m_ioThread, &QThread::finished, m_resumeDataSavingManager, &QObject::deleteLater);
+    m_resumeDataStorage->moveToThread(m_ioThread);
+    connect(m_ioThread, &QThread::finished, m_resumeDataStorage, &QObject::deleteLater);
     m_ioThread->start();
 
     // Regular saving of fastresume data
@@ -504,6 +589,12 @@ Session::Session(QObject *parent)
         m_resumeDataTimer->start();
     }
 
+    // Resume data requests are spread over time to avoid bursts of disk writes
+    m_resumeDataSchedulerTimer = new QTimer(this);
+    m_resumeDataSchedulerTimer->setInterval(RESUME_DATA_SCHEDULER_INTERVAL);
+    connect(m_resumeDataSchedulerTimer, &QTimer::timeout, this, &Session::processResumeDataQueue);
+    m_resumeDataClock.start();
+
     // initialize PortForwarder instance
     new PortForwarderImpl {m_nativeSession};
 
@@ -895,6 +986,15 @@ bool Session::isTrackerEnabled() const
     return m_isTrackerEnabled;
 }
 
+bool Session::trackerStatistics(TrackerStatistics &stats) const
+{
+    if (!m_tracker)
+        return false;
+
+    stats = m_tracker->statistics();
+    return true;
+}
+
 void Session::setTrackerEnabled(const bool enabled)
 {
     if (isTrackerEnabled() != enabled) {
@@ -917,7 +1017,7 @@ void Session::setGlobalMaxRatio(qreal ratio)
 
     if (ratio != globalMaxRatio()) {
         m_globalMaxRatio = ratio;
-        updateSeedingLimitTimer();
+        rescheduleShareLimits();
     }
 }
 
@@ -933,7 +1033,7 @@ void Session::setGlobalMaxSeedingMinutes(int minutes)
 
     if (minutes != globalMaxSeedingMinutes()) {
         m_globalMaxSeedingMinutes = minutes;
-        updateSeedingLimitTimer();
+        rescheduleShareLimits();
     }
 }
 
@@ -943,6 +1043,10 @@ Session::~Session()
     // Do some BT related saving
     saveResumeData();
 
+    // Pending asynchronous requests can't outlive lt::session
+    m_asyncWorker->clear();
+    m_asyncWorker->waitForDone();
+
     // We must delete FilterParserThread
     // before we delete lt::session
     if (m_filterParser)
@@ -955,6 +1059,8 @@ Session::~Session()
     qDebug("Deleting the session");
     delete m_nativeSession;
 
+    // make sure all the pending resume data is written
+    QMetaObject::invokeMethod(m_resumeDataStorage, "flush", Qt::BlockingQueuedConnection);
     m_ioThread->quit();
     m_ioThread->wait();
 
@@ -1503,58 +1609,184 @@ void Session::processShareLimits()
 {
     qDebug("Processing share limits...");
 
-    for (TorrentHandle *const torrent : asConst(torrents())) {
-        if (torrent->isSeed() && !torrent->isForced()) {
-            if (torrent->ratioLimit() != TorrentHandle::NO_RATIO_LIMIT) {
-                const qreal ratio = torrent->realRatio();
-                qreal ratioLimit = torrent->ratioLimit();
-                if (ratioLimit == TorrentHandle::USE_GLOBAL_RATIO)
-                    // If Global Max Ratio is really set...
-                    ratioLimit = globalMaxRatio();
-
-                if (ratioLimit >= 0) {
-                    qDebug("Ratio: %f (limit: %f)", ratio, ratioLimit);
-
-                    if ((ratio <= TorrentHandle::MAX_RATIO) && (ratio >= ratioLimit)) {
-                        Logger *const logger = Logger::instance();
-                        if (m_maxRatioAction == Remove) {
-                            logger->addMessage(tr("'%1' reached the maximum ratio you set. Removed.").arg(torrent->name()));
-                            deleteTorrent(torrent->hash());
-                        }
-                        else if (!torrent->isPaused()) {
-                            torrent->pause();
-                            logger->addMessage(tr("'%1' reached the maximum ratio you set. Paused.").arg(torrent->name()));
-                        }
-                        continue;
-                    }
+    // Collect due torrents first since applying the limits can
+    // remove torrents and reschedule the remaining ones
+    const qint64 now = m_shareLimitClock.elapsed();
+    QVector<InfoHash> dueTorrents;
+    while (!m_shareLimitQueue.isEmpty() && (m_shareLimitQueue.firstKey() <= now)) {
+        const InfoHash hash = m_shareLimitQueue.first();
+        m_shareLimitQueue.erase(m_shareLimitQueue.begin());
+        m_shareLimitTimes.remove(hash);
+        dueTorrents.append(hash);
+    }
+
+    for (const InfoHash &hash : asConst(dueTorrents)) {
+        TorrentHandle *const torrent = m_torrents.value(hash);
+        if (torrent && !applyShareLimits(torrent))
+            scheduleShareLimitCheck(torrent);
+    }
+
+    updateShareLimitTimer();
+}
+
+bool Session::applyShareLimits(TorrentHandle *const torrent)
+{
+    if (!torrent->isSeed() || torrent->isForced())
+        return false;
+
+    if (torrent->ratioLimit() != TorrentHandle::NO_RATIO_LIMIT) {
+        const qreal ratio = torrent->realRatio();
+        qreal ratioLimit = torrent->ratioLimit();
+        if (ratioLimit == TorrentHandle::USE_GLOBAL_RATIO)
+            // If Global Max Ratio is really set...
+            ratioLimit = globalMaxRatio();
+
+        if (ratioLimit >= 0) {
+            qDebug("Ratio: %f (limit: %f)", ratio, ratioLimit);
+
+            if ((ratio <= TorrentHandle::MAX_RATIO) && (ratio >= ratioLimit)) {
+                Logger *const logger = Logger::instance();
+                if (m_maxRatioAction == Remove) {
+                    logger->addMessage(tr("'%1' reached the maximum ratio you set. Removed.").arg(torrent->name()));
+                    deleteTorrent(torrent->hash());
                 }
+                else if (!torrent->isPaused()) {
+                    torrent->pause();
+                    logger->addMessage(tr("'%1' reached the maximum ratio you set. Paused.").arg(torrent->name()));
+                }
+                return true;
             }
+        }
+    }
 
-            if (torrent->seedingTimeLimit() != TorrentHandle::NO_SEEDING_TIME_LIMIT) {
-                const int seedingTimeInMinutes = torrent->seedingTime() / 60;
-                int seedingTimeLimit = torrent->seedingTimeLimit();
-                if (seedingTimeLimit == TorrentHandle::USE_GLOBAL_SEEDING_TIME)
-                     // If Global Seeding Time Limit is really set...
-                    seedingTimeLimit = globalMaxSeedingMinutes();
-
-                if (seedingTimeLimit >= 0) {
-                    qDebug("Seeding Time: %d (limit: %d)", seedingTimeInMinutes, seedingTimeLimit);
-
-                    if ((seedingTimeInMinutes <= TorrentHandle::MAX_SEEDING_TIME) && (seedingTimeInMinutes >= seedingTimeLimit)) {
-                        Logger *const logger = Logger::instance();
-                        if (m_maxRatioAction == Remove) {
-                            logger->addMessage(tr("'%1' reached the maximum seeding time you set. Removed.").arg(torrent->name()));
-                            deleteTorrent(torrent->hash());
-                        }
-                        else if (!torrent->isPaused()) {
-                            torrent->pause();
-                            logger->addMessage(tr("'%1' reached the maximum seeding time you set. Paused.").arg(torrent->name()));
-                        }
-                    }
+    if (torrent->seedingTimeLimit() != TorrentHandle::NO_SEEDING_TIME_LIMIT) {
+        const int seedingTimeInMinutes = torrent->seedingTime() / 60;
+        int seedingTimeLimit = torrent->seedingTimeLimit();
+        if (seedingTimeLimit == TorrentHandle::USE_GLOBAL_SEEDING_TIME)
+             // If Global Seeding Time Limit is really set...
+            seedingTimeLimit = globalMaxSeedingMinutes();
+
+        if (seedingTimeLimit >= 0) {
+            qDebug("Seeding Time: %d (limit: %d)", seedingTimeInMinutes, seedingTimeLimit);
+
+            if ((seedingTimeInMinutes <= TorrentHandle::MAX_SEEDING_TIME) && (seedingTimeInMinutes >= seedingTimeLimit)) {
+                Logger *const logger = Logger::instance();
+                if (m_maxRatioAction == Remove) {
+                    logger->addMessage(tr("'%1' reached the maximum seeding time you set. Removed.").arg(torrent->name()));
+                    deleteTorrent(torrent->hash());
                 }
+                else if (!torrent->isPaused()) {
+                    torrent->pause();
+                    logger->addMessage(tr("'%1' reached the maximum seeding time you set. Paused.").arg(torrent->name()));
+                }
+                return true;
             }
         }
     }
+
+    return false;
+}
+
+// Returns the time (according to m_shareLimitClock) the torrent is expected
+// to reach its share limits at or -1 if it can't reach them in its current state.
+// The projection is refreshed each time the torrent state is updated so it
+// doesn't need to be precise for active torrents.
+qint64 Session::projectShareLimitTime(const TorrentHandle *torrent) const
+{
+    if (!torrent->isSeed() || torrent->isForced())
+        return -1;
+    // Nothing to do with paused torrents unless they should be removed
+    if (torrent->isPaused() && (m_maxRatioAction != Remove))
+        return -1;
+
+    const qint64 now = m_shareLimitClock.elapsed();
+    qint64 result = -1;
+
+    qreal ratioLimit = torrent->ratioLimit();
+    if (ratioLimit == TorrentHandle::USE_GLOBAL_RATIO)
+        ratioLimit = globalMaxRatio();
+    if (ratioLimit >= 0) {
+        const qreal ratio = torrent->realRatio();
+        if (ratio >= ratioLimit) {
+            return now;
+        }
+        else if (!torrent->isPaused() && (torrent->uploadPayloadRate() > 0)) {
+            // Same estimation of downloaded amount as TorrentHandle::realRatio() uses
+            const qreal downloaded = (torrent->totalDownload() < (torrent->completedSize() * 0.01))
+                ? torrent->completedSize() : torrent->totalDownload();
+            const qreal bytesLeft = (ratioLimit * downloaded) - torrent->totalUpload();
+            const qreal msecsLeft = std::max<qreal>(bytesLeft, 0) * 1000 / torrent->uploadPayloadRate();
+            result = now + static_cast<qint64>(std::min<qreal>(msecsLeft, std::numeric_limits<int>::max()));
+        }
+    }
+
+    int seedingTimeLimit = torrent->seedingTimeLimit();
+    if (seedingTimeLimit == TorrentHandle::USE_GLOBAL_SEEDING_TIME)
+        seedingTimeLimit = globalMaxSeedingMinutes();
+    if ((seedingTimeLimit >= 0) && ((torrent->seedingTime() / 60) <= TorrentHandle::MAX_SEEDING_TIME)) {
+        const qlonglong secsLeft = (seedingTimeLimit * 60LL) - torrent->seedingTime();
+        if (secsLeft <= 0)
+            return now;
+        if (!torrent->isPaused()) {
+            const qint64 seedingLimitTime = now + (secsLeft * 1000);
+            if ((result < 0) || (seedingLimitTime < result))
+                result = seedingLimitTime;
+        }
+    }
+
+    return result;
+}
+
+void Session::scheduleShareLimitCheck(const TorrentHandle *torrent)
+{
+    const InfoHash hash = torrent->hash();
+    const qint64 time = projectShareLimitTime(torrent);
+    const qint64 scheduledTime = m_shareLimitTimes.value(hash, -1);
+    if (time == scheduledTime) return;
+
+    if (scheduledTime >= 0) {
+        m_shareLimitQueue.remove(scheduledTime, hash);
+        m_shareLimitTimes.remove(hash);
+    }
+
+    if (time >= 0) {
+        m_shareLimitQueue.insert(time, hash);
+        m_shareLimitTimes.insert(hash, time);
+    }
+}
+
+void Session::unscheduleShareLimitCheck(const InfoHash &hash)
+{
+    const auto iter = m_shareLimitTimes.find(hash);
+    if (iter == m_shareLimitTimes.end()) return;
+
+    m_shareLimitQueue.remove(iter.value(), hash);
+    m_shareLimitTimes.erase(iter);
+}
+
+void Session::rescheduleShareLimits()
+{
+    for (const TorrentHandle *torrent : asConst(m_torrents))
+        scheduleShareLimitCheck(torrent);
+    updateShareLimitTimer();
+}
+
+void Session::updateShareLimitTimer()
+{
+    if (m_shareLimitQueue.isEmpty()) {
+        m_seedingLimitTimer->stop();
+        return;
+    }
+
+    // Projections that come due repeatedly are throttled to once per second
+    const int interval = static_cast<int>(qBound<qint64>(1000, (m_shareLimitQueue.firstKey() - m_shareLimitClock.elapsed())
+                                                         , std::numeric_limits<int>::max()));
+    // Don't postpone the pending check, otherwise frequent
+    // rescheduling could prevent the timer from ever firing
+    if (m_seedingLimitTimer->isActive() && (m_seedingLimitTimer->remainingTime() <= interval))
+        return;
+
+    m_seedingLimitTimer->start(interval);
 }
 
 // Add to BitTorrent session the downloaded torrent file
@@ -1632,6 +1864,9 @@ bool Session::deleteTorrent(const QString &hash, const bool deleteLocalFiles)
     qDebug("Deleting torrent with hash: %s", qUtf8Printable(torrent->hash()));
     emit torrentAboutToBeRemoved(torrent);
 
+    handleTorrentStatusReportChanged(torrent->statusReportCategories(), 0);
+    unscheduleShareLimitCheck(torrent->hash());
+
     // Remove it from session
     if (deleteLocalFiles) {
         const QString rootPath = torrent->rootPath(true);
@@ -1661,13 +1896,8 @@ bool Session::deleteTorrent(const QString &hash, const bool deleteLocalFiles)
         }
     }
 
-    // Remove it from torrent resume directory
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QStringList filters;
-    filters << QString("%1.*").arg(torrent->hash());
-    const QStringList files = resumeDataDir.entryList(filters, QDir::Files, QDir::Unsorted);
-    for (const QString &file : files)
-        Utils::Fs::forceRemove(resumeDataDir.absoluteFilePath(file));
+    // Remove it from torrent resume data storage
+    QMetaObject::invokeMethod(m_resumeDataStorage, "remove", Q_ARG(QString, torrent->hash()));
 
     delete torrent;
     qDebug("Torrent deleted.");
@@ -2108,22 +2338,33 @@ void Session::exportTorrentFile(TorrentHandle *const torrent, TorrentExportFolde
     Q_ASSERT(((folder == TorrentExportFolder::Regular) && !torrentExportDirectory().isEmpty()) ||
              ((folder == TorrentExportFolder::Finished) && !finishedTorrentExportDirectory().isEmpty()));
 
+    const QByteArray torrentData = torrent->torrentFileData();
+    if (torrentData.isEmpty()) return;
+
+    const auto hasSameContent = [&torrentData](const QString &path) -> bool
+    {
+        QFile file {path};
+        return (file.size() == torrentData.size()) && file.open(QIODevice::ReadOnly)
+                && (file.readAll() == torrentData);
+    };
+
     const QString validName = Utils::Fs::toValidFileSystemName(torrent->name());
-    const QString torrentFilename = QString("%1.torrent").arg(torrent->hash());
     QString torrentExportFilename = QString("%1.torrent").arg(validName);
-    const QString torrentPath = QDir(m_resumeFolderPath).absoluteFilePath(torrentFilename);
     const QDir exportPath(folder == TorrentExportFolder::Regular ? torrentExportDirectory() : finishedTorrentExportDirectory());
     if (exportPath.exists() || exportPath.mkpath(exportPath.absolutePath())) {
         QString newTorrentPath = exportPath.absoluteFilePath(torrentExportFilename);
         int counter = 0;
-        while (QFile::exists(newTorrentPath) && !Utils::Fs::sameFiles(torrentPath, newTorrentPath)) {
+        while (QFile::exists(newTorrentPath) && !hasSameContent(newTorrentPath)) {
             // Append number to torrent name to make it unique
             torrentExportFilename = QString("%1 %2.torrent").arg(validName).arg(++counter);
             newTorrentPath = exportPath.absoluteFilePath(torrentExportFilename);
         }
 
-        if (!QFile::exists(newTorrentPath))
-            QFile::copy(torrentPath, newTorrentPath);
+        if (!QFile::exists(newTorrentPath)) {
+            QFile file {newTorrentPath};
+            if (file.open(QIODevice::WriteOnly))
+                file.write(torrentData);
+        }
     }
 }
 
@@ -2135,8 +2376,112 @@ void Session::generateResumeData(const bool final)
         if (!final && !torrent->needSaveResumeData()) continue;
         if (torrent->hasMissingFiles() || torrent->hasError()) continue;
 
-        saveTorrentResumeData(torrent);
+        if (final) {
+            m_queuedResumeData.remove(torrent->hash());
+            requestResumeData(torrent->hash());
+        }
+        else {
+            enqueueResumeDataRequest(torrent->hash(), false);
+        }
+    }
+
+    if (final) {
+        // There is no time left to spread the load
+        dispatchResumeDataRequests(m_urgentResumeDataQueue, true, std::numeric_limits<int>::max());
+        m_regularResumeDataQueue.clear();
+        m_queuedResumeData.clear();
+        m_resumeDataSchedulerTimer->stop();
+    }
+    else {
+        // Regular requests are spread over the first half of saving interval
+        const int spreadTicks = std::max<int>(1, (saveResumeDataInterval() * 60 * 1000 / 2) / RESUME_DATA_SCHEDULER_INTERVAL);
+        m_regularResumeDataBatchSize = (m_regularResumeDataQueue.size() + spreadTicks - 1) / spreadTicks;
     }
+
+    updateResumeDataStatus();
+}
+
+void Session::enqueueResumeDataRequest(const InfoHash &hash, const bool urgent)
+{
+    // Repeated requests for the same torrent are coalesced
+    const auto iter = m_queuedResumeData.find(hash);
+    if (iter != m_queuedResumeData.end()) {
+        if (!urgent || iter.value()) return;
+
+        // promote it to the urgent queue, outdated regular queue entry will be skipped
+        iter.value() = true;
+        m_urgentResumeDataQueue.enqueue(hash);
+    }
+    else {
+        m_queuedResumeData.insert(hash, urgent);
+        if (urgent)
+            m_urgentResumeDataQueue.enqueue(hash);
+        else
+            m_regularResumeDataQueue.enqueue(hash);
+    }
+
+    if (!m_resumeDataRequestTimes.contains(hash))
+        m_resumeDataRequestTimes.insert(hash, m_resumeDataClock.elapsed());
+
+    if (!m_resumeDataSchedulerTimer->isActive())
+        m_resumeDataSchedulerTimer->start();
+}
+
+int Session::dispatchResumeDataRequests(QQueue<InfoHash> &queue, const bool urgent, const int maxCount)
+{
+    int count = 0;
+    while ((count < maxCount) && !queue.isEmpty()) {
+        const InfoHash hash = queue.dequeue();
+        const auto iter = m_queuedResumeData.find(hash);
+        // already dispatched or promoted to the urgent queue
+        if ((iter == m_queuedResumeData.end()) || (iter.value() != urgent)) continue;
+
+        m_queuedResumeData.erase(iter);
+        if (requestResumeData(hash))
+            ++count;
+    }
+
+    return count;
+}
+
+bool Session::requestResumeData(const InfoHash &hash)
+{
+    TorrentHandle *const torrent = m_torrents.value(hash);
+    if (!torrent || !torrent->isValid()) {
+        m_resumeDataRequestTimes.remove(hash);
+        return false;
+    }
+
+    qDebug("Saving fastresume data for %s", qUtf8Printable(torrent->name()));
+    if (!m_resumeDataRequestTimes.contains(hash))
+        m_resumeDataRequestTimes.insert(hash, m_resumeDataClock.elapsed());
+    torrent->saveResumeData();
+    ++m_numResumeData;
+    return true;
+}
+
+void Session::processResumeDataQueue()
+{
+    const int rateLimit = resumeDataSavingRateLimit();
+    int budget = (rateLimit > 0)
+            ? std::max(1, (rateLimit * RESUME_DATA_SCHEDULER_INTERVAL / 1000))
+            : std::numeric_limits<int>::max();
+
+    budget -= dispatchResumeDataRequests(m_urgentResumeDataQueue, true, budget);
+    dispatchResumeDataRequests(m_regularResumeDataQueue, false, std::min(budget, m_regularResumeDataBatchSize));
+
+    if (m_queuedResumeData.isEmpty()) {
+        m_urgentResumeDataQueue.clear();
+        m_regularResumeDataQueue.clear();
+        m_resumeDataSchedulerTimer->stop();
+    }
+
+    updateResumeDataStatus();
+}
+
+void Session::updateResumeDataStatus()
+{
+    m_status.resumeDataPending = m_queuedResumeData.size() + m_numResumeData;
 }
 
 // Called on exit
@@ -2180,19 +2525,12 @@ void Session::saveTorrentsQueue()
             queue[queuePos] = torrent->hash();
     }
 
-    QByteArray data;
-    for (const QString &hash : asConst(queue))
-        data += (hash.toLatin1() + '\n');
-
-    const QString filename = QLatin1String {"queue"};
-    QMetaObject::invokeMethod(m_resumeDataSavingManager, "save"
-                              , Q_ARG(QString, filename), Q_ARG(QByteArray, data));
+    QMetaObject::invokeMethod(m_resumeDataStorage, "storeQueue", Q_ARG(QStringList, queue.values()));
 }
 
 void Session::removeTorrentsQueue()
 {
-    const QString filename = QLatin1String {"queue"};
-    QMetaObject::invokeMethod(m_resumeDataSavingManager, "remove", Q_ARG(QString, filename));
+    QMetaObject::invokeMethod(m_resumeDataStorage, "removeQueue");
 }
 
 void Session::setDefaultSavePath(QString path)
@@ -2485,6 +2823,27 @@ void Session::setSaveResumeDataInterval(const uint value)
     }
 }
 
+int Session::resumeDataSavingRateLimit() const
+{
+    return m_resumeDataSavingRateLimit;
+}
+
+void Session::setResumeDataSavingRateLimit(const int limit)
+{
+    m_resumeDataSavingRateLimit = std::max(0, limit);
+}
+
+ResumeDataStorageType Session::resumeDataStorageType() const
+{
+    return m_resumeDataStorageType;
+}
+
+void Session::setResumeDataStorageType(const ResumeDataStorageType type)
+{
+    // takes effect after restart
+    m_resumeDataStorageType = type;
+}
+
 int Session::port() const
 {
     static int randomPort = Utils::Random::rand(1024, 65535);
@@ -3269,7 +3628,10 @@ MaxRatioAction Session::maxRatioAction() const
 
 void Session::setMaxRatioAction(const MaxRatioAction act)
 {
-    m_maxRatioAction = static_cast<int>(act);
+    if (act != maxRatioAction()) {
+        m_maxRatioAction = static_cast<int>(act);
+        rescheduleShareLimits();
+    }
 }
 
 // If this functions returns true, we cannot add torrent to session,
@@ -3281,29 +3643,43 @@ bool Session::isKnownTorrent(const InfoHash &hash) const
             || m_loadedMetadata.contains(hash));
 }
 
-void Session::updateSeedingLimitTimer()
+void Session::handleTorrentShareLimitChanged(TorrentHandle *const torrent)
 {
-    if ((globalMaxRatio() == TorrentHandle::NO_RATIO_LIMIT) && !hasPerTorrentRatioLimit()
-        && (globalMaxSeedingMinutes() == TorrentHandle::NO_SEEDING_TIME_LIMIT) && !hasPerTorrentSeedingTimeLimit()) {
-        if (m_seedingLimitTimer->isActive())
-            m_seedingLimitTimer->stop();
-    }
-    else if (!m_seedingLimitTimer->isActive()) {
-        m_seedingLimitTimer->start();
-    }
+    saveTorrentResumeData(torrent);
+    scheduleShareLimitCheck(torrent);
+    updateShareLimitTimer();
 }
 
-void Session::handleTorrentShareLimitChanged(TorrentHandle *const torrent)
+void Session::handleTorrentStatusReportChanged(const int oldCategories, const int newCategories)
 {
-    saveTorrentResumeData(torrent);
-    updateSeedingLimitTimer();
+    const auto updateCounter = [oldCategories, newCategories](uint &counter, const int category)
+    {
+        if (oldCategories & category)
+            --counter;
+        if (newCategories & category)
+            ++counter;
+    };
+
+    updateCounter(m_torrentStatusReport.nbDownloading, TorrentStatusReport::Downloading);
+    updateCounter(m_torrentStatusReport.nbSeeding, TorrentStatusReport::Seeding);
+    updateCounter(m_torrentStatusReport.nbCompleted, TorrentStatusReport::Completed);
+    updateCounter(m_torrentStatusReport.nbPaused, TorrentStatusReport::Paused);
+    updateCounter(m_torrentStatusReport.nbResumed, TorrentStatusReport::Resumed);
+    updateCounter(m_torrentStatusReport.nbActive, TorrentStatusReport::Active);
+    updateCounter(m_torrentStatusReport.nbInactive, TorrentStatusReport::Inactive);
+    updateCounter(m_torrentStatusReport.nbErrored, TorrentStatusReport::Errored);
+}
+
+void Session::invokeAsync(const std::function<void ()> &func)
+{
+    m_asyncWorker->start(new AsyncTask(func));
 }
 
 void Session::saveTorrentResumeData(TorrentHandle *const torrent)
 {
-    qDebug("Saving fastresume data for %s", qUtf8Printable(torrent->name()));
-    torrent->saveResumeData();
-    ++m_numResumeData;
+    // Request is postponed until the next scheduler tick
+    // so repeated changes of the torrent produce a single write
+    enqueueResumeDataRequest(torrent->hash(), true);
 }
 
 void Session::handleTorrentNameChanged(TorrentHandle *const torrent)
@@ -3390,9 +3766,10 @@ void Session::handleTorrentMetadataReceived(TorrentHandle *const torrent)
     saveTorrentResumeData(torrent);
 
     // Save metadata
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QString torrentFile = resumeDataDir.absoluteFilePath(QString("%1.torrent").arg(torrent->hash()));
-    if (torrent->saveTorrentFile(torrentFile)) {
+    const QByteArray torrentData = torrent->torrentFileData();
+    if (!torrentData.isEmpty()) {
+        QMetaObject::invokeMethod(m_resumeDataStorage, "storeMetadata"
+                                  , Q_ARG(QString, torrent->hash()), Q_ARG(QByteArray, torrentData));
         // Copy the torrent file to the export folder
         if (!torrentExportDirectory().isEmpty())
             exportTorrentFile(torrent);
@@ -3465,15 +3842,24 @@ void Session::handleTorrentResumeDataReady(TorrentHandle *const torrent, const l
     QByteArray out;
     lt::bencode(std::back_inserter(out), data);
 
-    const QString filename = QString("%1.fastresume").arg(torrent->hash());
-    QMetaObject::invokeMethod(m_resumeDataSavingManager, "save",
-                              Q_ARG(QString, filename), Q_ARG(QByteArray, out));
+    QMetaObject::invokeMethod(m_resumeDataStorage, "store",
+                              Q_ARG(QString, torrent->hash()), Q_ARG(QByteArray, out));
+
+    ++m_status.resumeDataWritten;
+    m_status.resumeDataBytesWritten += out.size();
+    const qint64 requestTime = m_resumeDataRequestTimes.take(torrent->hash());
+    const quint64 latency = std::max<qint64>(0, (m_resumeDataClock.elapsed() - requestTime));
+    // exponential moving average
+    m_status.averageResumeDataLatency = (m_status.resumeDataWritten == 1)
+            ? latency : ((m_status.averageResumeDataLatency * 7 + latency) / 8);
+    updateResumeDataStatus();
 }
 
 void Session::handleTorrentResumeDataFailed(TorrentHandle *const torrent)
 {
-    Q_UNUSED(torrent)
     --m_numResumeData;
+    m_resumeDataRequestTimes.remove(torrent->hash());
+    updateResumeDataStatus();
 }
 
 void Session::handleTorrentTrackerReply(TorrentHandle *const torrent, const QString &trackerUrl)
@@ -3491,22 +3877,6 @@ void Session::handleTorrentTrackerWarning(TorrentHandle *const torrent, const QS
     emit trackerWarning(torrent, trackerUrl);
 }
 
-bool Session::hasPerTorrentRatioLimit() const
-{
-    return std::any_of(m_torrents.cbegin(), m_torrents.cend(), [](const TorrentHandle *torrent)
-    {
-        return (torrent->ratioLimit() >= 0);
-    });
-}
-
-bool Session::hasPerTorrentSeedingTimeLimit() const
-{
-    return std::any_of(m_torrents.cbegin(), m_torrents.cend(), [](const TorrentHandle *torrent)
-    {
-        return (torrent->seedingTimeLimit() >= 0);
-    });
-}
-
 void Session::initResumeFolder()
 {
     m_resumeFolderPath = Utils::Fs::expandPathAbs(specialFolderLocation(SpecialFolder::Data) + RESUME_FOLDER);
@@ -3522,6 +3892,72 @@ void Session::initResumeFolder()
     }
 }
 
+void Session::initResumeDataStorage()
+{
+    const auto createStorage = [this](const ResumeDataStorageType type) -> ResumeDataStorage *
+    {
+        if (type == ResumeDataStorageType::Journal)
+            return new JournalResumeDataStorage {m_resumeFolderPath};
+        return new DirectoryResumeDataStorage {m_resumeFolderPath};
+    };
+
+    const ResumeDataStorageType storageType = resumeDataStorageType();
+    m_resumeDataStorage = createStorage(storageType);
+    if (!m_resumeDataStorage->registeredTorrents().isEmpty()) {
+        m_resumeDataMigratedStorageType = storageType;
+        return;
+    }
+
+    // One-shot migration of the resume data stored using another storage type.
+    // The other storage is only looked at once after the storage type has changed.
+    if (m_resumeDataMigratedStorageType == storageType) return;
+
+    const ResumeDataStorageType oldStorageType = (storageType == ResumeDataStorageType::Journal)
+            ? ResumeDataStorageType::Directory : ResumeDataStorageType::Journal;
+    const std::unique_ptr<ResumeDataStorage> oldStorage {createStorage(oldStorageType)};
+    const QStringList hashes = oldStorage->registeredTorrents();
+    if (hashes.isEmpty()) {
+        m_resumeDataMigratedStorageType = storageType;
+        return;
+    }
+
+    LogMsg(tr("Migrating resume data of %1 torrents...").arg(hashes.size()));
+
+    int migratedCount = 0;
+    for (const QString &hash : hashes) {
+        QByteArray resumeData;
+        QByteArray metadata;
+        if (!oldStorage->load(hash, resumeData, metadata)) continue;
+
+        m_resumeDataStorage->store(hash, resumeData);
+        if (!metadata.isEmpty())
+            m_resumeDataStorage->storeMetadata(hash, metadata);
+        ++migratedCount;
+    }
+
+    QStringList queue;
+    if (oldStorage->loadQueue(queue))
+        m_resumeDataStorage->storeQueue(queue);
+    m_resumeDataStorage->flush();
+
+    // reopen the storage to load the migrated data
+    delete m_resumeDataStorage;
+    m_resumeDataStorage = createStorage(storageType);
+    if (m_resumeDataStorage->registeredTorrents().size() < migratedCount) {
+        LogMsg(tr("Couldn't migrate resume data. Previously stored data is kept intact."), Log::CRITICAL);
+        return;
+    }
+
+    oldStorage->releaseLoadedData();
+    for (const QString &hash : hashes)
+        oldStorage->remove(hash);
+    oldStorage->removeQueue();
+    oldStorage->flush();
+    m_resumeDataMigratedStorageType = storageType;
+
+    LogMsg(tr("Resume data of %1 torrents was successfully migrated.").arg(migratedCount));
+}
+
 void Session::configureDeferred()
 {
     if (!m_deferredConfigureScheduled) {
@@ -3545,6 +3981,26 @@ void Session::enableIPFilter()
         connect(m_filterParser.data(), &FilterParserThread::IPFilterError, this, &Session::handleIPFilterError);
     }
     m_filterParser->processFilterFile(IPFilterFile());
+
+    // Reload the filter when its file gets modified, the current filter stays applied until then
+    if (!m_IPFilterFileWatcher) {
+        m_IPFilterReloadTimer = new QTimer(this);
+        m_IPFilterReloadTimer->setSingleShot(true);
+        m_IPFilterReloadTimer->setInterval(IP_FILTER_RELOAD_DELAY);
+        connect(m_IPFilterReloadTimer.data(), &QTimer::timeout, this, &Session::handleIPFilterFileChanged);
+
+        m_IPFilterFileWatcher = new QFileSystemWatcher(this);
+        connect(m_IPFilterFileWatcher.data(), &QFileSystemWatcher::fileChanged, this, [this]()
+        {
+            m_IPFilterReloadTimer->start();
+        });
+    }
+
+    const QStringList watchedFiles = m_IPFilterFileWatcher->files();
+    if (!watchedFiles.isEmpty())
+        m_IPFilterFileWatcher->removePaths(watchedFiles);
+    if (QFile::exists(IPFilterFile()))
+        m_IPFilterFileWatcher->addPath(IPFilterFile());
 }
 
 // Disable IP Filtering
@@ -3555,6 +4011,8 @@ void Session::disableIPFilter()
         disconnect(m_filterParser.data(), nullptr, this, nullptr);
         delete m_filterParser;
     }
+    delete m_IPFilterFileWatcher;
+    delete m_IPFilterReloadTimer;
 
     // Add the banned IPs after the IPFilter disabling
     // which creates an empty filter and overrides all previously
@@ -3601,79 +4059,86 @@ void Session::startUpTorrents()
 {
     qDebug("Resuming torrents...");
 
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QStringList fastresumes = resumeDataDir.entryList(
-                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+    QStringList hashes = m_resumeDataStorage->registeredTorrents();
 
     Logger *const logger = Logger::instance();
 
-    typedef struct
-    {
-        QString hash;
-        MagnetUri magnetUri;
-        CreateTorrentParams addTorrentData;
-        QByteArray data;
-    } TorrentResumeData;
-
-    int resumedTorrentsCount = 0;
-    const auto startupTorrent = [this, logger, &resumeDataDir, &resumedTorrentsCount](const TorrentResumeData &params)
+    const auto startupTorrent = [this, logger](const TorrentResumeData &params)
     {
-        const QString filePath = resumeDataDir.filePath(QString("%1.torrent").arg(params.hash));
         qDebug() << "Starting up torrent" << params.hash << "...";
-        if (!addTorrent_impl(params.addTorrentData, params.magnetUri, TorrentInfo::loadFromFile(filePath), params.data))
+        if (addTorrent_impl(params.addTorrentData, params.magnetUri, params.torrentInfo, params.data)) {
+            ++m_torrentsRestoreStatus.restored;
+        }
+        else {
+            ++m_torrentsRestoreStatus.failed;
             logger->addMessage(tr("Unable to resume torrent '%1'.", "e.g: Unable to resume torrent 'hash'.")
                                .arg(params.hash), Log::CRITICAL);
+        }
 
         // process add torrent messages before message queue overflow
-        if ((resumedTorrentsCount % 100) == 0) readAlerts();
-
-        ++resumedTorrentsCount;
+        const int processedCount = m_torrentsRestoreStatus.restored + m_torrentsRestoreStatus.failed;
+        if ((processedCount % 100) == 0) {
+            readAlerts();
+            emit torrentsRestoreProgress(processedCount, m_torrentsRestoreStatus.total);
+        }
     };
 
     qDebug("Starting up torrents...");
-    qDebug("Queue size: %d", fastresumes.size());
+    qDebug("Queue size: %d", hashes.size());
 
-    const QRegularExpression rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
+    QElapsedTimer restoreTimer;
+    restoreTimer.start();
+    const auto finishRestore = [this, logger, &restoreTimer]()
+    {
+        m_resumeDataStorage->releaseLoadedData();
+
+        m_torrentsRestoreStatus.elapsedTime = restoreTimer.elapsed();
+        const int processedCount = m_torrentsRestoreStatus.restored + m_torrentsRestoreStatus.failed;
+        emit torrentsRestoreProgress(processedCount, m_torrentsRestoreStatus.total);
+        logger->addMessage(tr("Restored %1 torrents in %2 ms (%3 torrents/s)")
+                           .arg(m_torrentsRestoreStatus.restored).arg(m_torrentsRestoreStatus.elapsedTime)
+                           .arg(m_torrentsRestoreStatus.torrentsPerSecond(), 0, 'f', 1));
+    };
 
     if (isQueueingSystemEnabled()) {
-        QFile queueFile {resumeDataDir.absoluteFilePath(QLatin1String {"queue"})};
+        QStringList queue;
 
         // TODO: The following code is deprecated in 4.1.5. Remove after several releases in 4.2.x.
         // === BEGIN DEPRECATED CODE === //
-        if (!queueFile.exists()) {
+        if (!m_resumeDataStorage->loadQueue(queue)) {
             // Resume downloads in a legacy manner
+            ResumeDataLoader loader {m_resumeDataStorage, hashes};
+            m_torrentsRestoreStatus = {};
+            m_torrentsRestoreStatus.total = loader.count();
+
             QMap<int, TorrentResumeData> queuedResumeData;
             int nextQueuePosition = 1;
             int numOfRemappedFiles = 0;
-            for (const QString &fastresumeName : asConst(fastresumes)) {
-                const QRegularExpressionMatch rxMatch = rx.match(fastresumeName);
-                if (!rxMatch.hasMatch()) continue;
-
-                QString hash = rxMatch.captured(1);
-                QString fastresumePath = resumeDataDir.absoluteFilePath(fastresumeName);
-                QByteArray data;
-                CreateTorrentParams torrentParams;
-                MagnetUri magnetUri;
-                int queuePosition;
-                if (readFile(fastresumePath, data) && loadTorrentResumeData(data, torrentParams, queuePosition, magnetUri)) {
-                    if (queuePosition <= nextQueuePosition) {
-                        startupTorrent({ hash, magnetUri, torrentParams, data });
-
-                        if (queuePosition == nextQueuePosition) {
+            for (int i = 0; i < loader.count(); ++i) {
+                TorrentResumeData torrentResumeData = loader.take(i);
+                if (!torrentResumeData.isValid) {
+                    --m_torrentsRestoreStatus.total;
+                    continue;
+                }
+
+                const int queuePosition = torrentResumeData.queuePosition;
+                if (queuePosition <= nextQueuePosition) {
+                    startupTorrent(torrentResumeData);
+
+                    if (queuePosition == nextQueuePosition) {
+                        ++nextQueuePosition;
+                        while (queuedResumeData.contains(nextQueuePosition)) {
+                            startupTorrent(queuedResumeData.take(nextQueuePosition));
                             ++nextQueuePosition;
-                            while (queuedResumeData.contains(nextQueuePosition)) {
-                                startupTorrent(queuedResumeData.take(nextQueuePosition));
-                                ++nextQueuePosition;
-                            }
                         }
                     }
-                    else {
-                        int q = queuePosition;
-                        for (; queuedResumeData.contains(q); ++q) {}
-                        if (q != queuePosition)
-                            ++numOfRemappedFiles;
-                        queuedResumeData[q] = {hash, magnetUri, torrentParams, data};
-                    }
+                }
+                else {
+                    int q = queuePosition;
+                    for (; queuedResumeData.contains(q); ++q) {}
+                    if (q != queuePosition)
+                        ++numOfRemappedFiles;
+                    queuedResumeData[q] = std::move(torrentResumeData);
                 }
             }
 
@@ -3687,40 +4152,33 @@ void Session::startUpTorrents()
             for (const TorrentResumeData &torrentResumeData : asConst(queuedResumeData))
                 startupTorrent(torrentResumeData);
 
+            finishRestore();
             return;
         }
         // === END DEPRECATED CODE === //
 
-        QStringList queue;
-        if (queueFile.open(QFile::ReadOnly)) {
-            QByteArray line;
-            while (!(line = queueFile.readLine()).isEmpty())
-                queue.append(QString::fromLatin1(line.trimmed()) + QLatin1String {".fastresume"});
-        }
-        else {
-            LogMsg(tr("Couldn't load torrents queue from '%1'. Error: %2")
-                   .arg(queueFile.fileName(), queueFile.errorString()), Log::WARNING);
-        }
-
         if (!queue.empty())
-            fastresumes = queue + fastresumes.toSet().subtract(queue.toSet()).toList();
+            hashes = queue + hashes.toSet().subtract(queue.toSet()).toList();
     }
 
-    for (const QString &fastresumeName : asConst(fastresumes)) {
-        const QRegularExpressionMatch rxMatch = rx.match(fastresumeName);
-        if (!rxMatch.hasMatch()) continue;
+    ResumeDataLoader loader {m_resumeDataStorage, hashes};
+    m_torrentsRestoreStatus = {};
+    m_torrentsRestoreStatus.total = loader.count();
 
-        const QString hash = rxMatch.captured(1);
-        const QString fastresumePath = resumeDataDir.absoluteFilePath(fastresumeName);
-        QByteArray data;
-        CreateTorrentParams torrentParams;
-        MagnetUri magnetUri;
-        int queuePosition;
-        if (readFile(fastresumePath, data)
-            && loadTorrentResumeData(data, torrentParams, queuePosition, magnetUri)) {
-            startupTorrent({hash, magnetUri, torrentParams, data});
-        }
+    for (int i = 0; i < loader.count(); ++i) {
+        const TorrentResumeData torrentResumeData = loader.take(i);
+        if (torrentResumeData.isValid)
+            startupTorrent(torrentResumeData);
+        else
+            --m_torrentsRestoreStatus.total;
     }
+
+    finishRestore();
+}
+
+const TorrentsRestoreStatus &Session::torrentsRestoreStatus() const
+{
+    return m_torrentsRestoreStatus;
 }
 
 quint64 Session::getAlltimeDL() const
@@ -3752,14 +4210,26 @@ void Session::handleIPFilterParsed(const int ruleCount)
 
 void Session::handleIPFilterError()
 {
-    lt::ip_filter filter;
-    processBannedIPs(filter);
-    m_nativeSession->set_ip_filter(filter);
-
+    // The previously applied filter is kept so peers are never left unfiltered
     Logger::instance()->addMessage(tr("Error: Failed to parse the provided IP filter."), Log::CRITICAL);
     emit IPFilterParsed(true, 0);
 }
 
+void Session::handleIPFilterFileChanged()
+{
+    if (!isIPFilteringEnabled())
+        return;
+
+    // The file may be in the middle of being replaced, keep the current filter until it is back
+    if (!QFile::exists(IPFilterFile())) {
+        m_IPFilterReloadTimer->start();
+        return;
+    }
+
+    LogMsg(tr("IP filter file was modified, reloading it."));
+    enableIPFilter();
+}
+
 void Session::getPendingAlerts(std::vector<lt::alert *> &out, const ulong time)
 {
     Q_ASSERT(out.empty());
@@ -3893,9 +4363,10 @@ void Session::createTorrentHandle(const lt::torrent_handle &nativeHandle)
         // The following is useless for newly added magnet
         if (!fromMagnetUri) {
             // Backup torrent file
-            const QDir resumeDataDir(m_resumeFolderPath);
-            const QString newFile = resumeDataDir.absoluteFilePath(QString("%1.torrent").arg(torrent->hash()));
-            if (torrent->saveTorrentFile(newFile)) {
+            const QByteArray torrentData = torrent->torrentFileData();
+            if (!torrentData.isEmpty()) {
+                QMetaObject::invokeMethod(m_resumeDataStorage, "storeMetadata"
+                                          , Q_ARG(QString, torrent->hash()), Q_ARG(QByteArray, torrentData));
                 // Copy the torrent file to the export folder
                 if (!torrentExportDirectory().isEmpty())
                     exportTorrentFile(torrent);
@@ -3916,9 +4387,8 @@ void Session::createTorrentHandle(const lt::torrent_handle &nativeHandle)
         saveTorrentResumeData(torrent);
     }
 
-    if (((torrent->ratioLimit() >= 0) || (torrent->seedingTimeLimit() >= 0))
-        && !m_seedingLimitTimer->isActive())
-        m_seedingLimitTimer->start();
+    scheduleShareLimitCheck(torrent);
+    updateShareLimitTimer();
 
     // Send torrent addition signal
     emit torrentAdded(torrent);
@@ -4283,52 +4753,29 @@ void Session::handleSessionStatsAlert(const lt::session_stats_alert *p)
 
 void Session::handleStateUpdateAlert(const lt::state_update_alert *p)
 {
+    QVector<TorrentHandle *> updatedTorrents;
+    updatedTorrents.reserve(static_cast<int>(p->status.size()));
+
     for (const lt::torrent_status &status : p->status) {
         TorrentHandle *const torrent = m_torrents.value(status.info_hash);
 
         if (!torrent)
             continue;
 
+        // Status report counters are updated by the torrent itself
+        // when its state changes so only changed torrents are visited here
         torrent->handleStateUpdate(status);
+        scheduleShareLimitCheck(torrent);
+        updatedTorrents.append(torrent);
     }
 
-    m_torrentStatusReport = TorrentStatusReport();
-    for (const TorrentHandle *torrent : asConst(m_torrents)) {
-        if (torrent->isDownloading())
-            ++m_torrentStatusReport.nbDownloading;
-        if (torrent->isUploading())
-            ++m_torrentStatusReport.nbSeeding;
-        if (torrent->isCompleted())
-            ++m_torrentStatusReport.nbCompleted;
-        if (torrent->isPaused())
-            ++m_torrentStatusReport.nbPaused;
-        if (torrent->isResumed())
-            ++m_torrentStatusReport.nbResumed;
-        if (torrent->isActive())
-            ++m_torrentStatusReport.nbActive;
-        if (torrent->isInactive())
-            ++m_torrentStatusReport.nbInactive;
-        if (torrent->isErrored())
-            ++m_torrentStatusReport.nbErrored;
-    }
+    updateShareLimitTimer();
 
-    emit torrentsUpdated();
+    emit torrentsUpdated(updatedTorrents);
 }
 
 namespace
 {
-    bool readFile(const QString &path, QByteArray &buf)
-    {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug("Cannot read file %s: %s", qUtf8Printable(path), qUtf8Printable(file.errorString()));
-            return false;
-        }
-
-        buf = file.readAll();
-        return true;
-    }
-
     bool loadTorrentResumeData(const QByteArray &data, CreateTorrentParams &torrentParams, int &prio, MagnetUri &magnetUri)
     {
         torrentParams = CreateTorrentParams();
@@ -4378,6 +4825,100 @@ namespace
         return true;
     }
 
+    class ResumeDataLoader::Worker : public QRunnable
+    {
+    public:
+        explicit Worker(ResumeDataLoader *loader)
+            : m_loader {loader}
+        {
+        }
+
+        void run() override
+        {
+            m_loader->loadItems();
+        }
+
+    private:
+        ResumeDataLoader *m_loader;
+    };
+
+    ResumeDataLoader::ResumeDataLoader(const ResumeDataStorage *storage, const QStringList &hashes)
+        : m_storage {storage}
+        , m_hashes {hashes}
+        , m_items(hashes.size())
+        , m_loaded(hashes.size(), false)
+        , m_nextIndex {0}
+        , m_readAheadSlots {MAX_RESUME_DATA_READ_AHEAD}
+    {
+        const int workersCount = std::min(QThread::idealThreadCount(), m_hashes.size());
+        m_threadPool.setMaxThreadCount(std::max(1, workersCount));
+        for (int i = 0; i < workersCount; ++i)
+            m_threadPool.start(new Worker {this});
+    }
+
+    ResumeDataLoader::~ResumeDataLoader()
+    {
+        // prevent workers from picking up remaining items
+        m_nextIndex.store(m_hashes.size());
+        // wake up the workers waiting for a slot, they find nothing to load
+        m_readAheadSlots.release(m_threadPool.maxThreadCount());
+        m_threadPool.waitForDone();
+    }
+
+    int ResumeDataLoader::count() const
+    {
+        return m_hashes.size();
+    }
+
+    TorrentResumeData ResumeDataLoader::take(const int index)
+    {
+        QMutexLocker locker {&m_mutex};
+        while (!m_loaded[index])
+            m_itemLoaded.wait(&m_mutex);
+
+        TorrentResumeData item;
+        std::swap(item, m_items[index]);
+        m_readAheadSlots.release();
+        return item;
+    }
+
+    void ResumeDataLoader::loadItems()
+    {
+        forever {
+            // the slot is acquired before picking up the item, so the item the consumer
+            // waits for has always got one and the workers can't block it
+            m_readAheadSlots.acquire();
+            const int index = m_nextIndex.fetchAndAddOrdered(1);
+            if (index >= m_hashes.size()) {
+                m_readAheadSlots.release();
+                return;
+            }
+
+            loadItem(index);
+        }
+    }
+
+    void ResumeDataLoader::loadItem(const int index)
+    {
+        const QString &hash = m_hashes[index];
+
+        TorrentResumeData item;
+        item.hash = hash;
+
+        QByteArray metadata;
+        if (m_storage->load(hash, item.data, metadata)
+            && loadTorrentResumeData(item.data, item.addTorrentData, item.queuePosition, item.magnetUri)) {
+            if (!metadata.isEmpty())
+                item.torrentInfo = TorrentInfo::load(metadata);
+            item.isValid = true;
+        }
+
+        const QMutexLocker locker {&m_mutex};
+        m_items[index] = std::move(item);
+        m_loaded[index] = true;
+        m_itemLoaded.wakeAll();
+    }
+
     void torrentQueuePositionUp(const lt::torrent_handle &handle)
     {
         try {
@@ -30,15 +30,19 @@
 #ifndef BITTORRENT_SESSION_H
 #define BITTORRENT_SESSION_H
 
+#include <functional>
 #include <vector>
 
 #include <libtorrent/fwd.hpp>
 
+#include <QElapsedTimer>
 #include <QFile>
 #include <QHash>
 #include <QList>
+#include <QMap>
 #include <QNetworkConfigurationManager>
 #include <QPointer>
+#include <QQueue>
 #include <QSet>
 
 #include "base/settingvalue.h"
@@ -48,7 +52,9 @@
 #include "sessionstatus.h"
 #include "torrentinfo.h"
 
+class QFileSystemWatcher;
 class QThread;
+class QThreadPool;
 class QTimer;
 class QString;
 class QStringList;
@@ -57,7 +63,7 @@ class QUrl;
 class FilterParserThread;
 class BandwidthScheduler;
 class Statistics;
-class ResumeDataSavingManager;
+class ResumeDataStorage;
 
 enum MaxRatioAction
 {
@@ -81,12 +87,26 @@ namespace BitTorrent
     class InfoHash;
     class TorrentHandle;
     class Tracker;
+    struct TrackerStatistics;
     class MagnetUri;
     class TrackerEntry;
     struct CreateTorrentParams;
 
     struct TorrentStatusReport
     {
+        // Categories a torrent is counted in
+        enum Category
+        {
+            Downloading = 1 << 0,
+            Seeding = 1 << 1,
+            Completed = 1 << 2,
+            Active = 1 << 3,
+            Inactive = 1 << 4,
+            Paused = 1 << 5,
+            Resumed = 1 << 6,
+            Errored = 1 << 7
+        };
+
         uint nbDownloading = 0;
         uint nbSeeding = 0;
         uint nbCompleted = 0;
@@ -97,6 +117,19 @@ namespace BitTorrent
         uint nbErrored = 0;
     };
 
+    struct TorrentsRestoreStatus
+    {
+        int total = 0;
+        int restored = 0;
+        int failed = 0;
+        qint64 elapsedTime = 0; // in milliseconds
+
+        qreal torrentsPerSecond() const
+        {
+            return (elapsedTime > 0) ? (restored * 1000.0 / elapsedTime) : 0;
+        }
+    };
+
     class SessionSettingsEnums
     {
         Q_GADGET
@@ -132,11 +165,19 @@ namespace BitTorrent
             UTP = 2
         };
         Q_ENUM(BTProtocol)
+
+        enum class ResumeDataStorageType : int
+        {
+            Directory = 0,
+            Journal = 1
+        };
+        Q_ENUM(ResumeDataStorageType)
     };
     using ChokingAlgorithm = SessionSettingsEnums::ChokingAlgorithm;
     using SeedChokingAlgorithm = SessionSettingsEnums::SeedChokingAlgorithm;
     using MixedModeAlgorithm = SessionSettingsEnums::MixedModeAlgorithm;
     using BTProtocol = SessionSettingsEnums::BTProtocol;
+    using ResumeDataStorageType = SessionSettingsEnums::ResumeDataStorageType;
 
     struct SessionMetricIndices
     {
@@ -254,6 +295,8 @@ namespace BitTorrent
         void setCreateTorrentSubfolder(bool value);
         bool isTrackerEnabled() const;
         void setTrackerEnabled(bool enabled);
+        // returns false when the embedded tracker isn't running
+        bool trackerStatistics(TrackerStatistics &stats) const;
         bool isAppendExtensionEnabled() const;
         void setAppendExtensionEnabled(bool enabled);
         uint refreshInterval() const;
@@ -284,6 +327,11 @@ namespace BitTorrent
 
         uint saveResumeDataInterval() const;
         void setSaveResumeDataInterval(uint value);
+        // Max number of resume data writes per second, 0 means unlimited
+        int resumeDataSavingRateLimit() const;
+        void setResumeDataSavingRateLimit(int limit);
+        ResumeDataStorageType resumeDataStorageType() const;
+        void setResumeDataStorageType(ResumeDataStorageType type);
         int port() const;
         void setPort(int port);
         bool useRandomPort() const;
@@ -392,6 +440,7 @@ namespace BitTorrent
         void setBannedIPs(const QStringList &newList);
 
         void startUpTorrents();
+        const TorrentsRestoreStatus &torrentsRestoreStatus() const;
         TorrentHandle *findTorrent(const InfoHash &hash) const;
         QHash<InfoHash, TorrentHandle *> torrents() const;
         TorrentStatusReport torrentStatusReport() const;
@@ -422,8 +471,12 @@ namespace BitTorrent
         void topTorrentsPriority(const QStringList &hashes);
         void bottomTorrentsPriority(const QStringList &hashes);
 
+        // Runs the function in the worker thread dedicated to blocking libtorrent requests
+        void invokeAsync(const std::function<void ()> &func);
+
         // TorrentHandle interface
         void handleTorrentShareLimitChanged(TorrentHandle *const torrent);
+        void handleTorrentStatusReportChanged(int oldCategories, int newCategories);
         void handleTorrentNameChanged(TorrentHandle *const torrent);
         void handleTorrentSavePathChanged(TorrentHandle *const torrent);
         void handleTorrentCategoryChanged(TorrentHandle *const torrent, const QString &oldCategory);
@@ -448,7 +501,8 @@ namespace BitTorrent
 
     signals:
         void statsUpdated();
-        void torrentsUpdated();
+        void torrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
+        void torrentsRestoreProgress(int processed, int total);
         void addTorrentFailed(const QString &error);
         void torrentAdded(BitTorrent::TorrentHandle *const torrent);
         void torrentNew(BitTorrent::TorrentHandle *const torrent);
@@ -491,8 +545,10 @@ namespace BitTorrent
         void refresh();
         void processShareLimits();
         void generateResumeData(bool final = false);
+        void processResumeDataQueue();
         void handleIPFilterParsed(int ruleCount);
         void handleIPFilterError();
+        void handleIPFilterFileChanged();
         void handleDownloadFinished(const Net::DownloadResult &result);
 
         // Session reconfiguration triggers
@@ -510,10 +566,8 @@ namespace BitTorrent
         explicit Session(QObject *parent = nullptr);
         ~Session();
 
-        bool hasPerTorrentRatioLimit() const;
-        bool hasPerTorrentSeedingTimeLimit() const;
-
         void initResumeFolder();
+        void initResumeDataStorage();
 
         // Session configuration
         Q_INVOKABLE void configure();
@@ -538,9 +592,18 @@ namespace BitTorrent
                              const QByteArray &fastresumeData = {});
         bool findIncompleteFiles(TorrentInfo &torrentInfo, QString &savePath) const;
 
-        void updateSeedingLimitTimer();
+        bool applyShareLimits(TorrentHandle *const torrent);
+        qint64 projectShareLimitTime(const TorrentHandle *torrent) const;
+        void scheduleShareLimitCheck(const TorrentHandle *torrent);
+        void unscheduleShareLimitCheck(const InfoHash &hash);
+        void rescheduleShareLimits();
+        void updateShareLimitTimer();
         void exportTorrentFile(TorrentHandle *const torrent, TorrentExportFolder folder = TorrentExportFolder::Regular);
         void saveTorrentResumeData(TorrentHandle *const torrent);
+        void enqueueResumeDataRequest(const InfoHash &hash, bool urgent);
+        int dispatchResumeDataRequests(QQueue<InfoHash> &queue, bool urgent, int maxCount);
+        bool requestResumeData(const InfoHash &hash);
+        void updateResumeDataStatus();
 
         void handleAlert(const lt::alert *a);
         void dispatchTorrentAlert(const lt::alert *a);
@@ -660,6 +723,9 @@ namespace BitTorrent
         CachedSettingValue<bool> m_isDisableAutoTMMWhenCategorySavePathChanged;
         CachedSettingValue<bool> m_isTrackerEnabled;
         CachedSettingValue<QStringList> m_bannedIPs;
+        CachedSettingValue<ResumeDataStorageType> m_resumeDataStorageType;
+        CachedSettingValue<ResumeDataStorageType> m_resumeDataMigratedStorageType;
+        CachedSettingValue<int> m_resumeDataSavingRateLimit;
 
         // Order is important. This needs to be declared after its CachedSettingsValue
         // counterpart, because it uses it for initialization in the constructor
@@ -675,16 +741,31 @@ namespace BitTorrent
 
         QTimer *m_refreshTimer;
         QTimer *m_seedingLimitTimer;
+        // torrents ordered by the projected time of reaching their share limits
+        QMultiMap<qint64, InfoHash> m_shareLimitQueue;
+        QHash<InfoHash, qint64> m_shareLimitTimes;
+        QElapsedTimer m_shareLimitClock;
         QTimer *m_resumeDataTimer;
+        // resume data saving scheduler
+        QTimer *m_resumeDataSchedulerTimer;
+        QHash<InfoHash, bool> m_queuedResumeData; // value is true for urgent requests
+        QQueue<InfoHash> m_urgentResumeDataQueue;
+        QQueue<InfoHash> m_regularResumeDataQueue;
+        int m_regularResumeDataBatchSize = 0;
+        QHash<InfoHash, qint64> m_resumeDataRequestTimes;
+        QElapsedTimer m_resumeDataClock;
         Statistics *m_statistics;
         // IP filtering
         QPointer<FilterParserThread> m_filterParser;
+        QPointer<QFileSystemWatcher> m_IPFilterFileWatcher;
+        QPointer<QTimer> m_IPFilterReloadTimer;
         QPointer<BandwidthScheduler> m_bwScheduler;
         // Tracker
         QPointer<Tracker> m_tracker;
         // fastresume data writing thread
         QThread *m_ioThread;
-        ResumeDataSavingManager *m_resumeDataSavingManager;
+        QThreadPool *m_asyncWorker;
+        ResumeDataStorage *m_resumeDataStorage;
 
         QHash<InfoHash, TorrentInfo> m_loadedMetadata;
         QHash<InfoHash, TorrentHandle *> m_torrents;
@@ -692,6 +773,7 @@ namespace BitTorrent
         QHash<QString, AddTorrentParams> m_downloadedTorrents;
         QHash<InfoHash, RemovingTorrentData> m_removingTorrents;
         TorrentStatusReport m_torrentStatusReport;
+        TorrentsRestoreStatus m_torrentsRestoreStatus;
         QStringMap m_categories;
         QSet<QString> m_tags;
 
@@ -72,6 +72,12 @@ namespace BitTorrent
         quint64 diskWriteQueue = 0;
         quint64 dhtNodes = 0;
         quint64 peersCount = 0;
+
+        // Resume data saving
+        quint64 resumeDataPending = 0;
+        quint64 resumeDataWritten = 0;
+        quint64 resumeDataBytesWritten = 0;
+        quint64 averageResumeDataLatency = 0; // in milliseconds
     };
 }
 
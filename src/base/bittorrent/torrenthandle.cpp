@@ -30,6 +30,7 @@
 #include "torrenthandle.h"
 
 #include <algorithm>
+#include <set>
 #include <type_traits>
 
 #ifdef Q_OS_WIN
@@ -50,7 +51,9 @@
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QPointer>
 #include <QStringList>
+#include <QTimer>
 #include <QUrl>
 
 #include "base/global.h"
@@ -101,6 +104,189 @@ namespace
             entryList.emplace_back(setValue.toStdString());
         return entryList;
     }
+
+    // Snapshots are shared by all the consumers requesting the same data within this time (in ms)
+    const int SNAPSHOT_TTL = 500;
+
+    // The following functions block until the libtorrent network thread handles the request
+    std::vector<lt::peer_info> nativePeerInfo(const lt::torrent_handle &nativeHandle)
+    {
+        std::vector<lt::peer_info> nativePeers;
+        nativeHandle.get_peer_info(nativePeers);
+        return nativePeers;
+    }
+
+    std::vector<lt::announce_entry> nativeTrackers(const lt::torrent_handle &nativeHandle)
+    {
+        return nativeHandle.trackers();
+    }
+
+    std::set<std::string> nativeURLSeeds(const lt::torrent_handle &nativeHandle)
+    {
+        return nativeHandle.url_seeds();
+    }
+
+    std::vector<boost::int64_t> nativeFilesProgress(const lt::torrent_handle &nativeHandle)
+    {
+        std::vector<boost::int64_t> fp;
+        nativeHandle.file_progress(fp, lt::torrent_handle::piece_granularity);
+        return fp;
+    }
+
+    std::vector<LTDownloadPriority> nativeFilePriorities(const lt::torrent_handle &nativeHandle)
+    {
+#if (LIBTORRENT_VERSION_NUM < 10200)
+        return nativeHandle.file_priorities();
+#else
+        return nativeHandle.get_file_priorities();
+#endif
+    }
+
+    std::vector<lt::partial_piece_info> nativeDownloadQueue(const lt::torrent_handle &nativeHandle)
+    {
+        std::vector<lt::partial_piece_info> queue;
+        nativeHandle.get_download_queue(queue);
+        return queue;
+    }
+
+    std::vector<int> nativePieceAvailability(const lt::torrent_handle &nativeHandle)
+    {
+        std::vector<int> avail;
+        nativeHandle.piece_availability(avail);
+        return avail;
+    }
+
+    QList<PeerInfo> toPeerInfo(const TorrentHandle *torrent, const std::vector<lt::peer_info> &nativePeers)
+    {
+        const QBitArray torrentPieces = torrent->pieces();
+        QList<PeerInfo> peers;
+        peers.reserve(static_cast<int>(nativePeers.size()));
+        for (const lt::peer_info &peer : nativePeers)
+            peers << PeerInfo(peer, torrentPieces);
+        return peers;
+    }
+
+    QVector<TrackerEntry> toTrackerEntries(const std::vector<lt::announce_entry> &announces)
+    {
+        QVector<TrackerEntry> entries;
+        entries.reserve(announces.size());
+        for (const lt::announce_entry &tracker : announces)
+            entries << tracker;
+        return entries;
+    }
+
+    QList<QUrl> toURLSeeds(const std::set<std::string> &seeds)
+    {
+        QList<QUrl> urlSeeds;
+        for (const std::string &urlSeed : seeds)
+            urlSeeds.append(QUrl(urlSeed.c_str()));
+        return urlSeeds;
+    }
+
+    QVector<qreal> toFilesProgress(const TorrentHandle *torrent, const std::vector<boost::int64_t> &fp)
+    {
+        const int count = static_cast<int>(fp.size());
+        QVector<qreal> result;
+        result.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const qlonglong size = torrent->fileSize(i);
+            if ((size <= 0) || (fp[i] == size))
+                result << 1;
+            else
+                result << (fp[i] / static_cast<qreal>(size));
+        }
+        return result;
+    }
+
+    QVector<DownloadPriority> toDownloadPriorities(const std::vector<LTDownloadPriority> &fp)
+    {
+        QVector<DownloadPriority> ret;
+        std::transform(fp.cbegin(), fp.cend(), std::back_inserter(ret), [](LTDownloadPriority priority)
+        {
+            return static_cast<DownloadPriority>(
+                        static_cast<std::underlying_type<DownloadPriority>::type>(priority));
+        });
+        return ret;
+    }
+
+    QBitArray toDownloadingPieces(const TorrentHandle *torrent, const std::vector<lt::partial_piece_info> &queue)
+    {
+        QBitArray result(torrent->piecesCount());
+        for (const lt::partial_piece_info &info : queue)
+            result.setBit(info.piece_index);
+        return result;
+    }
+
+    QVector<int> toPieceAvailability(const std::vector<int> &avail)
+    {
+        return QVector<int>::fromStdVector(avail);
+    }
+
+    QVector<qreal> toAvailableFileFractions(const TorrentHandle *torrent, const QVector<int> &piecesAvailability)
+    {
+        const int filesCount = torrent->filesCount();
+        if (filesCount < 0) return {};
+
+        // libtorrent returns empty array for seeding only torrents
+        if (piecesAvailability.empty()) return QVector<qreal>(filesCount, -1.);
+
+        QVector<qreal> res;
+        res.reserve(filesCount);
+        const TorrentInfo info = torrent->info();
+        for (int i = 0; i < filesCount; ++i) {
+            const TorrentInfo::PieceRange filePieces = info.filePieces(i);
+
+            int availablePieces = 0;
+            for (int piece = filePieces.first(); piece <= filePieces.last(); ++piece) {
+                availablePieces += (piecesAvailability[piece] > 0) ? 1 : 0;
+            }
+            res.push_back(static_cast<qreal>(availablePieces) / filePieces.size());
+        }
+        return res;
+    }
+
+    // Performs the native request in the session worker thread and converts
+    // its result in the main thread, concurrent requests share the same round-trip
+    template <typename NativeResult, typename Result, typename NativeFetcher, typename Converter>
+    void fetchSnapshot(const TorrentHandle *torrent, Session *session, AsyncSnapshot<Result> &snapshot
+                       , QObject *context, const typename AsyncSnapshot<Result>::ResultHandler &resultHandler
+                       , NativeFetcher nativeFetcher, Converter converter)
+    {
+        if (snapshot.isFresh()) {
+            resultHandler(snapshot.value());
+            return;
+        }
+
+        if (!snapshot.enqueue(context, resultHandler))
+            return;
+
+        const lt::torrent_handle nativeHandle = torrent->nativeHandle();
+        const QPointer<const TorrentHandle> torrentPtr = torrent;
+        const int generation = snapshot.generation();
+        AsyncSnapshot<Result> *const snapshotPtr = &snapshot;
+        session->invokeAsync([session, nativeHandle, torrentPtr, generation, snapshotPtr, nativeFetcher, converter]()
+        {
+            NativeResult nativeResult;
+            try {
+                nativeResult = nativeFetcher(nativeHandle);
+            }
+            catch (const std::exception &) {
+                // torrent has been removed in the meantime
+            }
+
+            const auto finish = [torrentPtr, generation, snapshotPtr, nativeResult, converter]()
+            {
+                // snapshot is owned by the torrent so it's valid as long as the torrent exists
+                if (torrentPtr)
+                    snapshotPtr->finish(converter(nativeResult), generation);
+            };
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
+            QMetaObject::invokeMethod(session, finish, Qt::QueuedConnection);
+#else
+            QTimer::singleShot(0, session, finish);
+#endif
+        });
+    }
 }
 
 // AddTorrentData
@@ -186,6 +372,13 @@ TorrentHandle::TorrentHandle(Session *session, const lt::torrent_handle &nativeH
     , m_hasRootFolder(params.hasRootFolder)
     , m_needsToSetFirstLastPiecePriority(false)
     , m_needsToStartForced(params.forced)
+    , m_peersSnapshot(SNAPSHOT_TTL)
+    , m_trackersSnapshot(SNAPSHOT_TTL)
+    , m_urlSeedsSnapshot(SNAPSHOT_TTL)
+    , m_filesProgressSnapshot(SNAPSHOT_TTL)
+    , m_filePrioritiesSnapshot(SNAPSHOT_TTL)
+    , m_downloadingPiecesSnapshot(SNAPSHOT_TTL)
+    , m_pieceAvailabilitySnapshot(SNAPSHOT_TTL)
 {
     if (m_useAutoTMM)
         m_savePath = Utils::Fs::toNativePath(m_session->categorySavePath(m_category));
@@ -389,13 +582,15 @@ void TorrentHandle::setAutoManaged(const bool enable)
 
 QVector<TrackerEntry> TorrentHandle::trackers() const
 {
-    const std::vector<lt::announce_entry> announces = m_nativeHandle.trackers();
+    if (!m_trackersSnapshot.isFresh())
+        m_trackersSnapshot.setValue(toTrackerEntries(nativeTrackers(m_nativeHandle)));
+    return m_trackersSnapshot.value();
+}
 
-    QVector<TrackerEntry> entries;
-    entries.reserve(announces.size());
-    for (const lt::announce_entry &tracker : announces)
-        entries << tracker;
-    return entries;
+void TorrentHandle::fetchTrackers(QObject *context, const std::function<void (const QVector<TrackerEntry> &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<lt::announce_entry>>(this, m_session, m_trackersSnapshot, context, resultHandler
+        , nativeTrackers, toTrackerEntries);
 }
 
 QHash<QString, TrackerInfo> TorrentHandle::trackerInfos() const
@@ -417,8 +612,10 @@ void TorrentHandle::addTrackers(const QVector<TrackerEntry> &trackers)
         }
     }
 
-    if (!newTrackers.isEmpty())
+    if (!newTrackers.isEmpty()) {
+        m_trackersSnapshot.invalidate();
         m_session->handleTorrentTrackersAdded(this, newTrackers);
+    }
 }
 
 void TorrentHandle::replaceTrackers(const QVector<TrackerEntry> &trackers)
@@ -438,6 +635,7 @@ void TorrentHandle::replaceTrackers(const QVector<TrackerEntry> &trackers)
     }
 
     m_nativeHandle.replace_trackers(announces);
+    m_trackersSnapshot.invalidate();
 
     if (newTrackers.isEmpty() && currentTrackers.isEmpty()) {
         // when existing tracker reorders
@@ -454,13 +652,15 @@ void TorrentHandle::replaceTrackers(const QVector<TrackerEntry> &trackers)
 
 QList<QUrl> TorrentHandle::urlSeeds() const
 {
-    QList<QUrl> urlSeeds;
-    const std::set<std::string> seeds = m_nativeHandle.url_seeds();
-
-    for (const std::string &urlSeed : seeds)
-        urlSeeds.append(QUrl(urlSeed.c_str()));
+    if (!m_urlSeedsSnapshot.isFresh())
+        m_urlSeedsSnapshot.setValue(toURLSeeds(nativeURLSeeds(m_nativeHandle)));
+    return m_urlSeedsSnapshot.value();
+}
 
-    return urlSeeds;
+void TorrentHandle::fetchURLSeeds(QObject *context, const std::function<void (const QList<QUrl> &)> &resultHandler) const
+{
+    fetchSnapshot<std::set<std::string>>(this, m_session, m_urlSeedsSnapshot, context, resultHandler
+        , nativeURLSeeds, toURLSeeds);
 }
 
 void TorrentHandle::addUrlSeeds(const QList<QUrl> &urlSeeds)
@@ -493,6 +693,7 @@ bool TorrentHandle::addUrlSeed(const QUrl &urlSeed)
     if (seeds.contains(urlSeed)) return false;
 
     m_nativeHandle.add_url_seed(urlSeed.toString().toStdString());
+    m_urlSeedsSnapshot.invalidate();
     return true;
 }
 
@@ -502,6 +703,7 @@ bool TorrentHandle::removeUrlSeed(const QUrl &urlSeed)
     if (!seeds.contains(urlSeed)) return false;
 
     m_nativeHandle.remove_url_seed(urlSeed.toString().toStdString());
+    m_urlSeedsSnapshot.invalidate();
     return true;
 }
 
@@ -686,19 +888,15 @@ QStringList TorrentHandle::absoluteFilePathsUnwanted() const
 
 QVector<DownloadPriority> TorrentHandle::filePriorities() const
 {
-#if (LIBTORRENT_VERSION_NUM < 10200)
-    const std::vector<LTDownloadPriority> fp = m_nativeHandle.file_priorities();
-#else
-    const std::vector<LTDownloadPriority> fp = m_nativeHandle.get_file_priorities();
-#endif
+    if (!m_filePrioritiesSnapshot.isFresh())
+        m_filePrioritiesSnapshot.setValue(toDownloadPriorities(nativeFilePriorities(m_nativeHandle)));
+    return m_filePrioritiesSnapshot.value();
+}
 
-    QVector<DownloadPriority> ret;
-    std::transform(fp.cbegin(), fp.cend(), std::back_inserter(ret), [](LTDownloadPriority priority)
-    {
-        return static_cast<DownloadPriority>(
-                    static_cast<std::underlying_type<DownloadPriority>::type>(priority));
-    });
-    return ret;
+void TorrentHandle::fetchFilePriorities(QObject *context, const std::function<void (const QVector<DownloadPriority> &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<LTDownloadPriority>>(this, m_session, m_filePrioritiesSnapshot, context, resultHandler
+        , nativeFilePriorities, toDownloadPriorities);
 }
 
 TorrentInfo TorrentHandle::info() const
@@ -901,6 +1099,34 @@ void TorrentHandle::updateState()
             }
         }
     }
+
+    const int categories = calculateStatusReportCategories();
+    if (categories != m_statusReportCategories) {
+        m_session->handleTorrentStatusReportChanged(m_statusReportCategories, categories);
+        m_statusReportCategories = categories;
+    }
+}
+
+int TorrentHandle::calculateStatusReportCategories() const
+{
+    int categories = 0;
+    if (isDownloading())
+        categories |= TorrentStatusReport::Downloading;
+    if (isUploading())
+        categories |= TorrentStatusReport::Seeding;
+    if (isCompleted())
+        categories |= TorrentStatusReport::Completed;
+    if (isPaused())
+        categories |= TorrentStatusReport::Paused;
+    if (isResumed())
+        categories |= TorrentStatusReport::Resumed;
+    if (isActive())
+        categories |= TorrentStatusReport::Active;
+    if (isInactive())
+        categories |= TorrentStatusReport::Inactive;
+    if (isErrored())
+        categories |= TorrentStatusReport::Errored;
+    return categories;
 }
 
 bool TorrentHandle::hasMetadata() const
@@ -1025,21 +1251,15 @@ qulonglong TorrentHandle::eta() const
 
 QVector<qreal> TorrentHandle::filesProgress() const
 {
-    std::vector<boost::int64_t> fp;
-    m_nativeHandle.file_progress(fp, lt::torrent_handle::piece_granularity);
-
-    const int count = static_cast<int>(fp.size());
-    QVector<qreal> result;
-    result.reserve(count);
-    for (int i = 0; i < count; ++i) {
-        const qlonglong size = fileSize(i);
-        if ((size <= 0) || (fp[i] == size))
-            result << 1;
-        else
-            result << (fp[i] / static_cast<qreal>(size));
-    }
+    if (!m_filesProgressSnapshot.isFresh())
+        m_filesProgressSnapshot.setValue(toFilesProgress(this, nativeFilesProgress(m_nativeHandle)));
+    return m_filesProgressSnapshot.value();
+}
 
-    return result;
+void TorrentHandle::fetchFilesProgress(QObject *context, const std::function<void (const QVector<qreal> &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<boost::int64_t>>(this, m_session, m_filesProgressSnapshot, context, resultHandler
+        , nativeFilesProgress, [this](const std::vector<boost::int64_t> &fp) { return toFilesProgress(this, fp); });
 }
 
 int TorrentHandle::seedsCount() const
@@ -1149,15 +1369,15 @@ bool TorrentHandle::superSeeding() const
 
 QList<PeerInfo> TorrentHandle::peers() const
 {
-    QList<PeerInfo> peers;
-    std::vector<lt::peer_info> nativePeers;
-
-    m_nativeHandle.get_peer_info(nativePeers);
-
-    for (const lt::peer_info &peer : nativePeers)
-        peers << PeerInfo(this, peer);
+    if (!m_peersSnapshot.isFresh())
+        m_peersSnapshot.setValue(toPeerInfo(this, nativePeerInfo(m_nativeHandle)));
+    return m_peersSnapshot.value();
+}
 
-    return peers;
+void TorrentHandle::fetchPeerInfo(QObject *context, const std::function<void (const QList<PeerInfo> &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<lt::peer_info>>(this, m_session, m_peersSnapshot, context, resultHandler
+        , nativePeerInfo, [this](const std::vector<lt::peer_info> &nativePeers) { return toPeerInfo(this, nativePeers); });
 }
 
 QBitArray TorrentHandle::pieces() const
@@ -1172,23 +1392,28 @@ QBitArray TorrentHandle::pieces() const
 
 QBitArray TorrentHandle::downloadingPieces() const
 {
-    QBitArray result(piecesCount());
-
-    std::vector<lt::partial_piece_info> queue;
-    m_nativeHandle.get_download_queue(queue);
-
-    for (const lt::partial_piece_info &info : queue)
-        result.setBit(info.piece_index);
+    if (!m_downloadingPiecesSnapshot.isFresh())
+        m_downloadingPiecesSnapshot.setValue(toDownloadingPieces(this, nativeDownloadQueue(m_nativeHandle)));
+    return m_downloadingPiecesSnapshot.value();
+}
 
-    return result;
+void TorrentHandle::fetchDownloadingPieces(QObject *context, const std::function<void (const QBitArray &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<lt::partial_piece_info>>(this, m_session, m_downloadingPiecesSnapshot, context, resultHandler
+        , nativeDownloadQueue, [this](const std::vector<lt::partial_piece_info> &queue) { return toDownloadingPieces(this, queue); });
 }
 
 QVector<int> TorrentHandle::pieceAvailability() const
 {
-    std::vector<int> avail;
-    m_nativeHandle.piece_availability(avail);
+    if (!m_pieceAvailabilitySnapshot.isFresh())
+        m_pieceAvailabilitySnapshot.setValue(toPieceAvailability(nativePieceAvailability(m_nativeHandle)));
+    return m_pieceAvailabilitySnapshot.value();
+}
 
-    return QVector<int>::fromStdVector(avail);
+void TorrentHandle::fetchPieceAvailability(QObject *context, const std::function<void (const QVector<int> &)> &resultHandler) const
+{
+    fetchSnapshot<std::vector<int>>(this, m_session, m_pieceAvailabilitySnapshot, context, resultHandler
+        , nativePieceAvailability, toPieceAvailability);
 }
 
 qreal TorrentHandle::distributedCopies() const
@@ -1485,9 +1710,9 @@ void TorrentHandle::renameFile(const int index, const QString &name)
     m_nativeHandle.rename_file(index, Utils::Fs::toNativePath(name).toStdString());
 }
 
-bool TorrentHandle::saveTorrentFile(const QString &path)
+QByteArray TorrentHandle::torrentFileData() const
 {
-    if (!m_torrentInfo.isValid()) return false;
+    if (!m_torrentInfo.isValid()) return {};
 #if (LIBTORRENT_VERSION_NUM < 10200)
     const lt::create_torrent torrentCreator = lt::create_torrent(*(m_torrentInfo.nativeInfo()), true);
 #else
@@ -1495,11 +1720,17 @@ bool TorrentHandle::saveTorrentFile(const QString &path)
 #endif
     const lt::entry torrentEntry = torrentCreator.generate();
 
-    QVector<char> out;
+    QByteArray out;
     lt::bencode(std::back_inserter(out), torrentEntry);
+    return out;
+}
+
+bool TorrentHandle::saveTorrentFile(const QString &path)
+{
+    const QByteArray out = torrentFileData();
     QFile torrentFile(path);
-    if (!out.empty() && torrentFile.open(QIODevice::WriteOnly))
-        return (torrentFile.write(&out[0], out.size()) == out.size());
+    if (!out.isEmpty() && torrentFile.open(QIODevice::WriteOnly))
+        return (torrentFile.write(out) == out.size());
 
     return false;
 }
@@ -1807,6 +2038,10 @@ void TorrentHandle::handleMetadataReceivedAlert(const lt::metadata_received_aler
 {
     Q_UNUSED(p);
     qDebug("Metadata received for torrent %s.", qUtf8Printable(name()));
+    m_filesProgressSnapshot.invalidate();
+    m_filePrioritiesSnapshot.invalidate();
+    m_downloadingPiecesSnapshot.invalidate();
+    m_pieceAvailabilitySnapshot.invalidate();
     updateStatus();
     if (m_session->isAppendExtensionEnabled())
         manageIncompleteFiles();
@@ -1971,6 +2206,11 @@ lt::torrent_handle TorrentHandle::nativeHandle() const
     return m_nativeHandle;
 }
 
+int TorrentHandle::statusReportCategories() const
+{
+    return m_statusReportCategories;
+}
+
 void TorrentHandle::updateTorrentInfo()
 {
     if (!hasMetadata()) return;
@@ -2092,6 +2332,7 @@ void TorrentHandle::prioritizeFiles(const QVector<DownloadPriority> &priorities)
 
     qDebug() << Q_FUNC_INFO << "Changing files priorities...";
     m_nativeHandle.prioritize_files(toLTDownloadPriorities(priorities));
+    m_filePrioritiesSnapshot.invalidate();
 
     qDebug() << Q_FUNC_INFO << "Moving unwanted files to .unwanted folder and conversely...";
     const QString spath = savePath(true);
@@ -2155,24 +2396,13 @@ void TorrentHandle::prioritizeFiles(const QVector<DownloadPriority> &priorities)
 
 QVector<qreal> TorrentHandle::availableFileFractions() const
 {
-    const int filesCount = this->filesCount();
-    if (filesCount < 0) return {};
-
-    const QVector<int> piecesAvailability = pieceAvailability();
-    // libtorrent returns empty array for seeding only torrents
-    if (piecesAvailability.empty()) return QVector<qreal>(filesCount, -1.);
-
-    QVector<qreal> res;
-    res.reserve(filesCount);
-    const TorrentInfo info = this->info();
-    for (int i = 0; i < filesCount; ++i) {
-        const TorrentInfo::PieceRange filePieces = info.filePieces(i);
+    return toAvailableFileFractions(this, pieceAvailability());
+}
 
-        int availablePieces = 0;
-        for (int piece = filePieces.first(); piece <= filePieces.last(); ++piece) {
-            availablePieces += (piecesAvailability[piece] > 0) ? 1 : 0;
-        }
-        res.push_back(static_cast<qreal>(availablePieces) / filePieces.size());
-    }
-    return res;
+void TorrentHandle::fetchAvailableFileFractions(QObject *context, const std::function<void (const QVector<qreal> &)> &resultHandler) const
+{
+    fetchPieceAvailability(context, [this, resultHandler](const QVector<int> &piecesAvailability)
+    {
+        resultHandler(toAvailableFileFractions(this, piecesAvailability));
+    });
 }
@@ -36,31 +36,32 @@
 #include <libtorrent/torrent_handle.hpp>
 #include <libtorrent/torrent_status.hpp>
 
+#include <QBitArray>
 #include <QHash>
 #include <QList>
 #include <QObject>
 #include <QQueue>
 #include <QSet>
 #include <QString>
+#include <QUrl>
 #include <QVector>
 
+#include "private/asyncsnapshot.h"
 #include "private/speedmonitor.h"
 #include "infohash.h"
+#include "peerinfo.h"
 #include "torrentinfo.h"
+#include "trackerentry.h"
 
 extern const QString QB_EXT;
 
-class QBitArray;
 class QDateTime;
 class QStringList;
-class QUrl;
 
 namespace BitTorrent
 {
     enum class DownloadPriority;
-    class PeerInfo;
     class Session;
-    class TrackerEntry;
     struct AddTorrentParams;
     struct PeerAddress;
 
@@ -316,6 +317,7 @@ namespace BitTorrent
         void forceDHTAnnounce();
         void forceRecheck();
         void renameFile(int index, const QString &name);
+        QByteArray torrentFileData() const;
         bool saveTorrentFile(const QString &path);
         void prioritizeFiles(const QVector<DownloadPriority> &priorities);
         void setRatioLimit(qreal limit);
@@ -336,6 +338,7 @@ namespace BitTorrent
 
         // Session interface
         lt::torrent_handle nativeHandle() const;
+        int statusReportCategories() const;
 
         void handleAlert(const lt::alert *a);
         void handleStateUpdate(const lt::torrent_status &nativeStatus);
@@ -352,12 +355,27 @@ namespace BitTorrent
          */
         QVector<qreal> availableFileFractions() const;
 
+        // Non-blocking counterparts of the accessors above. The request is performed
+        // in the worker thread and the result handler is invoked in the main thread
+        // unless the context object has been destroyed. Results are cached for a short
+        // time and shared between concurrent requests so the handler can be invoked
+        // immediately if there is a fresh snapshot available.
+        void fetchPeerInfo(QObject *context, const std::function<void (const QList<PeerInfo> &)> &resultHandler) const;
+        void fetchTrackers(QObject *context, const std::function<void (const QVector<TrackerEntry> &)> &resultHandler) const;
+        void fetchURLSeeds(QObject *context, const std::function<void (const QList<QUrl> &)> &resultHandler) const;
+        void fetchFilesProgress(QObject *context, const std::function<void (const QVector<qreal> &)> &resultHandler) const;
+        void fetchFilePriorities(QObject *context, const std::function<void (const QVector<DownloadPriority> &)> &resultHandler) const;
+        void fetchDownloadingPieces(QObject *context, const std::function<void (const QBitArray &)> &resultHandler) const;
+        void fetchPieceAvailability(QObject *context, const std::function<void (const QVector<int> &)> &resultHandler) const;
+        void fetchAvailableFileFractions(QObject *context, const std::function<void (const QVector<qreal> &)> &resultHandler) const;
+
     private:
         typedef std::function<void ()> EventTrigger;
 
         void updateStatus();
         void updateStatus(const lt::torrent_status &nativeStatus);
         void updateState();
+        int calculateStatusReportCategories() const;
         void updateTorrentInfo();
 
         void handleFastResumeRejectedAlert(const lt::fastresume_rejected_alert *p);
@@ -444,6 +462,16 @@ namespace BitTorrent
 
         StartupState m_startupState = NotStarted;
         bool m_unchecked = false;
+        int m_statusReportCategories = 0;
+
+        // cached results of blocking libtorrent requests
+        mutable AsyncSnapshot<QList<PeerInfo>> m_peersSnapshot;
+        mutable AsyncSnapshot<QVector<TrackerEntry>> m_trackersSnapshot;
+        mutable AsyncSnapshot<QList<QUrl>> m_urlSeedsSnapshot;
+        mutable AsyncSnapshot<QVector<qreal>> m_filesProgressSnapshot;
+        mutable AsyncSnapshot<QVector<DownloadPriority>> m_filePrioritiesSnapshot;
+        mutable AsyncSnapshot<QBitArray> m_downloadingPiecesSnapshot;
+        mutable AsyncSnapshot<QVector<int>> m_pieceAvailabilitySnapshot;
     };
 }
 
@@ -29,52 +29,137 @@
 
 #include "tracker.h"
 
-#include <libtorrent/bencode.hpp>
-#include <libtorrent/entry.hpp>
+#include <algorithm>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
 
 #include "base/http/server.h"
+#include "base/logger.h"
 #include "base/preferences.h"
+#include "base/utils/random.h"
 
 // static limits
-static const int MAX_TORRENTS = 100;
+static const int MAX_TORRENTS = 10000;
 static const int MAX_PEERS_PER_TORRENT = 1000;
+static const int DEFAULT_NUMWANT = 50;
+static const int MAX_NUMWANT = 200;
 static const int ANNOUNCE_INTERVAL = 1800; // 30min
+// a peer missing an announce gets some slack before it is dropped
+static const int PEER_TIMEOUT = ANNOUNCE_INTERVAL * 3 / 2;
+static const int EXPIRY_CHECK_INTERVAL = 300; // 5min
+
+// [BEP 15] UDP Tracker Protocol
+static const quint64 UDP_PROTOCOL_ID = 0x41727101980;
+static const int UDP_CONNECTION_ID_LIFETIME = 120; // seconds
+static const int UDP_MAX_SCRAPE_HASHES = 74;
 
 using namespace BitTorrent;
 
-// Peer
-bool Peer::operator!=(const Peer &other) const
+namespace
 {
-    return uid() != other.uid();
-}
+    enum UdpAction
+    {
+        UdpConnect = 0,
+        UdpAnnounce = 1,
+        UdpScrape = 2,
+        UdpError = 3
+    };
+
+    QByteArray toCompactEndpoint(const QHostAddress &address, const quint16 port)
+    {
+        QByteArray endpoint;
+
+        // IPv4-mapped addresses are stored in the IPv4 form, so each peer has a single endpoint
+        bool isIPv4 = false;
+        const quint32 ipv4 = address.toIPv4Address(&isIPv4);
+        if (isIPv4) {
+            endpoint.resize(6);
+            qToBigEndian(ipv4, endpoint.data());
+            qToBigEndian(port, (endpoint.data() + 4));
+        }
+        else {
+            const Q_IPV6ADDR ipv6 = address.toIPv6Address();
+            endpoint.resize(18);
+            std::memcpy(endpoint.data(), ipv6.c, 16);
+            qToBigEndian(port, (endpoint.data() + 16));
+        }
 
-bool Peer::operator==(const Peer &other) const
-{
-    return uid() == other.uid();
+        return endpoint;
+    }
+
+    bool isIPv4Endpoint(const QByteArray &endpoint)
+    {
+        return (endpoint.size() == 6);
+    }
+
+    void appendInteger(QByteArray &buf, const qint64 value)
+    {
+        buf += 'i';
+        buf += QByteArray::number(value);
+        buf += 'e';
+    }
+
+    void appendString(QByteArray &buf, const QByteArray &str)
+    {
+        buf += QByteArray::number(str.size());
+        buf += ':';
+        buf += str;
+    }
+
+    template <typename T>
+    void appendBigEndian(QByteArray &buf, const T value)
+    {
+        const int pos = buf.size();
+        buf.resize(pos + static_cast<int>(sizeof(T)));
+        qToBigEndian(value, (buf.data() + pos));
+    }
+
+    QByteArray udpErrorReply(const quint32 transactionId, const QByteArray &message)
+    {
+        QByteArray reply;
+        appendBigEndian<quint32>(reply, UdpError);
+        appendBigEndian<quint32>(reply, transactionId);
+        reply += message;
+        return reply;
+    }
 }
 
-QString Peer::uid() const
+// Peer
+QHostAddress Peer::address() const
 {
-    return ip.toString() + ':' + QString::number(port);
+    if (isIPv4Endpoint(endpoint))
+        return QHostAddress(qFromBigEndian<quint32>(endpoint.constData()));
+    return QHostAddress(reinterpret_cast<const quint8 *>(endpoint.constData()));
 }
 
-lt::entry Peer::toEntry(const bool noPeerId) const
+quint16 Peer::port() const
 {
-    lt::entry::dictionary_type peerMap;
-    if (!noPeerId)
-        peerMap["id"] = lt::entry(peerId.toStdString());
-    peerMap["ip"] = lt::entry(ip.toString().toStdString());
-    peerMap["port"] = lt::entry(port);
-
-    return lt::entry(peerMap);
+    return qFromBigEndian<quint16>(endpoint.constData() + (endpoint.size() - 2));
 }
 
 // Tracker
 
 Tracker::Tracker(QObject *parent)
     : QObject(parent)
-    , m_server(new Http::Server(this, this))
+    , m_server(new Http::Server(this, 1, this))
+    , m_udpSocket(new QUdpSocket(this))
+    , m_expiryTimer(new QTimer(this))
+    , m_randomEngine(Utils::Random::rand())
 {
+    m_clock.start();
+
+    // the connection ids handed out over UDP can't be forged without it
+    for (int i = 0; i < 4; ++i)
+        appendBigEndian<quint32>(m_connectionIdSecret, Utils::Random::rand());
+
+    connect(m_udpSocket, &QUdpSocket::readyRead, this, &Tracker::readDatagrams);
+
+    m_expiryTimer->setInterval(EXPIRY_CHECK_INTERVAL * 1000);
+    connect(m_expiryTimer, &QTimer::timeout, this, &Tracker::expirePeers);
 }
 
 Tracker::~Tracker()
@@ -95,11 +180,31 @@ bool Tracker::start()
         }
         // Wrong port, closing the server
         m_server->close();
+        m_udpSocket->close();
     }
 
     qDebug("Starting the embedded tracker...");
     // Listen on the predefined port
-    return m_server->listen(QHostAddress::Any, listenPort);
+    if (!m_server->listen(QHostAddress::Any, listenPort))
+        return false;
+
+    // announcing over HTTP still works without it
+    if (!m_udpSocket->bind(QHostAddress::Any, listenPort)) {
+        LogMsg(tr("Embedded tracker failed to listen for UDP announces. Reason: %1")
+            .arg(m_udpSocket->errorString()), Log::WARNING);
+    }
+
+    m_expiryTimer->start();
+    return true;
+}
+
+TrackerStatistics Tracker::statistics() const
+{
+    TrackerStatistics stats = m_statistics;
+    stats.torrentCount = m_torrents.size();
+    for (const TorrentPeers &torrent : m_torrents)
+        stats.peerCount += torrent.peers.size();
+    return stats;
 }
 
 Http::Response Tracker::processRequest(const Http::Request &request, const Http::Environment &env)
@@ -110,18 +215,25 @@ Http::Response Tracker::processRequest(const Http::Request &request, const Http:
     // Is request a GET request?
     if (request.method != "GET") {
         qDebug("Tracker: Unsupported HTTP request: %s", qUtf8Printable(request.method));
+        ++m_statistics.invalidRequestCount;
         status(100, "Invalid request type");
     }
-    else if (!request.path.startsWith("/announce", Qt::CaseInsensitive)) {
-        qDebug("Tracker: Unrecognized path: %s", qUtf8Printable(request.path));
-        status(100, "Invalid request type");
-    }
-    else {
+    else if (request.path.startsWith("/announce", Qt::CaseInsensitive)) {
         // OK, this is a GET request
         m_request = request;
         m_env = env;
         respondToAnnounceRequest();
     }
+    else if (request.path.startsWith("/scrape", Qt::CaseInsensitive)) {
+        m_request = request;
+        m_env = env;
+        respondToScrapeRequest();
+    }
+    else {
+        qDebug("Tracker: Unrecognized path: %s", qUtf8Printable(request.path));
+        ++m_statistics.invalidRequestCount;
+        status(100, "Invalid request type");
+    }
 
     return response();
 }
@@ -134,11 +246,12 @@ void Tracker::respondToAnnounceRequest()
     // IP
     // Use the "ip" parameter provided from tracker request first, then fall back to client IP if invalid
     const QHostAddress paramIP {QString::fromLatin1(queryParams.value("ip"))};
-    announceReq.peer.ip = paramIP.isNull() ? m_env.clientAddress : paramIP;
+    announceReq.address = paramIP.isNull() ? m_env.clientAddress : paramIP;
 
     // 1. Get info_hash
     if (!queryParams.contains("info_hash")) {
         qDebug("Tracker: Missing info_hash");
+        ++m_statistics.invalidRequestCount;
         status(101, "Missing info_hash");
         return;
     }
@@ -153,10 +266,11 @@ void Tracker::respondToAnnounceRequest()
     // 2. Get peer ID
     if (!queryParams.contains("peer_id")) {
         qDebug("Tracker: Missing peer_id");
+        ++m_statistics.invalidRequestCount;
         status(102, "Missing peer_id");
         return;
     }
-    announceReq.peer.peerId = queryParams.value("peer_id");
+    announceReq.peerId = queryParams.value("peer_id");
     // peer_id cannot be longer than 20 bytes
     /*if (annonce_req.peer.peer_id.length() > 20) {
         qDebug("Tracker: peer_id is not 20 byte long: %s", qUtf8Printable(annonce_req.peer.peer_id));
@@ -167,100 +281,449 @@ void Tracker::respondToAnnounceRequest()
     // 3. Get port
     if (!queryParams.contains("port")) {
         qDebug("Tracker: Missing port");
+        ++m_statistics.invalidRequestCount;
         status(103, "Missing port");
         return;
     }
     bool ok = false;
-    announceReq.peer.port = queryParams.value("port").toInt(&ok);
-    if (!ok || (announceReq.peer.port < 0) || (announceReq.peer.port > 65535)) {
-        qDebug("Tracker: Invalid port number (%d)", announceReq.peer.port);
+    const int port = queryParams.value("port").toInt(&ok);
+    if (!ok || (port < 0) || (port > 65535)) {
+        qDebug("Tracker: Invalid port number (%d)", port);
+        ++m_statistics.invalidRequestCount;
         status(103, "Missing port");
         return;
     }
+    announceReq.port = port;
 
     // 4.  Get event
-    announceReq.event = "";
-    if (queryParams.contains("event")) {
-        announceReq.event = queryParams.value("event");
-        qDebug("Tracker: event is %s", qUtf8Printable(announceReq.event));
-    }
+    announceReq.event = TrackerAnnounceRequest::Event::None;
+    const QByteArray event = queryParams.value("event");
+    if (event == "started")
+        announceReq.event = TrackerAnnounceRequest::Event::Started;
+    else if (event == "completed")
+        announceReq.event = TrackerAnnounceRequest::Event::Completed;
+    else if (event == "stopped")
+        announceReq.event = TrackerAnnounceRequest::Event::Stopped;
 
     // 5. Get numwant
-    announceReq.numwant = 50;
+    announceReq.numwant = DEFAULT_NUMWANT;
     if (queryParams.contains("numwant")) {
         int tmp = queryParams.value("numwant").toInt();
-        if (tmp > 0) {
+        if (tmp >= 0) {
             qDebug("Tracker: numwant = %d", tmp);
-            announceReq.numwant = tmp;
+            announceReq.numwant = std::min(tmp, MAX_NUMWANT);
         }
     }
 
-    // 6. no_peer_id (extension)
-    announceReq.noPeerId = false;
-    if (queryParams.contains("no_peer_id"))
-        announceReq.noPeerId = true;
+    // 6. Get left, the peers having nothing left are seeders
+    announceReq.isSeeder = (queryParams.contains("left") && (queryParams.value("left").toLongLong() == 0))
+        || (announceReq.event == TrackerAnnounceRequest::Event::Completed);
 
-    // 7. TODO: support "compact" extension
+    // 7. no_peer_id (extension)
+    announceReq.noPeerId = queryParams.contains("no_peer_id");
+
+    // 8. compact (extension)
+    // [BEP 23] Tracker Returns Compact Peer Lists
+    announceReq.compact = (queryParams.value("compact") == "1");
 
     // Done parsing, now let's reply
-    if (announceReq.event == "stopped") {
-        unregisterPeer(announceReq);
+    ++m_statistics.announceCount;
+    announce(announceReq);
+    if (announceReq.event != TrackerAnnounceRequest::Event::Stopped)
+        replyWithPeerList(announceReq);
+}
+
+void Tracker::respondToScrapeRequest()
+{
+    // [BEP 48] Tracker Protocol Extension: Scrape
+    // without info_hash all the torrents are reported
+    ++m_statistics.scrapeCount;
+
+    QByteArray reply = "d5:filesd";
+    const auto appendFile = [&reply](const QByteArray &infoHash, const TorrentPeers &torrent)
+    {
+        appendString(reply, infoHash);
+        reply += "d8:complete";
+        appendInteger(reply, torrent.seederCount);
+        reply += "10:downloaded";
+        appendInteger(reply, torrent.completedCount);
+        reply += "10:incomplete";
+        appendInteger(reply, (torrent.peers.size() - torrent.seederCount));
+        reply += 'e';
+    };
+
+    if (m_request.query.contains("info_hash")) {
+        const QByteArray infoHash = m_request.query.value("info_hash");
+        const auto torrentIter = m_torrents.constFind(infoHash);
+        if (torrentIter != m_torrents.constEnd())
+            appendFile(infoHash, *torrentIter);
     }
     else {
-        registerPeer(announceReq);
-        replyWithPeerList(announceReq);
+        // dictionary keys are sorted
+        QList<QByteArray> infoHashes = m_torrents.keys();
+        std::sort(infoHashes.begin(), infoHashes.end());
+        for (const QByteArray &infoHash : infoHashes)
+            appendFile(infoHash, m_torrents[infoHash]);
     }
+
+    reply += "ee";
+    print(reply, Http::CONTENT_TYPE_TXT);
+}
+
+void Tracker::announce(const TrackerAnnounceRequest &announceReq)
+{
+    if (announceReq.event == TrackerAnnounceRequest::Event::Stopped)
+        unregisterPeer(announceReq);
+    else
+        registerPeer(announceReq);
 }
 
 void Tracker::registerPeer(const TrackerAnnounceRequest &announceReq)
 {
-    if (announceReq.peer.port == 0) return;
+    if (announceReq.port == 0) return;
 
-    if (!m_torrents.contains(announceReq.infoHash)) {
+    auto torrentIter = m_torrents.find(announceReq.infoHash);
+    if (torrentIter == m_torrents.end()) {
         // Unknown torrent
-        if (m_torrents.size() == MAX_TORRENTS) {
+        if (m_torrents.size() >= MAX_TORRENTS) {
             // Reached max size, remove a random torrent
             m_torrents.erase(m_torrents.begin());
         }
+        torrentIter = m_torrents.insert(announceReq.infoHash, {});
     }
 
     // Register the user
-    PeerList &peers = m_torrents[announceReq.infoHash];
-    if (!peers.contains(announceReq.peer.uid())) {
-        // Unknown peer
-        if (peers.size() == MAX_PEERS_PER_TORRENT) {
-            // Too many peers, remove a random one
-            peers.erase(peers.begin());
+    TorrentPeers &torrent = *torrentIter;
+    const QByteArray endpoint = toCompactEndpoint(announceReq.address, announceReq.port);
+    const qint64 now = m_clock.elapsed() / 1000;
+
+    if (announceReq.event == TrackerAnnounceRequest::Event::Completed)
+        ++torrent.completedCount;
+
+    const auto indexIter = torrent.peerIndexes.constFind(endpoint);
+    if (indexIter != torrent.peerIndexes.constEnd()) {
+        Peer &peer = torrent.peers[*indexIter];
+        torrent.seederCount += (announceReq.isSeeder - peer.isSeeder);
+        peer.peerId = announceReq.peerId;
+        peer.announceTime = now;
+        peer.isSeeder = announceReq.isSeeder;
+        return;
+    }
+
+    // Unknown peer
+    if (torrent.peers.size() >= MAX_PEERS_PER_TORRENT) {
+        removeExpiredPeers(torrent);
+        // Too many peers, remove a random one
+        if (torrent.peers.size() >= MAX_PEERS_PER_TORRENT) {
+            const int index = std::uniform_int_distribution<int>(0, (torrent.peers.size() - 1))(m_randomEngine);
+            removePeer(torrent, index);
         }
     }
-    peers[announceReq.peer.uid()] = announceReq.peer;
+
+    torrent.peerIndexes.insert(endpoint, torrent.peers.size());
+    torrent.peers.append({endpoint, announceReq.peerId, now, announceReq.isSeeder});
+    torrent.seederCount += announceReq.isSeeder;
 }
 
 void Tracker::unregisterPeer(const TrackerAnnounceRequest &announceReq)
 {
-    if (announceReq.peer.port == 0) return;
+    if (announceReq.port == 0) return;
+
+    const auto torrentIter = m_torrents.find(announceReq.infoHash);
+    if (torrentIter == m_torrents.end())
+        return;
+
+    TorrentPeers &torrent = *torrentIter;
+    const int index = torrent.peerIndexes.value(toCompactEndpoint(announceReq.address, announceReq.port), -1);
+    if (index < 0)
+        return;
 
-    if (m_torrents[announceReq.infoHash].remove(announceReq.peer.uid()) > 0)
-        qDebug("Tracker: Peer stopped downloading, deleting it from the list");
+    qDebug("Tracker: Peer stopped downloading, deleting it from the list");
+    removePeer(torrent, index);
 }
 
 void Tracker::replyWithPeerList(const TrackerAnnounceRequest &announceReq)
 {
-    // Prepare the entry for bencoding
-    lt::entry::dictionary_type replyDict;
-    replyDict["interval"] = lt::entry(ANNOUNCE_INTERVAL);
-
-    lt::entry::list_type peerList;
-    for (const Peer &p : m_torrents.value(announceReq.infoHash))
-        peerList.push_back(p.toEntry(announceReq.noPeerId));
-    replyDict["peers"] = lt::entry(peerList);
+    const TorrentPeers &torrent = torrentPeers(announceReq.infoHash);
+
+    // bencode, the dictionary keys are sorted
+    QByteArray reply = "d8:complete";
+    appendInteger(reply, torrent.seederCount);
+    reply += "10:incomplete";
+    appendInteger(reply, (torrent.peers.size() - torrent.seederCount));
+    reply += "8:interval";
+    appendInteger(reply, ANNOUNCE_INTERVAL);
+
+    if (announceReq.compact) {
+        QByteArray peers;
+        QByteArray peers6;
+        forEachSampledPeer(announceReq, [&peers, &peers6](const Peer &peer)
+        {
+            if (isIPv4Endpoint(peer.endpoint))
+                peers += peer.endpoint;
+            else
+                peers6 += peer.endpoint;
+        });
+
+        reply += "5:peers";
+        appendString(reply, peers);
+        // [BEP 7] IPv6 Tracker Extension
+        if (!peers6.isEmpty()) {
+            reply += "6:peers6";
+            appendString(reply, peers6);
+        }
+    }
+    else {
+        reply += "5:peersl";
+        forEachSampledPeer(announceReq, [&reply, &announceReq](const Peer &peer)
+        {
+            reply += "d2:ip";
+            appendString(reply, peer.address().toString().toLatin1());
+            if (!announceReq.noPeerId) {
+                reply += "7:peer id";
+                appendString(reply, peer.peerId);
+            }
+            reply += "4:port";
+            appendInteger(reply, peer.port());
+            reply += 'e';
+        });
+        reply += 'e';
+    }
 
-    const lt::entry replyEntry(replyDict);
-    // bencode
-    QByteArray reply;
-    lt::bencode(std::back_inserter(reply), replyEntry);
-    qDebug("Tracker: reply with the following bencoded data:\n %s", reply.constData());
+    reply += 'e';
 
     // HTTP reply
     print(reply, Http::CONTENT_TYPE_TXT);
 }
+
+const Tracker::TorrentPeers &Tracker::torrentPeers(const QByteArray &infoHash) const
+{
+    static const TorrentPeers noPeers;
+
+    const auto torrentIter = m_torrents.constFind(infoHash);
+    return (torrentIter != m_torrents.constEnd()) ? *torrentIter : noPeers;
+}
+
+template <typename Func>
+void Tracker::forEachSampledPeer(const TrackerAnnounceRequest &announceReq, Func func)
+{
+    const auto torrentIter = m_torrents.find(announceReq.infoHash);
+    if (torrentIter == m_torrents.end())
+        return;
+
+    TorrentPeers &torrent = *torrentIter;
+    QVector<Peer> &peers = torrent.peers;
+    const QByteArray requester = toCompactEndpoint(announceReq.address, announceReq.port);
+
+    // One more is drawn in case the requester is among them.
+    // A partial Fisher-Yates shuffle moves the sample to the front.
+    const int sampleSize = std::min((announceReq.numwant + 1), peers.size());
+    if (sampleSize < peers.size()) {
+        for (int i = 0; i < sampleSize; ++i) {
+            const int j = std::uniform_int_distribution<int>(i, (peers.size() - 1))(m_randomEngine);
+            if (i == j)
+                continue;
+
+            std::swap(peers[i], peers[j]);
+            torrent.peerIndexes[peers[i].endpoint] = i;
+            torrent.peerIndexes[peers[j].endpoint] = j;
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; (i < sampleSize) && (count < announceReq.numwant); ++i) {
+        if (peers[i].endpoint == requester)
+            continue;
+
+        func(peers[i]);
+        ++count;
+    }
+}
+
+void Tracker::removePeer(TorrentPeers &torrent, const int index)
+{
+    // the last peer takes its place
+    QVector<Peer> &peers = torrent.peers;
+    torrent.seederCount -= peers[index].isSeeder;
+    torrent.peerIndexes.remove(peers[index].endpoint);
+
+    const int lastIndex = peers.size() - 1;
+    if (index != lastIndex) {
+        peers[index] = peers[lastIndex];
+        torrent.peerIndexes[peers[index].endpoint] = index;
+    }
+    peers.removeLast();
+}
+
+void Tracker::removeExpiredPeers(TorrentPeers &torrent)
+{
+    const qint64 expiryTime = (m_clock.elapsed() / 1000) - PEER_TIMEOUT;
+
+    // going backwards, the peers moved into the gaps have been checked already
+    for (int i = (torrent.peers.size() - 1); i >= 0; --i) {
+        if (torrent.peers[i].announceTime < expiryTime) {
+            removePeer(torrent, i);
+            ++m_statistics.expiredPeerCount;
+        }
+    }
+}
+
+void Tracker::expirePeers()
+{
+    for (auto iter = m_torrents.begin(); iter != m_torrents.end();) {
+        removeExpiredPeers(*iter);
+        if (iter->peers.isEmpty())
+            iter = m_torrents.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+void Tracker::readDatagrams()
+{
+    while (m_udpSocket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(static_cast<int>(std::max<qint64>(m_udpSocket->pendingDatagramSize(), 0)));
+
+        QHostAddress address;
+        quint16 port = 0;
+        const qint64 size = m_udpSocket->readDatagram(datagram.data(), datagram.size(), &address, &port);
+        if (size < 0)
+            break;
+        datagram.truncate(size);
+
+        const QByteArray reply = processDatagram(datagram, address, port);
+        if (!reply.isEmpty())
+            m_udpSocket->writeDatagram(reply, address, port);
+    }
+}
+
+QByteArray Tracker::processDatagram(const QByteArray &datagram, const QHostAddress &address, const quint16 port)
+{
+    // [BEP 15] UDP Tracker Protocol
+    // every request starts with the connection id, the action and the transaction id
+    if (datagram.size() < 16) {
+        ++m_statistics.invalidRequestCount;
+        return {};
+    }
+
+    const char *data = datagram.constData();
+    const quint64 connId = qFromBigEndian<quint64>(data);
+    const quint32 action = qFromBigEndian<quint32>(data + 8);
+    const quint32 transactionId = qFromBigEndian<quint32>(data + 12);
+
+    const qint64 window = (m_clock.elapsed() / 1000) / UDP_CONNECTION_ID_LIFETIME;
+
+    if (action == UdpConnect) {
+        if (connId != UDP_PROTOCOL_ID) {
+            ++m_statistics.invalidRequestCount;
+            return {};
+        }
+
+        ++m_statistics.udpConnectCount;
+        QByteArray reply;
+        appendBigEndian<quint32>(reply, UdpConnect);
+        appendBigEndian<quint32>(reply, transactionId);
+        appendBigEndian<quint64>(reply, connectionId(address, port, window));
+        return reply;
+    }
+
+    // the ids handed out in the previous window are still accepted, so each one lives at least that long
+    // The source address of a request without a valid connection id isn't verified,
+    // replying to it could reflect traffic to a spoofed address
+    if ((connId != connectionId(address, port, window)) && (connId != connectionId(address, port, (window - 1)))) {
+        ++m_statistics.invalidRequestCount;
+        return {};
+    }
+
+    if (action == UdpAnnounce) {
+        if (datagram.size() < 98) {
+            ++m_statistics.invalidRequestCount;
+            return udpErrorReply(transactionId, "Malformed announce request");
+        }
+
+        TrackerAnnounceRequest announceReq;
+        announceReq.infoHash = datagram.mid(16, 20);
+        announceReq.peerId = datagram.mid(36, 20);
+        const qint64 left = qFromBigEndian<qint64>(data + 64);
+        const quint32 event = qFromBigEndian<quint32>(data + 80);
+        const quint32 ip = qFromBigEndian<quint32>(data + 84);
+        const qint32 numwant = qFromBigEndian<qint32>(data + 92);
+        announceReq.port = qFromBigEndian<quint16>(data + 96);
+
+        // Use the address provided in the request first, like the "ip" parameter over HTTP
+        announceReq.address = (ip != 0) ? QHostAddress(ip) : address;
+
+        switch (event) {
+        case 1:
+            announceReq.event = TrackerAnnounceRequest::Event::Completed;
+            break;
+        case 2:
+            announceReq.event = TrackerAnnounceRequest::Event::Started;
+            break;
+        case 3:
+            announceReq.event = TrackerAnnounceRequest::Event::Stopped;
+            break;
+        default:
+            announceReq.event = TrackerAnnounceRequest::Event::None;
+            break;
+        }
+
+        announceReq.numwant = (numwant < 0) ? DEFAULT_NUMWANT : std::min(numwant, MAX_NUMWANT);
+        announceReq.isSeeder = (left == 0) || (announceReq.event == TrackerAnnounceRequest::Event::Completed);
+        announceReq.noPeerId = true;
+        announceReq.compact = true;
+
+        ++m_statistics.udpAnnounceCount;
+        announce(announceReq);
+
+        const TorrentPeers &torrent = torrentPeers(announceReq.infoHash);
+        QByteArray reply;
+        appendBigEndian<quint32>(reply, UdpAnnounce);
+        appendBigEndian<quint32>(reply, transactionId);
+        appendBigEndian<quint32>(reply, ANNOUNCE_INTERVAL);
+        appendBigEndian<quint32>(reply, (torrent.peers.size() - torrent.seederCount));
+        appendBigEndian<quint32>(reply, torrent.seederCount);
+
+        // the peers are of the same address family as the request
+        if (announceReq.event != TrackerAnnounceRequest::Event::Stopped) {
+            const bool isIPv4Request = (toCompactEndpoint(address, port).size() == 6);
+            forEachSampledPeer(announceReq, [&reply, isIPv4Request](const Peer &peer)
+            {
+                if (isIPv4Endpoint(peer.endpoint) == isIPv4Request)
+                    reply += peer.endpoint;
+            });
+        }
+        return reply;
+    }
+
+    if (action == UdpScrape) {
+        ++m_statistics.udpScrapeCount;
+
+        QByteArray reply;
+        appendBigEndian<quint32>(reply, UdpScrape);
+        appendBigEndian<quint32>(reply, transactionId);
+
+        const int hashCount = std::min(((datagram.size() - 16) / 20), UDP_MAX_SCRAPE_HASHES);
+        for (int i = 0; i < hashCount; ++i) {
+            const TorrentPeers &torrent = torrentPeers(datagram.mid((16 + (i * 20)), 20));
+            appendBigEndian<quint32>(reply, torrent.seederCount);
+            appendBigEndian<quint32>(reply, torrent.completedCount);
+            appendBigEndian<quint32>(reply, (torrent.peers.size() - torrent.seederCount));
+        }
+        return reply;
+    }
+
+    ++m_statistics.invalidRequestCount;
+    return udpErrorReply(transactionId, "Unknown action");
+}
+
+quint64 Tracker::connectionId(const QHostAddress &address, const quint16 port, const qint64 window) const
+{
+    // derived from the client's endpoint, so no state is kept for the UDP clients
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_connectionIdSecret);
+    hash.addData(toCompactEndpoint(address, port));
+    hash.addData(QByteArray::number(window));
+    return qFromBigEndian<quint64>(hash.result().constData());
+}
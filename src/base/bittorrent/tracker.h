@@ -30,15 +30,20 @@
 #ifndef BITTORRENT_TRACKER_H
 #define BITTORRENT_TRACKER_H
 
-#include <libtorrent/fwd.hpp>
+#include <random>
 
+#include <QElapsedTimer>
 #include <QHash>
-#include <QObject>
 #include <QHostAddress>
+#include <QObject>
+#include <QVector>
 
 #include "base/http/irequesthandler.h"
 #include "base/http/responsebuilder.h"
 
+class QTimer;
+class QUdpSocket;
+
 namespace Http
 {
     class Server;
@@ -48,31 +53,53 @@ namespace BitTorrent
 {
     struct Peer
     {
-        QHostAddress ip;
+        QByteArray endpoint;  // [BEP 23] address and port in network byte order, 6 bytes for IPv4 and 18 bytes for IPv6
         QByteArray peerId;
-        int port;
+        qint64 announceTime;  // seconds since the tracker has started
+        bool isSeeder;
 
-        bool operator!=(const Peer &other) const;
-        bool operator==(const Peer &other) const;
-        QString uid() const;
-        lt::entry toEntry(bool noPeerId) const;
+        QHostAddress address() const;
+        quint16 port() const;
     };
 
     struct TrackerAnnounceRequest
     {
+        enum class Event
+        {
+            None,
+            Started,
+            Completed,
+            Stopped
+        };
+
         QByteArray infoHash;
-        QString event;
+        Event event;
         int numwant;
-        Peer peer;
+        QHostAddress address;
+        quint16 port;
+        QByteArray peerId;
+        bool isSeeder;
         // Extensions
         bool noPeerId;
+        bool compact;
     };
 
-    typedef QHash<QString, Peer> PeerList;
-    typedef QHash<QByteArray, PeerList> TorrentList;
+    struct TrackerStatistics
+    {
+        quint64 announceCount = 0;
+        quint64 udpAnnounceCount = 0;
+        quint64 scrapeCount = 0;
+        quint64 udpScrapeCount = 0;
+        quint64 udpConnectCount = 0;
+        quint64 invalidRequestCount = 0;
+        quint64 expiredPeerCount = 0;
+        int torrentCount = 0;
+        int peerCount = 0;
+    };
 
     /* Basic Bittorrent tracker implementation in Qt */
     /* Following http://wiki.theory.org/BitTorrent_Tracker_Protocol */
+    /* Announces are also accepted over UDP, see BEP 15 */
     class Tracker : public QObject, public Http::IRequestHandler, private Http::ResponseBuilder
     {
         Q_OBJECT
@@ -85,14 +112,43 @@ namespace BitTorrent
         bool start();
         Http::Response processRequest(const Http::Request &request, const Http::Environment &env);
 
+        TrackerStatistics statistics() const;
+
     private:
+        // The peers are stored contiguously, so a random sample of them is cheap to draw
+        struct TorrentPeers
+        {
+            QVector<Peer> peers;
+            QHash<QByteArray, int> peerIndexes;  // by endpoint
+            int seederCount = 0;
+            int completedCount = 0;
+        };
+
         void respondToAnnounceRequest();
+        void respondToScrapeRequest();
+        void announce(const TrackerAnnounceRequest &announceReq);
         void registerPeer(const TrackerAnnounceRequest &announceReq);
         void unregisterPeer(const TrackerAnnounceRequest &announceReq);
         void replyWithPeerList(const TrackerAnnounceRequest &announceReq);
+        const TorrentPeers &torrentPeers(const QByteArray &infoHash) const;
+        template <typename Func>
+        void forEachSampledPeer(const TrackerAnnounceRequest &announceReq, Func func);
+        void removePeer(TorrentPeers &torrent, int index);
+        void removeExpiredPeers(TorrentPeers &torrent);
+        void expirePeers();
+
+        void readDatagrams();
+        QByteArray processDatagram(const QByteArray &datagram, const QHostAddress &address, quint16 port);
+        quint64 connectionId(const QHostAddress &address, quint16 port, qint64 window) const;
 
         Http::Server *m_server;
-        TorrentList m_torrents;
+        QUdpSocket *m_udpSocket;
+        QTimer *m_expiryTimer;
+        QHash<QByteArray, TorrentPeers> m_torrents;
+        QElapsedTimer m_clock;
+        std::mt19937 m_randomEngine;
+        QByteArray m_connectionIdSecret;
+        TrackerStatistics m_statistics;
 
         Http::Request m_request;
         Http::Environment m_env;
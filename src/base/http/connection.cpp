@@ -30,23 +30,56 @@
 
 #include "connection.h"
 
+#include <algorithm>
+
 #include <QTcpSocket>
+#include <QTimer>
 
 #include "base/logger.h"
-#include "irequesthandler.h"
+#include "base/utils/gzip.h"
 #include "requestparser.h"
 #include "responsegenerator.h"
+#include "responsestream.h"
+#include "server.h"
+
+namespace
+{
+    // the content is handed over to the socket in slices, so a large payload isn't copied into its buffer at once
+    const int OUTPUT_SLICE_SIZE = 64 * 1024;
+    // no more data is handed over while the socket has this much left to send
+    const qint64 MAX_BYTES_TO_WRITE = 256 * 1024;
+
+    bool isKeepAlive(const Http::Request &request)
+    {
+        // [rfc7230] 6.3. Persistence
+        const QString options = request.headers.value(Http::HEADER_CONNECTION).toLower();
+        if (request.version == QLatin1String("1.0"))
+            return options.contains(QLatin1String("keep-alive"));
+        return !options.contains(QLatin1String("close"));
+    }
+}
 
 using namespace Http;
 
-Connection::Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent)
+Connection::Connection(QTcpSocket *socket, Server *server, QObject *parent)
     : QObject(parent)
     , m_socket(socket)
-    , m_requestHandler(requestHandler)
+    , m_server(server)
+    , m_isProcessingRequest(false)
+    , m_isWaitingForOutput(false)
+    , m_isClosing(false)
+    , m_acceptsGzip(false)
+    , m_isHeadRequest(false)
+    , m_isKeepAlive(true)
+    , m_isChunked(false)
+    , m_outputOffset(0)
 {
+    Q_ASSERT(parent);
+
     m_socket->setParent(this);
     m_idleTimer.start();
     connect(m_socket, &QTcpSocket::readyRead, this, &Connection::read);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &Connection::writeOutput);
 }
 
 Connection::~Connection()
@@ -57,23 +90,31 @@ Connection::~Connection()
 void Connection::read()
 {
     m_idleTimer.restart();
-    m_receivedData.append(m_socket->readAll());
 
-    while (!m_receivedData.isEmpty()) {
-        const RequestParser::ParseResult result = RequestParser::parse(m_receivedData);
+    // the remaining requests won't be answered
+    if (m_isClosing) {
+        m_socket->readAll();
+        return;
+    }
+
+    m_requestParser.read(m_socket);
 
-        switch (result.status) {
+    // pipelined requests are answered in order, the next one is parsed once the response is sent
+    if (!m_isProcessingRequest && !m_isWaitingForOutput)
+        processReceivedData();
+}
+
+void Connection::processReceivedData()
+{
+    while (m_requestParser.hasBufferedData()) {
+        switch (m_requestParser.parse()) {
         case RequestParser::ParseStatus::Incomplete: {
                 const long bufferLimit = RequestParser::MAX_CONTENT_SIZE * 1.1;  // some margin for headers
-                if (m_receivedData.size() > bufferLimit) {
+                if (m_requestParser.bufferedSize() > bufferLimit) {
                     Logger::instance()->addMessage(tr("Http request size exceeds limiation, closing socket. Limit: %1, IP: %2")
                         .arg(bufferLimit).arg(m_socket->peerAddress().toString()), Log::WARNING);
 
-                    Response resp(413, "Payload Too Large");
-                    resp.headers[HEADER_CONNECTION] = "close";
-
-                    sendResponse(resp);
-                    m_socket->close();
+                    rejectRequest(Response(413, "Payload Too Large"));
                 }
             }
             return;
@@ -82,28 +123,16 @@ void Connection::read()
                 Logger::instance()->addMessage(tr("Bad Http request, closing socket. IP: %1")
                     .arg(m_socket->peerAddress().toString()), Log::WARNING);
 
-                Response resp(400, "Bad Request");
-                resp.headers[HEADER_CONNECTION] = "close";
-
-                sendResponse(resp);
-                m_socket->close();
+                rejectRequest(Response(400, "Bad Request"));
             }
             return;
 
         case RequestParser::ParseStatus::OK: {
                 const Environment env {m_socket->localAddress(), m_socket->localPort(), m_socket->peerAddress(), m_socket->peerPort()};
 
-                Response resp = m_requestHandler->processRequest(result.request, env);
-
-                if (acceptsGzipEncoding(result.request.headers["accept-encoding"]))
-                    resp.headers[HEADER_CONTENT_ENCODING] = "gzip";
-
-                resp.headers[HEADER_CONNECTION] = "keep-alive";
-
-                sendResponse(resp);
-                m_receivedData = m_receivedData.mid(result.frameSize);
+                dispatchRequest(m_requestParser.takeRequest(), env);
             }
-            break;
+            return;
 
         default:
             Q_ASSERT(false);
@@ -112,59 +141,308 @@ void Connection::read()
     }
 }
 
-void Connection::sendResponse(const Response &response) const
+void Connection::dispatchRequest(Request request, const Environment &env)
 {
-    m_socket->write(toByteArray(response));
+    m_isProcessingRequest = true;
+    m_acceptsGzip = acceptsGzipEncoding(request.headers.value(HEADER_ACCEPT_ENCODING));
+    m_isKeepAlive = isKeepAlive(request);
+    // [rfc7230] 4.1. Chunked Transfer Coding
+    // HTTP/1.0 clients don't know it, their streamed content ends when the connection is closed
+    m_isChunked = (request.version != QLatin1String("1.0"));
+
+    // [rfc7231] 4.3.2. HEAD
+    // the request is handled as GET, so the header fields are the same, the content is left out when sending
+    m_isHeadRequest = (request.method == HEADER_REQUEST_METHOD_HEAD);
+    if (m_isHeadRequest)
+        request.method = METHOD_GET;
+
+    // The request handler isn't thread-safe, so it is called in the server thread.
+    // The response is handed back to this thread, where it gets compressed and sent.
+    Server *server = m_server;
+    QObject *context = parent();
+    const QPointer<Connection> connection = this;
+    QElapsedTimer queueTimer;
+    queueTimer.start();
+
+    QTimer::singleShot(0, server, [server, context, connection, request, env, queueTimer]()
+    {
+        const Response resp = server->processRequest(request, env, (queueTimer.nsecsElapsed() / 1000));
+
+        // the handler answers later through the stream
+        if (resp.stream) {
+            resp.stream->attach(server, context, connection);
+            return;
+        }
+
+        // The server isn't destroyed from within its request handler, so it is still alive here and
+        // so is `context`, which is only destroyed when the server stops the I/O threads
+        QTimer::singleShot(0, context, [connection, resp]()
+        {
+            if (connection)
+                connection->finishRequest(resp);
+        });
+    });
 }
 
-bool Connection::hasExpired(const qint64 timeout) const
+void Connection::finishRequest(Response response)
 {
-    return m_idleTimer.hasExpired(timeout);
+    if (m_isClosing)
+        return;
+
+    // content that is already encoded (e.g. precompressed files) is sent as is
+    if (m_acceptsGzip && !response.headers.contains(HEADER_CONTENT_ENCODING)) {
+        QElapsedTimer compressionTimer;
+        compressionTimer.start();
+        compressContent(response);
+
+        const QString timing = QString::fromLatin1("gzip;dur=%1").arg((compressionTimer.nsecsElapsed() / 1000000.0), 0, 'f', 3);
+        QString &serverTiming = response.headers[HEADER_SERVER_TIMING];
+        if (!serverTiming.isEmpty())
+            serverTiming += QLatin1String(", ");
+        serverTiming += timing;
+    }
+
+    response.headers[HEADER_CONNECTION] = (m_isKeepAlive ? "keep-alive" : "close");
+    sendResponse(response);
+
+    finishProcessing();
 }
 
-bool Connection::isClosed() const
+void Connection::startStream(Response response, const QPointer<ResponseStream> &stream)
 {
-    return (m_socket->state() == QAbstractSocket::UnconnectedState);
+    if (m_isClosing)
+        return;
+
+    m_responseStream = stream;
+    // the length of streamed content isn't known in advance
+    response.stream = stream;
+
+    // The events have to reach the client as soon as they are written, so they aren't compressed.
+    // The other streamed content is large, so it is compressed with the fastest level.
+    if (m_acceptsGzip && !response.headers.contains(HEADER_CONTENT_ENCODING)
+        && !response.headers.value(HEADER_CONTENT_TYPE).startsWith(QLatin1String(CONTENT_TYPE_EVENT_STREAM))) {
+        response.headers[HEADER_CONTENT_ENCODING] = QLatin1String("gzip");
+        if (!m_isHeadRequest)
+            m_streamCompressor.reset(new Utils::Gzip::Compressor(1));
+    }
+
+    if (m_isChunked)
+        response.headers[HEADER_TRANSFER_ENCODING] = "chunked";
+    else
+        m_isKeepAlive = false;
+
+    // the content of a stream has no foreseeable end, so the connection isn't reused after a HEAD request
+    if (m_isHeadRequest)
+        m_isKeepAlive = false;
+
+    response.headers[HEADER_CONNECTION] = (m_isKeepAlive ? "keep-alive" : "close");
+
+    const QByteArray content = response.content;
+    response.content.clear();
+    sendResponse(response);
+
+    if (m_isHeadRequest)
+        finishProcessing();
+    else
+        writeStream(content);
 }
 
-bool Connection::acceptsGzipEncoding(QString codings)
+void Connection::writeStream(const QByteArray &data)
 {
-    // [rfc7231] 5.3.4. Accept-Encoding
+    if (data.isEmpty() || m_isClosing)
+        return;
 
-    const auto isCodingAvailable = [](const QStringList &list, const QString &encoding) -> bool
-    {
-        for (const QString &str : list) {
-            if (!str.startsWith(encoding))
-                continue;
+    m_idleTimer.restart();
+
+    if (!m_streamCompressor) {
+        writeChunk(data, data.size());
+        return;
+    }
+
+    bool ok = false;
+    const QByteArray compressedData = m_streamCompressor->compress(data, &ok);
+    if (!ok) {
+        // the content sent so far can't be completed
+        abortRequest();
+        return;
+    }
+
+    // zlib holds the data until it has enough of it, then it's taken by the client at once
+    if (compressedData.isEmpty())
+        notifyStreamBytesWritten(data.size());
+    else
+        writeChunk(compressedData, data.size());
+}
+
+void Connection::finishStream()
+{
+    if (m_isClosing)
+        return;
+
+    if (m_streamCompressor) {
+        bool ok = false;
+        const QByteArray compressedData = m_streamCompressor->finish(&ok);
+        m_streamCompressor.reset();
+        if (!ok) {
+            abortRequest();
+            return;
+        }
+
+        writeChunk(compressedData, 0);
+    }
+
+    if (m_isChunked)
+        write(QByteArray("0").append(CRLF).append(CRLF));
+
+    finishProcessing();
+}
 
-            // without quality values
-            if (str == encoding)
-                return true;
+void Connection::writeChunk(const QByteArray &data, const qint64 streamContentSize)
+{
+    // an empty chunk would end the content
+    if (data.isEmpty())
+        return;
+
+    if (m_isChunked) {
+        write(QByteArray::number(data.size(), 16).append(CRLF));
+        write(data, streamContentSize);
+        write(CRLF);
+    }
+    else {
+        write(data, streamContentSize);
+    }
+}
+
+void Connection::abortRequest()
+{
+    // there is no response to send, the client has to retry
+    m_streamCompressor.reset();
+    m_isClosing = true;
+    m_output.clear();
+    m_outputOffset = 0;
+    m_socket->close();
+}
 
-            // [rfc7231] 5.3.1. Quality Values
-            const QStringRef substr = str.midRef(encoding.size() + 3);  // ex. skip over "gzip;q="
+void Connection::finishProcessing()
+{
+    m_isProcessingRequest = false;
+    m_responseStream.clear();
+    m_idleTimer.restart();
 
-            bool ok = false;
-            const double qvalue = substr.toDouble(&ok);
-            if (!ok || (qvalue <= 0.0))
-                return false;
+    if (!m_isKeepAlive) {
+        closeAfterWrite();
+        return;
+    }
 
-            return true;
+    // the next response isn't queued before this one is handed over to the socket,
+    // so at most one response body is held besides the socket's buffer
+    if (!m_output.empty()) {
+        m_isWaitingForOutput = true;
+        return;
+    }
+
+    processReceivedData();
+}
+
+void Connection::rejectRequest(Response response)
+{
+    // the request couldn't be read, so there is nothing to answer it with but the status
+    m_isHeadRequest = false;
+    response.headers[HEADER_CONNECTION] = "close";
+
+    sendResponse(response);
+    closeAfterWrite();
+}
+
+void Connection::sendResponse(Response response)
+{
+    // write the content separately to avoid copying large payloads into the header buffer
+    write(toHeaderByteArray(response));
+    if (!m_isHeadRequest)
+        write(response.content);
+}
+
+void Connection::write(const QByteArray &data, const qint64 streamContentSize)
+{
+    if (data.isEmpty())
+        return;
+
+    m_output.push_back({data, streamContentSize});
+    writeOutput();
+}
+
+void Connection::writeOutput()
+{
+    m_idleTimer.restart();
+
+    // the socket's own buffer holds what it hasn't sent yet, it is only topped up when it runs low
+    while (!m_output.empty() && (m_socket->bytesToWrite() < MAX_BYTES_TO_WRITE)) {
+        const OutputBuffer &buffer = m_output.front();
+        const int size = std::min(OUTPUT_SLICE_SIZE, (buffer.data.size() - m_outputOffset));
+
+        const qint64 written = m_socket->write((buffer.data.constData() + m_outputOffset), size);
+        if (written < 0) {
+            // the socket is going to be disconnected
+            m_output.clear();
+            m_outputOffset = 0;
+            return;
         }
-        return false;
-    };
 
-    const QStringList list = codings.remove(' ').remove('\t').split(',', QString::SkipEmptyParts);
-    if (list.isEmpty())
-        return false;
+        m_outputOffset += written;
+        if (m_outputOffset < buffer.data.size())
+            continue;
+
+        if (buffer.streamContentSize > 0)
+            notifyStreamBytesWritten(buffer.streamContentSize);
+        m_output.pop_front();
+        m_outputOffset = 0;
+    }
+
+    if (!m_output.empty())
+        return;
+
+    if (m_isClosing) {
+        // the socket sends what it has buffered before disconnecting
+        m_socket->disconnectFromHost();
+        return;
+    }
+
+    if (m_isWaitingForOutput) {
+        m_isWaitingForOutput = false;
+        processReceivedData();
+    }
+}
+
+void Connection::notifyStreamBytesWritten(const qint64 bytes) const
+{
+    const QPointer<ResponseStream> stream = m_responseStream;
+    if (!stream)
+        return;
 
-    const bool canGzip = isCodingAvailable(list, QLatin1String("gzip"));
-    if (canGzip)
-        return true;
+    // the stream lives in the server thread
+    QTimer::singleShot(0, m_server, [stream, bytes]()
+    {
+        if (stream)
+            stream->reportBytesWritten(bytes);
+    });
+}
 
-    const bool canAny = isCodingAvailable(list, QLatin1String("*"));
-    if (canAny)
-        return true;
+void Connection::closeAfterWrite()
+{
+    if (m_isClosing)
+        return;
 
-    return false;
+    m_isClosing = true;
+    writeOutput();
+}
+
+bool Connection::hasExpired(const qint64 timeout) const
+{
+    // the idle timer is restarted whenever the client takes some of the output
+    return !m_isProcessingRequest && m_idleTimer.hasExpired(timeout);
+}
+
+bool Connection::isClosed() const
+{
+    return (m_socket->state() == QAbstractSocket::UnconnectedState);
 }
@@ -31,15 +31,29 @@
 #ifndef HTTP_CONNECTION_H
 #define HTTP_CONNECTION_H
 
+#include <deque>
+#include <memory>
+
 #include <QElapsedTimer>
 #include <QObject>
+#include <QPointer>
+
+#include "requestparser.h"
 
 class QTcpSocket;
 
+namespace Utils
+{
+    namespace Gzip
+    {
+        class Compressor;
+    }
+}
+
 namespace Http
 {
-    class IRequestHandler;
-    struct Response;
+    class ResponseStream;
+    class Server;
 
     class Connection : public QObject
     {
@@ -47,7 +61,8 @@ namespace Http
         Q_DISABLE_COPY(Connection)
 
     public:
-        Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent = nullptr);
+        // `parent` must live in the connection's thread, it's destroyed when the I/O threads are stopped
+        Connection(QTcpSocket *socket, Server *server, QObject *parent);
         ~Connection();
 
         bool hasExpired(qint64 timeout) const;
@@ -55,15 +70,52 @@ namespace Http
 
     private slots:
         void read();
+        void writeOutput();
 
     private:
-        static bool acceptsGzipEncoding(QString codings);
-        void sendResponse(const Response &response) const;
+        // the request handler answers through ResponseStream when it doesn't respond right away
+        friend class ResponseStream;
+
+        struct OutputBuffer
+        {
+            QByteArray data;
+            qint64 streamContentSize;  // the stream content it carries, reported to the stream once written
+        };
+
+        void processReceivedData();
+        void dispatchRequest(Request request, const Environment &env);
+        void finishRequest(Response response);
+        void startStream(Response response, const QPointer<ResponseStream> &stream);
+        void writeStream(const QByteArray &data);
+        void finishStream();
+        void writeChunk(const QByteArray &data, qint64 streamContentSize);
+        void abortRequest();
+        void finishProcessing();
+        void rejectRequest(Response response);
+        void sendResponse(Response response);
+        void write(const QByteArray &data, qint64 streamContentSize = 0);
+        void notifyStreamBytesWritten(qint64 bytes) const;
+        void closeAfterWrite();
 
         QTcpSocket *m_socket;
-        IRequestHandler *m_requestHandler;
-        QByteArray m_receivedData;
+        Server *m_server;
+        RequestParser m_requestParser;
         QElapsedTimer m_idleTimer;
+        bool m_isProcessingRequest;
+        bool m_isWaitingForOutput;
+        bool m_isClosing;
+
+        // the request being processed
+        bool m_acceptsGzip;
+        bool m_isHeadRequest;
+        bool m_isKeepAlive;
+        bool m_isChunked;
+        QPointer<ResponseStream> m_responseStream;
+        std::unique_ptr<Utils::Gzip::Compressor> m_streamCompressor;
+
+        // the data not handed over to the socket yet
+        std::deque<OutputBuffer> m_output;
+        int m_outputOffset;
     };
 }
 
@@ -0,0 +1,116 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "connectionworker.h"
+
+#include <QSslSocket>
+#include <QTimer>
+
+#include "base/algorithm.h"
+#include "connection.h"
+#include "server.h"
+
+namespace
+{
+    const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
+    const int CONNECTIONS_SCAN_INTERVAL = 2;  // seconds
+}
+
+using namespace Http;
+
+ConnectionWorker::ConnectionWorker(Server *server)
+    : m_server(server)
+    , m_dropConnectionTimer(new QTimer(this))
+{
+    m_dropConnectionTimer->setInterval(CONNECTIONS_SCAN_INTERVAL * 1000);
+    connect(m_dropConnectionTimer, &QTimer::timeout, this, &ConnectionWorker::dropTimedOutConnection);
+}
+
+int ConnectionWorker::connectionCount() const
+{
+    return m_connectionCount.load();
+}
+
+void ConnectionWorker::addConnection(const qintptr socketDescriptor, const bool https
+    , const QList<QSslCertificate> &certificates, const QSslKey &key)
+{
+    // the timer can only be started in the thread the worker was moved to
+    if (!m_dropConnectionTimer->isActive())
+        m_dropConnectionTimer->start();
+
+    QTcpSocket *serverSocket;
+    if (https)
+        serverSocket = new QSslSocket(this);
+    else
+        serverSocket = new QTcpSocket(this);
+
+    if (!serverSocket->setSocketDescriptor(socketDescriptor)) {
+        delete serverSocket;
+        m_connectionCount.deref();
+        return;
+    }
+
+    if (https) {
+        static_cast<QSslSocket *>(serverSocket)->setProtocol(QSsl::SecureProtocols);
+        static_cast<QSslSocket *>(serverSocket)->setPrivateKey(key);
+        static_cast<QSslSocket *>(serverSocket)->setLocalCertificateChain(certificates);
+        static_cast<QSslSocket *>(serverSocket)->setPeerVerifyMode(QSslSocket::VerifyNone);
+        static_cast<QSslSocket *>(serverSocket)->startServerEncryption();
+    }
+
+    auto *c = new Connection(serverSocket, m_server, this);
+    m_connections.insert(c);
+    connect(serverSocket, &QAbstractSocket::disconnected, this, [c, this]() { removeConnection(c); });
+}
+
+void ConnectionWorker::reserveConnection()
+{
+    m_connectionCount.ref();
+}
+
+void ConnectionWorker::removeConnection(Connection *connection)
+{
+    if (!m_connections.remove(connection))
+        return;
+
+    m_connectionCount.deref();
+    connection->deleteLater();
+}
+
+void ConnectionWorker::dropTimedOutConnection()
+{
+    Algorithm::removeIf(m_connections, [this](Connection *connection)
+    {
+        if (!connection->hasExpired(KEEP_ALIVE_DURATION))
+            return false;
+
+        m_connectionCount.deref();
+        connection->deleteLater();
+        return true;
+    });
+}
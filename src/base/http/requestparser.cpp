@@ -31,9 +31,10 @@
 #include "requestparser.h"
 
 #include <algorithm>
+#include <limits>
 
 #include <QDebug>
-#include <QRegularExpression>
+#include <QIODevice>
 #include <QStringList>
 #include <QUrl>
 #include <QUrlQuery>
@@ -57,7 +58,7 @@ namespace
         return in;
     }
 
-    bool parseHeaderLine(const QString &line, QStringMap &out)
+    bool parseHeaderLine(const QByteArray &line, QStringMap &out)
     {
         // [rfc7230] 3.2. Header Fields
         const int i = line.indexOf(':');
@@ -66,90 +67,181 @@ namespace
             return false;
         }
 
-        const QString name = line.leftRef(i).trimmed().toString().toLower();
-        const QString value = line.midRef(i + 1).trimmed().toString();
+        const QString name = QString::fromLatin1(midView(line, 0, i).trimmed()).toLower();
+        const QString value = QString::fromLatin1(midView(line, (i + 1)).trimmed());
         out[name] = value;
 
         return true;
     }
+
+    bool isValidMethod(const QByteArray &method)
+    {
+        return std::all_of(method.cbegin(), method.cend(), [](const char c)
+        {
+            return ((c >= 'A') && (c <= 'Z'));
+        });
+    }
+
+    bool isValidVersion(const QByteArray &version)
+    {
+        const auto isDigit = [](const char c) { return ((c >= '0') && (c <= '9')); };
+        return ((version.size() == 8) && version.startsWith("HTTP/")
+            && isDigit(version[5]) && (version[6] == '.') && isDigit(version[7]));
+    }
 }
 
 RequestParser::RequestParser()
+    : m_state(State::Header)
+    , m_frameStart(0)
+    , m_scanPos(0)
+    , m_headerLength(0)
+    , m_contentLength(0)
+{
+}
+
+void RequestParser::read(QIODevice *device)
+{
+    if (m_frameStart > 0) {
+        // the requests taken so far may still reference the old buffer, only the rest is copied
+        m_buffer = m_buffer.mid(m_frameStart);
+        m_scanPos -= m_frameStart;
+        m_frameStart = 0;
+    }
+
+    // a large body is received into a buffer allocated once
+    if (m_state == State::Body)
+        m_buffer.reserve(m_headerLength + m_contentLength);
+
+    const int oldSize = m_buffer.size();
+    const qint64 available = std::min<qint64>(device->bytesAvailable()
+        , ((std::numeric_limits<int>::max() / 2) - oldSize));
+    if (available <= 0)
+        return;
+
+    // read straight into the buffer without an intermediate copy
+    m_buffer.resize(oldSize + static_cast<int>(available));
+    const qint64 bytesRead = device->read((m_buffer.data() + oldSize), available);
+    m_buffer.resize(oldSize + static_cast<int>(std::max<qint64>(bytesRead, 0)));
+}
+
+bool RequestParser::hasBufferedData() const
 {
+    return (bufferedSize() > 0);
 }
 
-RequestParser::ParseResult RequestParser::parse(const QByteArray &data)
+int RequestParser::bufferedSize() const
 {
-    // Warning! Header names are converted to lowercase
-    return RequestParser().doParse(data);
+    return (m_buffer.size() - m_frameStart);
 }
 
-RequestParser::ParseResult RequestParser::doParse(const QByteArray &data)
+RequestParser::ParseStatus RequestParser::parse()
+{
+    if (m_state == State::Header) {
+        const ParseStatus status = parseHeader();
+        if (status != ParseStatus::OK)
+            return status;
+    }
+
+    if (m_state == State::Body) {
+        if (bufferedSize() < (m_headerLength + m_contentLength))
+            return ParseStatus::Incomplete;
+
+        if (m_contentLength > 0) {
+            const QByteArray httpBodyView = midView(m_buffer, (m_frameStart + m_headerLength), m_contentLength);
+            if (!parsePostMessage(httpBodyView)) {
+                qWarning() << Q_FUNC_INFO << "message body parsing error";
+                return ParseStatus::BadRequest;
+            }
+        }
+
+        // share the buffer with the request, so the views into it stay valid
+        m_request.frame = m_buffer;
+        m_state = State::Done;
+    }
+
+    return ParseStatus::OK;
+}
+
+Request RequestParser::takeRequest()
+{
+    Q_ASSERT(m_state == State::Done);
+
+    Request request = std::move(m_request);
+    m_request = Request();
+
+    m_frameStart += (m_headerLength + m_contentLength);
+    if (m_frameStart >= m_buffer.size()) {
+        m_buffer.clear();
+        m_frameStart = 0;
+    }
+
+    m_scanPos = m_frameStart;
+    m_headerLength = 0;
+    m_contentLength = 0;
+    m_state = State::Header;
+
+    return request;
+}
+
+RequestParser::ParseStatus RequestParser::parseHeader()
 {
     // we don't handle malformed requests which use double `LF` as delimiter
-    const int headerEnd = data.indexOf(EOH);
+    const int headerEnd = m_buffer.indexOf(EOH, m_scanPos);
     if (headerEnd < 0) {
-        qDebug() << Q_FUNC_INFO << "incomplete request";
-        return {ParseStatus::Incomplete, Request(), 0};
+        // don't scan the same data again, but the delimiter may be split between reads
+        m_scanPos = std::max(m_frameStart, (m_buffer.size() - EOH.size() + 1));
+        return ParseStatus::Incomplete;
     }
 
-    const QString httpHeaders = QString::fromLatin1(data.constData(), headerEnd);
-    if (!parseStartLines(httpHeaders)) {
+    if (!parseStartLines(midView(m_buffer, m_frameStart, (headerEnd - m_frameStart)))) {
         qWarning() << Q_FUNC_INFO << "header parsing error";
-        return {ParseStatus::BadRequest, Request(), 0};
+        return ParseStatus::BadRequest;
     }
 
-    const int headerLength = headerEnd + EOH.length();
+    m_headerLength = headerEnd - m_frameStart + EOH.length();
 
     // handle supported methods
-    if ((m_request.method == HEADER_REQUEST_METHOD_GET) || (m_request.method == HEADER_REQUEST_METHOD_HEAD))
-        return {ParseStatus::OK, m_request, headerLength};
-    if (m_request.method == HEADER_REQUEST_METHOD_POST) {
+    if ((m_request.method == HEADER_REQUEST_METHOD_GET) || (m_request.method == HEADER_REQUEST_METHOD_HEAD)) {
+        m_contentLength = 0;
+    }
+    else if (m_request.method == HEADER_REQUEST_METHOD_POST) {
         bool ok = false;
         const int contentLength = m_request.headers[HEADER_CONTENT_LENGTH].toInt(&ok);
         if (!ok || (contentLength < 0)) {
             qWarning() << Q_FUNC_INFO << "bad request: content-length invalid";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return ParseStatus::BadRequest;
         }
         if (contentLength > MAX_CONTENT_SIZE) {
             qWarning() << Q_FUNC_INFO << "bad request: message too long";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return ParseStatus::BadRequest;
         }
 
-        if (contentLength > 0) {
-            const QByteArray httpBodyView = midView(data, headerLength, contentLength);
-            if (httpBodyView.length() < contentLength) {
-                qDebug() << Q_FUNC_INFO << "incomplete request";
-                return {ParseStatus::Incomplete, Request(), 0};
-            }
-
-            if (!parsePostMessage(httpBodyView)) {
-                qWarning() << Q_FUNC_INFO << "message body parsing error";
-                return {ParseStatus::BadRequest, Request(), 0};
-            }
-        }
-
-        return {ParseStatus::OK, m_request, (headerLength + contentLength)};
+        m_contentLength = contentLength;
+    }
+    else {
+        qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
+        return ParseStatus::BadRequest;  // TODO: SHOULD respond "501 Not Implemented"
     }
 
-    qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
-    return {ParseStatus::BadRequest, Request(), 0};  // TODO: SHOULD respond "501 Not Implemented"
+    m_state = State::Body;
+    return ParseStatus::OK;
 }
 
-bool RequestParser::parseStartLines(const QString &data)
+bool RequestParser::parseStartLines(const QByteArray &data)
 {
     // we don't handle malformed request which uses `LF` for newline
-    const QVector<QStringRef> lines = data.splitRef(CRLF, QString::SkipEmptyParts);
+    const QVector<QByteArray> lines = splitToViews(data, CRLF, QString::SkipEmptyParts);
 
     // [rfc7230] 3.2.2. Field Order
-    QStringList requestLines;
-    for (const auto &line : lines) {
-        if (line.at(0).isSpace() && !requestLines.isEmpty()) {
+    QVector<QByteArray> requestLines;
+    requestLines.reserve(lines.size());
+    for (const QByteArray &line : lines) {
+        if (QChar::fromLatin1(line.at(0)).isSpace() && !requestLines.isEmpty()) {
             // continuation of previous line
-            requestLines.last() += line.toString();
+            requestLines.last() += line;
         }
         else {
-            requestLines += line.toString();
+            requestLines += line;
         }
     }
 
@@ -159,7 +251,7 @@ bool RequestParser::parseStartLines(const QString &data)
     if (!parseRequestLine(requestLines[0]))
         return false;
 
-    for (auto i = ++(requestLines.begin()); i != requestLines.end(); ++i) {
+    for (auto i = ++(requestLines.cbegin()); i != requestLines.cend(); ++i) {
         if (!parseHeaderLine(*i, m_request.headers))
             return false;
     }
@@ -167,23 +259,21 @@ bool RequestParser::parseStartLines(const QString &data)
     return true;
 }
 
-bool RequestParser::parseRequestLine(const QString &line)
+bool RequestParser::parseRequestLine(const QByteArray &line)
 {
     // [rfc7230] 3.1.1. Request Line
 
-    const QRegularExpression re(QLatin1String("^([A-Z]+)\\s+(\\S+)\\s+HTTP\\/(\\d\\.\\d)$"));
-    const QRegularExpressionMatch match = re.match(line);
-
-    if (!match.hasMatch()) {
+    const QVector<QByteArray> parts = splitToViews(line, " ", QString::SkipEmptyParts);
+    if ((parts.size() != 3) || !isValidMethod(parts[0]) || !isValidVersion(parts[2])) {
         qWarning() << Q_FUNC_INFO << "invalid http header:" << line;
         return false;
     }
 
     // Request Methods
-    m_request.method = match.captured(1);
+    m_request.method = QString::fromLatin1(parts[0]);
 
     // Request Target
-    const QByteArray url {match.captured(2).toLatin1()};
+    const QByteArray &url = parts[1];
     const int sepPos = url.indexOf('?');
     const QByteArray pathComponent = ((sepPos == -1) ? url : midView(url, 0, sepPos));
 
@@ -200,15 +290,16 @@ bool RequestParser::parseRequestLine(const QString &line)
 
             const QByteArray nameComponent = midView(param, 0, eqCharPos);
             const QByteArray valueComponent = midView(param, (eqCharPos + 1));
-            const QString paramName = QString::fromUtf8(QByteArray::fromPercentEncoding(nameComponent).replace('+', ' '));
-            const QByteArray paramValue = QByteArray::fromPercentEncoding(valueComponent).replace('+', ' ');
+            // '+' is replaced before decoding, so an encoded "%2B" survives (e.g. in binary info hashes)
+            const QString paramName = QString::fromUtf8(QByteArray::fromPercentEncoding(QByteArray(nameComponent).replace('+', ' ')));
+            const QByteArray paramValue = QByteArray::fromPercentEncoding(QByteArray(valueComponent).replace('+', ' '));
 
             m_request.query[paramName] = paramValue;
         }
     }
 
     // HTTP-version
-    m_request.version = match.captured(3);
+    m_request.version = QString::fromLatin1(midView(parts[2], 5));
 
     return true;
 }
@@ -275,39 +366,37 @@ bool RequestParser::parsePostMessage(const QByteArray &data)
 
 bool RequestParser::parseFormData(const QByteArray &data)
 {
-    const QVector<QByteArray> list = splitToViews(data, EOH, QString::KeepEmptyParts);
-
-    if (list.size() != 2) {
+    // the payload may contain `EOH` as well, only the first one ends the part headers
+    const int headerEnd = data.indexOf(EOH);
+    if (headerEnd < 0) {
         qWarning() << Q_FUNC_INFO << "multipart/form-data format error";
         return false;
     }
 
-    const QString headers = QString::fromLatin1(list[0]);
-    const QByteArray payload = viewWithoutEndingWith(list[1], CRLF);
+    const QByteArray payload = viewWithoutEndingWith(midView(data, (headerEnd + EOH.size())), CRLF);
 
     QStringMap headersMap;
-    const QVector<QStringRef> headerLines = headers.splitRef(CRLF, QString::SkipEmptyParts);
-    for (const auto &line : headerLines) {
-        if (line.trimmed().startsWith(HEADER_CONTENT_DISPOSITION, Qt::CaseInsensitive)) {
+    const QVector<QByteArray> headerLines = splitToViews(midView(data, 0, headerEnd), CRLF, QString::SkipEmptyParts);
+    for (const QByteArray &line : headerLines) {
+        if (line.trimmed().toLower().startsWith(HEADER_CONTENT_DISPOSITION)) {
             // extract out filename & name
-            const QVector<QStringRef> directives = line.split(';', QString::SkipEmptyParts);
+            const QVector<QByteArray> directives = splitToViews(line, ";", QString::SkipEmptyParts);
 
-            for (const auto &directive : directives) {
+            for (const QByteArray &directive : directives) {
                 const int idx = directive.indexOf('=');
                 if (idx < 0)
                     continue;
 
-                const QString name = directive.left(idx).trimmed().toString().toLower();
-                const QString value = Utils::String::unquote(directive.mid(idx + 1).trimmed()).toString();
+                const QString name = QString::fromLatin1(midView(directive, 0, idx).trimmed()).toLower();
+                const QString value = Utils::String::unquote(QString::fromLatin1(midView(directive, (idx + 1)).trimmed()));
                 headersMap[name] = value;
             }
         }
         else {
-            if (!parseHeaderLine(line.toString(), headersMap))
+            if (!parseHeaderLine(line, headersMap))
                 return false;
         }
     }
-
     // pick data
     const QLatin1String filename("filename");
     const QLatin1String name("name");
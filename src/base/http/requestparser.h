@@ -33,8 +33,12 @@
 
 #include "types.h"
 
+class QIODevice;
+
 namespace Http
 {
+    // Resumable request parser, it keeps its position in the receive buffer across reads.
+    // Multipart form data of the parsed request are views into the receive buffer.
     class RequestParser
     {
     public:
@@ -45,28 +49,40 @@ namespace Http
             BadRequest
         };
 
-        struct ParseResult
-        {
-            // when `status != ParseStatus::OK`, `request` & `frameSize` are undefined
-            ParseStatus status;
-            Request request;
-            long frameSize;  // http request frame size (bytes)
-        };
+        RequestParser();
 
-        static ParseResult parse(const QByteArray &data);
+        void read(QIODevice *device);
+        bool hasBufferedData() const;
+        int bufferedSize() const;  // bytes of the request currently being received
+
+        // Warning! Header names are converted to lowercase
+        ParseStatus parse();
+        // valid after `parse()` returned `ParseStatus::OK`, the next request is parsed afterwards
+        Request takeRequest();
 
         static const long MAX_CONTENT_SIZE = 64 * 1024 * 1024;  // 64 MB
 
     private:
-        RequestParser();
+        enum class State
+        {
+            Header,
+            Body,
+            Done
+        };
 
-        ParseResult doParse(const QByteArray &data);
-        bool parseStartLines(const QString &data);
-        bool parseRequestLine(const QString &line);
+        ParseStatus parseHeader();
+        bool parseStartLines(const QByteArray &data);
+        bool parseRequestLine(const QByteArray &line);
 
         bool parsePostMessage(const QByteArray &data);
         bool parseFormData(const QByteArray &data);
 
+        QByteArray m_buffer;
+        State m_state;
+        int m_frameStart;  // position of the current request in `m_buffer`
+        int m_scanPos;  // position from which the end of the header is looked for
+        int m_headerLength;
+        int m_contentLength;
         Request m_request;
     };
 }
@@ -29,24 +29,137 @@
 
 #include "responsegenerator.h"
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+
 #include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
 
 #include "base/http/types.h"
 #include "base/utils/gzip.h"
 
-QByteArray Http::toByteArray(Response response)
+namespace
 {
-    compressContent(response);
+    using Clock = std::chrono::steady_clock;
+
+    const int MIN_CACHEABLE_SIZE = 16 * 1024;  // 16 KiB
+    const int COMPRESSION_CACHE_SIZE = 16;
+    // long enough to cover the WebUI refresh interval, so identical responses to several pollers are compressed once
+    const Clock::duration COMPRESSION_CACHE_TTL = std::chrono::seconds(2);
+    // compression time allowed per second, summed over all threads
+    const Clock::duration COMPRESSION_TIME_BUDGET = std::chrono::milliseconds(250);
+
+    class CompressionCache
+    {
+    public:
+        QByteArray find(const QByteArray &content)
+        {
+            // smaller payloads are never stored
+            if (content.size() < MIN_CACHEABLE_SIZE)
+                return {};
+
+            const QMutexLocker locker(&m_mutex);
+
+            const Clock::time_point now = Clock::now();
+            while (!m_entries.empty() && ((now - m_entries.front().time) > COMPRESSION_CACHE_TTL))
+                m_entries.pop_front();
+
+            for (const Entry &entry : m_entries) {
+                if (entry.content == content)
+                    return entry.compressedContent;
+            }
+            return {};
+        }
+
+        void insert(const QByteArray &content, const QByteArray &compressedContent)
+        {
+            const QMutexLocker locker(&m_mutex);
+
+            if (m_entries.size() >= static_cast<std::size_t>(COMPRESSION_CACHE_SIZE))
+                m_entries.pop_front();
+            m_entries.push_back({content, compressedContent, Clock::now()});
+        }
+
+    private:
+        struct Entry
+        {
+            QByteArray content;
+            QByteArray compressedContent;
+            Clock::time_point time;
+        };
+
+        QMutex m_mutex;
+        std::deque<Entry> m_entries;
+    };
+
+    // Keeps track of the time spent compressing during the current second
+    class CompressionBudget
+    {
+    public:
+        bool isExceeded()
+        {
+            const qint64 now = Clock::now().time_since_epoch().count();
+            qint64 windowStart = m_windowStart.load();
+            if (((now - windowStart) >= std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)).count())
+                && m_windowStart.compare_exchange_strong(windowStart, now)) {
+                m_spentTime = 0;
+            }
 
-    response.headers[HEADER_CONTENT_LENGTH] = QString::number(response.content.length());
+            return (m_spentTime.load() >= COMPRESSION_TIME_BUDGET.count());
+        }
+
+        void spend(const Clock::duration time)
+        {
+            m_spentTime += time.count();
+        }
+
+    private:
+        std::atomic<qint64> m_windowStart {0};
+        std::atomic<qint64> m_spentTime {0};
+    };
+
+    CompressionCache compressionCache;
+    CompressionBudget compressionBudget;
+
+    std::atomic<quint64> compressedCount {0};
+    std::atomic<quint64> compressionCacheHits {0};
+    std::atomic<qint64> compressionInputBytes {0};
+    std::atomic<qint64> compressionOutputBytes {0};
+    std::atomic<qint64> compressionTime {0};  // microseconds
+
+    int compressionLevel(const int contentSize)
+    {
+        // once the time budget is used up, only the fastest level is used
+        if (compressionBudget.isExceeded())
+            return 1;
+
+        // large payloads (e.g. full torrent lists) are sent often, favor speed over ratio
+        if (contentSize <= (64 * 1024))
+            return 6;
+        if (contentSize <= (1024 * 1024))
+            return 3;
+        return 1;
+    }
+}
+
+QByteArray Http::toHeaderByteArray(Response &response)
+{
+    // the length of streamed content isn't known in advance
+    if (!response.stream && !response.headers.contains(HEADER_TRANSFER_ENCODING))
+        response.headers[HEADER_CONTENT_LENGTH] = QString::number(response.content.length());
     response.headers[HEADER_DATE] = httpDate();
 
     QByteArray buf;
     buf.reserve(10 * 1024);
 
     // Status Line
+    // [rfc7230] 2.6. Protocol Versioning
+    // the highest version the server conforms to is sent, the connection treats HTTP/1.0 clients accordingly
     buf += QString("HTTP/%1 %2 %3")
-        .arg("1.1",  // TODO: depends on request
+        .arg("1.1",
             QString::number(response.status.code),
             response.status.text)
         .toLatin1()
@@ -59,9 +172,6 @@ QByteArray Http::toByteArray(Response response)
     // the first empty line
     buf += CRLF;
 
-    // message body  // TODO: support HEAD request
-    buf += response.content;
-
     return buf;
 }
 
@@ -74,13 +184,50 @@ QString Http::httpDate()
         .append(QLatin1String(" GMT"));
 }
 
-void Http::compressContent(Response &response)
+bool Http::acceptsGzipEncoding(QString codings)
 {
-    if (response.headers.value(HEADER_CONTENT_ENCODING) != QLatin1String("gzip"))
-        return;
+    // [rfc7231] 5.3.4. Accept-Encoding
+
+    const auto isCodingAvailable = [](const QStringList &list, const QString &encoding) -> bool
+    {
+        for (const QString &str : list) {
+            if (!str.startsWith(encoding))
+                continue;
+
+            // without quality values
+            if (str == encoding)
+                return true;
+
+            // [rfc7231] 5.3.1. Quality Values
+            const QStringRef substr = str.midRef(encoding.size() + 3);  // ex. skip over "gzip;q="
+
+            bool ok = false;
+            const double qvalue = substr.toDouble(&ok);
+            if (!ok || (qvalue <= 0.0))
+                return false;
+
+            return true;
+        }
+        return false;
+    };
 
-    response.headers.remove(HEADER_CONTENT_ENCODING);
+    const QStringList list = codings.remove(' ').remove('\t').split(',', QString::SkipEmptyParts);
+    if (list.isEmpty())
+        return false;
 
+    const bool canGzip = isCodingAvailable(list, QLatin1String("gzip"));
+    if (canGzip)
+        return true;
+
+    const bool canAny = isCodingAvailable(list, QLatin1String("*"));
+    if (canAny)
+        return true;
+
+    return false;
+}
+
+void Http::compressContent(Response &response)
+{
     // for very small files, compressing them only wastes cpu cycles
     const int contentSize = response.content.size();
     if (contentSize <= 1024)  // 1 kb
@@ -91,11 +238,32 @@ void Http::compressContent(Response &response)
     if ((contentType == CONTENT_TYPE_GIF) || (contentType == CONTENT_TYPE_PNG))
         return;
 
-    // try compressing
-    bool ok = false;
-    const QByteArray compressedData = Utils::Gzip::compress(response.content, 6, &ok);
-    if (!ok)
-        return;
+    // identical responses are often sent to several clients in a row
+    QByteArray compressedData = compressionCache.find(response.content);
+    if (!compressedData.isEmpty()) {
+        ++compressionCacheHits;
+    }
+    else {
+        const Clock::time_point start = Clock::now();
+
+        bool ok = false;
+        compressedData = Utils::Gzip::compress(response.content, compressionLevel(contentSize), &ok);
+
+        const Clock::duration elapsed = Clock::now() - start;
+        compressionBudget.spend(elapsed);
+        compressionTime += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+        if (!ok)
+            return;
+
+        ++compressedCount;
+        compressionInputBytes += contentSize;
+        compressionOutputBytes += compressedData.size();
+
+        // payloads that don't compress well are cached too, so they aren't tried again
+        if (contentSize >= MIN_CACHEABLE_SIZE)
+            compressionCache.insert(response.content, compressedData);
+    }
 
     // "Content-Encoding: gzip\r\n" is 24 bytes long
     if ((compressedData.size() + 24) >= contentSize)
@@ -104,3 +272,14 @@ void Http::compressContent(Response &response)
     response.content = compressedData;
     response.headers[HEADER_CONTENT_ENCODING] = QLatin1String("gzip");
 }
+
+Http::CompressionStatistics Http::compressionStatistics()
+{
+    CompressionStatistics stats;
+    stats.compressedCount = compressedCount.load();
+    stats.cacheHits = compressionCacheHits.load();
+    stats.inputBytes = compressionInputBytes.load();
+    stats.outputBytes = compressionOutputBytes.load();
+    stats.totalTime = compressionTime.load();
+    return stats;
+}
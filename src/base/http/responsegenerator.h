@@ -31,6 +31,8 @@
 #ifndef HTTP_RESPONSEGENERATOR_H
 #define HTTP_RESPONSEGENERATOR_H
 
+#include <QtGlobal>
+
 class QByteArray;
 class QString;
 
@@ -38,9 +40,23 @@ namespace Http
 {
     struct Response;
 
-    QByteArray toByteArray(Response response);
+    struct CompressionStatistics
+    {
+        quint64 compressedCount = 0;
+        quint64 cacheHits = 0;
+        qint64 inputBytes = 0;
+        qint64 outputBytes = 0;
+        qint64 totalTime = 0;  // microseconds
+    };
+
+    // Returns the status line and the header fields, the content should be sent right after them
+    QByteArray toHeaderByteArray(Response &response);
     QString httpDate();
+    bool acceptsGzipEncoding(QString codings);
+    // Compresses the content with gzip when it pays off, the level adapts to the payload size
+    // and to the time recently spent compressing. Thread-safe.
     void compressContent(Response &response);
+    CompressionStatistics compressionStatistics();
 }
 
 #endif // HTTP_RESPONSEGENERATOR_H
@@ -0,0 +1,196 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "responsestream.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QVector>
+
+#include "connection.h"
+#include "server.h"
+#include "types.h"
+
+using namespace Http;
+
+// The calls are made in the server thread and run in the connection's thread.
+// They are drained all at once, so they run in the order they were made.
+struct ResponseStream::CallQueue
+{
+    QMutex mutex;
+    QVector<Call> calls;
+    bool isFlushScheduled = false;
+};
+
+ResponseStream::ResponseStream(QObject *parent)
+    : QObject(parent)
+    , m_callQueue(std::make_shared<CallQueue>())
+{
+}
+
+ResponseStream::~ResponseStream()
+{
+    // don't leave the connection waiting
+    if (m_isAttached && m_server)
+        finish();
+}
+
+bool ResponseStream::isFinished() const
+{
+    return m_isFinished;
+}
+
+qint64 ResponseStream::bytesToWrite() const
+{
+    return m_bytesToWrite;
+}
+
+void ResponseStream::sendResponse(const Response &response)
+{
+    if (m_isFinished || m_isHeaderSent)
+        return;
+
+    m_isFinished = true;
+    post([response](Connection *connection) { connection->finishRequest(response); });
+}
+
+void ResponseStream::sendHeader(const Response &response)
+{
+    if (m_isFinished || m_isHeaderSent)
+        return;
+
+    m_isHeaderSent = true;
+    const QPointer<ResponseStream> stream = this;
+    post([response, stream](Connection *connection) { connection->startStream(response, stream); });
+}
+
+void ResponseStream::write(const QByteArray &data)
+{
+    if (m_isFinished || !m_isHeaderSent || data.isEmpty())
+        return;
+
+    m_bytesToWrite += data.size();
+    post([data](Connection *connection) { connection->writeStream(data); });
+}
+
+void ResponseStream::finish()
+{
+    if (m_isFinished)
+        return;
+
+    m_isFinished = true;
+    if (m_isHeaderSent)
+        post([](Connection *connection) { connection->finishStream(); });
+    else
+        post([](Connection *connection) { connection->abortRequest(); });
+}
+
+void ResponseStream::attach(Server *server, QObject *context, const QPointer<Connection> &connection)
+{
+    Q_ASSERT(!m_isAttached);
+
+    m_server = server;
+    m_context = context;
+    m_connection = connection;
+    m_isAttached = true;
+    flush();
+}
+
+void ResponseStream::reportBytesWritten(const qint64 bytes)
+{
+    m_bytesToWrite = qMax<qint64>((m_bytesToWrite - bytes), 0);
+    emit bytesWritten(bytes);
+}
+
+void ResponseStream::post(const Call &call)
+{
+    {
+        const QMutexLocker locker(&m_callQueue->mutex);
+        m_callQueue->calls.append(call);
+    }
+
+    // calls made before the handler has returned wait for attach()
+    if (m_isAttached)
+        flush();
+}
+
+void ResponseStream::flush()
+{
+    if (!m_isAttached)
+        return;
+
+    // `context` is alive as long as the server is
+    if (!m_server) {
+        handleDisconnected();
+        return;
+    }
+
+    {
+        const QMutexLocker locker(&m_callQueue->mutex);
+        if (m_callQueue->isFlushScheduled || m_callQueue->calls.isEmpty())
+            return;
+        m_callQueue->isFlushScheduled = true;
+    }
+
+    const std::shared_ptr<CallQueue> callQueue = m_callQueue;
+    const QPointer<Connection> connection = m_connection;
+    const QPointer<ResponseStream> stream = this;
+    Server *server = m_server;
+    QTimer::singleShot(0, m_context, [callQueue, connection, stream, server]()
+    {
+        QVector<Call> calls;
+        {
+            const QMutexLocker locker(&callQueue->mutex);
+            calls.swap(callQueue->calls);
+            callQueue->isFlushScheduled = false;
+        }
+
+        if (!connection) {
+            QTimer::singleShot(0, server, [stream]()
+            {
+                if (stream)
+                    stream->handleDisconnected();
+            });
+            return;
+        }
+
+        for (const Call &call : calls)
+            call(connection);
+    });
+}
+
+void ResponseStream::handleDisconnected()
+{
+    if (m_isDisconnected)
+        return;
+
+    m_isDisconnected = true;
+    m_isFinished = true;
+    emit disconnected();
+}
@@ -0,0 +1,102 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#ifndef HTTP_RESPONSESTREAM_H
+#define HTTP_RESPONSESTREAM_H
+
+#include <functional>
+#include <memory>
+
+#include <QObject>
+#include <QPointer>
+
+class QByteArray;
+
+namespace Http
+{
+    class Connection;
+    class Server;
+    struct Response;
+
+    // Lets the request handler answer a request after processRequest() has returned,
+    // either with a complete response or with content sent piece by piece.
+    // The handler returns a response referring to the stream, the connection
+    // doesn't serve other requests until the stream is finished.
+    // Lives in the server thread.
+    class ResponseStream : public QObject
+    {
+        Q_OBJECT
+        Q_DISABLE_COPY(ResponseStream)
+
+    public:
+        explicit ResponseStream(QObject *parent = nullptr);
+        ~ResponseStream() override;
+
+        bool isFinished() const;
+        // The content written but not handed over to the client yet,
+        // the handler should hold back when the client doesn't keep up
+        qint64 bytesToWrite() const;
+
+        // Answers the request with a complete response and finishes the stream
+        void sendResponse(const Response &response);
+        // Sends the status line and the header fields, the content is sent in chunks with write()
+        void sendHeader(const Response &response);
+        void write(const QByteArray &data);
+        void finish();
+
+        // called by the connection when the request handler has returned
+        void attach(Server *server, QObject *context, const QPointer<Connection> &connection);
+        // called by the connection when some of the content is handed over to the client
+        void reportBytesWritten(qint64 bytes);
+
+    signals:
+        void bytesWritten(qint64 bytes);
+        // the client has gone, further calls are ignored
+        void disconnected();
+
+    private:
+        struct CallQueue;
+        using Call = std::function<void (Connection *)>;
+
+        void post(const Call &call);
+        void flush();
+        void handleDisconnected();
+
+        QPointer<Server> m_server;
+        QObject *m_context = nullptr;
+        QPointer<Connection> m_connection;
+        std::shared_ptr<CallQueue> m_callQueue;
+        qint64 m_bytesToWrite = 0;
+        bool m_isAttached = false;
+        bool m_isHeaderSent = false;
+        bool m_isFinished = false;
+        bool m_isDisconnected = false;
+    };
+}
+
+#endif // HTTP_RESPONSESTREAM_H
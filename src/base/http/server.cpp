@@ -31,23 +31,31 @@
 #include "server.h"
 
 #include <algorithm>
+#include <atomic>
 
+#include <QElapsedTimer>
 #include <QNetworkProxy>
 #include <QSslCipher>
 #include <QSslConfiguration>
-#include <QSslSocket>
 #include <QStringList>
+#include <QTcpSocket>
+#include <QThread>
 #include <QTimer>
 
-#include "base/algorithm.h"
+#include "base/global.h"
 #include "base/utils/net.h"
-#include "connection.h"
+#include "connectionworker.h"
+#include "irequesthandler.h"
+#include "types.h"
 
 namespace
 {
-    const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
     const int CONNECTIONS_LIMIT = 500;
-    const int CONNECTIONS_SCAN_INTERVAL = 2;  // seconds
+
+    std::atomic<quint64> requestCount {0};
+    std::atomic<qint64> totalQueueTime {0};  // microseconds
+    std::atomic<qint64> totalProcessingTime {0};  // microseconds
+    std::atomic<qint64> maxProcessingTime {0};  // microseconds
 
     QList<QSslCipher> safeCipherList()
     {
@@ -67,7 +75,7 @@ namespace
 
 using namespace Http;
 
-Server::Server(IRequestHandler *requestHandler, QObject *parent)
+Server::Server(IRequestHandler *requestHandler, const int ioThreadCount, QObject *parent)
     : QTcpServer(parent)
     , m_requestHandler(requestHandler)
     , m_https(false)
@@ -78,55 +86,84 @@ Server::Server(IRequestHandler *requestHandler, QObject *parent)
     sslConf.setCiphers(safeCipherList());
     QSslConfiguration::setDefaultConfiguration(sslConf);
 
-    auto *dropConnectionTimer = new QTimer(this);
-    connect(dropConnectionTimer, &QTimer::timeout, this, &Server::dropTimedOutConnection);
-    dropConnectionTimer->start(CONNECTIONS_SCAN_INTERVAL * 1000);
+    const int threadCount = std::max(1, ioThreadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        auto *thread = new QThread(this);
+        thread->setObjectName(QString::fromLatin1("HTTP I/O %1").arg(i));
+
+        auto *worker = new ConnectionWorker(this);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        m_ioThreads.append(thread);
+        m_workers.append(worker);
+        thread->start();
+    }
 }
 
-void Server::incomingConnection(const qintptr socketDescriptor)
+Server::~Server()
 {
-    if (m_connections.size() >= CONNECTIONS_LIMIT) return;
+    // connections are destroyed along with their workers when the I/O threads finish
+    for (QThread *thread : asConst(m_ioThreads))
+        thread->quit();
+    for (QThread *thread : asConst(m_ioThreads))
+        thread->wait();
+}
 
-    QTcpSocket *serverSocket;
-    if (m_https)
-        serverSocket = new QSslSocket(this);
-    else
-        serverSocket = new QTcpSocket(this);
+void Server::incomingConnection(const qintptr socketDescriptor)
+{
+    // hand the socket over to the least loaded I/O thread, it is created there
+    ConnectionWorker *worker = nullptr;
+    int workerConnectionCount = 0;
+    int connectionCount = 0;
+    for (ConnectionWorker *w : asConst(m_workers)) {
+        const int count = w->connectionCount();
+        connectionCount += count;
+        if (!worker || (count < workerConnectionCount)) {
+            worker = w;
+            workerConnectionCount = count;
+        }
+    }
 
-    if (!serverSocket->setSocketDescriptor(socketDescriptor)) {
-        delete serverSocket;
+    if (connectionCount >= CONNECTIONS_LIMIT) {
+        QTcpSocket socket;  // closes the rejected connection
+        socket.setSocketDescriptor(socketDescriptor);
         return;
     }
 
-    if (m_https) {
-        static_cast<QSslSocket *>(serverSocket)->setProtocol(QSsl::SecureProtocols);
-        static_cast<QSslSocket *>(serverSocket)->setPrivateKey(m_key);
-        static_cast<QSslSocket *>(serverSocket)->setLocalCertificateChain(m_certificates);
-        static_cast<QSslSocket *>(serverSocket)->setPeerVerifyMode(QSslSocket::VerifyNone);
-        static_cast<QSslSocket *>(serverSocket)->startServerEncryption();
-    }
+    worker->reserveConnection();
 
-    auto *c = new Connection(serverSocket, m_requestHandler, this);
-    m_connections.insert(c);
-    connect(serverSocket, &QAbstractSocket::disconnected, this, [c, this]() { removeConnection(c); });
+    const bool https = m_https;
+    const QList<QSslCertificate> certificates = m_certificates;
+    const QSslKey key = m_key;
+    QTimer::singleShot(0, worker, [worker, socketDescriptor, https, certificates, key]()
+    {
+        worker->addConnection(socketDescriptor, https, certificates, key);
+    });
 }
 
-void Server::removeConnection(Connection *connection)
+Response Server::processRequest(const Request &request, const Environment &env, const qint64 queueTime)
 {
-    m_connections.remove(connection);
-    connection->deleteLater();
-}
+    QElapsedTimer processingTimer;
+    processingTimer.start();
 
-void Server::dropTimedOutConnection()
-{
-    Algorithm::removeIf(m_connections, [](Connection *connection)
-    {
-        if (!connection->hasExpired(KEEP_ALIVE_DURATION))
-            return false;
+    Response response = m_requestHandler->processRequest(request, env);
 
-        connection->deleteLater();
-        return true;
-    });
+    const qint64 processingTime = processingTimer.nsecsElapsed() / 1000;
+
+    ++requestCount;
+    totalQueueTime += queueTime;
+    totalProcessingTime += processingTime;
+    for (qint64 maxTime = maxProcessingTime.load(); processingTime > maxTime;) {
+        if (maxProcessingTime.compare_exchange_weak(maxTime, processingTime))
+            break;
+    }
+
+    // [W3C Server Timing] durations are in milliseconds
+    response.headers[HEADER_SERVER_TIMING] = QString::fromLatin1("queue;dur=%1, app;dur=%2")
+        .arg(queueTime / 1000.0, 0, 'f', 3).arg(processingTime / 1000.0, 0, 'f', 3);
+
+    return response;
 }
 
 bool Server::setupHttps(const QByteArray &certificates, const QByteArray &privateKey)
@@ -151,3 +188,13 @@ void Server::disableHttps()
     m_certificates.clear();
     m_key.clear();
 }
+
+RequestStatistics Http::requestStatistics()
+{
+    RequestStatistics stats;
+    stats.requestCount = requestCount.load();
+    stats.totalQueueTime = totalQueueTime.load();
+    stats.totalProcessingTime = totalProcessingTime.load();
+    stats.maxProcessingTime = maxProcessingTime.load();
+    return stats;
+}
@@ -31,36 +31,55 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 
-#include <QSet>
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QTcpServer>
+#include <QVector>
+
+class QThread;
 
 namespace Http
 {
     class IRequestHandler;
-    class Connection;
+    class ConnectionWorker;
+    struct Environment;
+    struct Request;
+    struct Response;
+
+    struct RequestStatistics
+    {
+        quint64 requestCount = 0;
+        qint64 totalQueueTime = 0;  // microseconds
+        qint64 totalProcessingTime = 0;  // microseconds
+        qint64 maxProcessingTime = 0;  // microseconds
+    };
+
+    // Covers the requests processed by all the servers. Thread-safe.
+    RequestStatistics requestStatistics();
 
+    // Sockets, TLS, request parsing and response compression run in a pool of I/O threads.
+    // Requests are handed over to the server thread, which is the only one calling the request handler.
     class Server : public QTcpServer
     {
         Q_OBJECT
         Q_DISABLE_COPY(Server)
 
     public:
-        explicit Server(IRequestHandler *requestHandler, QObject *parent = nullptr);
+        Server(IRequestHandler *requestHandler, int ioThreadCount, QObject *parent = nullptr);
+        ~Server() override;
 
         bool setupHttps(const QByteArray &certificates, const QByteArray &privateKey);
         void disableHttps();
 
-    private slots:
-        void dropTimedOutConnection();
+        // must be called in the server thread
+        Response processRequest(const Request &request, const Environment &env, qint64 queueTime);
 
     private:
-        void incomingConnection(qintptr socketDescriptor);
-        void removeConnection(Connection *connection);
+        void incomingConnection(qintptr socketDescriptor) override;
 
         IRequestHandler *m_requestHandler;
-        QSet<Connection *> m_connections;  // for tracking persistent connections
+        QVector<QThread *> m_ioThreads;
+        QVector<ConnectionWorker *> m_workers;
 
         bool m_https;
         QList<QSslCertificate> m_certificates;
@@ -31,6 +31,7 @@
 #define HTTP_TYPES_H
 
 #include <QHostAddress>
+#include <QPointer>
 #include <QString>
 #include <QVector>
 
@@ -38,9 +39,13 @@
 
 namespace Http
 {
+    class ResponseStream;
+
     const char METHOD_GET[] = "GET";
     const char METHOD_POST[] = "POST";
 
+    const char HEADER_ACCEPT[] = "accept";
+    const char HEADER_ACCEPT_ENCODING[] = "accept-encoding";
     const char HEADER_CACHE_CONTROL[] = "cache-control";
     const char HEADER_CONNECTION[] = "connection";
     const char HEADER_CONTENT_DISPOSITION[] = "content-disposition";
@@ -49,11 +54,17 @@ namespace Http
     const char HEADER_CONTENT_SECURITY_POLICY[] = "content-security-policy";
     const char HEADER_CONTENT_TYPE[] = "content-type";
     const char HEADER_DATE[] = "date";
+    const char HEADER_ETAG[] = "etag";
     const char HEADER_HOST[] = "host";
+    const char HEADER_IF_NONE_MATCH[] = "if-none-match";
+    const char HEADER_LAST_EVENT_ID[] = "last-event-id";
     const char HEADER_ORIGIN[] = "origin";
     const char HEADER_REFERER[] = "referer";
     const char HEADER_REFERRER_POLICY[] = "referrer-policy";
+    const char HEADER_SERVER_TIMING[] = "server-timing";
     const char HEADER_SET_COOKIE[] = "set-cookie";
+    const char HEADER_TRANSFER_ENCODING[] = "transfer-encoding";
+    const char HEADER_VARY[] = "vary";
     const char HEADER_X_CONTENT_TYPE_OPTIONS[] = "x-content-type-options";
     const char HEADER_X_FORWARDED_HOST[] = "x-forwarded-host";
     const char HEADER_X_FRAME_OPTIONS[] = "x-frame-options";
@@ -68,6 +79,8 @@ namespace Http
     const char CONTENT_TYPE_TXT[] = "text/plain";
     const char CONTENT_TYPE_JS[] = "application/javascript";
     const char CONTENT_TYPE_JSON[] = "application/json";
+    const char CONTENT_TYPE_CBOR[] = "application/cbor";
+    const char CONTENT_TYPE_EVENT_STREAM[] = "text/event-stream";
     const char CONTENT_TYPE_GIF[] = "image/gif";
     const char CONTENT_TYPE_PNG[] = "image/png";
     const char CONTENT_TYPE_FORM_ENCODED[] = "application/x-www-form-urlencoded";
@@ -100,7 +113,9 @@ namespace Http
         QStringMap headers;
         QMap<QString, QByteArray> query;
         QStringMap posts;
-        QVector<UploadedFile> files;
+        QVector<UploadedFile> files;  // `data` are views into `frame`
+
+        QByteArray frame;  // raw request data, keeps the views above valid
     };
 
     struct ResponseStatus
@@ -116,6 +131,7 @@ namespace Http
         ResponseStatus status;
         QStringMap headers;
         QByteArray content;
+        QPointer<ResponseStream> stream;  // set when the request is answered later, see ResponseStream
 
         Response(uint code = 200, const QString &text = "OK"): status(code, text) {}
     };
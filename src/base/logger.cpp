@@ -29,6 +29,8 @@
 #include "logger.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <vector>
 
 #include <QDateTime>
 
@@ -42,6 +44,22 @@ namespace
         std::copy((src.begin() + offset), src.end(), std::back_inserter(ret));
         return ret;
     }
+
+    const Log::MsgType MSG_TYPES[] = {Log::NORMAL, Log::INFO, Log::WARNING, Log::CRITICAL};
+
+    int msgTypeIndex(const Log::MsgType type)
+    {
+        switch (type) {
+        case Log::INFO:
+            return 1;
+        case Log::WARNING:
+            return 2;
+        case Log::CRITICAL:
+            return 3;
+        default:
+            return 0;
+        }
+    }
 }
 
 Logger *Logger::m_instance = nullptr;
@@ -51,6 +69,8 @@ Logger::Logger()
     , m_peers(MAX_LOG_MESSAGES)
     , m_lock(QReadWriteLock::Recursive)
 {
+    for (auto &ids : m_msgIds)
+        ids.set_capacity(MAX_LOG_MESSAGES);
 }
 
 Logger *Logger::instance()
@@ -77,7 +97,11 @@ void Logger::addMessage(const QString &message, const Log::MsgType &type)
     QWriteLocker locker(&m_lock);
 
     const Log::Msg temp = {m_msgCounter++, QDateTime::currentMSecsSinceEpoch(), type, message.toHtmlEscaped()};
+    // the message pushed out of the buffer is the oldest one of its type
+    if (m_messages.full())
+        m_msgIds[msgTypeIndex(m_messages.front().type)].pop_front();
     m_messages.push_back(temp);
+    m_msgIds[msgTypeIndex(type)].push_back(temp.id);
 
     emit newLogMessage(temp);
 }
@@ -108,6 +132,66 @@ QVector<Log::Msg> Logger::getMessages(const int lastKnownId) const
     return loadFromBuffer(m_messages, (size - diff));
 }
 
+QVector<Log::Msg> Logger::getMessages(const Log::MsgFilter &filter, int *lastCheckedId) const
+{
+    QReadLocker locker(&m_lock);
+
+    if (lastCheckedId)
+        *lastCheckedId = std::max(filter.lastKnownId, (m_msgCounter - 1));
+
+    QVector<Log::Msg> ret;
+    if (m_messages.empty())
+        return ret;
+
+    // the messages are stored in id order without gaps
+    const int firstId = m_messages.front().id;
+    const int startId = std::max(firstId, (filter.lastKnownId + 1));
+    if (startId >= m_msgCounter)
+        return ret;
+
+    const QString text = filter.text.toHtmlEscaped();
+    const auto matches = [&filter, &text](const Log::Msg &msg) -> bool
+    {
+        return (((filter.minTimestamp <= 0) || (msg.timestamp >= filter.minTimestamp))
+                && ((filter.maxTimestamp <= 0) || (msg.timestamp <= filter.maxTimestamp))
+                && (text.isEmpty() || msg.message.contains(text, Qt::CaseInsensitive)));
+    };
+
+    int typeCount = 0;
+    for (const Log::MsgType type : MSG_TYPES) {
+        if (filter.types.testFlag(type))
+            ++typeCount;
+    }
+
+    if (typeCount == static_cast<int>(sizeof(MSG_TYPES) / sizeof(MSG_TYPES[0]))) {
+        for (auto it = (m_messages.begin() + (startId - firstId)); it != m_messages.end(); ++it) {
+            if (matches(*it))
+                ret.append(*it);
+        }
+        return ret;
+    }
+
+    // Only the messages of the selected types are looked at
+    std::vector<int> ids;
+    for (const Log::MsgType type : MSG_TYPES) {
+        if (!filter.types.testFlag(type))
+            continue;
+
+        const auto &typeIds = m_msgIds[msgTypeIndex(type)];
+        const auto begin = std::lower_bound(typeIds.begin(), typeIds.end(), startId);
+        const auto middle = static_cast<std::ptrdiff_t>(ids.size());
+        ids.insert(ids.end(), begin, typeIds.end());
+        std::inplace_merge(ids.begin(), (ids.begin() + middle), ids.end());
+    }
+
+    for (const int id : ids) {
+        const Log::Msg &msg = m_messages[id - firstId];
+        if (matches(msg))
+            ret.append(msg);
+    }
+    return ret;
+}
+
 QVector<Log::Peer> Logger::getPeers(const int lastKnownId) const
 {
     QReadLocker locker(&m_lock);
@@ -66,6 +66,18 @@ namespace Log
         bool blocked;
         QString reason;
     };
+
+    struct MsgFilter
+    {
+        MsgTypes types = MsgTypes(ALL);
+        // exclude messages with id <= lastKnownId
+        int lastKnownId = -1;
+        // milliseconds since epoch, inclusive, a non-positive value leaves the range open
+        qint64 minTimestamp = 0;
+        qint64 maxTimestamp = 0;
+        // case insensitive text the messages must contain
+        QString text;
+    };
 }
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Log::MsgTypes)
@@ -83,6 +95,8 @@ public:
     void addMessage(const QString &message, const Log::MsgType &type = Log::NORMAL);
     void addPeer(const QString &ip, bool blocked, const QString &reason = {});
     QVector<Log::Msg> getMessages(int lastKnownId = -1) const;
+    // `lastCheckedId` receives the id of the newest message looked at, matching or not
+    QVector<Log::Msg> getMessages(const Log::MsgFilter &filter, int *lastCheckedId = nullptr) const;
     QVector<Log::Peer> getPeers(int lastKnownId = -1) const;
 
 signals:
@@ -95,6 +109,8 @@ private:
 
     static Logger *m_instance;
     boost::circular_buffer_space_optimized<Log::Msg> m_messages;
+    // ids of the messages in `m_messages` for each message type
+    boost::circular_buffer_space_optimized<int> m_msgIds[4];
     boost::circular_buffer_space_optimized<Log::Peer> m_peers;
     mutable QReadWriteLock m_lock;
     int m_msgCounter = 0;
@@ -30,6 +30,7 @@
 #include <QDebug>
 #include <QFile>
 #include <QHostAddress>
+#include <QtEndian>
 #include <QVariant>
 
 #include "geoipdatabase.h"
@@ -41,6 +42,8 @@ namespace
     const quint32 MAX_METADATA_SIZE = 131072; // 128KB
     const char METADATA_BEGIN_MARK[] = "\xab\xcd\xefMaxMind.com";
     const char DATA_SECTION_SEPARATOR[16] = {0};
+    const int IPV4_CACHE_BITS = 12;
+    const int IPV4_CACHE_SIZE = 1 << IPV4_CACHE_BITS;
 
     enum class DataType
     {
@@ -73,40 +76,96 @@ struct DataFieldDescriptor
     };
 };
 
-GeoIPDatabase::GeoIPDatabase(const quint32 size)
+namespace
+{
+    // Reads the left (0) or the right (1) record of the search tree node
+    template <int RecordSize>
+    quint32 readRecord(const uchar *node, int side);
+
+    template <>
+    quint32 readRecord<24>(const uchar *node, const int side)
+    {
+        const uchar *record = node + (side * 3);
+        return ((static_cast<quint32>(record[0]) << 16) | (static_cast<quint32>(record[1]) << 8) | record[2]);
+    }
+
+    template <>
+    quint32 readRecord<28>(const uchar *node, const int side)
+    {
+        // the middle byte holds the most significant bits of both records
+        if (side == 0)
+            return ((static_cast<quint32>(node[3] & 0xF0) << 20) | (static_cast<quint32>(node[0]) << 16)
+                    | (static_cast<quint32>(node[1]) << 8) | node[2]);
+        return ((static_cast<quint32>(node[3] & 0x0F) << 24) | (static_cast<quint32>(node[4]) << 16)
+                | (static_cast<quint32>(node[5]) << 8) | node[6]);
+    }
+
+    template <>
+    quint32 readRecord<32>(const uchar *node, const int side)
+    {
+        return qFromBigEndian<quint32>(node + (side * 4));
+    }
+
+    // Walks the search tree along the first 'bitCount' bits of the address.
+    // Returns the record the walk has ended with, it is less than the node count
+    // if there are more bits to go, equal to it if the address isn't found
+    // and greater if it points to the data section.
+    template <int RecordSize>
+    quint32 walkTree(const uchar *data, const quint32 nodeCount, quint32 node, const uchar *address, const int bitCount)
+    {
+        const int nodeSize = RecordSize / 4;
+        for (int i = 0; (i < bitCount) && (node < nodeCount); ++i) {
+            const int side = (address[i >> 3] >> (7 - (i & 7))) & 1;
+            node = readRecord<RecordSize>((data + (node * nodeSize)), side);
+        }
+        return node;
+    }
+}
+
+GeoIPDatabase::GeoIPDatabase()
     : m_ipVersion(0)
     , m_recordSize(0)
     , m_nodeCount(0)
     , m_nodeSize(0)
     , m_indexSize(0)
-    , m_recordBytes(0)
-    , m_size(size)
-    , m_data(new uchar[size])
+    , m_ipv4StartNode(0)
+    , m_ipv4Cache(IPV4_CACHE_SIZE)
+    , m_size(0)
+    , m_data(nullptr)
 {
 }
 
 GeoIPDatabase *GeoIPDatabase::load(const QString &filename, QString &error)
 {
-    GeoIPDatabase *db = nullptr;
-    QFile file(filename);
-    if (file.size() > MAX_FILE_SIZE) {
+    std::unique_ptr<QFile> file {new QFile(filename)};
+    if (file->size() > MAX_FILE_SIZE) {
         error = tr("Unsupported database file size.");
         return nullptr;
     }
 
-    if (!file.open(QFile::ReadOnly)) {
-        error = file.errorString();
+    if (!file->open(QFile::ReadOnly)) {
+        error = file->errorString();
         return nullptr;
     }
 
-    db = new GeoIPDatabase(file.size());
+    auto *db = new GeoIPDatabase;
+    db->m_size = file->size();
 
-    if (file.read(reinterpret_cast<char *>(db->m_data), db->m_size) != db->m_size) {
-        error = file.errorString();
-        delete db;
-        return nullptr;
+    // the pages are read by the system on demand and shared with the file cache
+    const uchar *data = file->map(0, file->size());
+    if (data) {
+        db->m_data = data;
+        db->m_file = std::move(file);
+    }
+    else {
+        db->m_buffer = file->readAll();
+        if (static_cast<quint32>(db->m_buffer.size()) != db->m_size) {
+            error = file->errorString();
+            delete db;
+            return nullptr;
+        }
+        db->m_data = reinterpret_cast<const uchar *>(db->m_buffer.constData());
     }
-
 
     if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
         delete db;
@@ -118,15 +177,16 @@ GeoIPDatabase *GeoIPDatabase::load(const QString &filename, QString &error)
 
 GeoIPDatabase *GeoIPDatabase::load(const QByteArray &data, QString &error)
 {
-    GeoIPDatabase *db = nullptr;
     if (data.size() > MAX_FILE_SIZE) {
         error = tr("Unsupported database file size.");
         return nullptr;
     }
 
-    db = new GeoIPDatabase(data.size());
-
-    memcpy(reinterpret_cast<char *>(db->m_data), data.constData(), db->m_size);
+    // the data are shared, not copied
+    auto *db = new GeoIPDatabase;
+    db->m_buffer = data;
+    db->m_size = data.size();
+    db->m_data = reinterpret_cast<const uchar *>(db->m_buffer.constData());
 
     if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
         delete db;
@@ -136,10 +196,7 @@ GeoIPDatabase *GeoIPDatabase::load(const QByteArray &data, QString &error)
     return db;
 }
 
-GeoIPDatabase::~GeoIPDatabase()
-{
-    delete [] m_data;
-}
+GeoIPDatabase::~GeoIPDatabase() = default;
 
 QString GeoIPDatabase::type() const
 {
@@ -158,44 +215,60 @@ QDateTime GeoIPDatabase::buildEpoch() const
 
 QString GeoIPDatabase::lookup(const QHostAddress &hostAddr) const
 {
-    Q_IPV6ADDR addr = hostAddr.toIPv6Address();
-
-    const uchar *ptr = m_data;
-
-    for (int i = 0; i < 16; ++i) {
-        for (int j = 0; j < 8; ++j) {
-            const bool right = static_cast<bool>((addr[i] >> (7 - j)) & 1);
-            // Interpret the left/right record as number
-            if (right)
-                ptr += m_recordBytes;
-
-            quint32 id = 0;
-            auto *idPtr = reinterpret_cast<uchar *>(&id);
-            memcpy(&idPtr[4 - m_recordBytes], ptr, m_recordBytes);
-            fromBigEndian(idPtr, 4);
-
-            if (id == m_nodeCount) {
-                return {};
-            }
-            if (id > m_nodeCount) {
-                QString country = m_countries.value(id);
-                if (country.isEmpty()) {
-                    const quint32 offset = id - m_nodeCount - sizeof(DATA_SECTION_SEPARATOR);
-                    quint32 tmp = offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
-                    const QVariant val = readDataField(tmp);
-                    if (val.userType() == QMetaType::QVariantHash) {
-                        country = val.toHash()["country"].toHash()["iso_code"].toString();
-                        m_countries[id] = country;
-                    }
-                }
-                return country;
-            }
-
-            ptr = m_data + (id * m_nodeSize);
-        }
+    bool isIPv4 = false;
+    const quint32 ipv4 = hostAddr.toIPv4Address(&isIPv4);
+    if (!isIPv4) {
+        const Q_IPV6ADDR addr = hostAddr.toIPv6Address();
+        return countryOf(findRecord(addr.c, 128, 0));
     }
 
-    return {};
+    // The entries are replaced without locking, a reader sees either the old or the new one.
+    // The address is a part of the entry, so it never gets the record of another address.
+    std::atomic<quint64> &entry = m_ipv4Cache[(ipv4 * 2654435769U) >> (32 - IPV4_CACHE_BITS)];
+    const quint64 cached = entry.load(std::memory_order_relaxed);
+    if ((cached != 0) && (static_cast<quint32>(cached >> 32) == ipv4))
+        return countryOf(static_cast<quint32>(cached));
+
+    uchar addr[4];
+    qToBigEndian(ipv4, addr);
+    const quint32 record = findRecord(addr, 32, m_ipv4StartNode);
+    entry.store(((static_cast<quint64>(ipv4) << 32) | record), std::memory_order_relaxed);
+    return countryOf(record);
+}
+
+quint32 GeoIPDatabase::findRecord(const uchar *address, const int bitCount, const quint32 startNode) const
+{
+    switch (m_recordSize) {
+    case 24:
+        return walkTree<24>(m_data, m_nodeCount, startNode, address, bitCount);
+    case 28:
+        return walkTree<28>(m_data, m_nodeCount, startNode, address, bitCount);
+    default:
+        return walkTree<32>(m_data, m_nodeCount, startNode, address, bitCount);
+    }
+}
+
+QString GeoIPDatabase::countryOf(const quint32 record) const
+{
+    if (record <= m_nodeCount)
+        return {};
+
+    {
+        const QReadLocker locker(&m_countriesLock);
+        const auto iter = m_countries.constFind(record);
+        if (iter != m_countries.cend())
+            return iter.value();
+    }
+
+    QString country;
+    quint32 offset = record - m_nodeCount + m_indexSize;
+    const QVariant val = readDataField(offset);
+    if (val.userType() == QMetaType::QVariantHash)
+        country = val.toHash()["country"].toHash()["iso_code"].toString();
+
+    const QWriteLocker locker(&m_countriesLock);
+    m_countries.insert(record, country);
+    return country;
 }
 
 #define CHECK_METADATA_REQ(key, type) \
@@ -241,12 +314,11 @@ bool GeoIPDatabase::parseMetadata(const QVariantHash &metadata, QString &error)
 
     CHECK_METADATA_REQ(record_size, UShort);
     m_recordSize = metadata.value("record_size").value<quint16>();
-    if (m_recordSize != 24) {
+    if ((m_recordSize != 24) && (m_recordSize != 28) && (m_recordSize != 32)) {
         error = tr("Unsupported record size: %1").arg(m_recordSize);
         return false;
     }
     m_nodeSize = m_recordSize / 4;
-    m_recordBytes = m_nodeSize / 2;
 
     CHECK_METADATA_REQ(node_count, UInt);
     m_nodeCount = metadata.value("node_count").value<quint32>();
@@ -268,7 +340,7 @@ bool GeoIPDatabase::parseMetadata(const QVariantHash &metadata, QString &error)
     return true;
 }
 
-bool GeoIPDatabase::loadDB(QString &error) const
+bool GeoIPDatabase::loadDB(QString &error)
 {
     qDebug() << "Parsing MaxMindDB index tree...";
 
@@ -280,6 +352,10 @@ bool GeoIPDatabase::loadDB(QString &error) const
         return false;
     }
 
+    // IPv4 addresses are stored as ::a.b.c.d, their subtree is found once for all lookups
+    const uchar ipv4Prefix[12] = {0};
+    m_ipv4StartNode = findRecord(ipv4Prefix, 96, 0);
+
     return true;
 }
 
@@ -29,11 +29,18 @@
 #ifndef GEOIPDATABASE_H
 #define GEOIPDATABASE_H
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
 #include <QCoreApplication>
+#include <QHash>
+#include <QReadWriteLock>
 #include <QtGlobal>
 
-class QByteArray;
 class QDateTime;
+class QFile;
 class QHostAddress;
 class QString;
 
@@ -52,13 +59,16 @@ public:
     QString type() const;
     quint16 ipVersion() const;
     QDateTime buildEpoch() const;
+    // It is safe to call from several threads
     QString lookup(const QHostAddress &hostAddr) const;
 
 private:
-    explicit GeoIPDatabase(quint32 size);
+    GeoIPDatabase();
 
     bool parseMetadata(const QVariantHash &metadata, QString &error);
-    bool loadDB(QString &error) const;
+    bool loadDB(QString &error);
+    quint32 findRecord(const uchar *address, int bitCount, quint32 startNode) const;
+    QString countryOf(quint32 record) const;
     QVariantHash readMetadata() const;
 
     QVariant readDataField(quint32 &offset) const;
@@ -91,12 +101,19 @@ private:
     quint32 m_nodeCount;
     int m_nodeSize;
     int m_indexSize;
-    int m_recordBytes;
     QDateTime m_buildEpoch;
     // Search data
+    // the node the IPv4 addresses (::a.b.c.d) start from
+    quint32 m_ipv4StartNode;
+    mutable QReadWriteLock m_countriesLock;
     mutable QHash<quint32, QString> m_countries;
+    // recently found IPv4 addresses, each entry is the address and its record packed together
+    mutable std::vector<std::atomic<quint64>> m_ipv4Cache;
+    // the file is mapped into memory when possible, otherwise its data are kept in the buffer
+    std::unique_ptr<QFile> m_file;
+    QByteArray m_buffer;
     quint32 m_size;
-    uchar *m_data;
+    const uchar *m_data;
 };
 
 #endif // GEOIPDATABASE_H
@@ -576,6 +576,16 @@ void Preferences::setUPnPForWebUIPort(const bool enabled)
     setValue("Preferences/WebUI/UseUPnP", enabled);
 }
 
+int Preferences::getWebUiServerThreads() const
+{
+    return qBound(1, value("Preferences/WebUI/ServerThreads", 2).toInt(), 16);
+}
+
+void Preferences::setWebUiServerThreads(const int threads)
+{
+    setValue("Preferences/WebUI/ServerThreads", threads);
+}
+
 QString Preferences::getWebUiUsername() const
 {
     return value("Preferences/WebUI/Username", "admin").toString();
@@ -178,6 +178,8 @@ public:
     void setWebUiPort(quint16 port);
     bool useUPnPForWebUIPort() const;
     void setUPnPForWebUIPort(bool enabled);
+    int getWebUiServerThreads() const;
+    void setWebUiServerThreads(int threads);
 
     // Authentication
     bool isWebUiLocalAuthEnabled() const;
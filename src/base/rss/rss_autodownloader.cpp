@@ -201,6 +201,7 @@ bool AutoDownloader::renameRule(const QString &ruleName, const QString &newRuleN
     if (hasRule(newRuleName)) return false;
 
     m_rules.insert(newRuleName, m_rules.take(ruleName));
+    m_rulesIndexDirty = true;
     m_dirty = true;
     store();
     emit ruleRenamed(newRuleName, ruleName);
@@ -212,6 +213,7 @@ void AutoDownloader::removeRule(const QString &ruleName)
     if (m_rules.contains(ruleName)) {
         emit ruleAboutToBeRemoved(ruleName);
         m_rules.remove(ruleName);
+        m_rulesIndexDirty = true;
         m_dirty = true;
         store();
     }
@@ -356,6 +358,7 @@ void AutoDownloader::handleNewArticle(const Article *article)
 void AutoDownloader::setRule_impl(const AutoDownloadRule &rule)
 {
     m_rules.insert(rule.name(), rule);
+    m_rulesIndexDirty = true;
 }
 
 void AutoDownloader::addJobForArticle(const Article *article)
@@ -371,11 +374,32 @@ void AutoDownloader::addJobForArticle(const Article *article)
         m_processingTimer->start();
 }
 
+void AutoDownloader::updateRulesIndex()
+{
+    m_enabledRulesByFeedURL.clear();
+    for (auto it = m_rules.cbegin(); it != m_rules.cend(); ++it) {
+        if (!it->isEnabled()) continue;
+
+        const QStringList feedURLs = it->feedURLs();
+        for (const QString &feedURL : feedURLs) {
+            QStringList &ruleNames = m_enabledRulesByFeedURL[feedURL];
+            if (ruleNames.isEmpty() || (ruleNames.last() != it.key()))
+                ruleNames.append(it.key());
+        }
+    }
+
+    m_rulesIndexDirty = false;
+}
+
 void AutoDownloader::processJob(const QSharedPointer<ProcessingJob> &job)
 {
-    for (AutoDownloadRule &rule : m_rules) {
-        if (!rule.isEnabled()) continue;
-        if (!rule.feedURLs().contains(job->feedURL)) continue;
+    // Only the enabled rules for the article feed are tried
+    if (m_rulesIndexDirty)
+        updateRulesIndex();
+
+    const QStringList ruleNames = m_enabledRulesByFeedURL.value(job->feedURL);
+    for (const QString &ruleName : ruleNames) {
+        AutoDownloadRule &rule = m_rules[ruleName];
         if (!rule.accepts(job->articleData)) continue;
 
         m_dirty = true;
@@ -120,6 +120,7 @@ namespace RSS
         void startProcessing();
         void addJobForArticle(const Article *article);
         void processJob(const QSharedPointer<ProcessingJob> &job);
+        void updateRulesIndex();
         void load();
         void loadRules(const QByteArray &data);
         void loadRulesLegacy();
@@ -137,6 +138,9 @@ namespace RSS
         QThread *m_ioThread;
         AsyncFileStorage *m_fileStorage;
         QHash<QString, AutoDownloadRule> m_rules;
+        // names of the enabled rules by the URLs of the feeds they apply to
+        QHash<QString, QStringList> m_enabledRulesByFeedURL;
+        bool m_rulesIndexDirty = true;
         QList<QSharedPointer<ProcessingJob>> m_processingQueue;
         QHash<QString, QSharedPointer<ProcessingJob>> m_waitingJobs;
         bool m_dirty = false;
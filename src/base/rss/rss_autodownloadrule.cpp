@@ -37,6 +37,7 @@
 #include <QJsonObject>
 #include <QRegularExpression>
 #include <QSharedData>
+#include <QVector>
 #include <QString>
 #include <QStringList>
 
@@ -88,6 +89,69 @@ namespace
         default: return 0; // default
         }
     }
+
+    // A must contain/must not contain expression prepared for matching
+    struct CompiledExpression
+    {
+        // the title has to match all of them
+        QVector<QRegularExpression> regexes;
+        // the title has to contain all of them, they are case folded like the title they are looked for in
+        QStringList literals;
+    };
+
+    bool isLiteralWildcard(const QString &wildcard)
+    {
+        return std::none_of(wildcard.cbegin(), wildcard.cend(), [](const QChar c)
+        {
+            return ((c == '*') || (c == '?') || (c == '[') || (c == ']') || (c == '\\'));
+        });
+    }
+
+    CompiledExpression compileExpression(const QString &expression, const bool useRegex)
+    {
+        CompiledExpression compiled;
+        // An empty expression always matches, like a regex of the form "expr|" does
+        if (expression.isEmpty())
+            return compiled;
+
+        if (useRegex) {
+            compiled.regexes.append(QRegularExpression {expression, QRegularExpression::CaseInsensitiveOption});
+            compiled.regexes.last().optimize();
+            return compiled;
+        }
+
+        // Only match if every wildcard token (separated by spaces) is present in the article name.
+        // Order of wildcard tokens is unimportant (if order is important, they should have used *).
+        // The tokens without wildcard characters are plain substrings and need no regex.
+        static const QRegularExpression whitespace {"\\s+"};
+        const QStringList wildcards {expression.split(whitespace, QString::SkipEmptyParts)};
+        for (const QString &wildcard : wildcards) {
+            if (isLiteralWildcard(wildcard)) {
+                compiled.literals.append(wildcard.toCaseFolded());
+            }
+            else {
+                compiled.regexes.append(QRegularExpression {Utils::String::wildcardToRegex(wildcard), QRegularExpression::CaseInsensitiveOption});
+                compiled.regexes.last().optimize();
+            }
+        }
+
+        return compiled;
+    }
+
+    bool matchesExpression(const CompiledExpression &expression, const QString &articleTitle, const QString &foldedTitle)
+    {
+        for (const QString &literal : expression.literals) {
+            if (!foldedTitle.contains(literal))
+                return false;
+        }
+
+        for (const QRegularExpression &regex : expression.regexes) {
+            if (!regex.match(articleTitle).hasMatch())
+                return false;
+        }
+
+        return true;
+    }
 }
 
 const QString Str_Name(QStringLiteral("name"));
@@ -129,6 +193,17 @@ namespace RSS
 
         mutable QStringList lastComputedEpisodes;
         mutable QHash<QString, QRegularExpression> cachedRegexes;
+        mutable bool expressionsCompiled = false;
+        mutable QVector<CompiledExpression> compiledMustContain;
+        mutable QVector<CompiledExpression> compiledMustNotContain;
+
+        void clearCache()
+        {
+            cachedRegexes.clear();
+            expressionsCompiled = false;
+            compiledMustContain.clear();
+            compiledMustNotContain.clear();
+        }
 
         bool operator==(const AutoDownloadRuleData &other) const
         {
@@ -205,57 +280,48 @@ QRegularExpression AutoDownloadRule::cachedRegex(const QString &expression, cons
     return regex;
 }
 
-bool AutoDownloadRule::matchesExpression(const QString &articleTitle, const QString &expression) const
+void AutoDownloadRule::compileExpressions() const
 {
-    const QRegularExpression whitespace {"\\s+"};
+    // The expressions are compiled once and reused for every article until the rule changes
+    if (m_dataPtr->expressionsCompiled)
+        return;
 
-    if (expression.isEmpty()) {
-        // A regex of the form "expr|" will always match, so do the same for wildcards
-        return true;
-    }
-
-    if (m_dataPtr->useRegex) {
-        const QRegularExpression reg(cachedRegex(expression));
-        return reg.match(articleTitle).hasMatch();
-    }
+    m_dataPtr->compiledMustContain.clear();
+    for (const QString &expression : asConst(m_dataPtr->mustContain))
+        m_dataPtr->compiledMustContain.append(compileExpression(expression, m_dataPtr->useRegex));
 
-    // Only match if every wildcard token (separated by spaces) is present in the article name.
-    // Order of wildcard tokens is unimportant (if order is important, they should have used *).
-    const QStringList wildcards {expression.split(whitespace, QString::SplitBehavior::SkipEmptyParts)};
-    for (const QString &wildcard : wildcards) {
-        const QRegularExpression reg {cachedRegex(wildcard, false)};
-        if (!reg.match(articleTitle).hasMatch())
-            return false;
-    }
+    m_dataPtr->compiledMustNotContain.clear();
+    for (const QString &expression : asConst(m_dataPtr->mustNotContain))
+        m_dataPtr->compiledMustNotContain.append(compileExpression(expression, m_dataPtr->useRegex));
 
-    return true;
+    m_dataPtr->expressionsCompiled = true;
 }
 
-bool AutoDownloadRule::matchesMustContainExpression(const QString &articleTitle) const
+bool AutoDownloadRule::matchesMustContainExpression(const QString &articleTitle, const QString &foldedTitle) const
 {
     if (m_dataPtr->mustContain.empty())
         return true;
 
     // Each expression is either a regex, or a set of wildcards separated by whitespace.
     // Accept if any complete expression matches.
-    return std::any_of(m_dataPtr->mustContain.cbegin(), m_dataPtr->mustContain.cend(), [this, &articleTitle](const QString &expression)
+    const QVector<CompiledExpression> &expressions = m_dataPtr->compiledMustContain;
+    return std::any_of(expressions.cbegin(), expressions.cend(), [&articleTitle, &foldedTitle](const CompiledExpression &expression)
     {
-        // A regex of the form "expr|" will always match, so do the same for wildcards
-        return matchesExpression(articleTitle, expression);
+        return matchesExpression(expression, articleTitle, foldedTitle);
     });
 }
 
-bool AutoDownloadRule::matchesMustNotContainExpression(const QString &articleTitle) const
+bool AutoDownloadRule::matchesMustNotContainExpression(const QString &articleTitle, const QString &foldedTitle) const
 {
     if (m_dataPtr->mustNotContain.empty())
         return true;
 
     // Each expression is either a regex, or a set of wildcards separated by whitespace.
     // Reject if any complete expression matches.
-    return std::none_of(m_dataPtr->mustNotContain.cbegin(), m_dataPtr->mustNotContain.cend(), [this, &articleTitle](const QString &expression)
+    const QVector<CompiledExpression> &expressions = m_dataPtr->compiledMustNotContain;
+    return std::none_of(expressions.cbegin(), expressions.cend(), [&articleTitle, &foldedTitle](const CompiledExpression &expression)
     {
-        // A regex of the form "expr|" will always match, so do the same for wildcards
-        return matchesExpression(articleTitle, expression);
+        return matchesExpression(expression, articleTitle, foldedTitle);
     });
 }
 
@@ -380,10 +446,13 @@ bool AutoDownloadRule::matches(const QVariantHash &articleData) const
             return false;
     }
 
+    compileExpressions();
+
     const QString articleTitle {articleData[Article::KeyTitle].toString()};
-    if (!matchesMustContainExpression(articleTitle))
+    const QString foldedTitle {articleTitle.toCaseFolded()};
+    if (!matchesMustContainExpression(articleTitle, foldedTitle))
         return false;
-    if (!matchesMustNotContainExpression(articleTitle))
+    if (!matchesMustNotContainExpression(articleTitle, foldedTitle))
         return false;
     if (!matchesEpisodeFilterExpression(articleTitle))
         return false;
@@ -518,7 +587,7 @@ AutoDownloadRule AutoDownloadRule::fromLegacyDict(const QVariantHash &dict)
 
 void AutoDownloadRule::setMustContain(const QString &tokens)
 {
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->clearCache();
 
     if (m_dataPtr->useRegex)
         m_dataPtr->mustContain = QStringList() << tokens;
@@ -532,7 +601,7 @@ void AutoDownloadRule::setMustContain(const QString &tokens)
 
 void AutoDownloadRule::setMustNotContain(const QString &tokens)
 {
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->clearCache();
 
     if (m_dataPtr->useRegex)
         m_dataPtr->mustNotContain = QStringList() << tokens;
@@ -652,7 +721,7 @@ bool AutoDownloadRule::useRegex() const
 void AutoDownloadRule::setUseRegex(const bool enabled)
 {
     m_dataPtr->useRegex = enabled;
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->clearCache();
 }
 
 QStringList AutoDownloadRule::previouslyMatchedEpisodes() const
@@ -673,5 +742,5 @@ QString AutoDownloadRule::episodeFilter() const
 void AutoDownloadRule::setEpisodeFilter(const QString &e)
 {
     m_dataPtr->episodeFilter = e;
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->clearCache();
 }
@@ -36,6 +36,7 @@
 #include "../utils/foreignapps.h"
 #include "../utils/fs.h"
 #include "searchpluginmanager.h"
+#include "searchresultindex.h"
 
 namespace
 {
@@ -60,6 +61,7 @@ SearchHandler::SearchHandler(const QString &pattern, const QString &category, co
     , m_manager {manager}
     , m_searchProcess {new QProcess {this}}
     , m_searchTimeout {new QTimer {this}}
+    , m_resultIndex {new SearchResultIndex}
 {
     // Load environment variables (proxy)
     m_searchProcess->setEnvironment(QProcess::systemEnvironment());
@@ -87,6 +89,8 @@ SearchHandler::SearchHandler(const QString &pattern, const QString &category, co
     QTimer::singleShot(0, this, [this]() { m_searchProcess->start(QIODevice::ReadOnly); });
 }
 
+SearchHandler::~SearchHandler() = default;
+
 bool SearchHandler::isActive() const
 {
     return (m_searchProcess->state() != QProcess::NotRunning);
@@ -141,7 +145,7 @@ void SearchHandler::readSearchOutput()
     }
 
     if (!searchResultList.isEmpty()) {
-        m_results.append(searchResultList);
+        m_resultIndex->append(searchResultList);
         emit newSearchResults(searchResultList);
     }
 }
@@ -186,7 +190,12 @@ SearchPluginManager *SearchHandler::manager() const
 
 QList<SearchResult> SearchHandler::results() const
 {
-    return m_results;
+    return m_resultIndex->results();
+}
+
+const SearchResultIndex &SearchHandler::resultIndex() const
+{
+    return *m_resultIndex;
 }
 
 QString SearchHandler::pattern() const
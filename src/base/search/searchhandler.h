@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include <QByteArray>
 #include <QList>
 #include <QObject>
@@ -49,6 +51,7 @@ struct SearchResult
 };
 
 class SearchPluginManager;
+class SearchResultIndex;
 
 class SearchHandler : public QObject
 {
@@ -61,10 +64,13 @@ class SearchHandler : public QObject
                   , const QStringList &usedPlugins, SearchPluginManager *manager);
 
 public:
+    ~SearchHandler() override;
+
     bool isActive() const;
     QString pattern() const;
     SearchPluginManager *manager() const;
     QList<SearchResult> results() const;
+    const SearchResultIndex &resultIndex() const;
 
     void cancelSearch();
 
@@ -87,5 +93,5 @@ private:
     QTimer *m_searchTimeout;
     QByteArray m_searchResultLineTruncated;
     bool m_searchCancelled = false;
-    QList<SearchResult> m_results;
+    std::unique_ptr<SearchResultIndex> m_resultIndex;
 };
@@ -0,0 +1,155 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "searchresultfilter.h"
+
+#include <algorithm>
+
+#include "searchhandler.h"
+
+namespace
+{
+    bool isInRange(const qint64 value, const qint64 min, const qint64 max)
+    {
+        return !(((min > 0) && (value < min)) || ((max > 0) && (value > max)));
+    }
+}
+
+void SearchResultFilter::setNamePattern(const QString &pattern)
+{
+    m_namePattern = pattern;
+
+    const QString foldedPattern = pattern.toCaseFolded();
+    if ((foldedPattern.length() > 2)
+        && foldedPattern.startsWith(QLatin1Char('"')) && foldedPattern.endsWith(QLatin1Char('"'))) {
+        m_foldedWords = QStringList(foldedPattern.mid(1, (foldedPattern.length() - 2)));
+    }
+    else {
+        m_foldedWords = foldedPattern.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    }
+}
+
+QString SearchResultFilter::namePattern() const
+{
+    return m_namePattern;
+}
+
+void SearchResultFilter::setSizeRange(const qint64 minSize, const qint64 maxSize)
+{
+    m_minSize = std::max<qint64>(0, minSize);
+    m_maxSize = std::max<qint64>(-1, maxSize);
+}
+
+void SearchResultFilter::setSeedsRange(const qint64 minSeeds, const qint64 maxSeeds)
+{
+    m_minSeeds = std::max<qint64>(0, minSeeds);
+    m_maxSeeds = std::max<qint64>(-1, maxSeeds);
+}
+
+void SearchResultFilter::setLeechesRange(const qint64 minLeeches, const qint64 maxLeeches)
+{
+    m_minLeeches = std::max<qint64>(0, minLeeches);
+    m_maxLeeches = std::max<qint64>(-1, maxLeeches);
+}
+
+qint64 SearchResultFilter::minSize() const
+{
+    return m_minSize;
+}
+
+qint64 SearchResultFilter::maxSize() const
+{
+    return m_maxSize;
+}
+
+qint64 SearchResultFilter::minSeeds() const
+{
+    return m_minSeeds;
+}
+
+qint64 SearchResultFilter::maxSeeds() const
+{
+    return m_maxSeeds;
+}
+
+qint64 SearchResultFilter::minLeeches() const
+{
+    return m_minLeeches;
+}
+
+qint64 SearchResultFilter::maxLeeches() const
+{
+    return m_maxLeeches;
+}
+
+bool SearchResultFilter::isEmpty() const
+{
+    return (m_foldedWords.isEmpty()
+            && (m_minSize <= 0) && (m_maxSize <= 0)
+            && (m_minSeeds <= 0) && (m_maxSeeds <= 0)
+            && (m_minLeeches <= 0) && (m_maxLeeches <= 0));
+}
+
+bool SearchResultFilter::matchesName(const QString &name) const
+{
+    if (m_foldedWords.isEmpty())
+        return true;
+
+    return matchesFoldedName(name.toCaseFolded());
+}
+
+bool SearchResultFilter::matchesFoldedName(const QString &foldedName) const
+{
+    return std::all_of(m_foldedWords.cbegin(), m_foldedWords.cend(), [&foldedName](const QString &word)
+    {
+        return foldedName.contains(word);
+    });
+}
+
+bool SearchResultFilter::matchesSize(const qint64 size) const
+{
+    return isInRange(size, m_minSize, m_maxSize);
+}
+
+bool SearchResultFilter::matchesSeeds(const qint64 seeds) const
+{
+    return isInRange(seeds, m_minSeeds, m_maxSeeds);
+}
+
+bool SearchResultFilter::matchesLeeches(const qint64 leeches) const
+{
+    return isInRange(leeches, m_minLeeches, m_maxLeeches);
+}
+
+bool SearchResultFilter::match(const SearchResult &result) const
+{
+    return (matchesSize(result.fileSize)
+            && matchesSeeds(result.nbSeeders)
+            && matchesLeeches(result.nbLeechers)
+            && matchesName(result.fileName));
+}
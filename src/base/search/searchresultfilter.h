@@ -0,0 +1,76 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+struct SearchResult;
+
+// Criteria the search results are filtered by.
+// It is shared by the GUI and the WebUI, so they show the same results.
+class SearchResultFilter
+{
+public:
+    // The words of the pattern are matched separately, the quoted pattern is matched as a whole
+    void setNamePattern(const QString &pattern);
+    QString namePattern() const;
+
+    // The ranges are inclusive, non-positive maximum disables the upper bound
+    void setSizeRange(qint64 minSize, qint64 maxSize);
+    void setSeedsRange(qint64 minSeeds, qint64 maxSeeds);
+    void setLeechesRange(qint64 minLeeches, qint64 maxLeeches);
+
+    qint64 minSize() const;
+    qint64 maxSize() const;
+    qint64 minSeeds() const;
+    qint64 maxSeeds() const;
+    qint64 minLeeches() const;
+    qint64 maxLeeches() const;
+
+    bool isEmpty() const;
+
+    bool matchesName(const QString &name) const;
+    // the name has to be case folded already, it saves the conversion when the names are indexed
+    bool matchesFoldedName(const QString &foldedName) const;
+    bool matchesSize(qint64 size) const;
+    bool matchesSeeds(qint64 seeds) const;
+    bool matchesLeeches(qint64 leeches) const;
+    bool match(const SearchResult &result) const;
+
+private:
+    QString m_namePattern;
+    QStringList m_foldedWords;
+    qint64 m_minSize = 0;
+    qint64 m_maxSize = -1;
+    qint64 m_minSeeds = 0;
+    qint64 m_maxSeeds = -1;
+    qint64 m_minLeeches = 0;
+    qint64 m_maxLeeches = -1;
+};
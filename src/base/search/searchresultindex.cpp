@@ -0,0 +1,188 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "searchresultindex.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "../utils/string.h"
+#include "searchresultfilter.h"
+
+namespace
+{
+    const int MAX_SORTED_ROWS = 4;
+
+    template <typename T>
+    int compare(const T &left, const T &right)
+    {
+        return (left < right) ? -1 : ((right < left) ? 1 : 0);
+    }
+}
+
+bool operator==(const SearchResultSortKey &left, const SearchResultSortKey &right)
+{
+    return ((left.field == right.field) && (left.descending == right.descending));
+}
+
+void SearchResultIndex::append(const QList<SearchResult> &results)
+{
+    m_results.append(results);
+
+    m_foldedNames.reserve(m_results.size());
+    for (const SearchResult &result : results)
+        m_foldedNames.append(result.fileName.toCaseFolded());
+}
+
+const QList<SearchResult> &SearchResultIndex::results() const
+{
+    return m_results;
+}
+
+int SearchResultIndex::size() const
+{
+    return m_results.size();
+}
+
+QVector<int> SearchResultIndex::find(const SearchResultFilter &filter, const QVector<SearchResultSortKey> &sortKeys
+                                     , const int afterRow, const int limit) const
+{
+    const QVector<int> &rows = sortedRows(sortKeys);
+
+    auto begin = rows.cbegin();
+    if ((afterRow >= 0) && (afterRow < m_results.size())) {
+        begin = std::upper_bound(rows.cbegin(), rows.cend(), afterRow, [this, &sortKeys](const int left, const int right)
+        {
+            return lessThan(left, right, sortKeys);
+        });
+    }
+
+    QVector<int> foundRows;
+    if (filter.isEmpty()) {
+        const auto end = ((limit > 0) && (limit < (rows.cend() - begin))) ? (begin + limit) : rows.cend();
+        foundRows.reserve(end - begin);
+        std::copy(begin, end, std::back_inserter(foundRows));
+        return foundRows;
+    }
+
+    for (auto it = begin; (it != rows.cend()) && ((limit <= 0) || (foundRows.size() < limit)); ++it) {
+        if (matches(*it, filter))
+            foundRows.append(*it);
+    }
+    return foundRows;
+}
+
+int SearchResultIndex::count(const SearchResultFilter &filter) const
+{
+    if (filter.isEmpty())
+        return m_results.size();
+
+    int matchCount = 0;
+    for (int row = 0; row < m_results.size(); ++row) {
+        if (matches(row, filter))
+            ++matchCount;
+    }
+    return matchCount;
+}
+
+bool SearchResultIndex::matches(const int row, const SearchResultFilter &filter) const
+{
+    const SearchResult &result = m_results[row];
+    return (filter.matchesSize(result.fileSize)
+            && filter.matchesSeeds(result.nbSeeders)
+            && filter.matchesLeeches(result.nbLeechers)
+            && filter.matchesFoldedName(m_foldedNames[row]));
+}
+
+bool SearchResultIndex::lessThan(const int left, const int right, const QVector<SearchResultSortKey> &sortKeys) const
+{
+    const SearchResult &leftResult = m_results[left];
+    const SearchResult &rightResult = m_results[right];
+
+    for (const SearchResultSortKey &key : sortKeys) {
+        int result = 0;
+        switch (key.field) {
+        case SearchResultField::FileName:
+            result = Utils::String::naturalCompare(leftResult.fileName, rightResult.fileName, Qt::CaseInsensitive);
+            break;
+        case SearchResultField::FileSize:
+            result = compare(leftResult.fileSize, rightResult.fileSize);
+            break;
+        case SearchResultField::NbSeeders:
+            result = compare(leftResult.nbSeeders, rightResult.nbSeeders);
+            break;
+        case SearchResultField::NbLeechers:
+            result = compare(leftResult.nbLeechers, rightResult.nbLeechers);
+            break;
+        case SearchResultField::SiteUrl:
+            result = Utils::String::naturalCompare(leftResult.siteUrl, rightResult.siteUrl, Qt::CaseInsensitive);
+            break;
+        }
+
+        if (result != 0)
+            return (key.descending ? (result > 0) : (result < 0));
+    }
+
+    return (left < right);
+}
+
+const QVector<int> &SearchResultIndex::sortedRows(const QVector<SearchResultSortKey> &sortKeys) const
+{
+    const auto iter = std::find_if(m_sortedRows.begin(), m_sortedRows.end(), [&sortKeys](const SortedRows &sortedRows)
+    {
+        return (sortedRows.sortKeys == sortKeys);
+    });
+
+    if (iter == m_sortedRows.end()) {
+        if (m_sortedRows.size() >= MAX_SORTED_ROWS)
+            m_sortedRows.removeLast();
+        m_sortedRows.prepend({sortKeys, {}});
+    }
+    else if (iter != m_sortedRows.begin()) {
+        std::rotate(m_sortedRows.begin(), iter, (iter + 1));
+    }
+
+    QVector<int> &rows = m_sortedRows.first().rows;
+    const int sortedCount = rows.size();
+    if (sortedCount == m_results.size())
+        return rows;
+
+    // only the new results are sorted, then they are merged into the known order
+    rows.reserve(m_results.size());
+    for (int row = sortedCount; row < m_results.size(); ++row)
+        rows.append(row);
+
+    const auto lessThan = [this, &sortKeys](const int left, const int right)
+    {
+        return this->lessThan(left, right, sortKeys);
+    };
+    std::sort((rows.begin() + sortedCount), rows.end(), lessThan);
+    std::inplace_merge(rows.begin(), (rows.begin() + sortedCount), rows.end(), lessThan);
+
+    return rows;
+}
@@ -0,0 +1,94 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVector>
+
+#include "searchhandler.h"
+
+class SearchResultFilter;
+
+enum class SearchResultField
+{
+    FileName,
+    FileSize,
+    NbSeeders,
+    NbLeechers,
+    SiteUrl
+};
+
+struct SearchResultSortKey
+{
+    SearchResultField field;
+    bool descending;
+};
+
+bool operator==(const SearchResultSortKey &left, const SearchResultSortKey &right);
+
+// Keeps the results of a search job along with the data needed to filter and sort them quickly.
+class SearchResultIndex
+{
+public:
+    void append(const QList<SearchResult> &results);
+
+    const QList<SearchResult> &results() const;
+    int size() const;
+
+    // Returns the rows of the results matching the filter, ordered by the keys.
+    // The ties are ordered by arrival, so the order of the known results stays the same
+    // when new ones arrive, and a row can be used as a paging cursor:
+    // only the rows ordered after 'afterRow' are returned, unless it is negative.
+    // At most 'limit' rows are returned, unless it is not positive.
+    QVector<int> find(const SearchResultFilter &filter, const QVector<SearchResultSortKey> &sortKeys
+                      , int afterRow = -1, int limit = -1) const;
+    // Returns the number of all the results matching the filter
+    int count(const SearchResultFilter &filter) const;
+
+private:
+    struct SortedRows
+    {
+        QVector<SearchResultSortKey> sortKeys;
+        QVector<int> rows;
+    };
+
+    bool matches(int row, const SearchResultFilter &filter) const;
+    bool lessThan(int left, int right, const QVector<SearchResultSortKey> &sortKeys) const;
+    const QVector<int> &sortedRows(const QVector<SearchResultSortKey> &sortKeys) const;
+
+    QList<SearchResult> m_results;
+    // case folded names for the name filter
+    QVector<QString> m_foldedNames;
+
+    // the recently requested orders, the most recent first, they are extended
+    // with the results arrived since then. The clients paging the results
+    // in different orders don't make each other sort them over again.
+    mutable QVector<SortedRows> m_sortedRows;
+};
@@ -29,7 +29,8 @@
 
 #include "gzip.h"
 
-#include <vector>
+#include <algorithm>
+#include <memory>
 
 #include <QByteArray>
 
@@ -38,6 +39,61 @@
 #endif
 #include <zlib.h>
 
+namespace
+{
+    // Setting up a deflate stream allocates ~270 KiB of state, so each thread keeps
+    // a single stream, it is only reset between uses and switched to the requested level
+    class DeflateStream
+    {
+    public:
+        ~DeflateStream()
+        {
+            if (m_stream)
+                deflateEnd(m_stream.get());
+        }
+
+        z_stream *get(int level)
+        {
+            if (level == Z_DEFAULT_COMPRESSION)
+                level = 6;
+            level = std::max(Z_NO_COMPRESSION, std::min(level, Z_BEST_COMPRESSION));
+
+            if (m_stream) {
+                // nothing is compressed since the reset, so the parameters can be changed without flushing
+                if ((deflateReset(m_stream.get()) == Z_OK)
+                    && ((level == m_level) || (deflateParams(m_stream.get(), level, Z_DEFAULT_STRATEGY) == Z_OK))) {
+                    m_level = level;
+                    return m_stream.get();
+                }
+
+                deflateEnd(m_stream.get());
+                m_stream.reset();
+            }
+
+            std::unique_ptr<z_stream> newStream {new z_stream {}};
+            newStream->zalloc = Z_NULL;
+            newStream->zfree = Z_NULL;
+            newStream->opaque = Z_NULL;
+
+            // windowBits = 15 + 16 to enable gzip
+            // From the zlib manual: windowBits can also be greater than 15 for optional gzip encoding. Add 16 to windowBits
+            // to write a simple gzip header and trailer around the compressed data instead of a zlib wrapper.
+            if (deflateInit2(newStream.get(), level, Z_DEFLATED, (15 + 16), 9, Z_DEFAULT_STRATEGY) != Z_OK)
+                return nullptr;
+
+            m_stream = std::move(newStream);
+            m_level = level;
+            return m_stream.get();
+        }
+
+    private:
+        std::unique_ptr<z_stream> m_stream;
+        int m_level = 0;
+    };
+
+    thread_local DeflateStream deflateStream;
+}
+
 QByteArray Utils::Gzip::compress(const QByteArray &data, const int level, bool *ok)
 {
     if (ok) *ok = false;
@@ -45,53 +101,92 @@ QByteArray Utils::Gzip::compress(const QByteArray &data, const int level, bool *
     if (data.isEmpty())
         return {};
 
-    const int BUFSIZE = 128 * 1024;
-    std::vector<char> tmpBuf(BUFSIZE);
+    z_stream *strm = deflateStream.get(level);
+    if (!strm)
+        return {};
 
-    z_stream strm;
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.next_in = reinterpret_cast<const Bytef *>(data.constData());
-    strm.avail_in = uInt(data.size());
-    strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-    strm.avail_out = BUFSIZE;
+    strm->next_in = reinterpret_cast<const Bytef *>(data.constData());
+    strm->avail_in = uInt(data.size());
 
-    // windowBits = 15 + 16 to enable gzip
-    // From the zlib manual: windowBits can also be greater than 15 for optional gzip encoding. Add 16 to windowBits
-    // to write a simple gzip header and trailer around the compressed data instead of a zlib wrapper.
-    int result = deflateInit2(&strm, level, Z_DEFLATED, (15 + 16), 9, Z_DEFAULT_STRATEGY);
-    if (result != Z_OK)
+    // the output buffer is large enough to compress everything in a single call
+    QByteArray output;
+    output.resize(int(deflateBound(strm, uLong(data.size()))));
+    strm->next_out = reinterpret_cast<Bytef *>(output.data());
+    strm->avail_out = uInt(output.size());
+
+    if (deflate(strm, Z_FINISH) != Z_STREAM_END)
         return {};
 
-    QByteArray output;
-    output.reserve(deflateBound(&strm, data.size()));
+    output.resize(int(strm->total_out));
+    output.squeeze();
 
-    // feed to deflate
-    while (strm.avail_in > 0) {
-        result = deflate(&strm, Z_NO_FLUSH);
+    if (ok) *ok = true;
+    return output;
+}
 
-        if (result != Z_OK) {
-            deflateEnd(&strm);
+Utils::Gzip::Compressor::Compressor(const int level)
+    : m_stream {new z_stream {}}
+{
+    m_stream->zalloc = Z_NULL;
+    m_stream->zfree = Z_NULL;
+    m_stream->opaque = Z_NULL;
+
+    // windowBits = 15 + 16 to enable gzip, see compress()
+    if (deflateInit2(m_stream.get(), level, Z_DEFLATED, (15 + 16), 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        m_stream.reset();
+}
+
+Utils::Gzip::Compressor::~Compressor()
+{
+    if (m_stream)
+        deflateEnd(m_stream.get());
+}
+
+QByteArray Utils::Gzip::Compressor::compress(const QByteArray &data, bool *ok)
+{
+    return deflate(data, Z_NO_FLUSH, ok);
+}
+
+QByteArray Utils::Gzip::Compressor::finish(bool *ok)
+{
+    return deflate({}, Z_FINISH, ok);
+}
+
+QByteArray Utils::Gzip::Compressor::deflate(const QByteArray &data, const int flush, bool *ok)
+{
+    if (ok) *ok = false;
+
+    if (!m_stream)
+        return {};
+
+    const int BUFSIZE = 16 * 1024;
+
+    m_stream->next_in = reinterpret_cast<const Bytef *>(data.constData());
+    m_stream->avail_in = uInt(data.size());
+
+    // the output buffer is grown until zlib leaves some of it unused, then all the output is taken
+    QByteArray output;
+    do {
+        const int outputSize = output.size();
+        output.resize(outputSize + BUFSIZE);
+        m_stream->next_out = reinterpret_cast<Bytef *>(output.data() + outputSize);
+        m_stream->avail_out = BUFSIZE;
+
+        const int result = ::deflate(m_stream.get(), flush);
+        if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR)) {
+            deflateEnd(m_stream.get());
+            m_stream.reset();
             return {};
         }
 
-        output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
-        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-        strm.avail_out = BUFSIZE;
-    }
-
-    // flush the rest from deflate
-    while (result != Z_STREAM_END) {
-        result = deflate(&strm, Z_FINISH);
+        output.resize(output.size() - int(m_stream->avail_out));
+    } while (m_stream->avail_out == 0);
 
-        output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
-        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
-        strm.avail_out = BUFSIZE;
+    if (flush == Z_FINISH) {
+        deflateEnd(m_stream.get());
+        m_stream.reset();
     }
 
-    deflateEnd(&strm);
-
     if (ok) *ok = true;
     return output;
 }
@@ -104,7 +199,7 @@ QByteArray Utils::Gzip::decompress(const QByteArray &data, bool *ok)
         return {};
 
     const int BUFSIZE = 1024 * 1024;
-    std::vector<char> tmpBuf(BUFSIZE);
+    const std::unique_ptr<char[]> tmpBuf {new char[BUFSIZE]};
 
     z_stream strm;
     strm.zalloc = Z_NULL;
@@ -112,7 +207,7 @@ QByteArray Utils::Gzip::decompress(const QByteArray &data, bool *ok)
     strm.opaque = Z_NULL;
     strm.next_in = reinterpret_cast<const Bytef *>(data.constData());
     strm.avail_in = uInt(data.size());
-    strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
+    strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.get());
     strm.avail_out = BUFSIZE;
 
     // windowBits must be greater than or equal to the windowBits value provided to deflateInit2() while compressing
@@ -130,7 +225,7 @@ QByteArray Utils::Gzip::decompress(const QByteArray &data, bool *ok)
         result = inflate(&strm, Z_NO_FLUSH);
 
         if (result == Z_STREAM_END) {
-            output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
+            output.append(tmpBuf.get(), (BUFSIZE - strm.avail_out));
             break;
         }
 
@@ -139,8 +234,8 @@ QByteArray Utils::Gzip::decompress(const QByteArray &data, bool *ok)
             return {};
         }
 
-        output.append(tmpBuf.data(), (BUFSIZE - strm.avail_out));
-        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.data());
+        output.append(tmpBuf.get(), (BUFSIZE - strm.avail_out));
+        strm.next_out = reinterpret_cast<Bytef *>(tmpBuf.get());
         strm.avail_out = BUFSIZE;
     }
 
@@ -30,7 +30,12 @@
 #ifndef UTILS_GZIP_H
 #define UTILS_GZIP_H
 
+#include <memory>
+
+#include <QtGlobal>
+
 class QByteArray;
+struct z_stream_s;
 
 namespace Utils
 {
@@ -38,6 +43,26 @@ namespace Utils
     {
         QByteArray compress(const QByteArray &data, int level = 6, bool *ok = nullptr);
         QByteArray decompress(const QByteArray &data, bool *ok = nullptr);
+
+        // Compresses the data given piece by piece into a single gzip member.
+        // The output comes as soon as zlib has enough input to produce it,
+        // the rest is returned by finish().
+        class Compressor
+        {
+            Q_DISABLE_COPY(Compressor)
+
+        public:
+            explicit Compressor(int level = 6);
+            ~Compressor();
+
+            QByteArray compress(const QByteArray &data, bool *ok = nullptr);
+            QByteArray finish(bool *ok = nullptr);
+
+        private:
+            QByteArray deflate(const QByteArray &data, int flush, bool *ok);
+
+            std::unique_ptr<z_stream_s> m_stream;
+        };
     }
 }
 
@@ -67,6 +67,8 @@ enum AdvSettingsRows
     NETWORK_LISTEN_IPV6,
     // behavior
     SAVE_RESUME_DATA_INTERVAL,
+    RESUME_DATA_STORAGE,
+    RESUME_DATA_SAVING_RATE,
     CONFIRM_RECHECK_TORRENT,
     RECHECK_COMPLETED,
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
@@ -82,6 +84,7 @@ enum AdvSettingsRows
     DOWNLOAD_TRACKER_FAVICON,
     SAVE_PATH_HISTORY_LENGTH,
     ENABLE_SPEED_WIDGET,
+    WEBUI_SERVER_THREADS,
 #if (defined(Q_OS_UNIX) && !defined(Q_OS_MAC))
     USE_ICON_THEME,
 #endif
@@ -173,6 +176,10 @@ void AdvancedSettings::saveAdvancedSettings()
     session->setSendBufferWatermarkFactor(spinBoxSendBufferWatermarkFactor.value());
     // Save resume data interval
     session->setSaveResumeDataInterval(spinBoxSaveResumeDataInterval.value());
+    // Resume data storage type
+    session->setResumeDataStorageType(static_cast<BitTorrent::ResumeDataStorageType>(comboBoxResumeDataStorage.currentIndex()));
+    // Resume data saving rate limit
+    session->setResumeDataSavingRateLimit(spinBoxResumeDataSavingRate.value());
     // Outgoing ports
     session->setOutgoingPortsMin(spinBoxOutgoingPortsMin.value());
     session->setOutgoingPortsMax(spinBoxOutgoingPortsMax.value());
@@ -222,6 +229,8 @@ void AdvancedSettings::saveAdvancedSettings()
     mainWindow->setDownloadTrackerFavicon(checkBoxTrackerFavicon.isChecked());
     AddNewTorrentDialog::setSavePathHistoryLength(spinBoxSavePathHistoryLength.value());
     pref->setSpeedWidgetEnabled(checkBoxSpeedWidgetEnabled.isChecked());
+    // Web UI server threads
+    pref->setWebUiServerThreads(spinBoxWebUiServerThreads.value());
 
     // Tracker
     session->setTrackerEnabled(checkBoxTrackerStatus.isChecked());
@@ -401,6 +410,16 @@ void AdvancedSettings::loadAdvancedSettings()
     spinBoxSaveResumeDataInterval.setValue(session->saveResumeDataInterval());
     updateSaveResumeDataIntervalSuffix(spinBoxSaveResumeDataInterval.value());
     addRow(SAVE_RESUME_DATA_INTERVAL, tr("Save resume data interval", "How often the fastresume file is saved."), &spinBoxSaveResumeDataInterval);
+    // Resume data storage type
+    comboBoxResumeDataStorage.addItems({tr("Fastresume files"), tr("Single-file journal")});
+    comboBoxResumeDataStorage.setCurrentIndex(static_cast<int>(session->resumeDataStorageType()));
+    addRow(RESUME_DATA_STORAGE, tr("Resume data storage type (requires restart)"), &comboBoxResumeDataStorage);
+    // Resume data saving rate limit
+    spinBoxResumeDataSavingRate.setMinimum(0);
+    spinBoxResumeDataSavingRate.setMaximum(std::numeric_limits<int>::max());
+    spinBoxResumeDataSavingRate.setSuffix(tr(" /s", " per second"));
+    spinBoxResumeDataSavingRate.setValue(session->resumeDataSavingRateLimit());
+    addRow(RESUME_DATA_SAVING_RATE, tr("Resume data saving rate limit [0: Unlimited]"), &spinBoxResumeDataSavingRate);
     // Outgoing port Min
     spinBoxOutgoingPortsMin.setMinimum(0);
     spinBoxOutgoingPortsMin.setMaximum(65535);
@@ -491,6 +510,11 @@ void AdvancedSettings::loadAdvancedSettings()
     // Enable speed graphs
     checkBoxSpeedWidgetEnabled.setChecked(pref->isSpeedWidgetEnabled());
     addRow(ENABLE_SPEED_WIDGET, tr("Enable speed graphs"), &checkBoxSpeedWidgetEnabled);
+    // Web UI server threads
+    spinBoxWebUiServerThreads.setMinimum(1);
+    spinBoxWebUiServerThreads.setMaximum(16);
+    spinBoxWebUiServerThreads.setValue(pref->getWebUiServerThreads());
+    addRow(WEBUI_SERVER_THREADS, tr("Web UI server I/O threads (requires restart)"), &spinBoxWebUiServerThreads);
     // Tracker State
     checkBoxTrackerStatus.setChecked(session->isTrackerEnabled());
     addRow(TRACKER_STATUS, tr("Enable embedded tracker"), &checkBoxTrackerStatus);
@@ -209,6 +209,8 @@ void PeerListWidget::updatePeerCountryResolutionState()
     if (Preferences::instance()->resolvePeerCountries() != m_resolveCountries) {
         m_resolveCountries = !m_resolveCountries;
         if (m_resolveCountries) {
+            // unchanged peers are not updated so the list should be reloaded
+            clear();
             loadPeers(m_properties->getCurrentTorrent());
             showColumn(PeerListDelegate::COUNTRY);
             if (columnWidth(PeerListDelegate::COUNTRY) <= 0)
@@ -314,8 +316,8 @@ void PeerListWidget::clear()
 {
     qDebug("clearing peer list");
     m_peerItems.clear();
-    m_peerAddresses.clear();
     m_missingFlags.clear();
+    m_peerListState = {};
     int nbrows = m_listModel->rowCount();
     if (nbrows > 0) {
         qDebug("Cleared %d peers", nbrows);
@@ -337,41 +339,48 @@ void PeerListWidget::loadPeers(BitTorrent::TorrentHandle *const torrent, bool fo
 {
     if (!torrent) return;
 
-    const QList<BitTorrent::PeerInfo> peers = torrent->peers();
-    QSet<QString> oldPeersSet = m_peerItems.keys().toSet();
+    torrent->fetchPeerInfo(this, [this, torrent, forceHostnameResolution](const QList<BitTorrent::PeerInfo> &peers)
+    {
+        // the current torrent could be changed while the peers were being fetched
+        if (torrent == m_properties->getCurrentTorrent())
+            updatePeers(torrent, peers, forceHostnameResolution);
+    });
+}
 
-    for (const BitTorrent::PeerInfo &peer : peers) {
-        BitTorrent::PeerAddress addr = peer.address();
-        if (addr.ip.isNull()) continue;
+void PeerListWidget::updatePeers(BitTorrent::TorrentHandle *const torrent, const QList<BitTorrent::PeerInfo> &peers, const bool forceHostnameResolution)
+{
+    BitTorrent::PeerListState peerListState(peers);
+    const BitTorrent::PeerListChanges changes = peerListState.diff(m_peerListState);
+    m_peerListState = peerListState;
 
-        QString peerIp = addr.ip.toString();
-        if (m_peerItems.contains(peerIp)) {
-            // Update existing peer
-            updatePeer(peerIp, torrent, peer);
-            oldPeersSet.remove(peerIp);
-            if (forceHostnameResolution && m_resolver)
-                m_resolver->resolve(peerIp);
-        }
-        else {
-            // Add new peer
-            m_peerItems[peerIp] = addPeer(peerIp, torrent, peer);
-            m_peerAddresses[peerIp] = addr;
-            // Resolve peer host name is asked
-            if (m_resolver)
-                m_resolver->resolve(peerIp);
-        }
-    }
     // Delete peers that are gone
-    for (const QString &ip : oldPeersSet) {
-        m_missingFlags.remove(ip);
-        m_peerAddresses.remove(ip);
-        QStandardItem *item = m_peerItems.take(ip);
-        m_listModel->removeRow(item->row());
+    for (const BitTorrent::PeerAddress &addr : changes.removed) {
+        m_missingFlags.remove(addr);
+        QStandardItem *item = m_peerItems.take(addr);
+        if (item)
+            m_listModel->removeRow(item->row());
+    }
+    // Update existing peers
+    for (const BitTorrent::PeerInfo &peer : changes.changed)
+        updatePeer(torrent, peer);
+    // Add new peers
+    for (const BitTorrent::PeerInfo &peer : changes.added) {
+        const BitTorrent::PeerAddress addr = peer.address();
+        m_peerItems[addr] = addPeer(torrent, peer);
+        // Resolve peer host name is asked
+        if (m_resolver && !forceHostnameResolution)
+            m_resolver->resolve(addr.ip.toString());
+    }
+
+    if (forceHostnameResolution && m_resolver) {
+        for (auto it = m_peerItems.cbegin(); it != m_peerItems.cend(); ++it)
+            m_resolver->resolve(it.key().ip.toString());
     }
 }
 
-QStandardItem *PeerListWidget::addPeer(const QString &ip, BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer)
+QStandardItem *PeerListWidget::addPeer(BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer)
 {
+    const QString ip = peer.address().ip.toString();
     int row = m_listModel->rowCount();
     // Adding Peer to peer list
     m_listModel->insertRow(row);
@@ -379,17 +388,8 @@ QStandardItem *PeerListWidget::addPeer(const QString &ip, BitTorrent::TorrentHan
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP), ip, Qt::ToolTipRole);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::PORT), peer.address().port);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::IP_HIDDEN), ip);
-    if (m_resolveCountries) {
-        const QIcon ico = GuiIconProvider::instance()->getFlagIcon(peer.country());
-        if (!ico.isNull()) {
-            m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), ico, Qt::DecorationRole);
-            const QString countryName = Net::GeoIPManager::CountryName(peer.country());
-            m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), countryName, Qt::ToolTipRole);
-        }
-        else {
-            m_missingFlags.insert(ip);
-        }
-    }
+    if (m_resolveCountries)
+        setPeerCountry(row, peer);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::CONNECTION), peer.connectionType());
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::FLAGS), peer.flags());
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::FLAGS), peer.flagsDescription(), Qt::ToolTipRole);
@@ -407,21 +407,16 @@ QStandardItem *PeerListWidget::addPeer(const QString &ip, BitTorrent::TorrentHan
     return m_listModel->item(row, PeerListDelegate::IP);
 }
 
-void PeerListWidget::updatePeer(const QString &ip, BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer)
+void PeerListWidget::updatePeer(BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer)
 {
-    QStandardItem *item = m_peerItems.value(ip);
+    QStandardItem *item = m_peerItems.value(peer.address());
+    if (!item) return;
+
     int row = item->row();
-    if (m_resolveCountries) {
-        const QIcon ico = GuiIconProvider::instance()->getFlagIcon(peer.country());
-        if (!ico.isNull()) {
-            m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), ico, Qt::DecorationRole);
-            const QString countryName = Net::GeoIPManager::CountryName(peer.country());
-            m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), countryName, Qt::ToolTipRole);
-            m_missingFlags.remove(ip);
-        }
-    }
+    // Country of the peer can't be changed so it's only retried if it was missing
+    if (m_resolveCountries && m_missingFlags.contains(peer.address()))
+        setPeerCountry(row, peer);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::CONNECTION), peer.connectionType());
-    m_listModel->setData(m_listModel->index(row, PeerListDelegate::PORT), peer.address().port);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::FLAGS), peer.flags());
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::FLAGS), peer.flagsDescription(), Qt::ToolTipRole);
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::CLIENT), peer.client().toHtmlEscaped());
@@ -436,12 +431,28 @@ void PeerListWidget::updatePeer(const QString &ip, BitTorrent::TorrentHandle *co
     m_listModel->setData(m_listModel->index(row, PeerListDelegate::DOWNLOADING_PIECE), downloadingFiles.join(QLatin1String("\n")), Qt::ToolTipRole);
 }
 
+void PeerListWidget::setPeerCountry(const int row, const BitTorrent::PeerInfo &peer)
+{
+    const QIcon ico = GuiIconProvider::instance()->getFlagIcon(peer.country());
+    if (!ico.isNull()) {
+        m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), ico, Qt::DecorationRole);
+        const QString countryName = Net::GeoIPManager::CountryName(peer.country());
+        m_listModel->setData(m_listModel->index(row, PeerListDelegate::COUNTRY), countryName, Qt::ToolTipRole);
+        m_missingFlags.remove(peer.address());
+    }
+    else {
+        m_missingFlags.insert(peer.address());
+    }
+}
+
 void PeerListWidget::handleResolved(const QString &ip, const QString &hostname)
 {
-    QStandardItem *item = m_peerItems.value(ip, nullptr);
-    if (item) {
-        qDebug("Resolved %s -> %s", qUtf8Printable(ip), qUtf8Printable(hostname));
-        item->setData(hostname, Qt::DisplayRole);
+    const QHostAddress addr(ip);
+    for (auto it = m_peerItems.cbegin(); it != m_peerItems.cend(); ++it) {
+        if (it.key().ip == addr) {
+            qDebug("Resolved %s -> %s", qUtf8Printable(ip), qUtf8Printable(hostname));
+            it.value()->setData(hostname, Qt::DisplayRole);
+        }
     }
 }
 
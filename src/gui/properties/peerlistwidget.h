@@ -35,6 +35,8 @@
 #include <QShortcut>
 #include <QTreeView>
 
+#include "base/bittorrent/peerlist.h"
+
 class QSortFilterProxyModel;
 class QStandardItem;
 class QStandardItemModel;
@@ -51,8 +53,6 @@ namespace Net
 namespace BitTorrent
 {
     class TorrentHandle;
-    class PeerInfo;
-    struct PeerAddress;
 }
 
 class PeerListWidget : public QTreeView
@@ -64,8 +64,8 @@ public:
     ~PeerListWidget() override;
 
     void loadPeers(BitTorrent::TorrentHandle *const torrent, bool forceHostnameResolution = false);
-    QStandardItem *addPeer(const QString &ip, BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer);
-    void updatePeer(const QString &ip, BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer);
+    QStandardItem *addPeer(BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer);
+    void updatePeer(BitTorrent::TorrentHandle *const torrent, const BitTorrent::PeerInfo &peer);
     void updatePeerHostNameResolutionState();
     void updatePeerCountryResolutionState();
     void clear();
@@ -81,14 +81,16 @@ private slots:
     void handleResolved(const QString &ip, const QString &hostname);
 
 private:
+    void updatePeers(BitTorrent::TorrentHandle *const torrent, const QList<BitTorrent::PeerInfo> &peers, bool forceHostnameResolution);
+    void setPeerCountry(int row, const BitTorrent::PeerInfo &peer);
     void wheelEvent(QWheelEvent *event) override;
 
     QStandardItemModel *m_listModel;
     PeerListDelegate *m_listDelegate;
     PeerListSortModel *m_proxyModel;
-    QHash<QString, QStandardItem *> m_peerItems;
-    QHash<QString, BitTorrent::PeerAddress> m_peerAddresses;
-    QSet<QString> m_missingFlags;
+    QHash<BitTorrent::PeerAddress, QStandardItem *> m_peerItems;
+    QSet<BitTorrent::PeerAddress> m_missingFlags;
+    BitTorrent::PeerListState m_peerListState;
     QPointer<Net::ReverseResolution> m_resolver;
     PropertiesWidget *m_properties;
     bool m_resolveCountries;
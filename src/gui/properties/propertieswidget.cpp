@@ -336,7 +336,11 @@ void PropertiesWidget::loadTorrentInfos(BitTorrent::TorrentHandle *const torrent
             m_ui->filesList->setExpanded(m_propListModel->index(0, 0), true);
 
         // Load file priorities
-        m_propListModel->model()->updateFilesPriorities(m_torrent->filePriorities());
+        m_torrent->fetchFilePriorities(this, [this, torrent](const QVector<BitTorrent::DownloadPriority> &filePriorities)
+        {
+            if (torrent == m_torrent)
+                m_propListModel->model()->updateFilesPriorities(filePriorities);
+        });
     }
     // Load dynamic data
     loadDynamicData();
@@ -392,6 +396,9 @@ void PropertiesWidget::loadDynamicData()
     // Refresh only if the torrent handle is valid and visible
     if (!m_torrent || (m_state != VISIBLE)) return;
 
+    // Some data is fetched asynchronously so the current torrent could be changed in the meantime
+    BitTorrent::TorrentHandle *const torrent = m_torrent;
+
     // Transfer infos
     switch (m_ui->stackedProperties->currentIndex()) {
     case PropTabBar::MainTab: {
@@ -459,7 +466,11 @@ void PropertiesWidget::loadDynamicData()
                 if (!m_torrent->isSeed() && !m_torrent->isPaused() && !m_torrent->isQueued() && !m_torrent->isChecking()) {
                     // Pieces availability
                     showPiecesAvailability(true);
-                    m_piecesAvailability->setAvailability(m_torrent->pieceAvailability());
+                    m_torrent->fetchPieceAvailability(this, [this, torrent](const QVector<int> &pieceAvailability)
+                    {
+                        if (torrent == m_torrent)
+                            m_piecesAvailability->setAvailability(pieceAvailability);
+                    });
                     m_ui->labelAverageAvailabilityVal->setText(Utils::String::fromDouble(m_torrent->distributedCopies(), 3));
                 }
                 else {
@@ -469,7 +480,11 @@ void PropertiesWidget::loadDynamicData()
                 // Progress
                 qreal progress = m_torrent->progress() * 100.;
                 m_ui->labelProgressVal->setText(Utils::String::fromDouble(progress, 1) + '%');
-                m_downloadedPieces->setProgress(m_torrent->pieces(), m_torrent->downloadingPieces());
+                m_torrent->fetchDownloadingPieces(this, [this, torrent](const QBitArray &downloadingPieces)
+                {
+                    if (torrent == m_torrent)
+                        m_downloadedPieces->setProgress(m_torrent->pieces(), downloadingPieces);
+                });
             }
             else {
                 showPiecesAvailability(false);
@@ -488,14 +503,23 @@ void PropertiesWidget::loadDynamicData()
         // Files progress
         if (m_torrent->hasMetadata()) {
             qDebug("Updating priorities in files tab");
-            m_ui->filesList->setUpdatesEnabled(false);
-            m_propListModel->model()->updateFilesProgress(m_torrent->filesProgress());
-            m_propListModel->model()->updateFilesAvailability(m_torrent->availableFileFractions());
+            m_torrent->fetchFilesProgress(this, [this, torrent](const QVector<qreal> &filesProgress)
+            {
+                if (torrent != m_torrent) return;
+
+                m_ui->filesList->setUpdatesEnabled(false);
+                m_propListModel->model()->updateFilesProgress(filesProgress);
+                m_ui->filesList->setUpdatesEnabled(true);
+            });
+            m_torrent->fetchAvailableFileFractions(this, [this, torrent](const QVector<qreal> &availableFileFractions)
+            {
+                if (torrent == m_torrent)
+                    m_propListModel->model()->updateFilesAvailability(availableFileFractions);
+            });
             // XXX: We don't update file priorities regularly for performance
             // reasons. This means that priorities will not be updated if
             // set from the Web UI.
             // PropListModel->model()->updateFilesPriorities(h.file_priorities());
-            m_ui->filesList->setUpdatesEnabled(true);
         }
         break;
     default:;
@@ -506,12 +530,18 @@ void PropertiesWidget::loadUrlSeeds()
 {
     m_ui->listWebSeeds->clear();
     qDebug("Loading URL seeds");
-    const QList<QUrl> hcSeeds = m_torrent->urlSeeds();
-    // Add url seeds
-    for (const QUrl &hcSeed : hcSeeds) {
-        qDebug("Loading URL seed: %s", qUtf8Printable(hcSeed.toString()));
-        new QListWidgetItem(hcSeed.toString(), m_ui->listWebSeeds);
-    }
+    BitTorrent::TorrentHandle *const torrent = m_torrent;
+    m_torrent->fetchURLSeeds(this, [this, torrent](const QList<QUrl> &hcSeeds)
+    {
+        if (torrent != m_torrent) return;
+
+        m_ui->listWebSeeds->clear();
+        // Add url seeds
+        for (const QUrl &hcSeed : hcSeeds) {
+            qDebug("Loading URL seed: %s", qUtf8Printable(hcSeed.toString()));
+            new QListWidgetItem(hcSeed.toString(), m_ui->listWebSeeds);
+        }
+    });
 }
 
 void PropertiesWidget::openDoubleClickedFile(const QModelIndex &index)
@@ -290,10 +290,19 @@ void TrackerListWidget::loadStickyItems(BitTorrent::TorrentHandle *const torrent
         m_LSDItem->setText(COL_MSG, privateMsg);
     }
 
+    torrent->fetchPeerInfo(this, [this, torrent](const QList<BitTorrent::PeerInfo> &peers)
+    {
+        if (torrent == m_properties->getCurrentTorrent())
+            updateStickyItemsPeers(peers);
+    });
+}
+
+void TrackerListWidget::updateStickyItemsPeers(const QList<BitTorrent::PeerInfo> &peers)
+{
     // XXX: libtorrent should provide this info...
     // Count peers from DHT, PeX, LSD
     uint seedsDHT = 0, seedsPeX = 0, seedsLSD = 0, peersDHT = 0, peersPeX = 0, peersLSD = 0;
-    for (const BitTorrent::PeerInfo &peer : asConst(torrent->peers())) {
+    for (const BitTorrent::PeerInfo &peer : peers) {
         if (peer.isConnecting()) continue;
 
         if (peer.fromDHT()) {
@@ -332,10 +341,20 @@ void TrackerListWidget::loadTrackers()
 
     loadStickyItems(torrent);
 
+    torrent->fetchTrackers(this, [this, torrent](const QVector<BitTorrent::TrackerEntry> &trackers)
+    {
+        // the current torrent could be changed while the trackers were being fetched
+        if (torrent == m_properties->getCurrentTorrent())
+            updateTrackers(torrent, trackers);
+    });
+}
+
+void TrackerListWidget::updateTrackers(BitTorrent::TorrentHandle *const torrent, const QVector<BitTorrent::TrackerEntry> &trackers)
+{
     // Load actual trackers information
     QHash<QString, BitTorrent::TrackerInfo> trackerData = torrent->trackerInfos();
     QStringList oldTrackerURLs = m_trackerItems.keys();
-    for (const BitTorrent::TrackerEntry &entry : asConst(torrent->trackers())) {
+    for (const BitTorrent::TrackerEntry &entry : trackers) {
         QString trackerURL = entry.url();
         QTreeWidgetItem *item = m_trackerItems.value(trackerURL, nullptr);
         if (!item) {
@@ -31,6 +31,7 @@
 
 #include <QList>
 #include <QTreeWidget>
+#include <QVector>
 
 #include "propertieswidget.h"
 
@@ -40,7 +41,9 @@ class QShortcut;
 
 namespace BitTorrent
 {
+    class PeerInfo;
     class TorrentHandle;
+    class TrackerEntry;
 }
 
 class TrackerListWidget : public QTreeWidget
@@ -91,6 +94,9 @@ protected:
     QList<QTreeWidgetItem *> getSelectedTrackerItems() const;
 
 private:
+    void updateStickyItemsPeers(const QList<BitTorrent::PeerInfo> &peers);
+    void updateTrackers(BitTorrent::TorrentHandle *const torrent, const QVector<BitTorrent::TrackerEntry> &trackers);
+
     PropertiesWidget *m_properties;
     QHash<QString, QTreeWidgetItem *> m_trackerItems;
     QTreeWidgetItem *m_DHTItem;
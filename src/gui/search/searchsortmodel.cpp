@@ -28,18 +28,11 @@
 
 #include "searchsortmodel.h"
 
-#include "base/global.h"
 #include "base/utils/string.h"
 
 SearchSortModel::SearchSortModel(QObject *parent)
     : base(parent)
     , m_isNameFilterEnabled(false)
-    , m_minSeeds(0)
-    , m_maxSeeds(-1)
-    , m_minLeeches(0)
-    , m_maxLeeches(-1)
-    , m_minSize(0)
-    , m_maxSize(-1)
 {
 }
 
@@ -50,32 +43,22 @@ void SearchSortModel::enableNameFilter(bool enabled)
 
 void SearchSortModel::setNameFilter(const QString &searchTerm)
 {
-    m_searchTerm = searchTerm;
-    if (searchTerm.length() > 2
-        && searchTerm.startsWith(QLatin1Char('"')) && searchTerm.endsWith(QLatin1Char('"'))) {
-        m_searchTermWords = QStringList(m_searchTerm.mid(1, m_searchTerm.length() - 2));
-    }
-    else {
-        m_searchTermWords = searchTerm.split(QLatin1Char(' '), QString::SkipEmptyParts);
-    }
+    m_filter.setNamePattern(searchTerm);
 }
 
 void SearchSortModel::setSizeFilter(qint64 minSize, qint64 maxSize)
 {
-    m_minSize = std::max(static_cast<qint64>(0), minSize);
-    m_maxSize = std::max(static_cast<qint64>(-1), maxSize);
+    m_filter.setSizeRange(minSize, maxSize);
 }
 
 void SearchSortModel::setSeedsFilter(int minSeeds, int maxSeeds)
 {
-    m_minSeeds = std::max(0, minSeeds);
-    m_maxSeeds = std::max(-1, maxSeeds);
+    m_filter.setSeedsRange(minSeeds, maxSeeds);
 }
 
 void SearchSortModel::setLeechesFilter(int minLeeches, int maxLeeches)
 {
-    m_minLeeches = std::max(0, minLeeches);
-    m_maxLeeches = std::max(-1, maxLeeches);
+    m_filter.setLeechesRange(minLeeches, maxLeeches);
 }
 
 bool SearchSortModel::isNameFilterEnabled() const
@@ -85,27 +68,27 @@ bool SearchSortModel::isNameFilterEnabled() const
 
 QString SearchSortModel::searchTerm() const
 {
-    return m_searchTerm;
+    return m_filter.namePattern();
 }
 
 int SearchSortModel::minSeeds() const
 {
-    return m_minSeeds;
+    return static_cast<int>(m_filter.minSeeds());
 }
 
 int SearchSortModel::maxSeeds() const
 {
-    return m_maxSeeds;
+    return static_cast<int>(m_filter.maxSeeds());
 }
 
 qint64 SearchSortModel::minSize() const
 {
-    return m_minSize;
+    return m_filter.minSize();
 }
 
 qint64 SearchSortModel::maxSize() const
 {
-    return m_maxSize;
+    return m_filter.maxSize();
 }
 
 bool SearchSortModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
@@ -127,39 +110,23 @@ bool SearchSortModel::lessThan(const QModelIndex &left, const QModelIndex &right
 bool SearchSortModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
     const QAbstractItemModel *const sourceModel = this->sourceModel();
-    if (m_isNameFilterEnabled && !m_searchTerm.isEmpty()) {
-        QString name = sourceModel->data(sourceModel->index(sourceRow, NAME, sourceParent)).toString();
-        for (const QString &word : asConst(m_searchTermWords)) {
-            int i = name.indexOf(word, 0, Qt::CaseInsensitive);
-            if (i == -1) {
-                return false;
-            }
-        }
-    }
-
-    if ((m_minSize > 0) || (m_maxSize >= 0)) {
-        qlonglong size = sourceModel->data(sourceModel->index(sourceRow, SIZE, sourceParent)).toLongLong();
-        if (((m_minSize > 0) && (size < m_minSize))
-            || ((m_maxSize > 0) && (size > m_maxSize))) {
+    if (m_isNameFilterEnabled) {
+        const QString name = sourceModel->data(sourceModel->index(sourceRow, NAME, sourceParent)).toString();
+        if (!m_filter.matchesName(name))
             return false;
-        }
     }
 
-    if ((m_minSeeds > 0) || (m_maxSeeds >= 0)) {
-        int seeds = sourceModel->data(sourceModel->index(sourceRow, SEEDS, sourceParent)).toInt();
-        if (((m_minSeeds > 0) && (seeds < m_minSeeds))
-            || ((m_maxSeeds > 0) && (seeds > m_maxSeeds))) {
-            return false;
-        }
-    }
+    const qlonglong size = sourceModel->data(sourceModel->index(sourceRow, SIZE, sourceParent)).toLongLong();
+    if (!m_filter.matchesSize(size))
+        return false;
 
-    if ((m_minLeeches > 0) || (m_maxLeeches >= 0)) {
-        int leeches = sourceModel->data(sourceModel->index(sourceRow, LEECHES, sourceParent)).toInt();
-        if (((m_minLeeches > 0) && (leeches < m_minLeeches))
-            || ((m_maxLeeches > 0) && (leeches > m_maxLeeches))) {
-            return false;
-        }
-    }
+    const qlonglong seeds = sourceModel->data(sourceModel->index(sourceRow, SEEDS, sourceParent)).toLongLong();
+    if (!m_filter.matchesSeeds(seeds))
+        return false;
+
+    const qlonglong leeches = sourceModel->data(sourceModel->index(sourceRow, LEECHES, sourceParent)).toLongLong();
+    if (!m_filter.matchesLeeches(leeches))
+        return false;
 
     return base::filterAcceptsRow(sourceRow, sourceParent);
 }
@@ -30,7 +30,8 @@
 #define SEARCHSORTMODEL_H
 
 #include <QSortFilterProxyModel>
-#include <QStringList>
+
+#include "base/search/searchresultfilter.h"
 
 class SearchSortModel : public QSortFilterProxyModel
 {
@@ -85,11 +86,8 @@ protected:
 
 private:
     bool m_isNameFilterEnabled;
-    QString m_searchTerm;
-    QStringList m_searchTermWords;
-    int m_minSeeds, m_maxSeeds;
-    int m_minLeeches, m_maxLeeches;
-    qint64 m_minSize, m_maxSize;
+    // the same criteria are used to filter the results for the WebUI
+    SearchResultFilter m_filter;
 };
 
 #endif // SEARCHSORTMODEL_H
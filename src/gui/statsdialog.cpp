@@ -109,6 +109,11 @@ void StatsDialog::update()
     m_ui->labelQueuedJobs->setText(QString::number(cs.jobQueueLength));
     m_ui->labelJobsTime->setText(tr("%1 ms", "18 milliseconds").arg(cs.averageJobTime));
     m_ui->labelQueuedBytes->setText(Utils::Misc::friendlyUnit(cs.queuedBytes));
+    // Resume data saving
+    m_ui->labelResumeDataPending->setText(QString::number(ss.resumeDataPending));
+    m_ui->labelResumeDataWritten->setText(QString::fromLatin1("%1 (%2)").arg(QString::number(ss.resumeDataWritten)
+                                                                             , Utils::Misc::friendlyUnit(ss.resumeDataBytesWritten)));
+    m_ui->labelResumeDataLatency->setText(tr("%1 ms", "18 milliseconds").arg(ss.averageResumeDataLatency));
 
     // Total connected peers
     m_ui->labelPeers->setText(QString::number(ss.peersCount));
@@ -28,6 +28,8 @@
 
 #include "apicontroller.h"
 
+#include <utility>
+
 #include <QJsonDocument>
 #include <QMetaObject>
 
@@ -39,11 +41,15 @@ APIController::APIController(ISessionManager *sessionManager, QObject *parent)
 {
 }
 
-QVariant APIController::run(const QString &action, const StringMap &params, const DataMap &data)
+QVariant APIController::run(const QString &action, const StringMap &params, const DataMap &data, const DataFormat format)
 {
     m_result.clear(); // clear result
+    m_isResultDeferred = false;
+    m_resumeParams.clear();
+    m_streamedResult = {};
     m_params = params;
     m_data = data;
+    m_format = format;
 
     const QString methodName {action + QLatin1String("Action")};
     if (!QMetaObject::invokeMethod(this, methodName.toLatin1().constData()))
@@ -57,6 +63,23 @@ ISessionManager *APIController::sessionManager() const
     return m_sessionManager;
 }
 
+bool APIController::isResultDeferred() const
+{
+    return m_isResultDeferred;
+}
+
+const StringMap &APIController::resumeParams() const
+{
+    return m_resumeParams;
+}
+
+StreamedResult APIController::takeStreamedResult()
+{
+    StreamedResult result = std::move(m_streamedResult);
+    m_streamedResult = {};
+    return result;
+}
+
 const StringMap &APIController::params() const
 {
     return m_params;
@@ -89,3 +112,32 @@ void APIController::setResult(const QJsonObject &result)
 {
     m_result = QJsonDocument(result);
 }
+
+std::unique_ptr<DataWriter> APIController::createResultWriter(const int reserveSize) const
+{
+    return DataWriter::create(m_format, reserveSize);
+}
+
+void APIController::setResult(const DataWriter &result)
+{
+    m_result = result.data();
+}
+
+void APIController::setResult(std::unique_ptr<DataWriter> writer, const std::function<bool (DataWriter &writer)> &writeNext)
+{
+    m_streamedResult = {std::move(writer), writeNext};
+}
+
+bool APIController::deferResult()
+{
+    if (m_params.value(QLatin1String("wait")).toInt() <= 0)
+        return false;
+
+    m_isResultDeferred = true;
+    return true;
+}
+
+void APIController::setResumeParams(const StringMap &params)
+{
+    m_resumeParams = params;
+}
@@ -28,17 +28,31 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+
 #include <QMap>
 #include <QObject>
 #include <QSet>
 #include <QVariant>
 
+#include "serialize/datawriter.h"
+
 class QString;
 
 struct ISessionManager;
 using StringMap = QMap<QString, QString>;
 using DataMap = QMap<QString, QByteArray>;
 
+// A result written piece by piece, so a large one isn't held in memory at once
+struct StreamedResult
+{
+    std::shared_ptr<DataWriter> writer;
+    // Writes the next piece of the result, returns false once the result is complete.
+    // It keeps its own position, so only one copy of the result should be written.
+    std::function<bool (DataWriter &writer)> writeNext;
+};
+
 class APIController : public QObject
 {
     Q_OBJECT
@@ -52,10 +66,18 @@ class APIController : public QObject
 public:
     explicit APIController(ISessionManager *sessionManager, QObject *parent = nullptr);
 
-    QVariant run(const QString &action, const StringMap &params, const DataMap &data = {});
+    // the results written with a result writer are encoded in the given format
+    QVariant run(const QString &action, const StringMap &params, const DataMap &data = {}, DataFormat format = DataFormat::JSON);
 
     ISessionManager *sessionManager() const;
 
+    // whether the last action had nothing to report and the client is willing to wait
+    bool isResultDeferred() const;
+    // the parameters the last action should be called with to get the changes made after its result
+    const StringMap &resumeParams() const;
+    // the result of the last action if it is written piece by piece, it has no writer otherwise
+    StreamedResult takeStreamedResult();
+
 protected:
     const StringMap &params() const;
     const DataMap &data() const;
@@ -64,10 +86,25 @@ protected:
     void setResult(const QString &result);
     void setResult(const QJsonArray &result);
     void setResult(const QJsonObject &result);
+    // creates a writer for the data format the client has asked for
+    std::unique_ptr<DataWriter> createResultWriter(int reserveSize = 0) const;
+    // the result is stored as raw data in the requested format
+    void setResult(const DataWriter &result);
+    // the result is written with `writeNext` while it is being sent, the writer may already hold its beginning
+    void setResult(std::unique_ptr<DataWriter> writer, const std::function<bool (DataWriter &writer)> &writeNext);
+
+    // Returns false if the client doesn't wait for changes ("wait" parameter),
+    // the action has to respond right away then
+    bool deferResult();
+    void setResumeParams(const StringMap &params);
 
 private:
     ISessionManager *m_sessionManager;
     StringMap m_params;
     DataMap m_data;
     QVariant m_result;
+    DataFormat m_format = DataFormat::JSON;
+    bool m_isResultDeferred = false;
+    StringMap m_resumeParams;
+    StreamedResult m_streamedResult;
 };
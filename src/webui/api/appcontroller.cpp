@@ -40,7 +40,10 @@
 #include <QTranslator>
 
 #include "base/bittorrent/session.h"
+#include "base/bittorrent/tracker.h"
 #include "base/global.h"
+#include "base/http/responsegenerator.h"
+#include "base/http/server.h"
 #include "base/net/portforwarder.h"
 #include "base/net/proxyconfigurationmanager.h"
 #include "base/preferences.h"
@@ -217,6 +220,7 @@ void AppController::preferencesAction()
     data["web_ui_address"] = pref->getWebUiAddress();
     data["web_ui_port"] = pref->getWebUiPort();
     data["web_ui_upnp"] = pref->useUPnPForWebUIPort();
+    data["web_ui_server_threads"] = pref->getWebUiServerThreads();
     data["use_https"] = pref->isWebUiHttpsEnabled();
     data["web_ui_https_cert_path"] = pref->getWebUIHttpsCertificatePath();
     data["web_ui_https_key_path"] = pref->getWebUIHttpsKeyPath();
@@ -518,6 +522,8 @@ void AppController::setPreferencesAction()
         pref->setWebUiPort(it.value().toUInt());
     if (hasKey("web_ui_upnp"))
         pref->setUPnPForWebUIPort(it.value().toBool());
+    if (hasKey("web_ui_server_threads"))
+        pref->setWebUiServerThreads(it.value().toInt());
     if (hasKey("use_https"))
         pref->setWebUiHttpsEnabled(it.value().toBool());
     if (hasKey("web_ui_https_cert_path"))
@@ -578,3 +584,74 @@ void AppController::defaultSavePathAction()
 {
     setResult(BitTorrent::Session::instance()->defaultSavePath());
 }
+
+// Returns the statistics of the HTTP servers (Web UI and embedded tracker) and of the tracker in JSON format.
+// The return value is a dictionary of dictionaries.
+// The "requests" dictionary keys are:
+//   - "count": number of processed requests
+//   - "total_queue_time": time the requests waited to be processed, in microseconds
+//   - "total_processing_time": time spent processing the requests, in microseconds
+//   - "max_processing_time": longest time spent processing a request, in microseconds
+// The "compression" dictionary keys are:
+//   - "count": number of compressed responses
+//   - "cache_hits": number of responses compressed earlier and taken from the cache
+//   - "input_bytes": size of the compressed responses before compression
+//   - "output_bytes": size of the compressed responses after compression
+//   - "ratio": "output_bytes" relative to "input_bytes"
+//   - "total_time": time spent compressing, in microseconds
+// The "tracker" dictionary is null when the embedded tracker isn't running, its keys are:
+//   - "torrents", "peers": number of tracked torrents and peers
+//   - "announces", "udp_announces": number of announces over HTTP and UDP
+//   - "scrapes", "udp_scrapes": number of scrapes over HTTP and UDP
+//   - "udp_connects": number of UDP connection requests
+//   - "invalid_requests": number of rejected requests
+//   - "expired_peers": number of peers dropped for not announcing in time
+void AppController::httpStatsAction()
+{
+    const Http::RequestStatistics requestStats = Http::requestStatistics();
+    const Http::CompressionStatistics compressionStats = Http::compressionStatistics();
+
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginObject();
+
+    result->writeKey("requests");
+    result->beginObject();
+    result->writeMember("count", requestStats.requestCount);
+    result->writeMember("total_queue_time", requestStats.totalQueueTime);
+    result->writeMember("total_processing_time", requestStats.totalProcessingTime);
+    result->writeMember("max_processing_time", requestStats.maxProcessingTime);
+    result->endObject();
+
+    result->writeKey("compression");
+    result->beginObject();
+    result->writeMember("count", compressionStats.compressedCount);
+    result->writeMember("cache_hits", compressionStats.cacheHits);
+    result->writeMember("input_bytes", compressionStats.inputBytes);
+    result->writeMember("output_bytes", compressionStats.outputBytes);
+    result->writeMember("ratio", ((compressionStats.inputBytes > 0)
+        ? (static_cast<double>(compressionStats.outputBytes) / compressionStats.inputBytes) : 1.0));
+    result->writeMember("total_time", compressionStats.totalTime);
+    result->endObject();
+
+    result->writeKey("tracker");
+    BitTorrent::TrackerStatistics trackerStats;
+    if (BitTorrent::Session::instance()->trackerStatistics(trackerStats)) {
+        result->beginObject();
+        result->writeMember("torrents", trackerStats.torrentCount);
+        result->writeMember("peers", trackerStats.peerCount);
+        result->writeMember("announces", trackerStats.announceCount);
+        result->writeMember("udp_announces", trackerStats.udpAnnounceCount);
+        result->writeMember("scrapes", trackerStats.scrapeCount);
+        result->writeMember("udp_scrapes", trackerStats.udpScrapeCount);
+        result->writeMember("udp_connects", trackerStats.udpConnectCount);
+        result->writeMember("invalid_requests", trackerStats.invalidRequestCount);
+        result->writeMember("expired_peers", trackerStats.expiredPeerCount);
+        result->endObject();
+    }
+    else {
+        result->writeNull();
+    }
+
+    result->endObject();
+    setResult(*result);
+}
@@ -48,4 +48,5 @@ private slots:
     void preferencesAction();
     void setPreferencesAction();
     void defaultSavePathAction();
+    void httpStatsAction();
 };
@@ -38,6 +38,9 @@ struct ISession
     virtual QString id() const = 0;
     virtual QVariant getData(const QString &id) const = 0;
     virtual void setData(const QString &id, const QVariant &data) = 0;
+    // The data is dropped when the sessions use too much memory, so it must be possible to rebuild it
+    // (e.g. the state of a sync, which is then fully updated). `size` is estimated when not given.
+    virtual void setCachedData(const QString &id, const QVariant &data, qint64 size = -1) = 0;
 
     template <class T>
     T getData(const QString &id) const {
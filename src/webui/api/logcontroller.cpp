@@ -28,11 +28,12 @@
 
 #include "logcontroller.h"
 
-#include <QJsonArray>
+#include <memory>
 
 #include "base/global.h"
 #include "base/logger.h"
 #include "base/utils/string.h"
+#include "serialize/datawriter.h"
 
 const char KEY_LOG_ID[] = "id";
 const char KEY_LOG_TIMESTAMP[] = "timestamp";
@@ -54,39 +55,54 @@ const char KEY_LOG_PEER_REASON[] = "reason";
 //   - info (bool): include info messages (default true)
 //   - warning (bool): include warning messages (default true)
 //   - critical (bool): include critical messages (default true)
+//   - filter (string): include only the messages containing this text, case insensitive (optional)
+//   - min_timestamp (int): exclude messages older than this, milliseconds since epoch (optional)
+//   - max_timestamp (int): exclude messages newer than this, milliseconds since epoch (optional)
 //   - last_known_id (int): exclude messages with id <= 'last_known_id' (default -1)
+//   - wait (int): seconds to wait for new messages if there are none (optional)
 void LogController::mainAction()
 {
     using Utils::String::parseBool;
 
-    const bool isNormal = parseBool(params()["normal"], true);
-    const bool isInfo = parseBool(params()["info"], true);
-    const bool isWarning = parseBool(params()["warning"], true);
-    const bool isCritical = parseBool(params()["critical"], true);
+    Log::MsgFilter filter;
+    filter.types = Log::MsgTypes();
+    if (parseBool(params()["normal"], true))
+        filter.types |= Log::NORMAL;
+    if (parseBool(params()["info"], true))
+        filter.types |= Log::INFO;
+    if (parseBool(params()["warning"], true))
+        filter.types |= Log::WARNING;
+    if (parseBool(params()["critical"], true))
+        filter.types |= Log::CRITICAL;
+    filter.text = params()["filter"];
+    filter.minTimestamp = params()["min_timestamp"].toLongLong();
+    filter.maxTimestamp = params()["max_timestamp"].toLongLong();
 
     bool ok = false;
-    int lastKnownId = params()["last_known_id"].toInt(&ok);
+    filter.lastKnownId = params()["last_known_id"].toInt(&ok);
     if (!ok)
-        lastKnownId = -1;
+        filter.lastKnownId = -1;
 
-    Logger *const logger = Logger::instance();
-    QVariantList msgList;
+    // the filtered out messages don't need to be looked at again
+    int lastKnownId = filter.lastKnownId;
+    const QVector<Log::Msg> messages = Logger::instance()->getMessages(filter, &lastKnownId);
+    if (messages.isEmpty() && deferResult())
+        return;
 
-    for (const Log::Msg &msg : asConst(logger->getMessages(lastKnownId))) {
-        if (!((msg.type == Log::NORMAL && isNormal)
-              || (msg.type == Log::INFO && isInfo)
-              || (msg.type == Log::WARNING && isWarning)
-              || (msg.type == Log::CRITICAL && isCritical)))
-            continue;
-        QVariantMap map;
-        map[KEY_LOG_ID] = msg.id;
-        map[KEY_LOG_TIMESTAMP] = msg.timestamp;
-        map[KEY_LOG_MSG_TYPE] = msg.type;
-        map[KEY_LOG_MSG_MESSAGE] = msg.message;
-        msgList.append(map);
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginArray();
+    for (const Log::Msg &msg : messages) {
+        result->beginObject();
+        result->writeMember(KEY_LOG_ID, msg.id);
+        result->writeMember(KEY_LOG_TIMESTAMP, msg.timestamp);
+        result->writeMember(KEY_LOG_MSG_TYPE, static_cast<int>(msg.type));
+        result->writeMember(KEY_LOG_MSG_MESSAGE, msg.message);
+        result->endObject();
     }
+    result->endArray();
 
-    setResult(QJsonArray::fromVariantList(msgList));
+    setResult(*result);
+    setResumeParams({{QLatin1String("last_known_id"), QString::number(lastKnownId)}});
 }
 
 // Returns the peer log in JSON format.
@@ -99,6 +115,7 @@ void LogController::mainAction()
 //   - "reason": reason of the block
 // GET params:
 //   - last_known_id (int): exclude messages with id <= 'last_known_id' (default -1)
+//   - wait (int): seconds to wait for new messages if there are none (optional)
 void LogController::peersAction()
 {
     int lastKnownId;
@@ -109,17 +126,25 @@ void LogController::peersAction()
         lastKnownId = -1;
 
     Logger *const logger = Logger::instance();
-    QVariantList peerList;
+    const QVector<Log::Peer> peers = logger->getPeers(lastKnownId);
+    if (peers.isEmpty() && deferResult())
+        return;
 
-    for (const Log::Peer &peer : asConst(logger->getPeers(lastKnownId))) {
-        QVariantMap map;
-        map[KEY_LOG_ID] = peer.id;
-        map[KEY_LOG_TIMESTAMP] = peer.timestamp;
-        map[KEY_LOG_PEER_IP] = peer.ip;
-        map[KEY_LOG_PEER_BLOCKED] = peer.blocked;
-        map[KEY_LOG_PEER_REASON] = peer.reason;
-        peerList.append(map);
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginArray();
+    for (const Log::Peer &peer : peers) {
+        result->beginObject();
+        result->writeMember(KEY_LOG_ID, peer.id);
+        result->writeMember(KEY_LOG_TIMESTAMP, peer.timestamp);
+        result->writeMember(KEY_LOG_PEER_IP, peer.ip);
+        result->writeMember(KEY_LOG_PEER_BLOCKED, peer.blocked);
+        result->writeMember(KEY_LOG_PEER_REASON, peer.reason);
+        result->endObject();
     }
+    result->endArray();
 
-    setResult(QJsonArray::fromVariantList(peerList));
+    setResult(*result);
+    if (!peers.isEmpty())
+        lastKnownId = peers.last().id;
+    setResumeParams({{QLatin1String("last_known_id"), QString::number(lastKnownId)}});
 }
@@ -28,6 +28,10 @@
 
 #include "searchcontroller.h"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QSharedPointer>
@@ -35,6 +39,8 @@
 #include "base/global.h"
 #include "base/logger.h"
 #include "base/search/searchhandler.h"
+#include "base/search/searchresultfilter.h"
+#include "base/search/searchresultindex.h"
 #include "base/utils/foreignapps.h"
 #include "base/utils/random.h"
 #include "base/utils/string.h"
@@ -147,6 +153,15 @@ void SearchController::statusAction()
     setResult(statusArray);
 }
 
+// GET params:
+//   - id (int): search id
+//   - filter (string): words the file name has to contain, a quoted pattern is matched as a whole
+//   - minSize, maxSize, minSeeds, maxSeeds, minLeeches, maxLeeches (int): inclusive ranges, non-positive maximum means unlimited
+//   - sort (string): fields to sort by separated by comma, prefixed with "-" for descending order,
+//       ex. "-nbSeeders,fileName". The fields are: fileName, fileSize, nbSeeders, nbLeechers, siteUrl
+//   - cursor (int): "cursor" of the previous page, the results ordered after it are returned
+//   - limit (int): number of results to return (if greater than 0, otherwise - unlimited)
+//   - offset (int): set offset (if less than 0 - offset from end)
 void SearchController::resultsAction()
 {
     checkParams({"id"});
@@ -159,9 +174,44 @@ void SearchController::resultsAction()
     if (!searchHandlers.contains(id))
         throw APIError(APIErrorType::NotFound);
 
+    SearchResultFilter filter;
+    filter.setNamePattern(params()["filter"].trimmed());
+    filter.setSizeRange(params()["minSize"].toLongLong(), params()["maxSize"].toLongLong());
+    filter.setSeedsRange(params()["minSeeds"].toLongLong(), params()["maxSeeds"].toLongLong());
+    filter.setLeechesRange(params()["minLeeches"].toLongLong(), params()["maxLeeches"].toLongLong());
+
+    QVector<SearchResultSortKey> sortKeys;
+    for (QString field : asConst(params()["sort"].split(',', QString::SkipEmptyParts))) {
+        field = field.trimmed();
+        const bool descending = field.startsWith('-');
+        if (descending)
+            field.remove(0, 1);
+
+        if (field == QLatin1String("fileName"))
+            sortKeys.append({SearchResultField::FileName, descending});
+        else if (field == QLatin1String("fileSize"))
+            sortKeys.append({SearchResultField::FileSize, descending});
+        else if (field == QLatin1String("nbSeeders"))
+            sortKeys.append({SearchResultField::NbSeeders, descending});
+        else if (field == QLatin1String("nbLeechers"))
+            sortKeys.append({SearchResultField::NbLeechers, descending});
+        else if (field == QLatin1String("siteUrl"))
+            sortKeys.append({SearchResultField::SiteUrl, descending});
+        else
+            throw APIError(APIErrorType::BadParams, tr("Unknown sort field \"%1\"").arg(field));
+    }
+
+    bool isCursorValid = false;
+    const int cursor = params()["cursor"].toInt(&isCursorValid);
+
     const SearchHandlerPtr searchHandler = searchHandlers[id];
-    const QList<SearchResult> searchResults = searchHandler->results();
-    const int size = searchResults.size();
+    const SearchResultIndex &resultIndex = searchHandler->resultIndex();
+    // an offset from the end needs all the matching rows
+    const int findLimit = ((offset >= 0) && (limit > 0))
+        ? static_cast<int>(std::min<qint64>((static_cast<qint64>(offset) + limit), std::numeric_limits<int>::max()))
+        : -1;
+    const QVector<int> rows = resultIndex.find(filter, sortKeys, (isCursorValid ? cursor : -1), findLimit);
+    const int size = rows.size();
 
     if (offset > size)
         throw APIError(APIErrorType::Conflict, tr("Offset is out of range"));
@@ -174,10 +224,7 @@ void SearchController::resultsAction()
     if (limit <= 0)
         limit = -1;
 
-    if ((limit > 0) || (offset > 0))
-        setResult(getResults(searchResults.mid(offset, limit), searchHandler->isActive(), size));
-    else
-        setResult(getResults(searchResults, searchHandler->isActive(), size));
+    getResults(searchHandler, rows, offset, limit, resultIndex.count(filter));
 }
 
 void SearchController::deleteAction()
@@ -300,9 +347,10 @@ int SearchController::generateSearchId() const
 }
 
 /**
- * Returns the search results in JSON format.
+ * Sets the search results as the result of the action, they are written a few at a time while being sent.
  *
- * The return value is an object with a status and an array of dictionaries.
+ * The result is an object with a status, a paging cursor, the number of all the results ("total"),
+ * the number of the results matching the filter ("total_matching") and an array of dictionaries.
  * The dictionary keys are:
  *   - "fileName"
  *   - "fileUrl"
@@ -312,28 +360,52 @@ int SearchController::generateSearchId() const
  *   - "siteUrl"
  *   - "descrLink"
  */
-QJsonObject SearchController::getResults(const QList<SearchResult> &searchResults, const bool isSearchActive, const int totalResults) const
+void SearchController::getResults(const QSharedPointer<SearchHandler> &searchHandler, const QVector<int> &rows
+                                  , const int offset, const int limit, const int matchCount)
 {
-    QJsonArray searchResultsArray;
-    for (const SearchResult &searchResult : searchResults) {
-        searchResultsArray << QJsonObject {
-            {"fileName", searchResult.fileName},
-            {"fileUrl", searchResult.fileUrl},
-            {"fileSize", searchResult.fileSize},
-            {"nbSeeders", searchResult.nbSeeders},
-            {"nbLeechers", searchResult.nbLeechers},
-            {"siteUrl", searchResult.siteUrl},
-            {"descrLink", searchResult.descrLink}
-        };
-    }
+    const int end = (limit > 0)
+        ? static_cast<int>(std::min<qint64>((static_cast<qint64>(offset) + limit), rows.size()))
+        : rows.size();
+    // the status matches the rows found, even if the search ends while they are being sent
+    const bool isSearchActive = searchHandler->isActive();
+    const int total = searchHandler->resultIndex().size();
+
+    std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginObject();
 
-    const QJsonObject result = {
-        {"status", isSearchActive ? "Running" : "Stopped"},
-        {"results", searchResultsArray},
-        {"total", totalResults}
-    };
+    // the next page starts after the last result of this one, even if new results arrive meanwhile
+    if (offset < end)
+        result->writeMember("cursor", rows[end - 1]);
 
-    return result;
+    result->writeKey("results");
+    result->beginArray();
+
+    // the results are only appended to, so the rows stay valid while they are being sent
+    setResult(std::move(result), [searchHandler, rows, i = offset, end, isSearchActive, total, matchCount](DataWriter &writer) mutable -> bool
+    {
+        if (i < end) {
+            const SearchResult &searchResult = searchHandler->resultIndex().results()[rows[i++]];
+            writer.beginObject();
+            writer.writeMember("descrLink", searchResult.descrLink);
+            writer.writeMember("fileName", searchResult.fileName);
+            writer.writeMember("fileSize", searchResult.fileSize);
+            writer.writeMember("fileUrl", searchResult.fileUrl);
+            writer.writeMember("nbLeechers", searchResult.nbLeechers);
+            writer.writeMember("nbSeeders", searchResult.nbSeeders);
+            writer.writeMember("siteUrl", searchResult.siteUrl);
+            writer.endObject();
+            return true;
+        }
+
+        writer.endArray();
+
+        writer.writeMember("status", (isSearchActive ? "Running" : "Stopped"));
+        writer.writeMember("total", total);
+        writer.writeMember("total_matching", matchCount);
+
+        writer.endObject();
+        return false;
+    });
 }
 
 /**
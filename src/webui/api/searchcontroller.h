@@ -30,6 +30,8 @@
 
 #include <QHash>
 #include <QList>
+#include <QSharedPointer>
+#include <QVector>
 
 #include "base/search/searchpluginmanager.h"
 #include "apicontroller.h"
@@ -40,6 +42,7 @@ class QStringList;
 
 struct ISession;
 struct SearchResult;
+class SearchHandler;
 
 class SearchController : public APIController
 {
@@ -70,6 +73,7 @@ private:
     void searchFinished(ISession *session, int id);
     void searchFailed(ISession *session, int id);
     int generateSearchId() const;
-    QJsonObject getResults(const QList<SearchResult> &searchResults, bool isSearchActive, int totalResults) const;
+    void getResults(const QSharedPointer<SearchHandler> &searchHandler, const QVector<int> &rows
+                    , int offset, int limit, int matchCount);
     QJsonArray getPluginsInfo(const QStringList &plugins) const;
 };
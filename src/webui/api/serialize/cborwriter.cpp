@@ -0,0 +1,200 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "cborwriter.h"
+
+#include <cstring>
+
+#include <QtEndian>
+#include <QtGlobal>
+
+namespace
+{
+    enum MajorType : quint8
+    {
+        UnsignedInteger = 0,
+        NegativeInteger = 1,
+        TextString = 3
+    };
+
+    const char INDEFINITE_ARRAY = '\x9f';
+    const char INDEFINITE_MAP = '\xbf';
+    const char BREAK = '\xff';
+    const char FALSE_VALUE = '\xf4';
+    const char TRUE_VALUE = '\xf5';
+    const char NULL_VALUE = '\xf6';
+    const char FLOAT32 = '\xfa';
+    const char FLOAT64 = '\xfb';
+
+    template <typename T>
+    void appendBigEndian(QByteArray &buffer, const T value)
+    {
+        char bytes[sizeof(T)];
+        qToBigEndian(value, bytes);
+        buffer.append(bytes, sizeof(T));
+    }
+}
+
+CborWriter::CborWriter(const int reserveSize)
+{
+    if (reserveSize > 0)
+        m_buffer.reserve(reserveSize);
+}
+
+void CborWriter::beginObject()
+{
+    m_buffer.append(INDEFINITE_MAP);
+    ++m_depth;
+}
+
+void CborWriter::endObject()
+{
+    Q_ASSERT(m_depth > 0);
+
+    m_buffer.append(BREAK);
+    --m_depth;
+}
+
+void CborWriter::beginArray()
+{
+    m_buffer.append(INDEFINITE_ARRAY);
+    ++m_depth;
+}
+
+void CborWriter::endArray()
+{
+    Q_ASSERT(m_depth > 0);
+
+    m_buffer.append(BREAK);
+    --m_depth;
+}
+
+void CborWriter::writeNull()
+{
+    m_buffer.append(NULL_VALUE);
+}
+
+void CborWriter::writeValue(const bool value)
+{
+    m_buffer.append(value ? TRUE_VALUE : FALSE_VALUE);
+}
+
+void CborWriter::writeValue(const qint64 value)
+{
+    // negative integers are encoded as (-1 - value)
+    if (value < 0)
+        writeHead(NegativeInteger, static_cast<quint64>(-1 - value));
+    else
+        writeHead(UnsignedInteger, static_cast<quint64>(value));
+}
+
+void CborWriter::writeValue(const quint64 value)
+{
+    writeHead(UnsignedInteger, value);
+}
+
+void CborWriter::writeValue(const double value)
+{
+    // written as null like in JSON, so the clients get the same values in both formats
+    if (!qIsFinite(value)) {
+        writeNull();
+        return;
+    }
+
+    // Use single precision when it doesn't lose anything, most of
+    // the API values (ratios, progress, availability) fit into it.
+    const float floatValue = static_cast<float>(value);
+    if (static_cast<double>(floatValue) == value) {
+        quint32 bits;
+        std::memcpy(&bits, &floatValue, sizeof(bits));
+        m_buffer.append(FLOAT32);
+        appendBigEndian(m_buffer, bits);
+    }
+    else {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        m_buffer.append(FLOAT64);
+        appendBigEndian(m_buffer, bits);
+    }
+}
+
+QByteArray CborWriter::data() const
+{
+    Q_ASSERT(m_depth == 0);
+
+    return m_buffer;
+}
+
+int CborWriter::size() const
+{
+    return m_buffer.size();
+}
+
+QByteArray CborWriter::takeData()
+{
+    QByteArray data;
+    data.swap(m_buffer);
+    return data;
+}
+
+void CborWriter::writeKeyData(const QByteArray &utf8)
+{
+    Q_ASSERT(m_depth > 0);
+
+    writeStringData(utf8);
+}
+
+void CborWriter::writeStringData(const QByteArray &utf8)
+{
+    writeHead(TextString, static_cast<quint64>(utf8.size()));
+    m_buffer.append(utf8);
+}
+
+void CborWriter::writeHead(const quint8 majorType, const quint64 value)
+{
+    const char type = static_cast<char>(majorType << 5);
+    if (value < 24) {
+        m_buffer.append(static_cast<char>(type | static_cast<char>(value)));
+    }
+    else if (value <= 0xFF) {
+        m_buffer.append(static_cast<char>(type | 24));
+        m_buffer.append(static_cast<char>(value));
+    }
+    else if (value <= 0xFFFF) {
+        m_buffer.append(static_cast<char>(type | 25));
+        appendBigEndian(m_buffer, static_cast<quint16>(value));
+    }
+    else if (value <= 0xFFFFFFFF) {
+        m_buffer.append(static_cast<char>(type | 26));
+        appendBigEndian(m_buffer, static_cast<quint32>(value));
+    }
+    else {
+        m_buffer.append(static_cast<char>(type | 27));
+        appendBigEndian(m_buffer, value);
+    }
+}
@@ -1,6 +1,6 @@
 /*
  * Bittorrent Client using Qt and libtorrent.
- * Copyright (C) 2015, 2018  Vladimir Golovnev <glassez@yandex.ru>
+ * Copyright (C) 2019  qBittorrent project
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU General Public License
@@ -26,36 +26,43 @@
  * exception statement from your version.
  */
 
-#include "resumedatasavingmanager.h"
+#pragma once
 
 #include <QByteArray>
-#include <QSaveFile>
 
-#include "base/logger.h"
-#include "base/utils/fs.h"
+#include "datawriter.h"
 
-ResumeDataSavingManager::ResumeDataSavingManager(const QString &resumeFolderPath)
-    : m_resumeDataDir(resumeFolderPath)
+// Writes CBOR (RFC 7049) directly into a byte buffer.
+// Objects and arrays are written as indefinite-length items,
+// so their size doesn't need to be known in advance.
+class CborWriter final : public DataWriter
 {
-}
+public:
+    explicit CborWriter(int reserveSize = 0);
 
-void ResumeDataSavingManager::save(const QString &filename, const QByteArray &data) const
-{
-    const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
-
-    QSaveFile file {filepath};
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(data);
-        if (!file.commit()) {
-            Logger::instance()->addMessage(QString("Couldn't save data in '%1'. Error: %2")
-                                           .arg(filepath, file.errorString()), Log::WARNING);
-        }
-    }
-}
-
-void ResumeDataSavingManager::remove(const QString &filename) const
-{
-    const QString filepath = m_resumeDataDir.absoluteFilePath(filename);
+    using DataWriter::writeValue;
+
+    void beginObject() override;
+    void endObject() override;
+    void beginArray() override;
+    void endArray() override;
+
+    void writeNull() override;
+    void writeValue(bool value) override;
+    void writeValue(qint64 value) override;
+    void writeValue(quint64 value) override;
+    void writeValue(double value) override;
+
+    QByteArray data() const override;
+    int size() const override;
+    QByteArray takeData() override;
+
+private:
+    void writeKeyData(const QByteArray &utf8) override;
+    void writeStringData(const QByteArray &utf8) override;
+
+    void writeHead(quint8 majorType, quint64 value);
 
-    Utils::Fs::forceRemove(filepath);
-}
+    QByteArray m_buffer;
+    int m_depth = 0;
+};
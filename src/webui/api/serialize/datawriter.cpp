@@ -0,0 +1,227 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "datawriter.h"
+
+#include <cmath>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+
+#include "cborwriter.h"
+#include "jsonwriter.h"
+
+std::unique_ptr<DataWriter> DataWriter::create(const DataFormat format, const int reserveSize)
+{
+    switch (format) {
+    case DataFormat::CBOR:
+        return std::unique_ptr<DataWriter>(new CborWriter(reserveSize));
+    case DataFormat::JSON:
+    default:
+        return std::unique_ptr<DataWriter>(new JsonWriter(reserveSize));
+    }
+}
+
+void DataWriter::writeKey(const char *key)
+{
+    writeKeyData(QByteArray(key));
+}
+
+void DataWriter::writeKey(const QString &key)
+{
+    writeKeyData(key.toUtf8());
+}
+
+void DataWriter::writeValue(const int value)
+{
+    writeValue(static_cast<qint64>(value));
+}
+
+void DataWriter::writeValue(const uint value)
+{
+    writeValue(static_cast<quint64>(value));
+}
+
+void DataWriter::writeValue(const char *value)
+{
+    writeStringData(QByteArray(value));
+}
+
+void DataWriter::writeValue(const QString &value)
+{
+    writeStringData(value.toUtf8());
+}
+
+void DataWriter::writeValue(const QStringList &value)
+{
+    beginArray();
+    for (const QString &item : value)
+        writeValue(item);
+    endArray();
+}
+
+void DataWriter::writeValue(const QVariantList &value)
+{
+    beginArray();
+    for (const QVariant &item : value)
+        writeValue(item);
+    endArray();
+}
+
+void DataWriter::writeValue(const QVariantMap &value)
+{
+    beginObject();
+    for (auto it = value.cbegin(); it != value.cend(); ++it) {
+        writeKey(it.key());
+        writeValue(it.value());
+    }
+    endObject();
+}
+
+void DataWriter::writeValue(const QVariantHash &value)
+{
+    beginObject();
+    for (auto it = value.cbegin(); it != value.cend(); ++it) {
+        writeKey(it.key());
+        writeValue(it.value());
+    }
+    endObject();
+}
+
+void DataWriter::writeValue(const QVariant &value)
+{
+    switch (static_cast<QMetaType::Type>(value.userType())) {
+    case QMetaType::UnknownType:
+        writeNull();
+        break;
+    case QMetaType::Bool:
+        writeValue(value.toBool());
+        break;
+    case QMetaType::Int:
+        writeValue(value.toInt());
+        break;
+    case QMetaType::UInt:
+        writeValue(value.toUInt());
+        break;
+    case QMetaType::LongLong:
+        writeValue(value.toLongLong());
+        break;
+    case QMetaType::ULongLong:
+        writeValue(value.toULongLong());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        writeValue(value.toDouble());
+        break;
+    case QMetaType::QString:
+        writeValue(value.toString());
+        break;
+    case QMetaType::QStringList:
+        writeValue(value.toStringList());
+        break;
+    case QMetaType::QVariantList:
+        writeValue(value.toList());
+        break;
+    case QMetaType::QVariantMap:
+        writeValue(value.toMap());
+        break;
+    case QMetaType::QVariantHash:
+        writeValue(value.toHash());
+        break;
+    default:
+        if (value.canConvert<QString>())
+            writeValue(value.toString());
+        else
+            writeNull();
+        break;
+    }
+}
+
+void DataWriter::writeValue(const QJsonValue &value)
+{
+    // the largest integer a double holds exactly
+    const double maxExactInteger = 9007199254740992.0;
+
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        writeValue(value.toBool());
+        break;
+    case QJsonValue::Double: {
+            const double number = value.toDouble();
+            if ((std::trunc(number) == number) && (std::fabs(number) <= maxExactInteger))
+                writeValue(static_cast<qint64>(number));
+            else
+                writeValue(number);
+        }
+        break;
+    case QJsonValue::String:
+        writeValue(value.toString());
+        break;
+    case QJsonValue::Array:
+        writeValue(value.toArray());
+        break;
+    case QJsonValue::Object:
+        writeValue(value.toObject());
+        break;
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+    default:
+        writeNull();
+        break;
+    }
+}
+
+void DataWriter::writeValue(const QJsonArray &value)
+{
+    beginArray();
+    for (const QJsonValue &item : value)
+        writeValue(item);
+    endArray();
+}
+
+void DataWriter::writeValue(const QJsonObject &value)
+{
+    beginObject();
+    for (auto it = value.constBegin(); it != value.constEnd(); ++it) {
+        writeKey(it.key());
+        writeValue(it.value());
+    }
+    endObject();
+}
+
+void DataWriter::writeValue(const QJsonDocument &value)
+{
+    if (value.isArray())
+        writeValue(value.array());
+    else if (value.isObject())
+        writeValue(value.object());
+    else
+        writeNull();
+}
@@ -0,0 +1,103 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+class QJsonArray;
+class QJsonDocument;
+class QJsonObject;
+class QJsonValue;
+
+enum class DataFormat
+{
+    JSON,
+    CBOR
+};
+
+// Writes API results directly into a byte buffer, in the format the client has asked for.
+// It allows to serialize large API results without building
+// the intermediate QJsonObject/QJsonArray trees and the JSON document.
+class DataWriter
+{
+public:
+    virtual ~DataWriter() = default;
+
+    static std::unique_ptr<DataWriter> create(DataFormat format, int reserveSize = 0);
+
+    virtual void beginObject() = 0;
+    virtual void endObject() = 0;
+    virtual void beginArray() = 0;
+    virtual void endArray() = 0;
+
+    void writeKey(const char *key);
+    void writeKey(const QString &key);
+
+    virtual void writeNull() = 0;
+    virtual void writeValue(bool value) = 0;
+    void writeValue(int value);
+    void writeValue(uint value);
+    virtual void writeValue(qint64 value) = 0;
+    virtual void writeValue(quint64 value) = 0;
+    virtual void writeValue(double value) = 0;
+    void writeValue(const char *value);
+    void writeValue(const QString &value);
+    void writeValue(const QStringList &value);
+    void writeValue(const QVariantList &value);
+    void writeValue(const QVariantMap &value);
+    void writeValue(const QVariantHash &value);
+    void writeValue(const QVariant &value);
+    // JSON numbers without a fractional part are written as integers
+    void writeValue(const QJsonValue &value);
+    void writeValue(const QJsonArray &value);
+    void writeValue(const QJsonObject &value);
+    void writeValue(const QJsonDocument &value);
+
+    template <typename T>
+    void writeMember(const char *key, const T &value)
+    {
+        writeKey(key);
+        writeValue(value);
+    }
+
+    virtual QByteArray data() const = 0;
+    // The bytes written since the last takeData() call, a large result can be
+    // sent piece by piece while it is being written
+    virtual int size() const = 0;
+    virtual QByteArray takeData() = 0;
+
+protected:
+    virtual void writeKeyData(const QByteArray &utf8) = 0;
+    virtual void writeStringData(const QByteArray &utf8) = 0;
+};
@@ -0,0 +1,205 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "jsonwriter.h"
+
+#include <QLocale>
+#include <QtGlobal>
+
+namespace
+{
+    const char HEX_DIGITS[] = "0123456789abcdef";
+}
+
+JsonWriter::JsonWriter(const int reserveSize)
+{
+    if (reserveSize > 0)
+        m_buffer.reserve(reserveSize);
+}
+
+void JsonWriter::beginObject()
+{
+    beginValue();
+    m_buffer.append('{');
+    m_scopes.push_back(false);
+}
+
+void JsonWriter::endObject()
+{
+    Q_ASSERT(!m_scopes.empty() && !m_afterKey);
+
+    m_scopes.pop_back();
+    m_buffer.append('}');
+}
+
+void JsonWriter::beginArray()
+{
+    beginValue();
+    m_buffer.append('[');
+    m_scopes.push_back(false);
+}
+
+void JsonWriter::endArray()
+{
+    Q_ASSERT(!m_scopes.empty());
+
+    m_scopes.pop_back();
+    m_buffer.append(']');
+}
+
+void JsonWriter::writeNull()
+{
+    beginValue();
+    m_buffer.append("null");
+}
+
+void JsonWriter::writeValue(const bool value)
+{
+    beginValue();
+    m_buffer.append(value ? "true" : "false");
+}
+
+void JsonWriter::writeValue(const qint64 value)
+{
+    beginValue();
+    m_buffer.append(QByteArray::number(value));
+}
+
+void JsonWriter::writeValue(const quint64 value)
+{
+    beginValue();
+    m_buffer.append(QByteArray::number(value));
+}
+
+void JsonWriter::writeValue(const double value)
+{
+    beginValue();
+    // same as QJsonDocument does
+    if (qIsFinite(value))
+        m_buffer.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+    else
+        m_buffer.append("null");
+}
+
+void JsonWriter::writeStringData(const QByteArray &utf8)
+{
+    beginValue();
+    writeString(utf8);
+}
+
+QByteArray JsonWriter::data() const
+{
+    Q_ASSERT(m_scopes.empty());
+
+    return m_buffer;
+}
+
+int JsonWriter::size() const
+{
+    return m_buffer.size();
+}
+
+QByteArray JsonWriter::takeData()
+{
+    QByteArray data;
+    data.swap(m_buffer);
+    return data;
+}
+
+void JsonWriter::writeKeyData(const QByteArray &utf8)
+{
+    Q_ASSERT(!m_scopes.empty() && !m_afterKey);
+
+    beginValue();
+    writeString(utf8);
+    m_buffer.append(':');
+    m_afterKey = true;
+}
+
+void JsonWriter::beginValue()
+{
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+
+    if (m_scopes.empty())
+        return;
+
+    if (m_scopes.back())
+        m_buffer.append(',');
+    else
+        m_scopes.back() = true;
+}
+
+void JsonWriter::writeString(const QByteArray &utf8)
+{
+    m_buffer.append('"');
+
+    int unescapedStart = 0;
+    for (int i = 0; i < utf8.size(); ++i) {
+        const uchar c = static_cast<uchar>(utf8[i]);
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+
+        m_buffer.append((utf8.constData() + unescapedStart), (i - unescapedStart));
+        unescapedStart = i + 1;
+
+        switch (c) {
+        case '"':
+            m_buffer.append("\\\"");
+            break;
+        case '\\':
+            m_buffer.append("\\\\");
+            break;
+        case '\b':
+            m_buffer.append("\\b");
+            break;
+        case '\f':
+            m_buffer.append("\\f");
+            break;
+        case '\n':
+            m_buffer.append("\\n");
+            break;
+        case '\r':
+            m_buffer.append("\\r");
+            break;
+        case '\t':
+            m_buffer.append("\\t");
+            break;
+        default:
+            m_buffer.append("\\u00");
+            m_buffer.append(HEX_DIGITS[c >> 4]);
+            m_buffer.append(HEX_DIGITS[c & 0xF]);
+            break;
+        }
+    }
+    m_buffer.append((utf8.constData() + unescapedStart), (utf8.size() - unescapedStart));
+
+    m_buffer.append('"');
+}
@@ -33,109 +33,152 @@
 #include "base/bittorrent/torrenthandle.h"
 #include "base/utils/fs.h"
 
-namespace
+QString torrentStateToString(const BitTorrent::TorrentState state)
 {
-    QString torrentStateToString(const BitTorrent::TorrentState state)
-    {
-        switch (state) {
-        case BitTorrent::TorrentState::Error:
-            return QLatin1String("error");
-        case BitTorrent::TorrentState::MissingFiles:
-            return QLatin1String("missingFiles");
-        case BitTorrent::TorrentState::Uploading:
-            return QLatin1String("uploading");
-        case BitTorrent::TorrentState::PausedUploading:
-            return QLatin1String("pausedUP");
-        case BitTorrent::TorrentState::QueuedUploading:
-            return QLatin1String("queuedUP");
-        case BitTorrent::TorrentState::StalledUploading:
-            return QLatin1String("stalledUP");
-        case BitTorrent::TorrentState::CheckingUploading:
-            return QLatin1String("checkingUP");
-        case BitTorrent::TorrentState::ForcedUploading:
-            return QLatin1String("forcedUP");
-        case BitTorrent::TorrentState::Allocating:
-            return QLatin1String("allocating");
-        case BitTorrent::TorrentState::Downloading:
-            return QLatin1String("downloading");
-        case BitTorrent::TorrentState::DownloadingMetadata:
-            return QLatin1String("metaDL");
-        case BitTorrent::TorrentState::PausedDownloading:
-            return QLatin1String("pausedDL");
-        case BitTorrent::TorrentState::QueuedDownloading:
-            return QLatin1String("queuedDL");
-        case BitTorrent::TorrentState::StalledDownloading:
-            return QLatin1String("stalledDL");
-        case BitTorrent::TorrentState::CheckingDownloading:
-            return QLatin1String("checkingDL");
-        case BitTorrent::TorrentState::ForcedDownloading:
-            return QLatin1String("forcedDL");
-        case BitTorrent::TorrentState::CheckingResumeData:
-            return QLatin1String("checkingResumeData");
-        case BitTorrent::TorrentState::Moving:
-            return QLatin1String("moving");
-        default:
-            return QLatin1String("unknown");
-        }
+    switch (state) {
+    case BitTorrent::TorrentState::Error:
+        return QLatin1String("error");
+    case BitTorrent::TorrentState::MissingFiles:
+        return QLatin1String("missingFiles");
+    case BitTorrent::TorrentState::Uploading:
+        return QLatin1String("uploading");
+    case BitTorrent::TorrentState::PausedUploading:
+        return QLatin1String("pausedUP");
+    case BitTorrent::TorrentState::QueuedUploading:
+        return QLatin1String("queuedUP");
+    case BitTorrent::TorrentState::StalledUploading:
+        return QLatin1String("stalledUP");
+    case BitTorrent::TorrentState::CheckingUploading:
+        return QLatin1String("checkingUP");
+    case BitTorrent::TorrentState::ForcedUploading:
+        return QLatin1String("forcedUP");
+    case BitTorrent::TorrentState::Allocating:
+        return QLatin1String("allocating");
+    case BitTorrent::TorrentState::Downloading:
+        return QLatin1String("downloading");
+    case BitTorrent::TorrentState::DownloadingMetadata:
+        return QLatin1String("metaDL");
+    case BitTorrent::TorrentState::PausedDownloading:
+        return QLatin1String("pausedDL");
+    case BitTorrent::TorrentState::QueuedDownloading:
+        return QLatin1String("queuedDL");
+    case BitTorrent::TorrentState::StalledDownloading:
+        return QLatin1String("stalledDL");
+    case BitTorrent::TorrentState::CheckingDownloading:
+        return QLatin1String("checkingDL");
+    case BitTorrent::TorrentState::ForcedDownloading:
+        return QLatin1String("forcedDL");
+    case BitTorrent::TorrentState::CheckingResumeData:
+        return QLatin1String("checkingResumeData");
+    case BitTorrent::TorrentState::Moving:
+        return QLatin1String("moving");
+    default:
+        return QLatin1String("unknown");
     }
 }
 
+const QVector<TorrentNumberField> &torrentNumberFields()
+{
+    static const QVector<TorrentNumberField> fields {
+        {KEY_TORRENT_SIZE, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.wantedSize(); }, true, 0},
+        {KEY_TORRENT_DLSPEED, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.downloadPayloadRate(); }, false, 0},
+        {KEY_TORRENT_UPSPEED, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.uploadPayloadRate(); }, false, 0},
+        {KEY_TORRENT_PRIORITY, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.queuePosition(); }, true, 0},
+        {KEY_TORRENT_SEEDS, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.seedsCount(); }, false, 0},
+        {KEY_TORRENT_NUM_COMPLETE, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalSeedsCount(); }, false, 0},
+        {KEY_TORRENT_LEECHS, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.leechsCount(); }, false, 0},
+        {KEY_TORRENT_NUM_INCOMPLETE, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalLeechersCount(); }, false, 0},
+        {KEY_TORRENT_ETA, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.eta(); }, false, 0},
+        {KEY_TORRENT_SEQUENTIAL_DOWNLOAD, TorrentNumberType::Boolean, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.isSequentialDownload(); }, true, 0},
+        {KEY_TORRENT_FIRST_LAST_PIECE_PRIO, TorrentNumberType::OptionalBoolean, [](const BitTorrent::TorrentHandle &torrent) -> qint64
+            {
+                return (torrent.hasMetadata() ? torrent.hasFirstLastPiecePriority() : -1);
+            }, true, 0},
+        {KEY_TORRENT_SUPER_SEEDING, TorrentNumberType::Boolean, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.superSeeding(); }, true, 0},
+        {KEY_TORRENT_FORCE_START, TorrentNumberType::Boolean, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.isForced(); }, true, 0},
+        {KEY_TORRENT_ADDED_ON, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.addedTime().toTime_t(); }, true, 0},
+        {KEY_TORRENT_COMPLETION_ON, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.completedTime().toTime_t(); }, true, 0},
+        {KEY_TORRENT_DL_LIMIT, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.downloadLimit(); }, true, 0},
+        {KEY_TORRENT_UP_LIMIT, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.uploadLimit(); }, true, 0},
+        {KEY_TORRENT_AMOUNT_DOWNLOADED, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalDownload(); }, false, 0},
+        {KEY_TORRENT_AMOUNT_UPLOADED, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalUpload(); }, false, 0},
+        {KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalPayloadDownload(); }, false, 0},
+        {KEY_TORRENT_AMOUNT_UPLOADED_SESSION, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalPayloadUpload(); }, false, 0},
+        {KEY_TORRENT_AMOUNT_LEFT, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.incompletedSize(); }, false, 0},
+        {KEY_TORRENT_AMOUNT_COMPLETED, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.completedSize(); }, false, 0},
+        {KEY_TORRENT_MAX_SEEDING_TIME, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.maxSeedingTime(); }, true, 0},
+        {KEY_TORRENT_SEEDING_TIME_LIMIT, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.seedingTimeLimit(); }, true, 0},
+        {KEY_TORRENT_LAST_SEEN_COMPLETE_TIME, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.lastSeenComplete().toTime_t(); }, false, 0},
+        {KEY_TORRENT_AUTO_TORRENT_MANAGEMENT, TorrentNumberType::Boolean, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.isAutoTMMEnabled(); }, true, 0},
+        {KEY_TORRENT_TIME_ACTIVE, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.activeTime(); }, false, 0},
+        // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
+        // So we don't need unnecessary updates of last activity time in response.
+        {KEY_TORRENT_LAST_ACTIVITY_TIME, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64
+            {
+                if (torrent.isPaused() || torrent.isChecking())
+                    return 0;
+                return QDateTime::currentDateTime().addSecs(-torrent.timeSinceActivity()).toTime_t();
+            }, false, 15},
+        {KEY_TORRENT_TOTAL_SIZE, TorrentNumberType::Integer, [](const BitTorrent::TorrentHandle &torrent) -> qint64 { return torrent.totalSize(); }, true, 0}
+    };
+    return fields;
+}
+
+const QVector<TorrentRealField> &torrentRealFields()
+{
+    static const QVector<TorrentRealField> fields {
+        {KEY_TORRENT_PROGRESS, [](const BitTorrent::TorrentHandle &torrent) -> qreal { return torrent.progress(); }, false},
+        {KEY_TORRENT_RATIO, [](const BitTorrent::TorrentHandle &torrent) -> qreal
+            {
+                const qreal ratio = torrent.realRatio();
+                return ((ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio);
+            }, false},
+        {KEY_TORRENT_MAX_RATIO, [](const BitTorrent::TorrentHandle &torrent) -> qreal { return torrent.maxRatio(); }, true},
+        {KEY_TORRENT_RATIO_LIMIT, [](const BitTorrent::TorrentHandle &torrent) -> qreal { return torrent.ratioLimit(); }, true}
+    };
+    return fields;
+}
+
+const QVector<TorrentStringField> &torrentStringFields()
+{
+    static const QVector<TorrentStringField> fields {
+        {KEY_TORRENT_NAME, [](const BitTorrent::TorrentHandle &torrent) { return torrent.name(); }, true},
+        {KEY_TORRENT_MAGNET_URI, [](const BitTorrent::TorrentHandle &torrent) { return torrent.toMagnetUri(); }, true},
+        {KEY_TORRENT_STATE, [](const BitTorrent::TorrentHandle &torrent) { return torrentStateToString(torrent.state()); }, false},
+        {KEY_TORRENT_CATEGORY, [](const BitTorrent::TorrentHandle &torrent) { return torrent.category(); }, true},
+        {KEY_TORRENT_TAGS, [](const BitTorrent::TorrentHandle &torrent) { return torrent.tags().toList().join(", "); }, true},
+        {KEY_TORRENT_SAVE_PATH, [](const BitTorrent::TorrentHandle &torrent) { return Utils::Fs::toNativePath(torrent.savePath()); }, true},
+        {KEY_TORRENT_TRACKER, [](const BitTorrent::TorrentHandle &torrent) { return torrent.currentTracker(); }, false}
+    };
+    return fields;
+}
+
 QVariantMap serialize(const BitTorrent::TorrentHandle &torrent)
 {
     QVariantMap ret;
     ret[KEY_TORRENT_HASH] = QString(torrent.hash());
-    ret[KEY_TORRENT_NAME] = torrent.name();
-    ret[KEY_TORRENT_MAGNET_URI] = torrent.toMagnetUri();
-    ret[KEY_TORRENT_SIZE] = torrent.wantedSize();
-    ret[KEY_TORRENT_PROGRESS] = torrent.progress();
-    ret[KEY_TORRENT_DLSPEED] = torrent.downloadPayloadRate();
-    ret[KEY_TORRENT_UPSPEED] = torrent.uploadPayloadRate();
-    ret[KEY_TORRENT_PRIORITY] = static_cast<int>(torrent.queuePosition());
-    ret[KEY_TORRENT_SEEDS] = torrent.seedsCount();
-    ret[KEY_TORRENT_NUM_COMPLETE] = torrent.totalSeedsCount();
-    ret[KEY_TORRENT_LEECHS] = torrent.leechsCount();
-    ret[KEY_TORRENT_NUM_INCOMPLETE] = torrent.totalLeechersCount();
-    const qreal ratio = torrent.realRatio();
-    ret[KEY_TORRENT_RATIO] = (ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio;
-    ret[KEY_TORRENT_STATE] = torrentStateToString(torrent.state());
-    ret[KEY_TORRENT_ETA] = torrent.eta();
-    ret[KEY_TORRENT_SEQUENTIAL_DOWNLOAD] = torrent.isSequentialDownload();
-    if (torrent.hasMetadata())
-        ret[KEY_TORRENT_FIRST_LAST_PIECE_PRIO] = torrent.hasFirstLastPiecePriority();
-    ret[KEY_TORRENT_CATEGORY] = torrent.category();
-    ret[KEY_TORRENT_TAGS] = torrent.tags().toList().join(", ");
-    ret[KEY_TORRENT_SUPER_SEEDING] = torrent.superSeeding();
-    ret[KEY_TORRENT_FORCE_START] = torrent.isForced();
-    ret[KEY_TORRENT_SAVE_PATH] = Utils::Fs::toNativePath(torrent.savePath());
-    ret[KEY_TORRENT_ADDED_ON] = torrent.addedTime().toTime_t();
-    ret[KEY_TORRENT_COMPLETION_ON] = torrent.completedTime().toTime_t();
-    ret[KEY_TORRENT_TRACKER] = torrent.currentTracker();
-    ret[KEY_TORRENT_DL_LIMIT] = torrent.downloadLimit();
-    ret[KEY_TORRENT_UP_LIMIT] = torrent.uploadLimit();
-    ret[KEY_TORRENT_AMOUNT_DOWNLOADED] = torrent.totalDownload();
-    ret[KEY_TORRENT_AMOUNT_UPLOADED] = torrent.totalUpload();
-    ret[KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION] = torrent.totalPayloadDownload();
-    ret[KEY_TORRENT_AMOUNT_UPLOADED_SESSION] = torrent.totalPayloadUpload();
-    ret[KEY_TORRENT_AMOUNT_LEFT] = torrent.incompletedSize();
-    ret[KEY_TORRENT_AMOUNT_COMPLETED] = torrent.completedSize();
-    ret[KEY_TORRENT_MAX_RATIO] = torrent.maxRatio();
-    ret[KEY_TORRENT_MAX_SEEDING_TIME] = torrent.maxSeedingTime();
-    ret[KEY_TORRENT_RATIO_LIMIT] = torrent.ratioLimit();
-    ret[KEY_TORRENT_SEEDING_TIME_LIMIT] = torrent.seedingTimeLimit();
-    ret[KEY_TORRENT_LAST_SEEN_COMPLETE_TIME] = torrent.lastSeenComplete().toTime_t();
-    ret[KEY_TORRENT_AUTO_TORRENT_MANAGEMENT] = torrent.isAutoTMMEnabled();
-    ret[KEY_TORRENT_TIME_ACTIVE] = torrent.activeTime();
 
-    if (torrent.isPaused() || torrent.isChecking()) {
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = 0;
-    }
-    else {
-        QDateTime dt = QDateTime::currentDateTime();
-        dt = dt.addSecs(-torrent.timeSinceActivity());
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = dt.toTime_t();
+    for (const TorrentNumberField &field : torrentNumberFields()) {
+        const qint64 value = field.value(torrent);
+        switch (field.type) {
+        case TorrentNumberType::Integer:
+            ret[field.key] = value;
+            break;
+        case TorrentNumberType::Boolean:
+            ret[field.key] = (value != 0);
+            break;
+        case TorrentNumberType::OptionalBoolean:
+            if (value >= 0)
+                ret[field.key] = (value != 0);
+            break;
+        }
     }
 
-    ret[KEY_TORRENT_TOTAL_SIZE] = torrent.totalSize();
+    for (const TorrentRealField &field : torrentRealFields())
+        ret[field.key] = field.value(torrent);
+
+    for (const TorrentStringField &field : torrentStringFields())
+        ret[field.key] = field.value(torrent);
 
     return ret;
 }
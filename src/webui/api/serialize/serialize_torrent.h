@@ -29,10 +29,12 @@
 #pragma once
 
 #include <QVariantMap>
+#include <QVector>
 
 namespace BitTorrent
 {
     class TorrentHandle;
+    enum class TorrentState;
 }
 
 // Torrent keys
@@ -79,4 +81,44 @@ const char KEY_TORRENT_TOTAL_SIZE[] = "total_size";
 const char KEY_TORRENT_AUTO_TORRENT_MANAGEMENT[] = "auto_tmm";
 const char KEY_TORRENT_TIME_ACTIVE[] = "time_active";
 
+// The torrent fields except the hash, with their typed getters.
+// Shared by serialize(), the sync/maindata changes and the torrents/info sorting.
+enum class TorrentNumberType
+{
+    Integer,
+    Boolean,
+    // boolean that isn't reported while it's negative
+    OptionalBoolean
+};
+
+struct TorrentNumberField
+{
+    const char *key;
+    TorrentNumberType type;
+    qint64 (*value)(const BitTorrent::TorrentHandle &torrent);
+    // the value is rarely changed, e.g. not by the transfers
+    bool isStable;
+    // smaller changes of the value aren't reported by sync/maindata
+    qint64 tolerance;
+};
+
+struct TorrentRealField
+{
+    const char *key;
+    qreal (*value)(const BitTorrent::TorrentHandle &torrent);
+    bool isStable;
+};
+
+struct TorrentStringField
+{
+    const char *key;
+    QString (*value)(const BitTorrent::TorrentHandle &torrent);
+    bool isStable;
+};
+
+const QVector<TorrentNumberField> &torrentNumberFields();
+const QVector<TorrentRealField> &torrentRealFields();
+const QVector<TorrentStringField> &torrentStringFields();
+
+QString torrentStateToString(BitTorrent::TorrentState state);
 QVariantMap serialize(const BitTorrent::TorrentHandle &torrent);
@@ -35,6 +35,7 @@
 #include <QThread>
 
 #include "base/bittorrent/peerinfo.h"
+#include "base/bittorrent/peerlist.h"
 #include "base/bittorrent/session.h"
 #include "base/bittorrent/torrenthandle.h"
 #include "base/global.h"
@@ -44,7 +45,8 @@
 #include "apierror.h"
 #include "freediskspacechecker.h"
 #include "isessionmanager.h"
-#include "serialize/serialize_torrent.h"
+#include "serialize/datawriter.h"
+#include "torrentsynctracker.h"
 
 // Sync main data keys
 const char KEY_SYNC_MAINDATA_QUEUEING[] = "queueing";
@@ -95,12 +97,30 @@ const char KEY_TRANSFER_READ_CACHE_OVERLOAD[] = "read_cache_overload";
 const char KEY_TRANSFER_QUEUED_IO_JOBS[] = "queued_io_jobs";
 const char KEY_TRANSFER_AVERAGE_TIME_QUEUE[] = "average_time_queue";
 const char KEY_TRANSFER_TOTAL_QUEUED_SIZE[] = "total_queued_size";
+const char KEY_TRANSFER_QUEUED_RESUME_DATA[] = "queued_resume_data";
+const char KEY_TRANSFER_RESUME_DATA_WRITTEN[] = "resume_data_written";
+const char KEY_TRANSFER_RESUME_DATA_BYTES_WRITTEN[] = "resume_data_bytes_written";
+const char KEY_TRANSFER_AVERAGE_RESUME_DATA_TIME[] = "average_resume_data_time";
 
 const char KEY_FULL_UPDATE[] = "full_update";
 const char KEY_RESPONSE_ID[] = "rid";
 const char KEY_SUFFIX_REMOVED[] = "_removed";
 
 const int FREEDISKSPACE_CHECK_TIMEOUT = 30000;
+// covers the longest wait of a polling client, data changing about once a second
+const int MAX_MAINDATA_SNAPSHOTS = 128;
+
+// The main data sync state of a session, the data itself is kept by SyncController
+struct MainDataSyncState
+{
+    int lastResponseId = 0;
+    int lastAcceptedResponseId = 0;
+    quint64 lastSnapshot = 0;
+    quint64 lastAcceptedSnapshot = 0;
+    quint64 lastRevision = 0;  // of the torrent sync tracker
+    quint64 lastAcceptedRevision = 0;
+};
+Q_DECLARE_METATYPE(MainDataSyncState)
 
 namespace
 {
@@ -108,6 +128,8 @@ namespace
     void processHash(QVariantHash prevData, const QVariantHash &data, QVariantMap &syncData, QVariantList &removedItems);
     void processList(QVariantList prevData, const QVariantList &data, QVariantList &syncData, QVariantList &removedItems);
     QVariantMap generateSyncData(int acceptedResponseId, const QVariantMap &data, QVariantMap &lastAcceptedData, QVariantMap &lastData);
+    QVariantMap serializePeer(const BitTorrent::TorrentHandle *torrent, const BitTorrent::PeerInfo &pi, bool resolvePeerCountries);
+    QString peerKey(const BitTorrent::PeerAddress &addr);
 
     QVariantMap getTranserInfo()
     {
@@ -147,6 +169,11 @@ namespace
         map[KEY_TRANSFER_AVERAGE_TIME_QUEUE] = cacheStatus.averageJobTime;
         map[KEY_TRANSFER_TOTAL_QUEUED_SIZE] = cacheStatus.queuedBytes;
 
+        map[KEY_TRANSFER_QUEUED_RESUME_DATA] = sessionStatus.resumeDataPending;
+        map[KEY_TRANSFER_RESUME_DATA_WRITTEN] = sessionStatus.resumeDataWritten;
+        map[KEY_TRANSFER_RESUME_DATA_BYTES_WRITTEN] = sessionStatus.resumeDataBytesWritten;
+        map[KEY_TRANSFER_AVERAGE_RESUME_DATA_TIME] = sessionStatus.averageResumeDataLatency;
+
         map[KEY_TRANSFER_DHT_NODES] = sessionStatus.dhtNodes;
         if (!BitTorrent::Session::instance()->isListening())
             map[KEY_TRANSFER_CONNECTION_STATUS] = "disconnected";
@@ -321,6 +348,38 @@ namespace
 
         return syncData;
     }
+
+    QVariantMap serializePeer(const BitTorrent::TorrentHandle *torrent, const BitTorrent::PeerInfo &pi, const bool resolvePeerCountries)
+    {
+        QVariantMap peer;
+#ifndef DISABLE_COUNTRIES_RESOLUTION
+        if (resolvePeerCountries) {
+            peer[KEY_PEER_COUNTRY_CODE] = pi.country().toLower();
+            peer[KEY_PEER_COUNTRY] = Net::GeoIPManager::CountryName(pi.country());
+        }
+#else
+        Q_UNUSED(resolvePeerCountries);
+#endif
+        peer[KEY_PEER_IP] = pi.address().ip.toString();
+        peer[KEY_PEER_PORT] = pi.address().port;
+        peer[KEY_PEER_CLIENT] = pi.client();
+        peer[KEY_PEER_PROGRESS] = pi.progress();
+        peer[KEY_PEER_DOWN_SPEED] = pi.payloadDownSpeed();
+        peer[KEY_PEER_UP_SPEED] = pi.payloadUpSpeed();
+        peer[KEY_PEER_TOT_DOWN] = pi.totalDownload();
+        peer[KEY_PEER_TOT_UP] = pi.totalUpload();
+        peer[KEY_PEER_CONNECTION_TYPE] = pi.connectionType();
+        peer[KEY_PEER_FLAGS] = pi.flags();
+        peer[KEY_PEER_FLAGS_DESCRIPTION] = pi.flagsDescription();
+        peer[KEY_PEER_RELEVANCE] = pi.relevance();
+        peer[KEY_PEER_FILES] = torrent->info().filesForPiece(pi.downloadingPieceIndex()).join(QLatin1String("\n"));
+        return peer;
+    }
+
+    QString peerKey(const BitTorrent::PeerAddress &addr)
+    {
+        return (addr.ip.toString() + ':' + QString::number(addr.port));
+    }
 }
 
 SyncController::SyncController(ISessionManager *sessionManager, QObject *parent)
@@ -336,6 +395,9 @@ SyncController::SyncController(ISessionManager *sessionManager, QObject *parent)
     m_freeDiskSpaceThread->start();
     invokeChecker();
     m_freeDiskSpaceElapsedTimer.start();
+
+    m_torrentSyncTracker = new TorrentSyncTracker(this);
+    connect(m_torrentSyncTracker, &TorrentSyncTracker::changed, this, &SyncController::torrentsChanged);
 }
 
 SyncController::~SyncController()
@@ -344,6 +406,11 @@ SyncController::~SyncController()
     m_freeDiskSpaceThread->wait();
 }
 
+void SyncController::setChangeNotificationEnabled(const bool enabled)
+{
+    m_torrentSyncTracker->setAutoRefreshEnabled(enabled);
+}
+
 // The function returns the changed data from the server to synchronize with the web client.
 // Return value is map in JSON format.
 // Map contain the key:
@@ -404,34 +471,25 @@ SyncController::~SyncController()
 //  - "free_space_on_disk": Free space on the default save path
 // GET param:
 //   - rid (int): last response id
+//   - wait (int): seconds to wait for changes if nothing has changed since 'rid' (optional)
 void SyncController::maindataAction()
 {
-    auto lastResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastResponse")).toMap();
-    auto lastAcceptedResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastAcceptedResponse")).toMap();
+    auto state = sessionManager()->session()->getData<MainDataSyncState>(QLatin1String("syncMainDataState"));
+
+    // The data aren't stored in the session. Instead the revisions of the main data snapshot
+    // and of the torrent tracker are remembered for each response and
+    // the same response id logic as in generateSyncData() is applied to them.
+    const int acceptedResponseId {params()["rid"].toInt()};
+    if ((acceptedResponseId > 0) && (state.lastResponseId == acceptedResponseId)) {
+        state.lastAcceptedResponseId = state.lastResponseId;
+        state.lastAcceptedSnapshot = state.lastSnapshot;
+        state.lastAcceptedRevision = state.lastRevision;
+    }
 
     QVariantMap data;
-    QVariantHash torrents;
 
     BitTorrent::Session *const session = BitTorrent::Session::instance();
 
-    for (BitTorrent::TorrentHandle *const torrent : asConst(session->torrents())) {
-        QVariantMap map = serialize(*torrent);
-        map.remove(KEY_TORRENT_HASH);
-
-        // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
-        // So we don't need unnecessary updates of last activity time in response.
-        if (lastResponse.contains("torrents") && lastResponse["torrents"].toHash().contains(torrent->hash()) &&
-                lastResponse["torrents"].toHash()[torrent->hash()].toMap().contains(KEY_TORRENT_LAST_ACTIVITY_TIME)) {
-            uint lastValue = lastResponse["torrents"].toHash()[torrent->hash()].toMap()[KEY_TORRENT_LAST_ACTIVITY_TIME].toUInt();
-            if (qAbs(static_cast<int>(lastValue - map[KEY_TORRENT_LAST_ACTIVITY_TIME].toUInt())) < 15)
-                map[KEY_TORRENT_LAST_ACTIVITY_TIME] = lastValue;
-        }
-
-        torrents[torrent->hash()] = map;
-    }
-
-    data["torrents"] = torrents;
-
     QVariantHash categories;
     const auto &categoriesList = session->categories();
     for (auto it = categoriesList.cbegin(); it != categoriesList.cend(); ++it) {
@@ -451,11 +509,59 @@ void SyncController::maindataAction()
     serverState[KEY_SYNC_MAINDATA_REFRESH_INTERVAL] = session->refreshInterval();
     data["server_state"] = serverState;
 
-    const int acceptedResponseId {params()["rid"].toInt()};
-    setResult(QJsonObject::fromVariantMap(generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse)));
+    const quint64 snapshot = addMainDataSnapshot(data);
+    const QVariantMap *lastAcceptedData = mainDataSnapshot(state.lastAcceptedSnapshot);
+
+    const bool isFullUpdate = (acceptedResponseId <= 0) || (state.lastAcceptedResponseId != acceptedResponseId)
+        || !lastAcceptedData || !m_torrentSyncTracker->canSyncFrom(state.lastAcceptedRevision);
 
-    sessionManager()->session()->setData(QLatin1String("syncMainDataLastResponse"), lastResponse);
-    sessionManager()->session()->setData(QLatin1String("syncMainDataLastAcceptedResponse"), lastAcceptedResponse);
+    QVariantMap syncData;
+    if (isFullUpdate) {
+        state.lastAcceptedResponseId = 0;
+        state.lastAcceptedSnapshot = 0;
+        state.lastAcceptedRevision = 0;
+        syncData = data;
+        syncData[KEY_FULL_UPDATE] = true;
+    }
+    else {
+        processMap(*lastAcceptedData, data, syncData);
+    }
+
+    m_torrentSyncTracker->refresh();
+    const bool hasChangedTorrents = isFullUpdate || m_torrentSyncTracker->hasChangedTorrents(state.lastAcceptedRevision);
+    const QStringList removedTorrents = isFullUpdate ? QStringList {} : m_torrentSyncTracker->removedTorrents(state.lastAcceptedRevision);
+
+    // Nothing has changed, the response would only have the response id.
+    // The session data are left as is, so the client's response id stays valid.
+    if (syncData.isEmpty() && !hasChangedTorrents && removedTorrents.isEmpty() && deferResult())
+        return;
+
+    state.lastResponseId = (state.lastResponseId % 1000000) + 1;  // cycle between 1 and 1000000
+    state.lastSnapshot = snapshot;
+    syncData[KEY_RESPONSE_ID] = state.lastResponseId;
+
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginObject();
+    for (auto it = syncData.cbegin(); it != syncData.cend(); ++it) {
+        result->writeKey(it.key());
+        result->writeValue(it.value());
+    }
+
+    if (hasChangedTorrents) {
+        result->writeKey("torrents");
+        m_torrentSyncTracker->writeChangedTorrents(*result, state.lastAcceptedRevision);
+    }
+    if (!removedTorrents.isEmpty()) {
+        result->writeKey(QLatin1String("torrents") + KEY_SUFFIX_REMOVED);
+        result->writeValue(removedTorrents);
+    }
+    state.lastRevision = m_torrentSyncTracker->revision();
+
+    result->endObject();
+    setResult(*result);
+    setResumeParams({{QLatin1String("rid"), QString::number(state.lastResponseId)}});
+
+    sessionManager()->session()->setCachedData(QLatin1String("syncMainDataState"), QVariant::fromValue(state), sizeof(state));
 }
 
 // GET param:
@@ -465,56 +571,105 @@ void SyncController::torrentPeersAction()
 {
     auto lastResponse = sessionManager()->session()->getData(QLatin1String("syncTorrentPeersLastResponse")).toMap();
     auto lastAcceptedResponse = sessionManager()->session()->getData(QLatin1String("syncTorrentPeersLastAcceptedResponse")).toMap();
+    auto lastPeers = sessionManager()->session()->getData<BitTorrent::PeerListState>(QLatin1String("syncTorrentPeersLastPeers"));
+    auto lastAcceptedPeers = sessionManager()->session()->getData<BitTorrent::PeerListState>(QLatin1String("syncTorrentPeersLastAcceptedPeers"));
 
     const QString hash {params()["hash"]};
     BitTorrent::TorrentHandle *const torrent = BitTorrent::Session::instance()->findTorrent(hash);
     if (!torrent)
         throw APIError(APIErrorType::NotFound);
 
-    QVariantMap data;
-    QVariantHash peers;
-    const QList<BitTorrent::PeerInfo> peersList = torrent->peers();
 #ifndef DISABLE_COUNTRIES_RESOLUTION
     bool resolvePeerCountries = Preferences::instance()->resolvePeerCountries();
 #else
     bool resolvePeerCountries = false;
 #endif
 
+    // Peers are diffed separately from the rest of the data since
+    // comparing the serialized peers is too expensive for large peer lists.
+    // The same response id logic as in generateSyncData() is applied to them.
+    const int acceptedResponseId {params()["rid"].toInt()};
+    if ((acceptedResponseId > 0) && (lastResponse[KEY_RESPONSE_ID].toInt() == acceptedResponseId))
+        lastAcceptedPeers = lastPeers;
+
+    QVariantMap data;
     data[KEY_SYNC_TORRENT_PEERS_SHOW_FLAGS] = resolvePeerCountries;
 
-    for (const BitTorrent::PeerInfo &pi : peersList) {
-        if (pi.address().ip.isNull()) continue;
-        QVariantMap peer;
-#ifndef DISABLE_COUNTRIES_RESOLUTION
-        if (resolvePeerCountries) {
-            peer[KEY_PEER_COUNTRY_CODE] = pi.country().toLower();
-            peer[KEY_PEER_COUNTRY] = Net::GeoIPManager::CountryName(pi.country());
+    QVariantMap syncData = generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse);
+
+    BitTorrent::PeerListState peerListState(torrent->peers());
+    if (syncData.contains(KEY_FULL_UPDATE) || syncData.contains(KEY_SYNC_TORRENT_PEERS_SHOW_FLAGS)) {
+        // all the peers should be sent again
+        // (e.g. country fields should be added or removed)
+        if (syncData.contains(KEY_FULL_UPDATE)) {
+            lastAcceptedPeers = {};
+        }
+        else {
+            // the client merges the peers into the ones it has, so the gone ones are still reported
+            const BitTorrent::PeerListChanges changes = peerListState.diff(lastAcceptedPeers);
+            QVariantList removedPeers;
+            for (const BitTorrent::PeerAddress &addr : changes.removed)
+                removedPeers << peerKey(addr);
+            if (!removedPeers.isEmpty())
+                syncData[QLatin1String("peers") + KEY_SUFFIX_REMOVED] = removedPeers;
         }
-#endif
-        peer[KEY_PEER_IP] = pi.address().ip.toString();
-        peer[KEY_PEER_PORT] = pi.address().port;
-        peer[KEY_PEER_CLIENT] = pi.client();
-        peer[KEY_PEER_PROGRESS] = pi.progress();
-        peer[KEY_PEER_DOWN_SPEED] = pi.payloadDownSpeed();
-        peer[KEY_PEER_UP_SPEED] = pi.payloadUpSpeed();
-        peer[KEY_PEER_TOT_DOWN] = pi.totalDownload();
-        peer[KEY_PEER_TOT_UP] = pi.totalUpload();
-        peer[KEY_PEER_CONNECTION_TYPE] = pi.connectionType();
-        peer[KEY_PEER_FLAGS] = pi.flags();
-        peer[KEY_PEER_FLAGS_DESCRIPTION] = pi.flagsDescription();
-        peer[KEY_PEER_RELEVANCE] = pi.relevance();
-        peer[KEY_PEER_FILES] = torrent->info().filesForPiece(pi.downloadingPieceIndex()).join(QLatin1String("\n"));
 
-        peers[pi.address().ip.toString() + ':' + QString::number(pi.address().port)] = peer;
+        QVariantHash peers;
+        for (const BitTorrent::PeerInfo &pi : asConst(peerListState.peers()))
+            peers[peerKey(pi.address())] = serializePeer(torrent, pi, resolvePeerCountries);
+        syncData["peers"] = peers;
+    }
+    else {
+        const BitTorrent::PeerListChanges changes = peerListState.diff(lastAcceptedPeers);
+
+        // changed peers are sent as whole objects
+        QVariantHash peers;
+        for (const BitTorrent::PeerInfo &pi : changes.added)
+            peers[peerKey(pi.address())] = serializePeer(torrent, pi, resolvePeerCountries);
+        for (const BitTorrent::PeerInfo &pi : changes.changed)
+            peers[peerKey(pi.address())] = serializePeer(torrent, pi, resolvePeerCountries);
+        if (!peers.isEmpty())
+            syncData["peers"] = peers;
+
+        QVariantList removedPeers;
+        for (const BitTorrent::PeerAddress &addr : changes.removed)
+            removedPeers << peerKey(addr);
+        if (!removedPeers.isEmpty())
+            syncData[QLatin1String("peers") + KEY_SUFFIX_REMOVED] = removedPeers;
     }
 
-    data["peers"] = peers;
+    setResult(QJsonObject::fromVariantMap(syncData));
 
-    const int acceptedResponseId {params()["rid"].toInt()};
-    setResult(QJsonObject::fromVariantMap(generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse)));
+    // the peer lists are measured roughly, the size of a PeerInfo dominates
+    sessionManager()->session()->setCachedData(QLatin1String("syncTorrentPeersLastResponse"), lastResponse);
+    sessionManager()->session()->setCachedData(QLatin1String("syncTorrentPeersLastAcceptedResponse"), lastAcceptedResponse);
+    sessionManager()->session()->setCachedData(QLatin1String("syncTorrentPeersLastPeers"), QVariant::fromValue(peerListState)
+        , (peerListState.size() * static_cast<qint64>(sizeof(BitTorrent::PeerInfo))));
+    sessionManager()->session()->setCachedData(QLatin1String("syncTorrentPeersLastAcceptedPeers"), QVariant::fromValue(lastAcceptedPeers)
+        , (lastAcceptedPeers.size() * static_cast<qint64>(sizeof(BitTorrent::PeerInfo))));
+}
+
+quint64 SyncController::addMainDataSnapshot(const QVariantMap &data)
+{
+    // the clients polling at the same time get the same data, it is stored once
+    if (!m_mainDataSnapshots.isEmpty() && (m_mainDataSnapshots.last().data == data))
+        return m_mainDataSnapshots.last().revision;
+
+    if (m_mainDataSnapshots.size() >= MAX_MAINDATA_SNAPSHOTS)
+        m_mainDataSnapshots.removeFirst();
+    m_mainDataSnapshots.append({++m_mainDataSnapshotRevision, data});
+    return m_mainDataSnapshotRevision;
+}
+
+const QVariantMap *SyncController::mainDataSnapshot(const quint64 revision) const
+{
+    // the revisions are consecutive
+    if (m_mainDataSnapshots.isEmpty() || (revision < m_mainDataSnapshots.first().revision)
+        || (revision > m_mainDataSnapshotRevision)) {
+        return nullptr;
+    }
 
-    sessionManager()->session()->setData(QLatin1String("syncTorrentPeersLastResponse"), lastResponse);
-    sessionManager()->session()->setData(QLatin1String("syncTorrentPeersLastAcceptedResponse"), lastAcceptedResponse);
+    return &m_mainDataSnapshots[static_cast<int>(revision - m_mainDataSnapshots.first().revision)].data;
 }
 
 qint64 SyncController::getFreeDiskSpace()
@@ -29,6 +29,8 @@
 #pragma once
 
 #include <QElapsedTimer>
+#include <QList>
+#include <QVariantMap>
 
 #include "apicontroller.h"
 
@@ -37,6 +39,7 @@ struct ISessionManager;
 class QThread;
 
 class FreeDiskSpaceChecker;
+class TorrentSyncTracker;
 
 class SyncController : public APIController
 {
@@ -49,17 +52,36 @@ public:
     explicit SyncController(ISessionManager *sessionManager, QObject *parent = nullptr);
     ~SyncController() override;
 
+    // Enabled while there are clients waiting for the changes, see torrentsChanged()
+    void setChangeNotificationEnabled(bool enabled);
+
+signals:
+    // Emitted when the torrents reported by maindata have changed
+    void torrentsChanged();
+
 private slots:
     void maindataAction();
     void torrentPeersAction();
     void freeDiskSpaceSizeUpdated(qint64 freeSpaceSize);
 
 private:
+    struct MainDataSnapshot
+    {
+        quint64 revision;
+        QVariantMap data;
+    };
+
     qint64 getFreeDiskSpace();
     void invokeChecker() const;
+    quint64 addMainDataSnapshot(const QVariantMap &data);
+    const QVariantMap *mainDataSnapshot(quint64 revision) const;
 
     qint64 m_freeDiskSpace = 0;
     FreeDiskSpaceChecker *m_freeDiskSpaceChecker = nullptr;
     QThread *m_freeDiskSpaceThread = nullptr;
     QElapsedTimer m_freeDiskSpaceElapsedTimer;
+    TorrentSyncTracker *m_torrentSyncTracker = nullptr;
+    // The recent main data, shared by the sessions which refer to it by revision
+    QList<MainDataSnapshot> m_mainDataSnapshots;
+    quint64 m_mainDataSnapshotRevision = 0;
 };
@@ -28,16 +28,22 @@
 
 #include "torrentscontroller.h"
 
+#include <algorithm>
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include <QBitArray>
 #include <QDir>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QList>
 #include <QNetworkCookie>
 #include <QRegularExpression>
+#include <QSet>
 #include <QUrl>
+#include <QVector>
 
 #include "base/bittorrent/downloadpriority.h"
 #include "base/bittorrent/peerinfo.h"
@@ -52,6 +58,7 @@
 #include "base/utils/fs.h"
 #include "base/utils/string.h"
 #include "apierror.h"
+#include "serialize/datawriter.h"
 #include "serialize/serialize_torrent.h"
 
 // Tracker keys
@@ -131,6 +138,278 @@ namespace
         }
     }
 
+    // The operations of a batch are parsed and their torrents are looked up before any of them is run
+    struct BatchOperation
+    {
+        enum class QueueChange
+        {
+            None,
+            Increase,
+            Decrease,
+            Top,
+            Bottom
+        };
+
+        QString action;
+        QVector<BitTorrent::TorrentHandle *> torrents;
+        // returns the error message if the torrent can't be changed
+        std::function<QString (BitTorrent::TorrentHandle *torrent)> apply;
+        QueueChange queueChange = QueueChange::None;
+        bool isDelete = false;
+    };
+
+    QString batchParam(const QJsonObject &operation, const QString &key)
+    {
+        if (!operation.contains(key))
+            throw APIError(APIErrorType::BadParams, TorrentsController::tr("Missing parameter \"%1\"").arg(key));
+
+        const QJsonValue value = operation.value(key);
+        return value.isString() ? value.toString() : value.toVariant().toString();
+    }
+
+    // the lists can be given as JSON arrays or as the strings the single actions take
+    QStringList batchListParam(const QJsonObject &operation, const QString &key, const QChar separator)
+    {
+        const QJsonValue value = operation.value(key);
+        if (!value.isArray())
+            return batchParam(operation, key).split(separator, QString::SkipEmptyParts);
+
+        const QJsonArray array = value.toArray();
+        QStringList list;
+        list.reserve(array.size());
+        for (const QJsonValue &item : array)
+            list << (item.isString() ? item.toString() : item.toVariant().toString());
+        return list;
+    }
+
+    QVector<BitTorrent::TorrentHandle *> findTorrents(const QStringList &hashes)
+    {
+        const BitTorrent::Session *const session = BitTorrent::Session::instance();
+        if ((hashes.size() == 1) && (hashes[0] == QLatin1String("all")))
+            return session->torrents().values().toVector();
+
+        QVector<BitTorrent::TorrentHandle *> torrents;
+        torrents.reserve(hashes.size());
+        for (const QString &hash : hashes) {
+            BitTorrent::TorrentHandle *const torrent = session->findTorrent(hash);
+            if (torrent)
+                torrents << torrent;
+        }
+        return torrents;
+    }
+
+    // Checks the parameters the same way the single actions do, nothing is changed here
+    BatchOperation parseBatchOperation(const QJsonObject &object)
+    {
+        using BitTorrent::TorrentHandle;
+
+        BitTorrent::Session *const session = BitTorrent::Session::instance();
+
+        BatchOperation operation;
+        operation.action = batchParam(object, QLatin1String("action"));
+        operation.torrents = findTorrents(batchListParam(object, QLatin1String("hashes"), '|'));
+
+        const QString &action = operation.action;
+        if (action == QLatin1String("pause")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->pause(); return QString(); };
+        }
+        else if (action == QLatin1String("resume")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->resume(); return QString(); };
+        }
+        else if (action == QLatin1String("recheck")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->forceRecheck(); return QString(); };
+        }
+        else if (action == QLatin1String("reannounce")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->forceReannounce(); return QString(); };
+        }
+        else if (action == QLatin1String("toggleSequentialDownload")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->toggleSequentialDownload(); return QString(); };
+        }
+        else if (action == QLatin1String("toggleFirstLastPiecePrio")) {
+            operation.apply = [](TorrentHandle *const torrent) { torrent->toggleFirstLastPiecePriority(); return QString(); };
+        }
+        else if (action == QLatin1String("setForceStart")) {
+            const bool value = parseBool(batchParam(object, QLatin1String("value")), false);
+            operation.apply = [value](TorrentHandle *const torrent) { torrent->resume(value); return QString(); };
+        }
+        else if (action == QLatin1String("setSuperSeeding")) {
+            const bool value = parseBool(batchParam(object, QLatin1String("value")), false);
+            operation.apply = [value](TorrentHandle *const torrent) { torrent->setSuperSeeding(value); return QString(); };
+        }
+        else if (action == QLatin1String("setAutoManagement")) {
+            const bool isEnabled = parseBool(batchParam(object, QLatin1String("enable")), false);
+            operation.apply = [isEnabled](TorrentHandle *const torrent) { torrent->setAutoTMMEnabled(isEnabled); return QString(); };
+        }
+        else if ((action == QLatin1String("setUploadLimit")) || (action == QLatin1String("setDownloadLimit"))) {
+            qlonglong limit = batchParam(object, QLatin1String("limit")).toLongLong();
+            if (limit == 0)
+                limit = -1;
+
+            if (action == QLatin1String("setUploadLimit"))
+                operation.apply = [limit](TorrentHandle *const torrent) { torrent->setUploadLimit(limit); return QString(); };
+            else
+                operation.apply = [limit](TorrentHandle *const torrent) { torrent->setDownloadLimit(limit); return QString(); };
+        }
+        else if (action == QLatin1String("setShareLimits")) {
+            const qreal ratioLimit = batchParam(object, QLatin1String("ratioLimit")).toDouble();
+            const qlonglong seedingTimeLimit = batchParam(object, QLatin1String("seedingTimeLimit")).toLongLong();
+            operation.apply = [ratioLimit, seedingTimeLimit](TorrentHandle *const torrent)
+            {
+                torrent->setRatioLimit(ratioLimit);
+                torrent->setSeedingTimeLimit(seedingTimeLimit);
+                return QString();
+            };
+        }
+        else if (action == QLatin1String("setCategory")) {
+            const QString category = batchParam(object, QLatin1String("category")).trimmed();
+            if (!category.isEmpty() && !session->categories().contains(category))
+                throw APIError(APIErrorType::Conflict, TorrentsController::tr("Incorrect category name"));
+
+            operation.apply = [category](TorrentHandle *const torrent)
+            {
+                return torrent->setCategory(category) ? QString() : TorrentsController::tr("Incorrect category name");
+            };
+        }
+        else if ((action == QLatin1String("addTags")) || (action == QLatin1String("removeTags"))) {
+            QStringList tags = batchListParam(object, QLatin1String("tags"), ',');
+            for (QString &tag : tags) {
+                tag = tag.trimmed();
+                if (!BitTorrent::Session::isValidTag(tag))
+                    throw APIError(APIErrorType::BadParams, TorrentsController::tr("Incorrect tag name"));
+            }
+
+            const bool isAdding = (action == QLatin1String("addTags"));
+            operation.apply = [tags, isAdding](TorrentHandle *const torrent)
+            {
+                for (const QString &tag : tags) {
+                    if (isAdding)
+                        torrent->addTag(tag);
+                    else
+                        torrent->removeTag(tag);
+                }
+                return QString();
+            };
+        }
+        else if (action == QLatin1String("setLocation")) {
+            const QString newLocation = batchParam(object, QLatin1String("location")).trimmed();
+            if (newLocation.isEmpty())
+                throw APIError(APIErrorType::BadParams, TorrentsController::tr("Save path cannot be empty"));
+            // an existing location is checked here, a missing one is only created when the batch is applied
+            const QFileInfo locationInfo(newLocation);
+            if (locationInfo.exists()) {
+                if (!locationInfo.isDir())
+                    throw APIError(APIErrorType::Conflict, TorrentsController::tr("Cannot make save path"));
+                if (!locationInfo.isWritable())
+                    throw APIError(APIErrorType::AccessDenied, TorrentsController::tr("Cannot write to directory"));
+            }
+
+            operation.apply = [newLocation](TorrentHandle *const torrent)
+            {
+                // try to create the location if it does not exist
+                if (!QDir(newLocation).mkpath("."))
+                    return TorrentsController::tr("Cannot make save path");
+                if (!QFileInfo(newLocation).isWritable())
+                    return TorrentsController::tr("Cannot write to directory");
+
+                LogMsg(TorrentsController::tr("WebUI Set location: moving \"%1\", from \"%2\" to \"%3\"")
+                    .arg(torrent->name(), Utils::Fs::toNativePath(torrent->savePath()), Utils::Fs::toNativePath(newLocation)));
+                torrent->move(Utils::Fs::expandPathAbs(newLocation));
+                return QString();
+            };
+        }
+        else if (action == QLatin1String("filePrio")) {
+            bool ok = false;
+            const auto priority = static_cast<BitTorrent::DownloadPriority>(batchParam(object, QLatin1String("priority")).toInt(&ok));
+            if (!ok)
+                throw APIError(APIErrorType::BadParams, TorrentsController::tr("Priority must be an integer"));
+            if (!BitTorrent::isValidDownloadPriority(priority))
+                throw APIError(APIErrorType::BadParams, TorrentsController::tr("Priority is not valid"));
+
+            const QStringList fileIDList = batchListParam(object, QLatin1String("id"), '|');
+            QVector<int> fileIDs;
+            for (const QString &fileID : fileIDList) {
+                const int id = fileID.toInt(&ok);
+                if (!ok)
+                    throw APIError(APIErrorType::BadParams, TorrentsController::tr("File IDs must be integers"));
+                fileIDs << id;
+            }
+
+            for (const TorrentHandle *torrent : asConst(operation.torrents)) {
+                if (!torrent->hasMetadata())
+                    throw APIError(APIErrorType::Conflict, TorrentsController::tr("Torrent's metadata has not yet downloaded"));
+                for (const int id : asConst(fileIDs)) {
+                    if ((id < 0) || (id >= torrent->filesCount()))
+                        throw APIError(APIErrorType::Conflict, TorrentsController::tr("File ID is not valid"));
+                }
+            }
+
+            operation.apply = [fileIDs, priority](TorrentHandle *const torrent)
+            {
+                QVector<BitTorrent::DownloadPriority> priorities = torrent->filePriorities();
+                bool priorityChanged = false;
+                for (const int id : fileIDs) {
+                    if (priorities[id] != priority) {
+                        priorities[id] = priority;
+                        priorityChanged = true;
+                    }
+                }
+
+                if (priorityChanged)
+                    torrent->prioritizeFiles(priorities);
+                return QString();
+            };
+        }
+        else if ((action == QLatin1String("increasePrio")) || (action == QLatin1String("decreasePrio"))
+                 || (action == QLatin1String("topPrio")) || (action == QLatin1String("bottomPrio"))) {
+            if (!session->isQueueingSystemEnabled())
+                throw APIError(APIErrorType::Conflict, TorrentsController::tr("Torrent queueing must be enabled"));
+
+            if (action == QLatin1String("increasePrio"))
+                operation.queueChange = BatchOperation::QueueChange::Increase;
+            else if (action == QLatin1String("decreasePrio"))
+                operation.queueChange = BatchOperation::QueueChange::Decrease;
+            else if (action == QLatin1String("topPrio"))
+                operation.queueChange = BatchOperation::QueueChange::Top;
+            else
+                operation.queueChange = BatchOperation::QueueChange::Bottom;
+        }
+        else if (action == QLatin1String("delete")) {
+            const bool deleteFiles = parseBool(batchParam(object, QLatin1String("deleteFiles")), false);
+            operation.isDelete = true;
+            operation.apply = [session, deleteFiles](TorrentHandle *const torrent)
+            {
+                session->deleteTorrent(torrent->hash(), deleteFiles);
+                return QString();
+            };
+        }
+        else {
+            throw APIError(APIErrorType::BadParams, TorrentsController::tr("Unknown action \"%1\"").arg(action));
+        }
+
+        return operation;
+    }
+
+    void changeQueuePositions(const BatchOperation::QueueChange change, const QStringList &hashes)
+    {
+        BitTorrent::Session *const session = BitTorrent::Session::instance();
+        switch (change) {
+        case BatchOperation::QueueChange::Increase:
+            session->increaseTorrentsPriority(hashes);
+            break;
+        case BatchOperation::QueueChange::Decrease:
+            session->decreaseTorrentsPriority(hashes);
+            break;
+        case BatchOperation::QueueChange::Top:
+            session->topTorrentsPriority(hashes);
+            break;
+        case BatchOperation::QueueChange::Bottom:
+            session->bottomTorrentsPriority(hashes);
+            break;
+        default:
+            break;
+        }
+    }
+
     QVariantList getStickyTrackers(const BitTorrent::TorrentHandle *const torrent)
     {
         uint seedsDHT = 0, seedsPeX = 0, seedsLSD = 0, leechesDHT = 0, leechesPeX = 0, leechesLSD = 0;
@@ -196,6 +475,125 @@ namespace
 
         return QVariantList {dht, pex, lsd};
     }
+
+    template <typename T>
+    struct SortColumn
+    {
+        T (*key)(const BitTorrent::TorrentHandle &torrent);
+        // Values of the column are rarely changed so the sorted order
+        // of all the torrents is kept between requests
+        bool isStable;
+    };
+
+    template <typename T, typename Field>
+    QHash<QString, SortColumn<T>> makeSortColumns(const QVector<Field> &fields)
+    {
+        QHash<QString, SortColumn<T>> columns;
+        for (const Field &field : fields)
+            columns.insert(QLatin1String(field.key), {field.value, field.isStable});
+        return columns;
+    }
+
+    const QHash<QString, SortColumn<qint64>> &numberSortColumns()
+    {
+        static const QHash<QString, SortColumn<qint64>> columns = makeSortColumns<qint64>(torrentNumberFields());
+        return columns;
+    }
+
+    const QHash<QString, SortColumn<qreal>> &realSortColumns()
+    {
+        static const QHash<QString, SortColumn<qreal>> columns = makeSortColumns<qreal>(torrentRealFields());
+        return columns;
+    }
+
+    const QHash<QString, SortColumn<QString>> &stringSortColumns()
+    {
+        static const QHash<QString, SortColumn<QString>> columns = []()
+        {
+            QHash<QString, SortColumn<QString>> result = makeSortColumns<QString>(torrentStringFields());
+            result.insert(QLatin1String(KEY_TORRENT_HASH), {[](const BitTorrent::TorrentHandle &torrent) -> QString { return torrent.hash(); }, true});
+            return result;
+        }();
+        return columns;
+    }
+
+    // Sorts the torrents by the values of the column.
+    // Only the first 'sortedCount' torrents are guaranteed to be in order.
+    template <typename T>
+    void sortTorrents(QVector<BitTorrent::TorrentHandle *> &torrents, const SortColumn<T> &column, const bool reverse, const int sortedCount)
+    {
+        using Entry = std::pair<T, BitTorrent::TorrentHandle *>;
+
+        // the values are extracted once instead of doing it on each comparison
+        std::vector<Entry> entries;
+        entries.reserve(torrents.size());
+        for (BitTorrent::TorrentHandle *const torrent : asConst(torrents))
+            entries.emplace_back(column.key(*torrent), torrent);
+
+        const auto lessThan = [reverse](const Entry &left, const Entry &right)
+        {
+            return (reverse ? (right.first < left.first) : (left.first < right.first));
+        };
+
+        // cached order is usually still valid
+        if (std::is_sorted(entries.cbegin(), entries.cend(), lessThan))
+            return;
+
+        if (sortedCount < static_cast<int>(entries.size()))
+            std::partial_sort(entries.begin(), (entries.begin() + sortedCount), entries.end(), lessThan);
+        else
+            std::stable_sort(entries.begin(), entries.end(), lessThan);
+
+        for (int i = 0; i < torrents.size(); ++i)
+            torrents[i] = entries[i].second;
+    }
+
+    template <typename T>
+    QVector<BitTorrent::TorrentHandle *> sortTorrents(const SortColumn<T> &column, const TorrentFilter &filter, const bool reverse
+                                                      , const int offset, const int limit, QVector<BitTorrent::InfoHash> &cachedOrder)
+    {
+        const auto allTorrents = BitTorrent::Session::instance()->torrents();
+
+        if (column.isStable) {
+            // Sort all the torrents in ascending order and keep them sorted for the next requests
+            // The order is kept by hash, so it isn't affected by the removed torrents
+            QVector<BitTorrent::TorrentHandle *> sortedTorrents;
+            sortedTorrents.reserve(allTorrents.size());
+            for (const BitTorrent::InfoHash &hash : asConst(cachedOrder)) {
+                BitTorrent::TorrentHandle *const torrent = allTorrents.value(hash);
+                if (torrent)
+                    sortedTorrents << torrent;
+            }
+            if (sortedTorrents.size() != allTorrents.size())
+                sortedTorrents = allTorrents.values().toVector();
+            sortTorrents(sortedTorrents, column, false, sortedTorrents.size());
+
+            cachedOrder.clear();
+            cachedOrder.reserve(sortedTorrents.size());
+            QVector<BitTorrent::TorrentHandle *> torrents;
+            for (BitTorrent::TorrentHandle *const torrent : asConst(sortedTorrents)) {
+                cachedOrder << torrent->hash();
+                if (filter.match(torrent))
+                    torrents << torrent;
+            }
+            if (reverse)
+                std::reverse(torrents.begin(), torrents.end());
+            return torrents;
+        }
+
+        QVector<BitTorrent::TorrentHandle *> torrents;
+        for (BitTorrent::TorrentHandle *const torrent : allTorrents) {
+            if (filter.match(torrent))
+                torrents << torrent;
+        }
+
+        // only the requested page should be in order
+        int sortedCount = torrents.size();
+        if ((limit > 0) && (offset >= 0))
+            sortedCount = static_cast<int>(std::min<qint64>((static_cast<qint64>(offset) + limit), sortedCount));
+        sortTorrents(torrents, column, reverse, sortedCount);
+        return torrents;
+    }
 }
 
 // Returns all the torrents in JSON format.
@@ -237,22 +635,29 @@ void TorrentsController::infoAction()
     int offset {params()["offset"].toInt()};
     const QStringSet hashSet {params()["hashes"].split('|', QString::SkipEmptyParts).toSet()};
 
-    QVariantList torrentList;
-    TorrentFilter torrentFilter(filter, (hashSet.isEmpty() ? TorrentFilter::AnyHash : hashSet), category);
-    for (BitTorrent::TorrentHandle *const torrent : asConst(BitTorrent::Session::instance()->torrents())) {
-        if (torrentFilter.match(torrent))
-            torrentList.append(serialize(*torrent));
-    }
+    const TorrentFilter torrentFilter(filter, (hashSet.isEmpty() ? TorrentFilter::AnyHash : hashSet), category);
 
-    std::sort(torrentList.begin(), torrentList.end()
-              , [sortedColumn, reverse](const QVariant &torrent1, const QVariant &torrent2)
-    {
-        return reverse
-                ? (torrent1.toMap().value(sortedColumn) > torrent2.toMap().value(sortedColumn))
-                : (torrent1.toMap().value(sortedColumn) < torrent2.toMap().value(sortedColumn));
-    });
+    QVector<BitTorrent::TorrentHandle *> torrents;
+    const auto numberColumnIter = numberSortColumns().constFind(sortedColumn);
+    const auto realColumnIter = realSortColumns().constFind(sortedColumn);
+    const auto stringColumnIter = stringSortColumns().constFind(sortedColumn);
+    if (numberColumnIter != numberSortColumns().constEnd()) {
+        torrents = sortTorrents(numberColumnIter.value(), torrentFilter, reverse, offset, limit, m_sortedTorrents[sortedColumn]);
+    }
+    else if (realColumnIter != realSortColumns().constEnd()) {
+        torrents = sortTorrents(realColumnIter.value(), torrentFilter, reverse, offset, limit, m_sortedTorrents[sortedColumn]);
+    }
+    else if (stringColumnIter != stringSortColumns().constEnd()) {
+        torrents = sortTorrents(stringColumnIter.value(), torrentFilter, reverse, offset, limit, m_sortedTorrents[sortedColumn]);
+    }
+    else {
+        for (BitTorrent::TorrentHandle *const torrent : asConst(BitTorrent::Session::instance()->torrents())) {
+            if (torrentFilter.match(torrent))
+                torrents << torrent;
+        }
+    }
 
-    const int size = torrentList.size();
+    const int size = torrents.size();
     // normalize offset
     if (offset < 0)
         offset = size + offset;
@@ -263,9 +668,29 @@ void TorrentsController::infoAction()
         limit = -1; // unlimited
 
     if ((limit > 0) || (offset > 0))
-        torrentList = torrentList.mid(offset, limit);
+        torrents = torrents.mid(offset, limit);
+
+    // Only the requested page is serialized, a few torrents at a time while the result is being sent.
+    // The torrents removed meanwhile are left out.
+    QVector<BitTorrent::InfoHash> hashes;
+    hashes.reserve(torrents.size());
+    for (const BitTorrent::TorrentHandle *torrent : asConst(torrents))
+        hashes.append(torrent->hash());
+
+    std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginArray();
+    setResult(std::move(result), [hashes, index = 0](DataWriter &writer) mutable -> bool
+    {
+        if (index >= hashes.size()) {
+            writer.endArray();
+            return false;
+        }
 
-    setResult(QJsonArray::fromVariantList(torrentList));
+        const BitTorrent::TorrentHandle *torrent = BitTorrent::Session::instance()->findTorrent(hashes[index++]);
+        if (torrent)
+            writer.writeValue(serialize(*torrent));
+        return true;
+    });
 }
 
 // Returns the properties for a torrent in JSON format.
@@ -440,39 +865,44 @@ void TorrentsController::filesAction()
     checkParams({"hash"});
 
     const QString hash {params()["hash"]};
-    QVariantList fileList;
     const BitTorrent::TorrentHandle *const torrent = BitTorrent::Session::instance()->findTorrent(hash);
     if (!torrent)
         throw APIError(APIErrorType::NotFound);
 
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginArray();
     if (torrent->hasMetadata()) {
         const QVector<BitTorrent::DownloadPriority> priorities = torrent->filePriorities();
         const QVector<qreal> fp = torrent->filesProgress();
         const QVector<qreal> fileAvailability = torrent->availableFileFractions();
         const BitTorrent::TorrentInfo info = torrent->info();
         for (int i = 0; i < torrent->filesCount(); ++i) {
-            QVariantMap fileDict;
-            fileDict[KEY_FILE_PROGRESS] = fp[i];
-            fileDict[KEY_FILE_PRIORITY] = static_cast<int>(priorities[i]);
-            fileDict[KEY_FILE_SIZE] = torrent->fileSize(i);
-            fileDict[KEY_FILE_AVAILABILITY] = fileAvailability[i];
-
             QString fileName = torrent->filePath(i);
             if (fileName.endsWith(QB_EXT, Qt::CaseInsensitive))
                 fileName.chop(QB_EXT.size());
-            fileDict[KEY_FILE_NAME] = Utils::Fs::toNativePath(fileName);
 
             const BitTorrent::TorrentInfo::PieceRange idx = info.filePieces(i);
-            fileDict[KEY_FILE_PIECE_RANGE] = QVariantList {idx.first(), idx.last()};
 
+            // keys are written in the same (sorted) order as QJsonObject does
+            result->beginObject();
+            result->writeMember(KEY_FILE_AVAILABILITY, fileAvailability[i]);
             if (i == 0)
-                fileDict[KEY_FILE_IS_SEED] = torrent->isSeed();
-
-            fileList.append(fileDict);
+                result->writeMember(KEY_FILE_IS_SEED, torrent->isSeed());
+            result->writeMember(KEY_FILE_NAME, Utils::Fs::toNativePath(fileName));
+            result->writeKey(KEY_FILE_PIECE_RANGE);
+            result->beginArray();
+            result->writeValue(idx.first());
+            result->writeValue(idx.last());
+            result->endArray();
+            result->writeMember(KEY_FILE_PRIORITY, static_cast<int>(priorities[i]));
+            result->writeMember(KEY_FILE_PROGRESS, fp[i]);
+            result->writeMember(KEY_FILE_SIZE, torrent->fileSize(i));
+            result->endObject();
         }
     }
+    result->endArray();
 
-    setResult(QJsonArray::fromVariantList(fileList));
+    setResult(*result);
 }
 
 // Returns an array of hashes (of each pieces respectively) for a torrent in JSON format.
@@ -1041,3 +1471,95 @@ void TorrentsController::categoriesAction()
 
     setResult(categories);
 }
+
+// Runs several operations in one request.
+// POST param:
+//   - operations (string): JSON array of operations, each one is an object with:
+//       - "action": name of the single action, e.g. "pause", "setCategory", "addTags", "topPrio", "filePrio"
+//       - "hashes": hashes of the torrents (array or string separated by |, "all" for every torrent)
+//       - the parameters of the single action under the same names
+// All the operations are checked before any of them is run, so a malformed batch changes nothing.
+// The return value is a JSON-formatted list of dictionaries, one for each operation.
+// The dictionary keys are:
+//   - "action": Operation action
+//   - "count": Number of torrents the operation was applied to
+//   - "error": Error message, present only if the operation failed for some torrents
+void TorrentsController::batchAction()
+{
+    checkParams({"operations"});
+
+    QJsonParseError jsonError;
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(params()["operations"].toUtf8(), &jsonError);
+    if ((jsonError.error != QJsonParseError::NoError) || !jsonDoc.isArray())
+        throw APIError(APIErrorType::BadParams, tr("Operations must be a JSON array"));
+
+    const QJsonArray operations = jsonDoc.array();
+    std::vector<BatchOperation> batch;
+    batch.reserve(operations.size());
+    for (int i = 0; i < operations.size(); ++i) {
+        if (!operations[i].isObject())
+            throw APIError(APIErrorType::BadParams, tr("Operation %1: operation must be a JSON object").arg(i));
+
+        try {
+            batch.push_back(parseBatchOperation(operations[i].toObject()));
+        }
+        catch (const APIError &error) {
+            throw APIError(error.type(), tr("Operation %1: %2").arg(i).arg(error.message()));
+        }
+    }
+
+    // the torrents deleted by an operation are skipped by the next ones
+    QSet<const BitTorrent::TorrentHandle *> deletedTorrents;
+
+    const std::unique_ptr<DataWriter> result = createResultWriter();
+    result->beginArray();
+    for (const BatchOperation &operation : batch) {
+        if (operation.queueChange != BatchOperation::QueueChange::None) {
+            // Each operation reorders the queue on its own, as the single actions do.
+            // The session orders the given torrents by their positions, not by the list,
+            // so merging the operations in a row could leave another torrent on top.
+            QStringList hashes;
+            int count = 0;
+            for (const BitTorrent::TorrentHandle *torrent : asConst(operation.torrents)) {
+                if (deletedTorrents.contains(torrent)) continue;
+
+                hashes << torrent->hash();
+                // the session doesn't move the seeds and the torrents out of the queue
+                if (!torrent->isSeed() && (torrent->queuePosition() > 0))
+                    ++count;
+            }
+
+            changeQueuePositions(operation.queueChange, hashes);
+
+            result->beginObject();
+            result->writeMember("action", operation.action);
+            result->writeMember("count", count);
+            result->endObject();
+            continue;
+        }
+
+        int count = 0;
+        QString errorMessage;
+        for (BitTorrent::TorrentHandle *const torrent : asConst(operation.torrents)) {
+            if (deletedTorrents.contains(torrent)) continue;
+            if (operation.isDelete)
+                deletedTorrents.insert(torrent);
+
+            const QString message = operation.apply(torrent);
+            if (message.isEmpty())
+                ++count;
+            else
+                errorMessage = message;
+        }
+
+        result->beginObject();
+        result->writeMember("action", operation.action);
+        result->writeMember("count", count);
+        if (!errorMessage.isEmpty())
+            result->writeMember("error", errorMessage);
+        result->endObject();
+    }
+    result->endArray();
+
+    setResult(*result);
+}
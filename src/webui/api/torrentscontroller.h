@@ -28,6 +28,10 @@
 
 #pragma once
 
+#include <QHash>
+#include <QVector>
+
+#include "base/bittorrent/infohash.h"
 #include "apicontroller.h"
 
 class TorrentsController : public APIController
@@ -77,4 +81,9 @@ private slots:
     void setForceStartAction();
     void toggleSequentialDownloadAction();
     void toggleFirstLastPiecePrioAction();
+    void batchAction();
+
+private:
+    // torrents sorted in ascending order by the columns requested before
+    QHash<QString, QVector<BitTorrent::InfoHash>> m_sortedTorrents;
 };
@@ -0,0 +1,314 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "torrentsynctracker.h"
+
+#include <QTimer>
+
+#include "base/bittorrent/session.h"
+#include "base/bittorrent/torrenthandle.h"
+#include "base/global.h"
+#include "serialize/datawriter.h"
+#include "serialize/serialize_torrent.h"
+
+namespace
+{
+    // Clients that may not know about earlier removed torrents get full update
+    const int MAX_REMOVED_TORRENTS = 10000;
+    // Some fields change without any signal (e.g. the limits or the values
+    // derived from the global settings), so all the torrents are reread this often
+    const int FULL_REFRESH_INTERVAL = 5000; // ms
+
+    int fieldCount()
+    {
+        return (torrentNumberFields().size() + torrentRealFields().size() + torrentStringFields().size());
+    }
+}
+
+TorrentSyncTracker::TorrentSyncTracker(QObject *parent)
+    : QObject(parent)
+    , m_refreshTimer(new QTimer(this))
+{
+    // the signals emitted together are handled by a single refresh
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(0);
+    connect(m_refreshTimer, &QTimer::timeout, this, &TorrentSyncTracker::refresh);
+
+    // torrentsUpdated is emitted on each session refresh along with the torrents
+    // whose status has changed, the other signals report the changes it doesn't cover
+    const BitTorrent::Session *const session = BitTorrent::Session::instance();
+    connect(session, &BitTorrent::Session::torrentsUpdated, this, &TorrentSyncTracker::handleTorrentsUpdated);
+    connect(session, &BitTorrent::Session::torrentAdded, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentAboutToBeRemoved, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentPaused, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentResumed, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentSavePathChanged, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentCategoryChanged, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentTagAdded, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentTagRemoved, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentSavingModeChanged, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::torrentMetadataLoaded, this, &TorrentSyncTracker::markTorrentDirty);
+    connect(session, &BitTorrent::Session::trackersChanged, this, &TorrentSyncTracker::markTorrentDirty);
+}
+
+void TorrentSyncTracker::refresh()
+{
+    const bool isFullRefresh = (!m_fullRefreshTimer.isValid() || m_fullRefreshTimer.hasExpired(FULL_REFRESH_INTERVAL));
+    if (!isFullRefresh && m_dirtyTorrents.isEmpty()) return;
+
+    const quint64 revision = m_revision + 1;
+    bool hasChanges = false;
+
+    const BitTorrent::Session *const session = BitTorrent::Session::instance();
+    if (isFullRefresh) {
+        m_fullRefreshTimer.start();
+        ++m_refreshCount;
+
+        const QHash<BitTorrent::InfoHash, BitTorrent::TorrentHandle *> torrents = session->torrents();
+        for (auto it = torrents.cbegin(); it != torrents.cend(); ++it) {
+            if (refreshTorrent(it.key(), it.value(), revision))
+                hasChanges = true;
+        }
+
+        for (auto it = m_torrents.begin(); it != m_torrents.end();) {
+            if (it->refreshCount == m_refreshCount) {
+                ++it;
+                continue;
+            }
+
+            m_removedTorrents.insert(it.key(), revision);
+            it = m_torrents.erase(it);
+            hasChanges = true;
+        }
+    }
+    else {
+        for (const BitTorrent::InfoHash &hash : asConst(m_dirtyTorrents)) {
+            const BitTorrent::TorrentHandle *torrent = session->findTorrent(hash);
+            if (torrent) {
+                if (refreshTorrent(hash, torrent, revision))
+                    hasChanges = true;
+            }
+            else if (m_torrents.remove(hash) > 0) {
+                m_removedTorrents.insert(hash, revision);
+                hasChanges = true;
+            }
+        }
+    }
+
+    m_dirtyTorrents.clear();
+
+    if (m_removedTorrents.size() > MAX_REMOVED_TORRENTS) {
+        m_removedTorrents.clear();
+        m_oldestRevision = revision;
+    }
+
+    if (hasChanges) {
+        m_revision = revision;
+        emit changed();
+    }
+}
+
+quint64 TorrentSyncTracker::revision() const
+{
+    return m_revision;
+}
+
+bool TorrentSyncTracker::canSyncFrom(const quint64 revision) const
+{
+    return ((revision >= m_oldestRevision) && (revision <= m_revision));
+}
+
+bool TorrentSyncTracker::hasChangedTorrents(const quint64 revision) const
+{
+    for (const TorrentEntry &entry : m_torrents) {
+        if (entry.revision > revision)
+            return true;
+    }
+
+    return false;
+}
+
+void TorrentSyncTracker::writeChangedTorrents(DataWriter &writer, const quint64 revision) const
+{
+    const QVector<TorrentNumberField> &numberFields = torrentNumberFields();
+    const QVector<TorrentRealField> &realFields = torrentRealFields();
+    const QVector<TorrentStringField> &stringFields = torrentStringFields();
+
+    writer.beginObject();
+
+    for (auto it = m_torrents.cbegin(); it != m_torrents.cend(); ++it) {
+        const TorrentEntry &entry = it.value();
+        if (entry.revision <= revision) continue;
+
+        writer.writeKey(QString(it.key()));
+        writer.beginObject();
+
+        int fieldIndex = 0;
+
+        for (int i = 0; i < numberFields.size(); ++i, ++fieldIndex) {
+            if (entry.fieldRevisions[fieldIndex] <= revision) continue;
+
+            const TorrentNumberField &field = numberFields[i];
+            const qint64 value = entry.numbers[i];
+            switch (field.type) {
+            case TorrentNumberType::Integer:
+                writer.writeMember(field.key, value);
+                break;
+            case TorrentNumberType::Boolean:
+                writer.writeMember(field.key, (value != 0));
+                break;
+            case TorrentNumberType::OptionalBoolean:
+                if (value >= 0)
+                    writer.writeMember(field.key, (value != 0));
+                break;
+            }
+        }
+
+        for (int i = 0; i < realFields.size(); ++i, ++fieldIndex) {
+            if (entry.fieldRevisions[fieldIndex] > revision)
+                writer.writeMember(realFields[i].key, entry.reals[i]);
+        }
+
+        for (int i = 0; i < stringFields.size(); ++i, ++fieldIndex) {
+            if (entry.fieldRevisions[fieldIndex] > revision)
+                writer.writeMember(stringFields[i].key, entry.strings[i]);
+        }
+
+        writer.endObject();
+    }
+
+    writer.endObject();
+}
+
+QStringList TorrentSyncTracker::removedTorrents(const quint64 revision) const
+{
+    QStringList result;
+    if (revision == 0)
+        return result;
+
+    for (auto it = m_removedTorrents.cbegin(); it != m_removedTorrents.cend(); ++it) {
+        if (it.value() > revision)
+            result.append(QString(it.key()));
+    }
+
+    return result;
+}
+
+void TorrentSyncTracker::setAutoRefreshEnabled(const bool enabled)
+{
+    m_isAutoRefreshEnabled = enabled;
+    if (!enabled)
+        m_refreshTimer->stop();
+    else if (!m_dirtyTorrents.isEmpty() && !m_refreshTimer->isActive())
+        m_refreshTimer->start();
+}
+
+void TorrentSyncTracker::markTorrentDirty(BitTorrent::TorrentHandle *const torrent)
+{
+    m_dirtyTorrents.insert(torrent->hash());
+    scheduleRefresh();
+}
+
+void TorrentSyncTracker::handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents)
+{
+    for (const BitTorrent::TorrentHandle *torrent : torrents)
+        m_dirtyTorrents.insert(torrent->hash());
+    // it is also the chance for the full refresh to happen when it's due
+    scheduleRefresh();
+}
+
+void TorrentSyncTracker::scheduleRefresh()
+{
+    // without waiting clients the changes are only looked for by the next refresh() call
+    if (m_isAutoRefreshEnabled && !m_refreshTimer->isActive())
+        m_refreshTimer->start();
+}
+
+bool TorrentSyncTracker::refreshTorrent(const BitTorrent::InfoHash &hash, const BitTorrent::TorrentHandle *torrent, const quint64 revision)
+{
+    auto entryIter = m_torrents.find(hash);
+    const bool isNew = (entryIter == m_torrents.end());
+    if (isNew) {
+        entryIter = m_torrents.insert(hash, TorrentEntry());
+        entryIter->numbers.resize(torrentNumberFields().size());
+        entryIter->reals.resize(torrentRealFields().size());
+        entryIter->strings.resize(torrentStringFields().size());
+        entryIter->fieldRevisions.resize(fieldCount());
+        m_removedTorrents.remove(hash);
+    }
+
+    entryIter->refreshCount = m_refreshCount;
+    return updateEntry(*entryIter, *torrent, revision, isNew);
+}
+
+bool TorrentSyncTracker::updateEntry(TorrentEntry &entry, const BitTorrent::TorrentHandle &torrent, const quint64 revision, const bool isNew) const
+{
+    bool changed = false;
+    int fieldIndex = 0;
+
+    const QVector<TorrentNumberField> &numberFields = torrentNumberFields();
+    for (int i = 0; i < numberFields.size(); ++i, ++fieldIndex) {
+        const TorrentNumberField &field = numberFields[i];
+        const qint64 value = field.value(torrent);
+        qint64 &storedValue = entry.numbers[i];
+        if (!isNew && ((value == storedValue) || (qAbs(value - storedValue) < field.tolerance)))
+            continue;
+
+        storedValue = value;
+        entry.fieldRevisions[fieldIndex] = revision;
+        changed = true;
+    }
+
+    const QVector<TorrentRealField> &realFields = torrentRealFields();
+    for (int i = 0; i < realFields.size(); ++i, ++fieldIndex) {
+        const qreal value = realFields[i].value(torrent);
+        qreal &storedValue = entry.reals[i];
+        if (!isNew && (value == storedValue))
+            continue;
+
+        storedValue = value;
+        entry.fieldRevisions[fieldIndex] = revision;
+        changed = true;
+    }
+
+    const QVector<TorrentStringField> &stringFields = torrentStringFields();
+    for (int i = 0; i < stringFields.size(); ++i, ++fieldIndex) {
+        const QString value = stringFields[i].value(torrent);
+        QString &storedValue = entry.strings[i];
+        if (!isNew && (value == storedValue))
+            continue;
+
+        storedValue = value;
+        entry.fieldRevisions[fieldIndex] = revision;
+        changed = true;
+    }
+
+    if (changed)
+        entry.revision = revision;
+    return changed;
+}
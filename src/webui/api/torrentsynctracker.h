@@ -0,0 +1,109 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2019  qBittorrent project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "base/bittorrent/infohash.h"
+
+class QTimer;
+
+namespace BitTorrent
+{
+    class TorrentHandle;
+}
+
+class DataWriter;
+
+// Keeps the typed values of the torrent fields reported by sync/maindata
+// along with the revision they were last changed at. So the changes since
+// any revision known by the client can be produced without keeping
+// the whole previous response for each client.
+class TorrentSyncTracker : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TorrentSyncTracker)
+
+public:
+    explicit TorrentSyncTracker(QObject *parent = nullptr);
+
+    // Updates the tracked values if the torrents could be changed since the last call
+    void refresh();
+    // While enabled, the changes are looked for as soon as the torrents could be changed
+    // and reported by changed(). Otherwise the values are only updated by refresh().
+    void setAutoRefreshEnabled(bool enabled);
+
+    quint64 revision() const;
+    // Whether the changes since 'revision' are still available
+    bool canSyncFrom(quint64 revision) const;
+
+    bool hasChangedTorrents(quint64 revision) const;
+    // Writes the fields changed since 'revision' as an object keyed by torrent hash.
+    // All the fields are written if 'revision' is 0.
+    void writeChangedTorrents(DataWriter &writer, quint64 revision) const;
+    QStringList removedTorrents(quint64 revision) const;
+
+signals:
+    // The revision has advanced, i.e. some torrents have changed or have been removed
+    void changed();
+
+private:
+    struct TorrentEntry
+    {
+        QVector<qint64> numbers;
+        QVector<qreal> reals;
+        QVector<QString> strings;
+        QVector<quint64> fieldRevisions;
+        quint64 revision = 0;
+        quint64 refreshCount = 0;
+    };
+
+    void markTorrentDirty(BitTorrent::TorrentHandle *torrent);
+    void handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
+    void scheduleRefresh();
+    bool refreshTorrent(const BitTorrent::InfoHash &hash, const BitTorrent::TorrentHandle *torrent, quint64 revision);
+    bool updateEntry(TorrentEntry &entry, const BitTorrent::TorrentHandle &torrent, quint64 revision, bool isNew) const;
+
+    QHash<BitTorrent::InfoHash, TorrentEntry> m_torrents;
+    QHash<BitTorrent::InfoHash, quint64> m_removedTorrents;
+    quint64 m_revision = 0;
+    quint64 m_oldestRevision = 0;
+    quint64 m_refreshCount = 0;
+    // Only these are looked at by refresh() between the full ones
+    QSet<BitTorrent::InfoHash> m_dirtyTorrents;
+    QElapsedTimer m_fullRefreshTimer;
+    bool m_isAutoRefreshEnabled = false;
+    QTimer *m_refreshTimer = nullptr;
+};
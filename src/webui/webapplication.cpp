@@ -29,7 +29,10 @@
 #include "webapplication.h"
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
@@ -39,15 +42,20 @@
 #include <QMimeType>
 #include <QNetworkCookie>
 #include <QRegExp>
+#include <QTimer>
 #include <QUrl>
+#include <QUrlQuery>
 
-#include "base/algorithm.h"
+#include "base/bittorrent/session.h"
 #include "base/global.h"
 #include "base/http/httperror.h"
+#include "base/http/responsegenerator.h"
+#include "base/http/responsestream.h"
 #include "base/logger.h"
 #include "base/preferences.h"
 #include "base/utils/bytearray.h"
 #include "base/utils/fs.h"
+#include "base/utils/gzip.h"
 #include "base/utils/misc.h"
 #include "base/utils/random.h"
 #include "base/utils/string.h"
@@ -57,11 +65,21 @@
 #include "api/logcontroller.h"
 #include "api/rsscontroller.h"
 #include "api/searchcontroller.h"
+#include "api/serialize/datawriter.h"
 #include "api/synccontroller.h"
 #include "api/torrentscontroller.h"
 #include "api/transfercontroller.h"
 
 constexpr int MAX_ALLOWED_FILESIZE = 10 * 1024 * 1024;
+constexpr int MAX_CACHED_FILES_SIZE = 32 * 1024 * 1024;  // bytes, the built-in WebUI takes a few MiB
+constexpr int MAX_WAIT_TIME = 60;  // seconds
+constexpr int CHANGE_NOTIFICATION_DELAY = 100;  // milliseconds, coalesces the changes made together
+constexpr int EVENT_STREAM_KEEP_ALIVE = 15 * 1000;  // milliseconds
+constexpr qint64 MAX_EVENT_STREAM_BACKLOG = 256 * 1024;  // bytes
+constexpr int STREAMED_RESULT_PIECE_SIZE = 256 * 1024;  // bytes
+constexpr int MAX_PENDING_REQUESTS_PER_CLIENT = 16;  // long polls and event streams
+constexpr qint64 MAX_SESSION_DATA_SIZE = 8 * 1024 * 1024;  // bytes cached by a single session
+constexpr qint64 MAX_TOTAL_SESSION_DATA_SIZE = 64 * 1024 * 1024;  // bytes cached by all the sessions
 
 const QString PATH_PREFIX_IMAGES {QStringLiteral("/images/")};
 const QString WWW_FOLDER {QStringLiteral(":/www")};
@@ -70,6 +88,17 @@ const QString PRIVATE_FOLDER {QStringLiteral("/private")};
 
 namespace
 {
+    // Writes the next piece of the result into its writer, returns false once the result is complete
+    bool writeStreamedResultPiece(const StreamedResult &result)
+    {
+        while (result.writer->size() < STREAMED_RESULT_PIECE_SIZE) {
+            if (!result.writeNext(*result.writer))
+                return false;
+        }
+
+        return true;
+    }
+
     QStringMap parseCookie(const QString &cookieStr)
     {
         // [rfc6265] 4.2.1. Syntax
@@ -110,18 +139,107 @@ namespace
 
         return QLatin1String("no-store");
     }
+
+    bool matchesETag(const QString &ifNoneMatch, const QString &etag)
+    {
+        // [rfc7232] 3.2. If-None-Match
+        // entity tags are compared with the weak comparison function
+        const QVector<QStringRef> tags = ifNoneMatch.splitRef(',', QString::SkipEmptyParts);
+        return std::any_of(tags.cbegin(), tags.cend(), [&etag](QStringRef tag)
+        {
+            tag = tag.trimmed();
+            if (tag == QLatin1String("*"))
+                return true;
+            if (tag.startsWith(QLatin1String("W/")))
+                tag = tag.mid(2);
+            return (tag == etag);
+        });
+    }
+
+    // Roughly the memory held by the value, the containers are measured by their content
+    qint64 estimateSize(const QVariant &value)
+    {
+        qint64 size = sizeof(QVariant);
+
+        switch (value.userType()) {
+        case QMetaType::QString:
+            size += value.toString().size() * sizeof(QChar);
+            break;
+        case QMetaType::QByteArray:
+            size += value.toByteArray().size();
+            break;
+        case QMetaType::QStringList:
+            for (const QString &str : asConst(value.toStringList()))
+                size += sizeof(QString) + (str.size() * sizeof(QChar));
+            break;
+        case QMetaType::QVariantList:
+            for (const QVariant &item : asConst(value.toList()))
+                size += estimateSize(item);
+            break;
+        case QMetaType::QVariantMap: {
+                const QVariantMap map = value.toMap();
+                for (auto it = map.cbegin(); it != map.cend(); ++it)
+                    size += sizeof(QString) + (it.key().size() * sizeof(QChar)) + estimateSize(it.value());
+            }
+            break;
+        case QMetaType::QVariantHash: {
+                const QVariantHash hash = value.toHash();
+                for (auto it = hash.cbegin(); it != hash.cend(); ++it)
+                    size += sizeof(QString) + (it.key().size() * sizeof(QChar)) + estimateSize(it.value());
+            }
+            break;
+        default:
+            break;
+        }
+
+        return size;
+    }
+
+    // [rfc7231] 5.3.2. Accept
+    // The results are sent as CBOR only to the clients asking for it,
+    // unless they prefer JSON with a higher quality value.
+    DataFormat negotiateDataFormat(const QString &accept)
+    {
+        qreal cborQuality = 0;
+        qreal jsonQuality = 0;
+
+        const QVector<QStringRef> mediaRanges = accept.splitRef(',', QString::SkipEmptyParts);
+        for (const QStringRef &mediaRange : mediaRanges) {
+            const QVector<QStringRef> parts = mediaRange.split(';');
+            const QStringRef type = parts[0].trimmed();
+
+            qreal quality = 1;
+            for (int i = 1; i < parts.size(); ++i) {
+                const QStringRef param = parts[i].trimmed();
+                if (param.startsWith(QLatin1String("q="), Qt::CaseInsensitive))
+                    quality = param.mid(2).toDouble();
+            }
+
+            if (type.compare(QLatin1String(Http::CONTENT_TYPE_CBOR), Qt::CaseInsensitive) == 0)
+                cborQuality = quality;
+            else if (type.compare(QLatin1String(Http::CONTENT_TYPE_JSON), Qt::CaseInsensitive) == 0)
+                jsonQuality = quality;
+        }
+
+        return ((cborQuality > 0) && (cborQuality >= jsonQuality)) ? DataFormat::CBOR : DataFormat::JSON;
+    }
 }
 
 WebApplication::WebApplication(QObject *parent)
     : QObject(parent)
+    , m_sessionExpiryTimer {new QTimer(this)}
     , m_cacheID {QString::number(Utils::Random::rand(), 36)}
+    , m_changeTimer {new QTimer(this)}
+    , m_pendingRequestTimer {new QTimer(this)}
+    , m_cachedFiles {MAX_CACHED_FILES_SIZE}
 {
     registerAPIController(QLatin1String("app"), new AppController(this, this));
     registerAPIController(QLatin1String("auth"), new AuthController(this, this));
     registerAPIController(QLatin1String("log"), new LogController(this, this));
     registerAPIController(QLatin1String("rss"), new RSSController(this, this));
     registerAPIController(QLatin1String("search"), new SearchController(this, this));
-    registerAPIController(QLatin1String("sync"), new SyncController(this, this));
+    m_syncController = new SyncController(this, this);
+    registerAPIController(QLatin1String("sync"), m_syncController);
     registerAPIController(QLatin1String("torrents"), new TorrentsController(this, this));
     registerAPIController(QLatin1String("transfer"), new TransferController(this, this));
 
@@ -129,6 +247,29 @@ WebApplication::WebApplication(QObject *parent)
 
     configure();
     connect(Preferences::instance(), &Preferences::changed, this, &WebApplication::configure);
+
+    m_changeTimer->setSingleShot(true);
+    m_changeTimer->setInterval(CHANGE_NOTIFICATION_DELAY);
+    connect(m_changeTimer, &QTimer::timeout, this, &WebApplication::processPendingRequests);
+    m_pendingRequestTimer->setInterval(1000);
+    connect(m_pendingRequestTimer, &QTimer::timeout, this, &WebApplication::checkPendingRequests);
+
+    // once the wheel has turned all the way round, a session has been inactive for at least INACTIVE_TIME
+    m_sessionExpiryWheel.resize((INACTIVE_TIME / SESSION_EXPIRY_GRANULARITY) + 1);
+    m_sessionExpiryTimer->setInterval(SESSION_EXPIRY_GRANULARITY * 1000);
+    connect(m_sessionExpiryTimer, &QTimer::timeout, this, &WebApplication::expireSessions);
+    m_sessionExpiryTimer->start();
+
+    // the transfer statistics alone don't wake the waiting clients, they are reported
+    // along with the next change or when the client stops waiting
+    connect(m_syncController, &SyncController::torrentsChanged, this, &WebApplication::notifyChange);
+    const BitTorrent::Session *const session = BitTorrent::Session::instance();
+    connect(session, &BitTorrent::Session::categoryAdded, this, &WebApplication::notifyChange);
+    connect(session, &BitTorrent::Session::categoryRemoved, this, &WebApplication::notifyChange);
+    connect(session, &BitTorrent::Session::tagAdded, this, &WebApplication::notifyChange);
+    connect(session, &BitTorrent::Session::tagRemoved, this, &WebApplication::notifyChange);
+    connect(Logger::instance(), &Logger::newLogMessage, this, &WebApplication::notifyChange);
+    connect(Logger::instance(), &Logger::newLogPeer, this, &WebApplication::notifyChange);
 }
 
 WebApplication::~WebApplication()
@@ -264,14 +405,49 @@ void WebApplication::doProcessRequest()
     for (const Http::UploadedFile &torrent : request().files)
         data[torrent.filename] = torrent.data;
 
+    const DataFormat format = negotiateDataFormat(request().headers.value(Http::HEADER_ACCEPT));
+    const char *contentType = ((format == DataFormat::CBOR) ? Http::CONTENT_TYPE_CBOR : Http::CONTENT_TYPE_JSON);
+
     try {
-        const QVariant result = controller->run(action, m_params, data);
+        const QVariant result = controller->run(action, m_params, data, format);
+        if (controller->isResultDeferred()) {
+            m_isResultDeferred = true;
+            return;
+        }
+
+        m_resumeParams = controller->resumeParams();
+        header(Http::HEADER_VARY, QLatin1String(Http::HEADER_ACCEPT));
+
+        StreamedResult streamedResult = controller->takeStreamedResult();
+        if (streamedResult.writer) {
+            // a result that turns out small is sent as usual, so it gets compressed and cached the same way
+            if (writeStreamedResultPiece(streamedResult)) {
+                m_streamedResult = std::move(streamedResult);
+                header(Http::HEADER_CONTENT_TYPE, QLatin1String(contentType));
+            }
+            else {
+                print(streamedResult.writer->takeData(), contentType);
+            }
+            return;
+        }
+
         switch (result.userType()) {
         case QMetaType::QString:
             print(result.toString(), Http::CONTENT_TYPE_TXT);
             break;
         case QMetaType::QJsonDocument:
-            print(result.toJsonDocument().toJson(QJsonDocument::Compact), Http::CONTENT_TYPE_JSON);
+            if (format == DataFormat::CBOR) {
+                const std::unique_ptr<DataWriter> writer = DataWriter::create(format);
+                writer->writeValue(result.toJsonDocument());
+                print(writer->data(), contentType);
+            }
+            else {
+                print(result.toJsonDocument().toJson(QJsonDocument::Compact), contentType);
+            }
+            break;
+        case QMetaType::QByteArray:
+            // already serialized in the requested format
+            print(result.toByteArray(), contentType);
             break;
         default:
             print(result.toString(), Http::CONTENT_TYPE_TXT);
@@ -307,7 +483,7 @@ void WebApplication::configure()
     if ((isAltUIUsed != m_isAltUIUsed) || (rootFolder != m_rootFolder)) {
         m_isAltUIUsed = isAltUIUsed;
         m_rootFolder = rootFolder;
-        m_translatedFiles.clear();
+        m_cachedFiles.clear();
         if (!m_isAltUIUsed)
             LogMsg(tr("Using built-in Web UI."));
         else
@@ -317,7 +493,7 @@ void WebApplication::configure()
     const QString newLocale = pref->getLocale();
     if (m_currentLocale != newLocale) {
         m_currentLocale = newLocale;
-        m_translatedFiles.clear();
+        m_cachedFiles.clear();
 
         m_translationFileLoaded = m_translator.load(m_rootFolder + QLatin1String("/translations/webui_") + newLocale);
         if (m_translationFileLoaded) {
@@ -364,17 +540,54 @@ void WebApplication::declarePublicAPI(const QString &apiPath)
 
 void WebApplication::sendFile(const QString &path)
 {
-    const QDateTime lastModified {QFileInfo(path).lastModified()};
+    // the built-in WebUI is compiled in, only the files of an alternative WebUI can change
+    QDateTime lastModified;
+    if (m_isAltUIUsed) {
+        const QFileInfo fileInfo {path};
+        if (!fileInfo.exists()) {
+            m_cachedFiles.remove(path);
+            throw NotFoundHTTPError();
+        }
+        lastModified = fileInfo.lastModified();
+    }
+
+    // find translated and compressed file in cache
+    CachedFile file;
+    const CachedFile *cachedFile = m_cachedFiles.object(path);
+    if (cachedFile && (lastModified <= cachedFile->lastModified)) {
+        file = *cachedFile;
+    }
+    else {
+        file = readFile(path, lastModified);
+        // a file larger than the whole cache isn't kept
+        m_cachedFiles.insert(path, new CachedFile(file), (file.data.size() + file.gzipData.size()));
+    }
 
-    // find translated file in cache
-    auto it = m_translatedFiles.constFind(path);
-    if ((it != m_translatedFiles.constEnd()) && (lastModified <= (*it).lastModified)) {
-        const QString mimeName {QMimeDatabase().mimeTypeForFileNameAndData(path, (*it).data).name()};
-        print((*it).data, mimeName);
-        header(Http::HEADER_CACHE_CONTROL, getCachingInterval(mimeName));
+    const bool sendGzip = !file.gzipData.isEmpty()
+        && Http::acceptsGzipEncoding(request().headers.value(Http::HEADER_ACCEPT_ENCODING));
+    const QString &etag = sendGzip ? file.gzipETag : file.etag;
+
+    // URLs containing the cache ID change with each start, so they can be cached for good
+    const bool isVersioned = (request().query.value(QLatin1String("v")) == m_cacheID.toLatin1());
+    header(Http::HEADER_CACHE_CONTROL, (isVersioned
+        ? QString::fromLatin1("private, max-age=31536000, immutable")
+        : getCachingInterval(file.mimeType)));
+    header(Http::HEADER_ETAG, etag);
+    if (!file.gzipData.isEmpty())
+        header(Http::HEADER_VARY, QLatin1String(Http::HEADER_ACCEPT_ENCODING));
+
+    if (matchesETag(request().headers.value(Http::HEADER_IF_NONE_MATCH), etag)) {
+        status(304, QLatin1String("Not Modified"));
         return;
     }
 
+    if (sendGzip)
+        header(Http::HEADER_CONTENT_ENCODING, QLatin1String("gzip"));
+    print((sendGzip ? file.gzipData : file.data), file.mimeType);
+}
+
+WebApplication::CachedFile WebApplication::readFile(const QString &path, const QDateTime &lastModified)
+{
     QFile file {path};
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug("File %s was not found!", qUtf8Printable(path));
@@ -398,17 +611,90 @@ void WebApplication::sendFile(const QString &path)
         QString dataStr {data};
         translateDocument(dataStr);
         data = dataStr.toUtf8();
-
-        m_translatedFiles[path] = {data, lastModified}; // caching translated file
     }
 
-    print(data, mimeType.name());
-    header(Http::HEADER_CACHE_CONTROL, getCachingInterval(mimeType.name()));
+    CachedFile cachedFile;
+    cachedFile.data = data;
+    cachedFile.mimeType = mimeType.name();
+    cachedFile.lastModified = lastModified;
+
+    // the file is compressed only once, so spend the time on the best ratio
+    bool ok = false;
+    const QByteArray gzipData = Utils::Gzip::compress(data, 9, &ok);
+    if (ok && (gzipData.size() < data.size()))
+        cachedFile.gzipData = gzipData;
+
+    // [rfc7232] 2.3. ETag
+    // each content coding is a different representation, so it gets its own strong tag
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    cachedFile.etag = QLatin1Char('"') + hash + QLatin1Char('"');
+    cachedFile.gzipETag = QLatin1Char('"') + hash + QLatin1String("-gzip\"");
+
+    return cachedFile;
+}
+
+Http::Response WebApplication::sendStreamedResult(Http::Response response)
+{
+    auto *stream = new Http::ResponseStream(this);
+    stream->sendHeader(response);
+    stream->write(m_streamedResult.writer->takeData());
+
+    // the next piece is written once the client has taken most of the previous ones,
+    // so only a few pieces of the result are held in memory at once
+    const StreamedResult result = std::move(m_streamedResult);
+    m_streamedResult = {};
+    connect(stream, &Http::ResponseStream::bytesWritten, stream, [stream, result]()
+    {
+        while (!stream->isFinished() && (stream->bytesToWrite() < STREAMED_RESULT_PIECE_SIZE)) {
+            const bool hasMore = writeStreamedResultPiece(result);
+            stream->write(result.writer->takeData());
+            if (!hasMore) {
+                stream->finish();
+                stream->deleteLater();
+            }
+        }
+    });
+    connect(stream, &Http::ResponseStream::disconnected, stream, &QObject::deleteLater);
+
+    response.stream = stream;
+    return response;
 }
 
 Http::Response WebApplication::processRequest(const Http::Request &request, const Http::Environment &env)
+{
+    if (isEventStreamRequest(request))
+        return openEventStream(request, env);
+
+    Http::Response response = handleRequest(request, env);
+    if (m_streamedResult.writer)
+        return sendStreamedResult(response);
+    if (!m_isResultDeferred)
+        return response;
+
+    const QString owner = pendingRequestOwner();
+    if (pendingRequestCount(owner) >= MAX_PENDING_REQUESTS_PER_CLIENT) {
+        // the client waits for too many things already, it's answered right away
+        Http::Request immediateRequest = request;
+        immediateRequest.query.remove(QLatin1String("wait"));
+        immediateRequest.posts.remove(QLatin1String("wait"));
+        return handleRequest(immediateRequest, env);
+    }
+
+    // nothing has changed yet, the request is run again when something does or when the client stops waiting
+    const int waitTime = qBound(1, m_params.value(QLatin1String("wait")).toInt(), MAX_WAIT_TIME);
+    const PendingRequest pendingRequest {request, env, owner, new Http::ResponseStream(this), {}, (waitTime * 1000)};
+    addPendingRequest(pendingRequest);
+
+    response.stream = pendingRequest.stream;
+    return response;
+}
+
+Http::Response WebApplication::handleRequest(const Http::Request &request, const Http::Environment &env)
 {
     m_currentSession = nullptr;
+    m_isResultDeferred = false;
+    m_resumeParams.clear();
+    m_streamedResult = {};
     m_request = request;
     m_env = env;
     m_params.clear();
@@ -440,6 +726,8 @@ Http::Response WebApplication::processRequest(const Http::Request &request, cons
             print(error.message(), Http::CONTENT_TYPE_TXT);
     }
 
+    limitSessionData();
+
     header(QLatin1String(Http::HEADER_X_XSS_PROTECTION), QLatin1String("1; mode=block"));
     header(QLatin1String(Http::HEADER_X_CONTENT_TYPE_OPTIONS), QLatin1String("nosniff"));
 
@@ -452,9 +740,210 @@ Http::Response WebApplication::processRequest(const Http::Request &request, cons
     if (!m_contentSecurityPolicy.isEmpty())
         header(QLatin1String(Http::HEADER_CONTENT_SECURITY_POLICY), m_contentSecurityPolicy);
 
+    // don't hold the uploaded data until the next request arrives
+    m_request.files.clear();
+    m_request.frame.clear();
+
     return response();
 }
 
+bool WebApplication::isEventStreamRequest(const Http::Request &request) const
+{
+    return ((request.method == Http::METHOD_GET)
+            && request.headers.value(Http::HEADER_ACCEPT).contains(QLatin1String(Http::CONTENT_TYPE_EVENT_STREAM))
+            && m_apiPathPattern.match(request.path).hasMatch());
+}
+
+Http::Response WebApplication::openEventStream(const Http::Request &request, const Http::Environment &env)
+{
+    // [HTML] 9.2 Server-sent events
+    // The event ids are the parameters to resume from, a reconnecting client sends back the last one.
+    Http::Request streamRequest = request;
+    const QUrlQuery lastEventId {request.headers.value(Http::HEADER_LAST_EVENT_ID)};
+    const QList<QPair<QString, QString>> resumeItems = lastEventId.queryItems(QUrl::FullyDecoded);
+    for (const QPair<QString, QString> &item : resumeItems)
+        streamRequest.query[item.first] = item.second.toUtf8();
+    streamRequest.query[QLatin1String("wait")] = "1";
+    // the events are text, so the results are always sent as JSON
+    streamRequest.headers.remove(Http::HEADER_ACCEPT);
+
+    Http::Response response = handleRequest(streamRequest, env);
+
+    // errors and the actions that can't report changes only are answered as usual
+    if (m_streamedResult.writer)
+        return sendStreamedResult(response);
+    if (!m_isResultDeferred && m_resumeParams.isEmpty())
+        return response;
+
+    const QString owner = pendingRequestOwner();
+    if (pendingRequestCount(owner) >= MAX_PENDING_REQUESTS_PER_CLIENT) {
+        // keeps the headers added while processing the request
+        response.status = {503, QLatin1String("Service Unavailable")};
+        response.headers[Http::HEADER_CONTENT_TYPE] = QLatin1String(Http::CONTENT_TYPE_TXT);
+        response.content = "Too many open event streams";
+        return response;
+    }
+
+    PendingRequest eventStream {streamRequest, env, owner, new Http::ResponseStream(this), {}, 0};
+
+    // keeps the headers added while processing the request, e.g. the session cookie
+    Http::Response header = response;
+    header.content.clear();
+    header.headers[Http::HEADER_CONTENT_TYPE] = QLatin1String(Http::CONTENT_TYPE_EVENT_STREAM);
+    header.headers[Http::HEADER_CACHE_CONTROL] = QLatin1String("no-store");
+    eventStream.stream->sendHeader(header);
+
+    if (!m_isResultDeferred)
+        writeEvent(eventStream, response.content);
+    addPendingRequest(eventStream);
+
+    header.stream = eventStream.stream;
+    return header;
+}
+
+void WebApplication::writeEvent(PendingRequest &eventStream, const QByteArray &data)
+{
+    // the next run continues from this event
+    QUrlQuery resumeQuery;
+    for (auto it = m_resumeParams.cbegin(); it != m_resumeParams.cend(); ++it) {
+        eventStream.request.query[it.key()] = it.value().toUtf8();
+        resumeQuery.addQueryItem(it.key(), it.value());
+    }
+
+    QByteArray event = "id: " + resumeQuery.toString(QUrl::FullyEncoded).toUtf8() + '\n';
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines)
+        event += "data: " + line + '\n';
+    event += '\n';
+
+    eventStream.stream->write(event);
+    eventStream.timer.restart();
+}
+
+// The pending requests are limited per session, or per client address when there is no session
+QString WebApplication::pendingRequestOwner() const
+{
+    return (m_currentSession ? m_currentSession->id() : clientId());
+}
+
+int WebApplication::pendingRequestCount(const QString &owner) const
+{
+    int count = 0;
+    for (const PendingRequest &pendingRequest : m_pendingRequests) {
+        if ((pendingRequest.owner == owner) && pendingRequest.stream && !pendingRequest.stream->isFinished())
+            ++count;
+    }
+
+    return count;
+}
+
+void WebApplication::addPendingRequest(const PendingRequest &pendingRequest)
+{
+    // the stream is dropped with the request on the next check
+    Http::ResponseStream *stream = pendingRequest.stream;
+    connect(stream, &Http::ResponseStream::disconnected, stream, &QObject::deleteLater);
+
+    m_pendingRequests.append(pendingRequest);
+    m_pendingRequests.last().timer.start();
+
+    if (!m_pendingRequestTimer->isActive())
+        m_pendingRequestTimer->start();
+    m_syncController->setChangeNotificationEnabled(true);
+}
+
+// Returns true when the request is done with
+bool WebApplication::runPendingRequest(PendingRequest &pendingRequest)
+{
+    if (!pendingRequest.stream || pendingRequest.stream->isFinished())
+        return true;
+
+    // the client doesn't keep up, the changes are reported in one event once it does
+    if ((pendingRequest.waitTime == 0) && (pendingRequest.stream->bytesToWrite() > MAX_EVENT_STREAM_BACKLOG))
+        return false;
+
+    const Http::Response response = handleRequest(pendingRequest.request, pendingRequest.env);
+    // the actions reporting changes don't stream their results
+    Q_ASSERT(!m_streamedResult.writer);
+    if (m_isResultDeferred)
+        return false;
+
+    if (pendingRequest.waitTime > 0) {
+        pendingRequest.stream->sendResponse(response);
+        return true;
+    }
+
+    // e.g. the session has expired
+    if (response.status.code != 200) {
+        pendingRequest.stream->finish();
+        return true;
+    }
+
+    writeEvent(pendingRequest, response.content);
+    return false;
+}
+
+void WebApplication::notifyChange()
+{
+    if (!m_pendingRequests.isEmpty() && !m_changeTimer->isActive())
+        m_changeTimer->start();
+}
+
+void WebApplication::processPendingRequests()
+{
+    for (int i = 0; i < m_pendingRequests.size();) {
+        PendingRequest &pendingRequest = m_pendingRequests[i];
+        if (runPendingRequest(pendingRequest)) {
+            if (pendingRequest.stream)
+                pendingRequest.stream->deleteLater();
+            m_pendingRequests.removeAt(i);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    if (m_pendingRequests.isEmpty())
+        m_syncController->setChangeNotificationEnabled(false);
+}
+
+void WebApplication::checkPendingRequests()
+{
+    for (int i = 0; i < m_pendingRequests.size();) {
+        PendingRequest &pendingRequest = m_pendingRequests[i];
+
+        bool isDone = (!pendingRequest.stream || pendingRequest.stream->isFinished());
+        if (!isDone) {
+            if (pendingRequest.waitTime > 0) {
+                if (pendingRequest.timer.hasExpired(pendingRequest.waitTime)) {
+                    // the action responds right away when the client doesn't wait
+                    pendingRequest.request.query.remove(QLatin1String("wait"));
+                    pendingRequest.request.posts.remove(QLatin1String("wait"));
+                    isDone = runPendingRequest(pendingRequest);
+                }
+            }
+            else if (pendingRequest.timer.hasExpired(EVENT_STREAM_KEEP_ALIVE)) {
+                // a comment line, it also reveals the clients that have gone
+                pendingRequest.stream->write(": keep-alive\n\n");
+                pendingRequest.timer.restart();
+            }
+        }
+
+        if (isDone) {
+            if (pendingRequest.stream)
+                pendingRequest.stream->deleteLater();
+            m_pendingRequests.removeAt(i);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    if (m_pendingRequests.isEmpty()) {
+        m_pendingRequestTimer->stop();
+        m_syncController->setChangeNotificationEnabled(false);
+    }
+}
+
 QString WebApplication::clientId() const
 {
     return env().clientAddress.toString();
@@ -474,11 +963,11 @@ void WebApplication::sessionInitialize()
             const qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
             if ((now - m_currentSession->m_timestamp) > INACTIVE_TIME) {
                 // session is outdated - removing it
-                delete m_sessions.take(sessionId);
+                removeSession(m_currentSession);
                 m_currentSession = nullptr;
             }
             else {
-                m_currentSession->updateTimestamp();
+                touchSession(m_currentSession);
             }
         }
         else {
@@ -522,19 +1011,10 @@ void WebApplication::sessionStart()
 {
     Q_ASSERT(!m_currentSession);
 
-    // remove outdated sessions
-    const qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
-    Algorithm::removeIf(m_sessions, [now](const QString &, const WebSession *session)
-    {
-        if ((now - session->timestamp()) <= INACTIVE_TIME)
-            return false;
-
-        delete session;
-        return true;
-    });
-
-    m_currentSession = new WebSession(generateSid());
+    // outdated sessions are removed by expireSessions()
+    m_currentSession = new WebSession(generateSid(), m_sessionDataSize);
     m_sessions[m_currentSession->id()] = m_currentSession;
+    touchSession(m_currentSession);
 
     QNetworkCookie cookie(C_SID, m_currentSession->id().toUtf8());
     cookie.setHttpOnly(true);
@@ -553,12 +1033,65 @@ void WebApplication::sessionEnd()
     cookie.setPath(QLatin1String("/"));
     cookie.setExpirationDate(QDateTime::currentDateTime().addDays(-1));
 
-    delete m_sessions.take(m_currentSession->id());
+    removeSession(m_currentSession);
     m_currentSession = nullptr;
 
     header(Http::HEADER_SET_COOKIE, cookie.toRawForm());
 }
 
+void WebApplication::touchSession(WebSession *session)
+{
+    session->updateTimestamp();
+
+    if (session->m_expirySlot == m_sessionExpirySlot)
+        return;
+
+    if (session->m_expirySlot >= 0)
+        m_sessionExpiryWheel[session->m_expirySlot].remove(session);
+    m_sessionExpiryWheel[m_sessionExpirySlot].insert(session);
+    session->m_expirySlot = m_sessionExpirySlot;
+}
+
+void WebApplication::removeSession(WebSession *session)
+{
+    if (session->m_expirySlot >= 0)
+        m_sessionExpiryWheel[session->m_expirySlot].remove(session);
+    m_sessions.remove(session->id());
+    delete session;
+}
+
+void WebApplication::expireSessions()
+{
+    m_sessionExpirySlot = (m_sessionExpirySlot + 1) % m_sessionExpiryWheel.size();
+
+    QSet<WebSession *> expiredSessions;
+    expiredSessions.swap(m_sessionExpiryWheel[m_sessionExpirySlot]);
+    for (WebSession *session : asConst(expiredSessions)) {
+        m_sessions.remove(session->id());
+        delete session;
+    }
+}
+
+void WebApplication::limitSessionData()
+{
+    // a single client can't take it all
+    if (m_currentSession && (m_currentSession->cachedDataSize() > MAX_SESSION_DATA_SIZE)) {
+        qDebug("Session data limit exceeded, dropping the cached data of a session");
+        m_currentSession->clearCachedData();
+    }
+
+    // the sessions that have been inactive the longest lose their data first
+    const int slotCount = m_sessionExpiryWheel.size();
+    for (int i = 1; (i <= slotCount) && (m_sessionDataSize > MAX_TOTAL_SESSION_DATA_SIZE); ++i) {
+        const QSet<WebSession *> &sessions = m_sessionExpiryWheel[(m_sessionExpirySlot + i) % slotCount];
+        for (WebSession *session : sessions) {
+            session->clearCachedData();
+            if (m_sessionDataSize <= MAX_TOTAL_SESSION_DATA_SIZE)
+                break;
+        }
+    }
+}
+
 bool WebApplication::isCrossSiteRequest(const Http::Request &request) const
 {
     // https://www.owasp.org/index.php/Cross-Site_Request_Forgery_(CSRF)_Prevention_Cheat_Sheet#Verifying_Same_Origin_with_Standard_Headers
@@ -639,12 +1172,18 @@ bool WebApplication::validateHostHeader(const QStringList &domains) const
 
 // WebSession
 
-WebSession::WebSession(const QString &sid)
+WebSession::WebSession(const QString &sid, qint64 &totalCachedDataSize)
     : m_sid {sid}
+    , m_totalCachedDataSize {totalCachedDataSize}
 {
     updateTimestamp();
 }
 
+WebSession::~WebSession()
+{
+    m_totalCachedDataSize -= m_cachedDataSize;
+}
+
 QString WebSession::id() const
 {
     return m_sid;
@@ -662,9 +1201,42 @@ QVariant WebSession::getData(const QString &id) const
 
 void WebSession::setData(const QString &id, const QVariant &data)
 {
+    // it isn't cached anymore
+    const qint64 size = m_cachedDataSizes.take(id);
+    m_cachedDataSize -= size;
+    m_totalCachedDataSize -= size;
+
+    m_data[id] = data;
+}
+
+void WebSession::setCachedData(const QString &id, const QVariant &data, qint64 size)
+{
+    if (size < 0)
+        size = estimateSize(data);
+
+    qint64 &cachedSize = m_cachedDataSizes[id];
+    m_cachedDataSize += size - cachedSize;
+    m_totalCachedDataSize += size - cachedSize;
+    cachedSize = size;
+
     m_data[id] = data;
 }
 
+qint64 WebSession::cachedDataSize() const
+{
+    return m_cachedDataSize;
+}
+
+void WebSession::clearCachedData()
+{
+    for (auto it = m_cachedDataSizes.cbegin(); it != m_cachedDataSizes.cend(); ++it)
+        m_data.remove(it.key());
+    m_cachedDataSizes.clear();
+
+    m_totalCachedDataSize -= m_cachedDataSize;
+    m_cachedDataSize = 0;
+}
+
 void WebSession::updateTimestamp()
 {
     m_timestamp = QDateTime::currentMSecsSinceEpoch() / 1000;
@@ -28,13 +28,18 @@
 
 #pragma once
 
+#include <QCache>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QObject>
+#include <QPointer>
 #include <QRegularExpression>
 #include <QSet>
 #include <QTranslator>
+#include <QVector>
 
+#include "api/apicontroller.h"
 #include "api/isessionmanager.h"
 #include "base/http/irequesthandler.h"
 #include "base/http/responsebuilder.h"
@@ -44,31 +49,45 @@
 
 constexpr Utils::Version<int, 3, 2> API_VERSION {2, 2, 0};
 
-class APIController;
+class QTimer;
+
+class SyncController;
 class WebApplication;
 
 constexpr char C_SID[] = "SID"; // name of session id cookie
 constexpr int INACTIVE_TIME = 900; // Session inactive time (in secs = 15 min.)
+constexpr int SESSION_EXPIRY_GRANULARITY = 60; // secs
 
 class WebSession : public ISession
 {
     friend class WebApplication;
 
 public:
-    explicit WebSession(const QString &sid);
+    // `totalCachedDataSize` sums up the data cached by all the sessions
+    WebSession(const QString &sid, qint64 &totalCachedDataSize);
+    ~WebSession() override;
 
     QString id() const override;
     qint64 timestamp() const;
 
     QVariant getData(const QString &id) const override;
     void setData(const QString &id, const QVariant &data) override;
+    void setCachedData(const QString &id, const QVariant &data, qint64 size = -1) override;
+
+    // approximate memory used by the cached data
+    qint64 cachedDataSize() const;
+    void clearCachedData();
 
 private:
     void updateTimestamp();
 
     const QString m_sid;
     qint64 m_timestamp;
+    int m_expirySlot = -1;  // in WebApplication's expiry wheel
     QVariantHash m_data;
+    QHash<QString, qint64> m_cachedDataSizes;
+    qint64 m_cachedDataSize = 0;
+    qint64 &m_totalCachedDataSize;
 };
 
 class WebApplication
@@ -98,6 +117,28 @@ public:
     const Http::Environment &env() const;
 
 private:
+    struct CachedFile
+    {
+        QByteArray data;
+        QByteArray gzipData;  // empty when compression doesn't pay off
+        QString mimeType;
+        QString etag;
+        QString gzipETag;
+        QDateTime lastModified;
+    };
+
+    // A request waiting for changes to report (long polling) or an event stream
+    struct PendingRequest
+    {
+        Http::Request request;
+        Http::Environment env;
+        QString owner;  // session id or client address
+        QPointer<Http::ResponseStream> stream;
+        QElapsedTimer timer;  // since the request has arrived, since the last event for event streams
+        qint64 waitTime;  // milliseconds, 0 for event streams
+    };
+
+    Http::Response handleRequest(const Http::Request &request, const Http::Environment &env);
     void doProcessRequest();
     void configure();
 
@@ -105,13 +146,32 @@ private:
     void declarePublicAPI(const QString &apiPath);
 
     void sendFile(const QString &path);
+    CachedFile readFile(const QString &path, const QDateTime &lastModified);
     void sendWebUIFile();
 
     void translateDocument(QString &data);
 
+    Http::Response sendStreamedResult(Http::Response response);
+
+    // Changes reporting
+    bool isEventStreamRequest(const Http::Request &request) const;
+    Http::Response openEventStream(const Http::Request &request, const Http::Environment &env);
+    void writeEvent(PendingRequest &eventStream, const QByteArray &data);
+    QString pendingRequestOwner() const;
+    int pendingRequestCount(const QString &owner) const;
+    void addPendingRequest(const PendingRequest &pendingRequest);
+    bool runPendingRequest(PendingRequest &pendingRequest);
+    void notifyChange();
+    void processPendingRequests();
+    void checkPendingRequests();
+
     // Session management
     QString generateSid() const;
     void sessionInitialize();
+    void touchSession(WebSession *session);
+    void removeSession(WebSession *session);
+    void expireSessions();
+    void limitSessionData();
     bool isAuthNeeded();
     bool isPublicAPI(const QString &scope, const QString &action) const;
 
@@ -120,27 +180,37 @@ private:
 
     // Persistent data
     QHash<QString, WebSession *> m_sessions;
+    // A timer wheel, each slot holds the sessions last active during one period of
+    // SESSION_EXPIRY_GRANULARITY. The slot the wheel turns to holds the expired sessions.
+    QVector<QSet<WebSession *>> m_sessionExpiryWheel;
+    int m_sessionExpirySlot = 0;
+    QTimer *m_sessionExpiryTimer;
+    qint64 m_sessionDataSize = 0;  // cached by all the sessions
 
     // Current data
     WebSession *m_currentSession = nullptr;
     Http::Request m_request;
     Http::Environment m_env;
     QMap<QString, QString> m_params;
+    bool m_isResultDeferred = false;
+    QStringMap m_resumeParams;
+    // the rest of the result is written while it is being sent
+    StreamedResult m_streamedResult;
     const QString m_cacheID;
 
     const QRegularExpression m_apiPathPattern {(QLatin1String("^/api/v2/(?<scope>[A-Za-z_][A-Za-z_0-9]*)/(?<action>[A-Za-z_][A-Za-z_0-9]*)$"))};
 
     QHash<QString, APIController *> m_apiControllers;
+    SyncController *m_syncController = nullptr;
     QSet<QString> m_publicAPIs;
+    QVector<PendingRequest> m_pendingRequests;
+    QTimer *m_changeTimer;
+    QTimer *m_pendingRequestTimer;
     bool m_isAltUIUsed = false;
     QString m_rootFolder;
 
-    struct TranslatedFile
-    {
-        QByteArray data;
-        QDateTime lastModified;
-    };
-    QHash<QString, TranslatedFile> m_translatedFiles;
+    // the cost is the size of the file data, the least recently used files are dropped
+    QCache<QString, CachedFile> m_cachedFiles;
     QString m_currentLocale;
     QTranslator m_translator;
     bool m_translationFileLoaded = false;
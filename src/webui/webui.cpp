@@ -71,8 +71,11 @@ void WebUI::configure()
         // http server
         const QString serverAddressString = pref->getWebUiAddress();
         if (!m_httpServer) {
-            m_webapp = new WebApplication(this);
-            m_httpServer = new Http::Server(m_webapp, this);
+            if (!m_webapp)
+                m_webapp = new WebApplication(this);
+            // The I/O thread pool can't be resized, so a changed thread count applies after restart.
+            // The server can't be started over here since this is also called from within its requests.
+            m_httpServer = new Http::Server(m_webapp, pref->getWebUiServerThreads(), this);
         }
         else {
             if ((m_httpServer->serverAddress().toString() != serverAddressString)
@@ -10,7 +10,11 @@ HEADERS += \
     $$PWD/api/searchcontroller.h \
     $$PWD/api/synccontroller.h \
     $$PWD/api/torrentscontroller.h \
+    $$PWD/api/torrentsynctracker.h \
     $$PWD/api/transfercontroller.h \
+    $$PWD/api/serialize/cborwriter.h \
+    $$PWD/api/serialize/datawriter.h \
+    $$PWD/api/serialize/jsonwriter.h \
     $$PWD/api/serialize/serialize_torrent.h \
     $$PWD/webapplication.h \
     $$PWD/webui.h
@@ -26,7 +30,11 @@ SOURCES += \
     $$PWD/api/searchcontroller.cpp \
     $$PWD/api/synccontroller.cpp \
     $$PWD/api/torrentscontroller.cpp \
+    $$PWD/api/torrentsynctracker.cpp \
     $$PWD/api/transfercontroller.cpp \
+    $$PWD/api/serialize/cborwriter.cpp \
+    $$PWD/api/serialize/datawriter.cpp \
+    $$PWD/api/serialize/jsonwriter.cpp \
     $$PWD/api/serialize/serialize_torrent.cpp \
     $$PWD/webapplication.cpp \
     $$PWD/webui.cpp
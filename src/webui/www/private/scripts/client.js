@@ -495,6 +495,9 @@ window.addEvent('load', function() {
             $('QueuedIOJobs').set('html', serverState.queued_io_jobs);
             $('AverageTimeInQueue').set('html', serverState.average_time_queue + " ms");
             $('TotalQueuedSize').set('html', friendlyUnit(serverState.total_queued_size, false));
+            $('QueuedResumeData').set('html', serverState.queued_resume_data);
+            $('ResumeDataWritten').set('html', serverState.resume_data_written + " (" + friendlyUnit(serverState.resume_data_bytes_written, false) + ")");
+            $('AverageResumeDataTime').set('html', serverState.average_resume_data_time + " ms");
         }
 
         if (serverState.connection_status == "connected")